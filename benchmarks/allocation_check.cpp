@@ -0,0 +1,206 @@
+// Checks that the operation log macros don't allocate heap memory once
+// they've been warmed up (i.e., their call sites are registered, and the call
+// stack, and output buffers have grown to their usual size).
+//
+// Every macro is run with `PlainTextFormatter`, and `HtmlFormatter` writing to
+// a null stream, directly, and through a `DeferredFormatter`, and with
+// `HtmlViewerFormatter`, for each built-in argument type.  (Only the logging thread's allocations are
+// counted.)  Allocations are counted by
+// the global `operator new` from `benchmark_utils.h`.
+//
+// Usage:
+//
+//     operation_log_allocation_check [--iterations=N]
+//
+// The program prints the allocations per event of each macro, and exits
+// with a non-zero status, if any macro allocated.
+
+#define OPERATION_LOG_ENABLE
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <tuple>
+
+#include <operation_log.h>
+
+#include "benchmark_utils.h"
+
+
+namespace checked_cases
+{
+#include <operation_log/enable.h>
+#include "macro_cases.inc"
+
+// Logs `depth` nested function calls, so the call stack grows.
+template <typename T>
+void nested_enter_function(const T &value, int depth)
+{
+    OPERATION_LOG_ENTER_FUNCTION(value, depth);
+    if (depth > 1)
+    {
+        nested_enter_function(value, depth - 1);
+    }
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+template <typename T>
+void nested_enter_function(const T &value)
+{
+    nested_enter_function(value, 40);
+}
+
+template <typename T>
+void message_stream_open(const T &)
+{
+    OPERATION_LOG_MESSAGE_STREAM_OPEN(message);
+    for (int i = 0; i < 100; ++i)
+    {
+        OPERATION_LOG_MESSAGE_STREAM_WRITE(message, << i << ": " << 0.5 * i << std::endl);
+    }
+    OPERATION_LOG_MESSAGE_STREAM_CLOSE(message);
+}
+}
+
+
+namespace operation_log_benchmarks
+{
+
+class AllocationCheck
+{
+public:
+    AllocationCheck(unsigned long long iterations)
+    : iterations(iterations)
+    {}
+
+    bool has_failed() const
+    {
+        return failure_c > 0;
+    }
+
+    void run_cases(const std::string &configuration)
+    {
+        run_argument_type(configuration, "int", 42);
+        run_argument_type(configuration, "double", 3.14159);
+        run_argument_type(configuration, "string",
+            std::string("A string that doesn't fit in small string storage."));
+        run_argument_type(configuration, "tuple",
+            std::make_tuple(1, 2.5, std::string("three")));
+        run_case(configuration, "MESSAGE", "none",
+            &checked_cases::message<int>, 0);
+        run_case(configuration, "MESSAGE_STREAM", "none",
+            &checked_cases::message_stream<int>, 0);
+        run_case(configuration, "MESSAGE_STREAM_OPEN", "none",
+            &checked_cases::message_stream_open<int>, 0);
+        run_case(configuration, "ENTER_NO_ARG_FUNCTION", "none",
+            &checked_cases::enter_no_arg_function<int>, 0);
+    }
+
+private:
+    unsigned long long iterations;
+    int failure_c = 0;
+
+    template <typename T>
+    void run_argument_type(
+        const std::string &configuration, const std::string &argument_type,
+        const T &value)
+    {
+        run_case(configuration, "ENTER_FUNCTION", argument_type,
+            &checked_cases::enter_function<T>, value);
+        run_case(configuration, "ENTER_FUNCTION (nested)", argument_type,
+            &checked_cases::nested_enter_function<T>, value);
+        run_case(configuration, "DUMP_VARS", argument_type,
+            &checked_cases::dump_vars<T>, value);
+    }
+
+    template <typename T>
+    void run_case(
+        const std::string &configuration, const std::string &macro,
+        const std::string &argument_type, void (*function)(const T &),
+        const T &value)
+    {
+        // Warm up:
+        for (int i = 0; i < 16; ++i)
+        {
+            function(value);
+        }
+
+        unsigned long long start_allocation_count = thread_allocation_count();
+
+        for (unsigned long long i = 0; i < iterations; ++i)
+        {
+            function(value);
+        }
+
+        unsigned long long allocation_count =
+            thread_allocation_count() - start_allocation_count;
+
+        std::cout << std::left <<
+            std::setw(21) << configuration <<
+            std::setw(26) << macro <<
+            std::setw(8) << argument_type <<
+            std::right << std::fixed << std::setprecision(2) <<
+            std::setw(8) << static_cast<double>(allocation_count) / iterations <<
+            " allocs" <<
+            (allocation_count > 0 ? "  FAILED" : "") << std::endl;
+
+        if (allocation_count > 0)
+        {
+            ++failure_c;
+        }
+    }
+};
+
+}
+
+
+int main(int argc, char **argv)
+{
+    using namespace operation_log_benchmarks;
+
+    unsigned long long iterations =
+        std::stoull(get_option(argc, argv, "iterations", "1000"));
+
+    AllocationCheck check(iterations);
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    operation_log::PlainTextFormatter plain_text_formatter(null_stream);
+    operation_log::HtmlFormatter html_formatter(null_stream, "Allocation Check");
+
+    log.set_formatter(plain_text_formatter);
+    check.run_cases("plain_text");
+
+    log.set_formatter(html_formatter);
+    check.run_cases("html");
+
+    {
+        operation_log::HtmlViewerFormatter html_viewer_formatter(null_stream);
+
+        log.set_formatter(html_viewer_formatter);
+        check.run_cases("html_viewer");
+    }
+
+    {
+        operation_log::DeferredFormatter deferred_formatter(plain_text_formatter);
+
+        log.set_formatter(deferred_formatter);
+        check.run_cases("deferred_plain_text");
+    }
+    {
+        operation_log::DeferredFormatter deferred_formatter(html_formatter);
+
+        log.set_formatter(deferred_formatter);
+        check.run_cases("deferred_html");
+    }
+    log.set_formatter(plain_text_formatter);
+
+    if (check.has_failed())
+    {
+        std::cout << "Some macros allocated heap memory." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
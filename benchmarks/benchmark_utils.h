@@ -0,0 +1,267 @@
+#ifndef _OPERATION_LOG_BENCHMARKS_BENCHMARK_UTILS_H
+#define _OPERATION_LOG_BENCHMARKS_BENCHMARK_UTILS_H
+
+// Helpers shared by the operation log benchmark programs.
+//
+// This header replaces the global `operator new` and `operator delete` to count
+// allocations, so it must be included in exactly one translation unit of a
+// program.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+
+namespace operation_log_benchmarks
+{
+
+// Counts the heap allocations made by the current thread.
+inline unsigned long long& thread_allocation_count()
+{
+    static thread_local unsigned long long count = 0;
+
+    return count;
+}
+
+// A stream buffer which discards everything written to it.
+class NullBuffer : public std::streambuf
+{
+public:
+    std::size_t get_byte_count() const
+    {
+        return byte_count;
+    }
+
+protected:
+    int overflow(int ch) override
+    {
+        ++byte_count;
+
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+        byte_count += n;
+
+        return n;
+    }
+
+private:
+    std::size_t byte_count = 0;
+};
+
+// Keeps the compiler from optimizing away the computation of a value.
+template <typename T>
+inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Stopwatch
+{
+public:
+    Stopwatch()
+    : start(std::chrono::steady_clock::now())
+    {}
+
+    double get_elapsed_ns() const
+    {
+        return std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// Writes benchmark results as a JSON object with a `results` array of flat
+// records.
+class JsonResultWriter
+{
+public:
+    JsonResultWriter(const std::string &benchmark_name)
+    : benchmark_name(benchmark_name)
+    {}
+
+    // Starts a new result record.
+    JsonResultWriter& add_result()
+    {
+        records.emplace_back();
+
+        return *this;
+    }
+
+    JsonResultWriter& field(const std::string &name, const std::string &value)
+    {
+        std::stringstream quoted;
+
+        quoted << '"';
+        for (char ch : value)
+        {
+            if (ch == '"' || ch == '\\')
+            {
+                quoted << '\\';
+            }
+            quoted << ch;
+        }
+        quoted << '"';
+
+        return raw_field(name, quoted.str());
+    }
+
+    JsonResultWriter& field(const std::string &name, double value)
+    {
+        std::stringstream formatted;
+
+        formatted << std::setprecision(6) << value;
+
+        return raw_field(name, formatted.str());
+    }
+
+    JsonResultWriter& field(const std::string &name, long long value)
+    {
+        return raw_field(name, std::to_string(value));
+    }
+
+    bool write_file(const std::string &path) const
+    {
+        std::ofstream output(path);
+
+        output << "{" << std::endl <<
+            "  \"benchmark\": \"" << benchmark_name << "\"," << std::endl <<
+            "  \"results\": [" << std::endl;
+        for (std::size_t i = 0; i < records.size(); ++i)
+        {
+            output << "    {" << records[i] << "}" <<
+                (i + 1 < records.size() ? "," : "") << std::endl;
+        }
+        output << "  ]" << std::endl << "}" << std::endl;
+
+        return static_cast<bool>(output);
+    }
+
+private:
+    std::string benchmark_name;
+    std::vector<std::string> records;
+
+    JsonResultWriter& raw_field(const std::string &name, const std::string &value)
+    {
+        std::string &record = records.back();
+
+        if (!record.empty())
+        {
+            record += ", ";
+        }
+        record += "\"" + name + "\": " + value;
+
+        return *this;
+    }
+};
+
+// Returns the value of a `--name=value` command line option, or the default
+// value.
+inline std::string get_option(
+    int argc, char **argv, const std::string &name, const std::string &default_value)
+{
+    std::string prefix = "--" + name + "=";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+
+        if (arg.compare(0, prefix.length(), prefix) == 0)
+        {
+            return arg.substr(prefix.length());
+        }
+    }
+
+    return default_value;
+}
+
+inline std::vector<int> parse_int_list(const std::string &list)
+{
+    std::vector<int> res;
+    std::stringstream input(list);
+    std::string item;
+
+    while (std::getline(input, item, ','))
+    {
+        res.push_back(std::stoi(item));
+    }
+
+    return res;
+}
+
+}
+
+
+// Replace the global allocation functions to count allocations:
+
+void* operator new(std::size_t size)
+{
+    ++operation_log_benchmarks::thread_allocation_count();
+    if (void *res = std::malloc(size ? size : 1))
+    {
+        return res;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    ++operation_log_benchmarks::thread_allocation_count();
+
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+// The replaced `operator new`s above allocate with `std::malloc()`, so the
+// memory is freed with `std::free()`.  (GCC can't see the pairing, and warns
+// about every call.  The warning is new in GCC 11.)
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#    pragma GCC diagnostic pop
+#endif
+
+#endif // _OPERATION_LOG_BENCHMARKS_BENCHMARK_UTILS_H
@@ -0,0 +1,258 @@
+// Logs a mesh, which an iterative algorithm changes a little at a time, as a
+// three.js scene in each iteration, and compares the log size, and the time
+// it takes to write it, when the mesh arrays are embedded in each scene, and
+// when they're written as blobs (see `Blob`), with, and without deltas of the
+// vertex positions.
+//
+// Usage:
+//
+//     operation_log_blob_benchmark [--grid=N] [--iterations=N]
+//         [--moved=PERCENT] [--formatter=html|html_viewer|deferred_html]
+//         [--log=FILE] [--output=FILE]
+//
+// The mesh is an N x N vertex grid, and each iteration moves `--moved`
+// percent of its vertices.  `--log` keeps the log of the last method in a
+// file (otherwise it's only counted).  Results are written to a JSON file
+// (`blob_benchmark.json`, by default).
+
+#define OPERATION_LOG_ENABLE
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <operation_log.h>
+
+#include "benchmark_utils.h"
+
+
+namespace operation_log_benchmarks
+{
+
+struct Options
+{
+    int grid_size;
+    int iteration_c;
+    int moved_percent;
+    std::string formatter;
+    std::string log_path;
+};
+
+struct Mesh
+{
+    std::vector<float> positions;
+    std::vector<std::uint32_t> indices;
+};
+
+Mesh make_grid(int grid_size)
+{
+    Mesh res;
+
+    for (int row = 0; row < grid_size; ++row)
+    {
+        for (int column = 0; column < grid_size; ++column)
+        {
+            res.positions.push_back(static_cast<float>(column));
+            res.positions.push_back(static_cast<float>(row));
+            res.positions.push_back(0.0f);
+        }
+    }
+    for (int row = 0; row + 1 < grid_size; ++row)
+    {
+        for (int column = 0; column + 1 < grid_size; ++column)
+        {
+            std::uint32_t corner = static_cast<std::uint32_t>(row * grid_size + column);
+
+            res.indices.insert(res.indices.end(), {
+                corner, corner + 1, corner + grid_size,
+                corner + 1, corner + grid_size + 1, corner + grid_size });
+        }
+    }
+
+    return res;
+}
+
+enum Method
+{
+    // The arrays are written into each scene:
+    embedded,
+    // The arrays are written as blobs:
+    blobs,
+    // The positions are written as deltas of the previous positions:
+    blob_deltas
+};
+
+const char* get_method_name(Method method)
+{
+    switch (method)
+    {
+        case embedded:    return "embedded";
+        case blobs:       return "blobs";
+        case blob_deltas: return "blob_deltas";
+    }
+
+    return "";
+}
+
+struct RunResult
+{
+    double elapsed_ns;
+    std::size_t output_byte_count;
+};
+
+RunResult run(const Options &options, Method method, bool is_log_kept)
+{
+    NullBuffer null_buffer;
+    std::ofstream log_file;
+    std::ostream null_stream(&null_buffer);
+    std::ostream *output = &null_stream;
+
+    if (is_log_kept)
+    {
+        log_file.open(options.log_path);
+        output = &log_file;
+    }
+
+    std::unique_ptr<operation_log::FormatterBase> formatter;
+    std::unique_ptr<operation_log::DeferredFormatter> deferred_formatter;
+
+    if (options.formatter == "html_viewer")
+    {
+        auto viewer_formatter = new operation_log::HtmlViewerFormatter(*output, "Blobs");
+
+        viewer_formatter->extra_header_code = operation_log::HtmlFormatter::three_js_header_code;
+        formatter.reset(viewer_formatter);
+    }
+    else
+    {
+        auto html_formatter = new operation_log::HtmlFormatter(*output, "Blobs");
+
+        html_formatter->extra_header_code = operation_log::HtmlFormatter::three_js_header_code;
+        formatter.reset(html_formatter);
+    }
+
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+
+    if (options.formatter == "deferred_html")
+    {
+        deferred_formatter.reset(new operation_log::DeferredFormatter(*formatter));
+        log.set_formatter(*deferred_formatter);
+    }
+    else
+    {
+        log.set_formatter(*formatter);
+    }
+
+    Mesh mesh = make_grid(options.grid_size);
+    operation_log::BlobSeries position_series;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::size_t> vertex(0, mesh.positions.size() / 3 - 1);
+    std::uniform_real_distribution<float> offset(-0.05f, 0.05f);
+    std::size_t moved_c = mesh.positions.size() / 3 * options.moved_percent / 100;
+    Stopwatch stopwatch;
+
+    for (int iteration_i = 0; iteration_i < options.iteration_c; ++iteration_i)
+    {
+        for (std::size_t moved_i = 0; moved_i < moved_c; ++moved_i)
+        {
+            mesh.positions[3 * vertex(random) + 2] += offset(random);
+        }
+
+        std::stringstream code;
+
+        code << R"code(
+<script type="text/javascript">
+operation_log_3js.document.addLazySceneView(function ()
+{
+    var camera = new THREE.PerspectiveCamera(70, 1, 0.01, 1000);
+    var scene = new THREE.Scene();
+    var material = new THREE.MeshNormalMaterial();
+    var geometry = )code";
+        if (method == embedded)
+        {
+            operation_log::ThreeJsGeometry::write_buffer_geometry(
+                code, mesh.positions, mesh.indices);
+        }
+        else
+        {
+            operation_log::ThreeJsGeometry::write_shared_buffer_geometry(
+                code, log, mesh.positions, mesh.indices, std::vector<float>(),
+                method == blob_deltas ? &position_series : nullptr);
+        }
+        code << R"code(;
+
+    camera.position.set()code" << options.grid_size / 2 << ", " <<
+            options.grid_size / 2 << ", " << options.grid_size << R"code();
+    scene.add(new THREE.Mesh(geometry, material));
+
+    return new operation_log_3js.SceneView(scene, null, camera);
+});
+</script>
+)code";
+        log.write_html(code.str());
+    }
+    deferred_formatter.reset();
+
+    RunResult res { stopwatch.get_elapsed_ns(), 0 };
+
+    formatter.reset();
+    output->flush();
+    res.output_byte_count = is_log_kept ?
+        static_cast<std::size_t>(log_file.tellp()) :
+        null_buffer.get_byte_count();
+
+    return res;
+}
+
+}
+
+
+int main(int argc, char **argv)
+{
+    using namespace operation_log_benchmarks;
+
+    Options options {
+        std::stoi(get_option(argc, argv, "grid", "100")),
+        std::stoi(get_option(argc, argv, "iterations", "200")),
+        std::stoi(get_option(argc, argv, "moved", "1")),
+        get_option(argc, argv, "formatter", "html"),
+        get_option(argc, argv, "log", "") };
+    std::string output_path = get_option(argc, argv, "output", "blob_benchmark.json");
+    JsonResultWriter results("blobs");
+    const Method methods[] = { embedded, blobs, blob_deltas };
+
+    std::cout << "Grid: " << options.grid_size << " x " << options.grid_size <<
+        ", iterations: " << options.iteration_c <<
+        ", moved vertices: " << options.moved_percent << "%" <<
+        ", formatter: " << options.formatter << std::endl;
+    for (Method method : methods)
+    {
+        bool is_log_kept = !options.log_path.empty() && method == blob_deltas;
+        RunResult res = run(options, method, is_log_kept);
+
+        std::cout << get_method_name(method) << ": " <<
+            res.elapsed_ns / 1e6 << " ms, output " <<
+            res.output_byte_count << " bytes" << std::endl;
+        results.add_result().
+            field("grid_size", static_cast<long long>(options.grid_size)).
+            field("iterations", static_cast<long long>(options.iteration_c)).
+            field("moved_percent", static_cast<long long>(options.moved_percent)).
+            field("formatter", options.formatter).
+            field("method", get_method_name(method)).
+            field("elapsed_ms", res.elapsed_ns / 1e6).
+            field("output_bytes", static_cast<long long>(res.output_byte_count));
+    }
+    if (!results.write_file(output_path))
+    {
+        std::cerr << "Can't write " << output_path << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << output_path << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Checks that a `DeferredFormatter` (see
+// `operation_log/deferred_formatter.h`) writes the events of threads, which
+// have exited, and removes their buffers, so threads, which are started, and
+// exit, don't grow its memory.
+//
+// Usage:
+//
+//     operation_log_deferred_thread_check
+//
+// It exits with 1, if a check fails.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+// Returns the number of times `text` occurs in `s`.
+std::size_t count(const std::string &s, const std::string &text)
+{
+    std::size_t res = 0;
+
+    for (std::size_t p = s.find(text); p != std::string::npos; p = s.find(text, p + 1))
+    {
+        ++res;
+    }
+
+    return res;
+}
+
+}
+
+int main()
+{
+    const int thread_c = 200;
+    std::stringstream log_text;
+    operation_log::PlainTextFormatter target(log_text);
+    std::size_t max_buffer_c = 0;
+
+    {
+        // (Small buffers, so each thread's buffer wraps around.)
+        operation_log::DeferredFormatter formatter(target, 4096);
+
+        for (int thread_i = 0; thread_i < thread_c; ++thread_i)
+        {
+            std::thread thread(
+                [&formatter]()
+                {
+                    for (int message_i = 0; message_i < 100; ++message_i)
+                    {
+                        formatter.write_message("from a short-lived thread");
+                    }
+                });
+
+            thread.join();
+            max_buffer_c = std::max(max_buffer_c, formatter.get_thread_buffer_count());
+        }
+
+        // Wait for the background thread to remove the last buffers:
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+        while (formatter.get_thread_buffer_count() > 0 &&
+            std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        check(
+            formatter.get_thread_buffer_count() == 0,
+            "the buffers of exited threads are removed");
+        check(
+            max_buffer_c < static_cast<std::size_t>(thread_c),
+            "the buffers don't grow with the number of exited threads");
+        formatter.write_message("from the main thread");
+        formatter.flush();
+        check(formatter.get_thread_buffer_count() == 1, "a live thread keeps its buffer");
+    }
+
+    check(
+        count(log_text.str(), "from a short-lived thread") ==
+            static_cast<std::size_t>(thread_c) * 100,
+        "the events of exited threads are written");
+    check(
+        count(log_text.str(), "from the main thread") == 1,
+        "the events of live threads are written");
+
+    std::cout << "at most " << max_buffer_c << " buffers for " << thread_c <<
+        " threads, which exited" << std::endl;
+    if (failure_c == 0)
+    {
+        std::cout << "Deferred thread check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
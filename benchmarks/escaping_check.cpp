@@ -0,0 +1,288 @@
+// Checks the HTML, and string escaping against the character at a time
+// implementations they replaced, on random text, and compares their speed.
+//
+// It's built once with the default instruction set (SSE2 on x86-64), once
+// with AVX2, and once with `OPERATION_LOG_DISABLE_SIMD`, so every search
+// loop is covered.
+//
+// Usage:
+//
+//     operation_log_escaping_check [--cases=N] [--size=BYTES]
+//
+// The program exits with a non-zero status, if any output differs.
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <operation_log/html_utils.h>
+#include <operation_log/value_formatter.h>
+
+#include "benchmark_utils.h"
+
+
+namespace reference
+{
+
+void write_escaped(std::ostream &out, const char *value, std::size_t len)
+{
+    const char *end = value + len;
+    const char *run_begin = value;
+
+    for (const char *p = value; p < end; ++p)
+    {
+        const char *entity;
+
+        switch (*p)
+        {
+            case '&':  entity = "&amp;";       break;
+            case '\"': entity = "&quot;";      break;
+            case '\'': entity = "&apos;";      break;
+            case '<':  entity = "&lt;";        break;
+            case '>':  entity = "&gt;";        break;
+            default:   continue;
+        }
+        out.write(run_begin, p - run_begin);
+        out << entity;
+        run_begin = p + 1;
+    }
+    out.write(run_begin, end - run_begin);
+}
+
+std::string escape(const std::string &value)
+{
+    std::stringstream res;
+
+    write_escaped(res, value.data(), value.length());
+
+    return res.str();
+}
+
+void write_string_text(std::ostream &out, const std::string &value)
+{
+    out << '"';
+    for (const auto &ch : value)
+    {
+        switch (ch)
+        {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\r':
+                out << "\\\r";
+                break;
+            case '\n':
+                out << "\\\n";
+                break;
+            default:
+                out << ch;
+        }
+    }
+    out << '"';
+}
+
+std::string string_to_text(const std::string &value)
+{
+    std::stringstream res;
+
+    write_string_text(res, value);
+
+    return res.str();
+}
+
+std::string string_to_html(const std::string &value)
+{
+    return escape(string_to_text(value));
+}
+
+}
+
+
+namespace operation_log_benchmarks
+{
+
+class EscapingCheck
+{
+public:
+    bool has_failed() const
+    {
+        return failure_c > 0;
+    }
+
+    void check_random_text(int case_c)
+    {
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> length(0, 300);
+        std::uniform_int_distribution<int> special_rate(0, 4);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_int_distribution<int> byte(1, 255);
+        const std::string specials = "&\"'<>\r\n";
+
+        for (int case_i = 0; case_i < case_c && failure_c < 10; ++case_i)
+        {
+            // From no characters to escape, to mostly characters to escape:
+            int rate = special_rate(random) * special_rate(random) * 4;
+            std::string text;
+
+            text.resize(length(random) + (case_i % 10 == 0 ? 4096 : 0));
+            for (char &ch : text)
+            {
+                ch = percent(random) < rate ?
+                    specials[percent(random) % specials.length()] :
+                    static_cast<char>(byte(random));
+            }
+            check(text);
+        }
+    }
+
+    void check(const std::string &text)
+    {
+        operation_log::ValueFormatter<std::string> formatter(text);
+        std::string expected_html = reference::escape(text);
+        std::string expected_string_text = reference::string_to_text(text);
+        std::string expected_string_html = reference::string_to_html(text);
+
+        std::stringstream html;
+
+        operation_log::HtmlUtils::write_escaped(html, text);
+        compare("HtmlUtils::write_escaped", text, expected_html, html.str());
+        compare("HtmlUtils::escape", text, expected_html,
+            operation_log::HtmlUtils::escape(text));
+
+        std::stringstream buffered_html;
+        operation_log::HtmlUtils::EscapingStreamBuffer escaping_buffer(buffered_html);
+        std::ostream escaped_out(&escaping_buffer);
+
+        escaped_out << text;
+        for (char ch : text)
+        {
+            escaped_out.put(ch);
+        }
+        compare("EscapingStreamBuffer", text, expected_html + expected_html,
+            buffered_html.str());
+
+        std::stringstream string_text;
+        std::stringstream string_html;
+
+        formatter.write_text(string_text);
+        formatter.write_html(string_html);
+        compare("string write_text", text, expected_string_text, string_text.str());
+        compare("string to_text", text, expected_string_text, formatter.to_text());
+        compare("string write_html", text, expected_string_html, string_html.str());
+        compare("string to_html", text, expected_string_html, formatter.to_html());
+    }
+
+    // Compares the speed on a large message with a character to escape about
+    // every 100 bytes.
+    void compare_speed(std::size_t size)
+    {
+        std::string text;
+
+        for (std::size_t i = 0; text.length() < size; ++i)
+        {
+            text += "Vertex " + std::to_string(i) + ": " + std::to_string(i * 7919) +
+                ", added to the parallel after the previous vertex, & its face. ";
+        }
+
+        NullBuffer null_buffer;
+        std::ostream null_stream(&null_buffer);
+        operation_log::ValueFormatter<std::string> formatter(text);
+
+        report_speed("write_escaped", text.length(),
+            [&]() { reference::write_escaped(null_stream, text.data(), text.length()); },
+            [&]() { operation_log::HtmlUtils::write_escaped(null_stream, text); });
+        report_speed("string write_text", text.length(),
+            [&]() { reference::write_string_text(null_stream, text); },
+            [&]() { formatter.write_text(null_stream); });
+        report_speed("string to_html", text.length(),
+            [&]() { do_not_optimize(reference::string_to_html(text)); },
+            [&]() { do_not_optimize(formatter.to_html()); });
+    }
+
+private:
+    int failure_c = 0;
+
+    void compare(
+        const std::string &function, const std::string &text,
+        const std::string &expected, const std::string &actual)
+    {
+        if (expected == actual)
+        {
+            return;
+        }
+
+        std::size_t diff_i = 0;
+
+        while (diff_i < expected.length() && diff_i < actual.length() &&
+            expected[diff_i] == actual[diff_i])
+        {
+            ++diff_i;
+        }
+        std::cout << function << ": output differs at byte " << diff_i <<
+            " for a text of " << text.length() << " bytes" << std::endl;
+        ++failure_c;
+    }
+
+    template <typename ReferenceFunction, typename Function>
+    void report_speed(
+        const std::string &name, std::size_t size,
+        ReferenceFunction reference_function, Function function)
+    {
+        double reference_mb_per_s = measure(size, reference_function);
+        double mb_per_s = measure(size, function);
+
+        std::cout << std::left << std::setw(20) << name <<
+            std::right << std::fixed << std::setprecision(0) <<
+            std::setw(8) << reference_mb_per_s << " MB/s before, " <<
+            std::setw(8) << mb_per_s << " MB/s now" << std::endl;
+    }
+
+    template <typename Function>
+    static double measure(std::size_t size, Function function)
+    {
+        const int repetition_c = 20;
+
+        function();
+
+        Stopwatch stopwatch;
+
+        for (int i = 0; i < repetition_c; ++i)
+        {
+            function();
+        }
+
+        return 1e3 * size * repetition_c / stopwatch.get_elapsed_ns();
+    }
+};
+
+}
+
+
+int main(int argc, char **argv)
+{
+    using namespace operation_log_benchmarks;
+
+#ifdef __AVX2__
+    if (!__builtin_cpu_supports("avx2"))
+    {
+        std::cout << "The CPU doesn't support AVX2, skipping." << std::endl;
+        return 0;
+    }
+#endif
+
+    EscapingCheck check;
+
+    check.check_random_text(std::stoi(get_option(argc, argv, "cases", "20000")));
+    check.compare_speed(std::stoul(get_option(argc, argv, "size", "1048576")));
+
+    if (check.has_failed())
+    {
+        std::cout << "Escaped output differs from the reference implementation." << std::endl;
+        return 1;
+    }
+    std::cout << "Escaped output matches the reference implementation." << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Checks that, with `ForkHandling`, processes which `fork()` inside logged
+// functions write separate logs: each child logs to its own file from the
+// top level, without the parent's events, or the parent's output being
+// duplicated, and a `DeferredFormatter` keeps working in the child, and
+// exits cleanly.
+//
+// Usage:
+//
+//     operation_log_fork_check [--log=0|1]
+//
+// The logs are written to the current directory, and removed, unless
+// `--log=1` is given.  It exits with 1, if a check fails.
+
+#define OPERATION_LOG_ENABLE
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+const int worker_c = 3;
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream input(path);
+    std::stringstream res;
+
+    res << input.rdbuf();
+
+    return res.str();
+}
+
+int count(const std::string &text, const std::string &part)
+{
+    int res = 0;
+
+    for (std::size_t position = text.find(part); position != std::string::npos;
+        position = text.find(part, position + 1))
+    {
+        ++res;
+    }
+
+    return res;
+}
+
+__attribute__((noinline))
+void handle_request(int worker_i, int request_i)
+{
+    OPERATION_LOG_ENTER_FUNCTION(worker_i, request_i);
+    OPERATION_LOG_MESSAGE("handled");
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+// Forks the workers, which handle requests, and exit, and returns their
+// process ids.
+__attribute__((noinline))
+std::vector<pid_t> start_workers()
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+
+    std::vector<pid_t> pids;
+
+    OPERATION_LOG_MESSAGE("starting workers");
+    for (int worker_i = 0; worker_i < worker_c; ++worker_i)
+    {
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            for (int request_i = 0; request_i < 2; ++request_i)
+            {
+                handle_request(worker_i, request_i);
+            }
+            // Return, like a worker would (the parent's functions exit
+            // unlogged):
+            pids.clear();
+            break;
+        }
+        pids.push_back(pid);
+    }
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return pids;
+}
+
+bool check_process_files(const std::string &prefix, bool is_log_written)
+{
+    operation_log::ForkHandling::enable_process_files(prefix);
+
+    std::vector<pid_t> pids = start_workers();
+
+    if (pids.empty())
+    {
+        // A worker exits (running the static destructors):
+        return false;
+    }
+    for (pid_t pid : pids)
+    {
+        int status;
+
+        waitpid(pid, &status, 0);
+        check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "a worker exits cleanly");
+    }
+    handle_request(-1, 0);
+
+    std::string parent_path = prefix + "." + std::to_string(getpid()) + ".log";
+    std::string parent_log = read_file(parent_path);
+
+    check(count(parent_log, "start_workers") == 1, "the parent logs start_workers once");
+    check(count(parent_log, "starting workers") == 1, "the parent's message isn't duplicated");
+    check(count(parent_log, "handle_request") == 1, "the parent logs its own request");
+    for (std::size_t worker_i = 0; worker_i < pids.size(); ++worker_i)
+    {
+        std::string path = prefix + "." + std::to_string(pids[worker_i]) + ".log";
+        std::string worker_log = read_file(path);
+        std::string pid_field = " " + std::to_string(pids[worker_i]) + " ";
+
+        check(count(worker_log, "handle_request") == 2, path + " has the worker's requests");
+        check(count(worker_log, "start_workers") == 0, path + " doesn't repeat the parent");
+        check(count(worker_log, "starting workers") == 0, path + " has no parent messages");
+        check(
+            count(worker_log, pid_field + "void ") == 2,
+            path + " starts at the top level, with the worker's id");
+        if (is_log_written)
+        {
+            std::cout << worker_log;
+        }
+        else
+        {
+            std::remove(path.c_str());
+        }
+    }
+    if (is_log_written)
+    {
+        std::cout << parent_log;
+    }
+    else
+    {
+        std::remove(parent_path.c_str());
+    }
+
+    return true;
+}
+
+// Logs through a `DeferredFormatter` to an HTML file, whose footer the
+// worker mustn't write.
+void check_deferred_formatter(const std::string &path)
+{
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+    std::ofstream *output = new std::ofstream(path);
+    operation_log::HtmlFormatter *html_formatter = new operation_log::HtmlFormatter(*output);
+    operation_log::DeferredFormatter *formatter =
+        new operation_log::DeferredFormatter(*html_formatter);
+    std::string worker_path = path + ".worker";
+
+    log.set_formatter(*formatter);
+    operation_log::ForkHandling::enable(
+        [worker_path](operation_log::DefaultOperationLog &log)
+        {
+            // The inherited formatter is still usable (its output is
+            // dropped), and a new one works too:
+            static std::ofstream worker_output(worker_path);
+            static operation_log::PlainTextFormatter worker_target(worker_output);
+            static operation_log::DeferredFormatter worker_formatter(worker_target);
+
+            log.set_formatter(worker_formatter);
+        });
+
+    handle_request(0, 0);
+
+    pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        handle_request(1, 0);
+        // The static destructors stop the background threads:
+        std::exit(0);
+    }
+
+    int status;
+
+    waitpid(pid, &status, 0);
+    check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "the worker exits cleanly");
+    handle_request(0, 1);
+    // Log nowhere, once the formatters are destroyed:
+    static std::ostream null_output(nullptr);
+    static operation_log::PlainTextFormatter null_formatter(null_output);
+
+    log.set_formatter(null_formatter);
+    delete formatter;
+    delete html_formatter;
+    delete output;
+    operation_log::ForkHandling::disable();
+
+    std::string html = read_file(path);
+    std::string worker_log = read_file(worker_path);
+
+    check(count(html, "</html>") == 1, "the HTML footer is written once");
+    check(count(html, "handle_request") == 2, "the parent's HTML log has its requests");
+    check(count(worker_log, "handle_request") == 1, "the worker's deferred log is written");
+    std::remove(path.c_str());
+    std::remove(worker_path.c_str());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    bool is_log_written = argc > 1 && std::string(argv[1]) == "--log=1";
+    std::string prefix = "fork_check";
+
+    if (!check_process_files(prefix, is_log_written))
+    {
+        return 0;
+    }
+    check_deferred_formatter("fork_check.html");
+    if (failure_c == 0)
+    {
+        std::cout << "Fork check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
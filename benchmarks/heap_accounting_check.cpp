@@ -0,0 +1,187 @@
+// Checks that heap allocations are attributed to the innermost logged
+// function (see `operation_log/heap_accounting.h`), inclusively, and
+// exclusively, and that the operation log's own allocations aren't counted.
+// Then, measures the cost of a counted allocation.
+//
+// Usage:
+//
+//     operation_log_heap_accounting_check [--log=0|1]
+//
+// `--log=1` writes the log, and the report of each function's totals to the
+// standard output.  The check is built with the `operator new` hooks, and
+// (as `operation_log_heap_accounting_check_malloc`) with the `malloc()`
+// hooks, and both again as C++17 (`..._cpp17`), which allocates an
+// over-aligned type with the aligned `operator new`.  It exits with 1, if a
+// check fails.
+
+#define OPERATION_LOG_ENABLE
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <operation_log.h>
+#include <operation_log/account_allocations.h>
+
+
+namespace
+{
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+void check_function(
+    const std::string &function_name, long long call_c,
+    long long inclusive_allocation_c, long long inclusive_byte_c,
+    long long exclusive_allocation_c, long long exclusive_byte_c)
+{
+    for (const operation_log::HeapFunctionTotals &totals :
+        operation_log::HeapAccounting::list_functions())
+    {
+        if (totals.function_name != function_name)
+        {
+            continue;
+        }
+        check(totals.call_c == call_c, function_name + " calls");
+        check(
+            totals.inclusive.allocation_c == inclusive_allocation_c,
+            function_name + " inclusive allocations");
+        check(totals.inclusive.byte_c == inclusive_byte_c, function_name + " inclusive bytes");
+        check(
+            totals.exclusive.allocation_c == exclusive_allocation_c,
+            function_name + " exclusive allocations");
+        check(totals.exclusive.byte_c == exclusive_byte_c, function_name + " exclusive bytes");
+
+        return;
+    }
+    check(false, function_name + " is reported");
+}
+
+__attribute__((noinline))
+void release(char *bytes)
+{
+    delete[] bytes;
+}
+
+#ifdef __cpp_aligned_new
+
+struct alignas(64) CacheLine
+{
+    char bytes[64];
+};
+
+__attribute__((noinline))
+void release(CacheLine *cache_lines)
+{
+    delete[] cache_lines;
+}
+
+const long long aligned_new_c = 1;
+
+#else // __cpp_aligned_new
+
+const long long aligned_new_c = 0;
+
+#endif // __cpp_aligned_new
+
+__attribute__((noinline))
+void allocate_leaf(int byte_c)
+{
+    OPERATION_LOG_ENTER_FUNCTION(byte_c);
+
+    // (The messages are formatted by the log, so they aren't counted.)
+    OPERATION_LOG_MESSAGE_STREAM(<< "Allocating " << byte_c << " bytes.");
+    release(new char[byte_c]);
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+__attribute__((noinline))
+void allocate_tree()
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+
+    release(new char[100]);
+    allocate_leaf(50);
+    allocate_leaf(25);
+#ifdef __cpp_aligned_new
+    release(new CacheLine[2]);
+#endif // __cpp_aligned_new
+    // C allocations are only counted by the `malloc()` hooks:
+    std::free(std::malloc(1000));
+
+    void *aligned = nullptr;
+
+    if (posix_memalign(&aligned, 64, 500) == 0)
+    {
+        std::free(aligned);
+    }
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    bool is_log_written = argc > 1 && std::string(argv[1]) == "--log=1";
+    std::stringstream null_log;
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+
+    if (!is_log_written)
+    {
+        log.set_output_stream(null_log);
+    }
+
+    allocate_tree();
+
+#ifdef OPERATION_LOG_ACCOUNT_MALLOC
+    const long long c_allocation_c = 1;
+#else // OPERATION_LOG_ACCOUNT_MALLOC
+    const long long c_allocation_c = 0;
+#endif // OPERATION_LOG_ACCOUNT_MALLOC
+
+    check_function("{anonymous}::allocate_leaf", 2, 2, 75, 2, 75);
+    check_function(
+        "{anonymous}::allocate_tree", 1,
+        3 + aligned_new_c + 2 * c_allocation_c,
+        175 + 128 * aligned_new_c + 1500 * c_allocation_c,
+        1 + aligned_new_c + 2 * c_allocation_c,
+        100 + 128 * aligned_new_c + 1500 * c_allocation_c);
+
+    // Measure an allocation, and its release outside of logged functions:
+    const int allocation_c = 1000000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int allocation_i = 0; allocation_i < allocation_c; ++allocation_i)
+    {
+        release(new char[16]);
+    }
+
+    double ns_per_allocation = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / allocation_c;
+
+    if (is_log_written)
+    {
+        std::cout << std::endl;
+        operation_log::HeapAccounting::write_report(std::cout);
+    }
+    std::cout << ns_per_allocation << " ns per counted allocation" << std::endl;
+    if (failure_c == 0)
+    {
+        std::cout << "Heap accounting check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+// Logs the calls of functions compiled with `-finstrument-functions` (see
+// `operation_log/instrument_functions.h`), and measures their cost in
+// nanoseconds per call, when the functions are disabled (by the master
+// switch), and when they're logged by `PlainTextFormatter` to a null stream.
+//
+// Usage:
+//
+//     operation_log_instrument_functions_benchmark [--depth=N]
+//         [--output=FILE]
+//
+// It first writes a short log of a few kinds of functions (templates,
+// lambdas, operators, and functions in anonymous namespaces) to the standard
+// output, and then calls a recursive function with `--depth` levels.
+// Results are written to a JSON file (`instrument_functions_benchmark.json`,
+// by default).
+
+#define OPERATION_LOG_ENABLE
+
+#include <iostream>
+#include <string>
+
+#include <operation_log.h>
+#include <operation_log/instrument_functions.h>
+
+#include "benchmark_utils.h"
+
+
+namespace operation_log_benchmarks
+{
+
+template <typename T>
+class Vector2
+{
+public:
+    Vector2(T x, T y)
+    : x(x),
+    y(y)
+    {}
+
+    Vector2 operator+(const Vector2 &other) const
+    {
+        return Vector2(x + other.x, y + other.y);
+    }
+
+    T get_length_squared() const
+    {
+        return x * x + y * y;
+    }
+
+private:
+    T x;
+    T y;
+};
+
+namespace
+{
+
+__attribute__((noinline))
+int fibonacci(int n)
+{
+    return n < 2 ? n : fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+}
+
+__attribute__((noinline))
+double sum_lengths()
+{
+    Vector2<double> sum(1, 2);
+    auto add = [&](double x, double y) { sum = sum + Vector2<double>(x, y); };
+
+    add(3, 4);
+    add(5, 6);
+
+    return sum.get_length_squared();
+}
+
+double measure_ns_per_call(int depth)
+{
+    // `fibonacci(n)` makes `2 * fibonacci(n + 1) - 1` calls:
+    long long call_c = 0;
+    int previous = 0;
+    int current = 1;
+
+    for (int i = 0; i <= depth; ++i)
+    {
+        int next = previous + current;
+
+        previous = current;
+        current = next;
+    }
+    call_c = 2LL * previous - 1;
+
+    // (The compiler may find that `fibonacci()` has no side effects, and
+    // call it once for both measurements otherwise.)
+    volatile int volatile_depth = depth;
+    Stopwatch stopwatch;
+
+    do_not_optimize(fibonacci(volatile_depth));
+
+    return stopwatch.get_elapsed_ns() / call_c;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    using namespace operation_log_benchmarks;
+
+    int depth = std::stoi(get_option(argc, argv, "depth", "25"));
+    std::string output_path =
+        get_option(argc, argv, "output", "instrument_functions_benchmark.json");
+
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+    operation_log::CallSiteRegistry &registry = operation_log::CallSiteRegistry::get();
+
+    // Show what the instrumented functions look like in the log:
+    do_not_optimize(sum_lengths());
+    do_not_optimize(fibonacci(2));
+
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    operation_log::PlainTextFormatter null_formatter(null_stream);
+    JsonResultWriter results("instrument_functions");
+
+    auto &formatter = log.get_formatter();
+
+    log.set_formatter(null_formatter);
+
+    registry.set_master_enabled(false);
+
+    double disabled_ns = measure_ns_per_call(depth);
+
+    registry.set_master_enabled(true);
+
+    double logged_ns = measure_ns_per_call(depth);
+    long long byte_c = static_cast<long long>(null_buffer.get_byte_count());
+
+    log.set_formatter(formatter);
+
+    std::cout << std::endl <<
+        "disabled: " << disabled_ns << " ns/call" << std::endl <<
+        "plain_text: " << logged_ns << " ns/call (" << byte_c << " bytes)" << std::endl;
+    results.add_result().
+        field("configuration", "disabled").
+        field("ns_per_call", disabled_ns);
+    results.add_result().
+        field("configuration", "plain_text").
+        field("ns_per_call", logged_ns).
+        field("bytes", byte_c);
+
+    return results.write_file(output_path) ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+// Checks that the instrumented locks (see `operation_log/instrumented_mutex.h`)
+// record their waits, and condition variable waits, in the innermost logged
+// function, and log those above the threshold (on the thread, which logs,
+// also for other threads).  Then, measures the cost of
+// an uncontended lock, and unlock, compared to `std::mutex`.
+//
+// Usage:
+//
+//     operation_log_lock_contention_check [--log=0|1]
+//
+// `--log=1` writes the log, and the contention report to the standard output.
+// It's built as C++17, for `SharedMutex`.  It exits with 1, if a check fails.
+
+#define OPERATION_LOG_ENABLE
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+const long long min_wait_ns = 10000000;
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+operation_log::LockContentionTotals find_lock(
+    const std::string &lock_name, const std::string &function_name)
+{
+    for (const operation_log::LockContentionTotals &totals :
+        operation_log::LockContention::list_locks())
+    {
+        if (totals.lock_name == lock_name && totals.function_name == function_name)
+        {
+            return totals;
+        }
+    }
+    check(false, lock_name + " in " + function_name + " is reported");
+
+    return operation_log::LockContentionTotals();
+}
+
+// Holds a lock on another (not logged) thread, until it's released.
+template <typename MutexT>
+class BackgroundHolder
+{
+public:
+    BackgroundHolder(MutexT &mutex, int hold_ms)
+    : thread(
+        [&mutex, hold_ms, this]()
+        {
+            std::lock_guard<MutexT> lock(mutex);
+
+            is_held = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(hold_ms));
+        })
+    {
+        while (!is_held)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    ~BackgroundHolder()
+    {
+        thread.join();
+    }
+
+private:
+    std::atomic<bool> is_held { false };
+    std::thread thread;
+};
+
+__attribute__((noinline))
+void wait_for_mutex(operation_log::Mutex &mutex)
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+
+    BackgroundHolder<operation_log::Mutex> holder(mutex, 30);
+    std::lock_guard<operation_log::Mutex> lock(mutex);
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+__attribute__((noinline))
+void wait_for_shared_mutex(operation_log::SharedMutex &mutex)
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+
+    BackgroundHolder<operation_log::SharedMutex> holder(mutex, 30);
+    std::shared_lock<operation_log::SharedMutex> lock(mutex);
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+__attribute__((noinline))
+void wait_for_condition(operation_log::Mutex &mutex, operation_log::ConditionVariable &condition)
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+
+    bool is_ready = false;
+    std::thread notifier(
+        [&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            std::lock_guard<operation_log::Mutex> lock(mutex);
+
+            is_ready = true;
+            condition.notify_one();
+        });
+    std::unique_lock<operation_log::Mutex> lock(mutex);
+
+    condition.wait(lock, [&is_ready]() { return is_ready; });
+    lock.unlock();
+    notifier.join();
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+__attribute__((noinline))
+void log_message(const char *text)
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+    OPERATION_LOG_MESSAGE(text);
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+template <typename MutexT>
+double measure_ns_per_lock(MutexT &mutex, int lock_c)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int lock_i = 0; lock_i < lock_c; ++lock_i)
+    {
+        mutex.lock();
+        mutex.unlock();
+    }
+
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / lock_c;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    using operation_log::LockContention;
+    using operation_log::LockContentionTotals;
+
+    bool is_log_written = argc > 1 && std::string(argv[1]) == "--log=1";
+    std::stringstream log_text;
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+
+    log.set_output_stream(log_text);
+
+    operation_log::Mutex queue_mutex("queue_mutex");
+    operation_log::SharedMutex table_mutex("table_mutex");
+    operation_log::ConditionVariable ready_condition("ready_condition");
+
+    wait_for_mutex(queue_mutex);
+    wait_for_shared_mutex(table_mutex);
+    wait_for_condition(queue_mutex, ready_condition);
+
+    LockContentionTotals mutex_totals = find_lock("queue_mutex", "{anonymous}::wait_for_mutex");
+    LockContentionTotals shared_totals =
+        find_lock("table_mutex", "{anonymous}::wait_for_shared_mutex");
+    LockContentionTotals condition_totals =
+        find_lock("ready_condition", "{anonymous}::wait_for_condition");
+
+    check(mutex_totals.wait_c == 1, "queue_mutex waits");
+    check(mutex_totals.wait_ns >= min_wait_ns, "queue_mutex wait time");
+    check(mutex_totals.hold_c == 1, "queue_mutex contended hold is measured");
+    check(shared_totals.wait_c == 1, "table_mutex shared waits");
+    check(shared_totals.wait_ns >= min_wait_ns, "table_mutex shared wait time");
+    check(condition_totals.condition_wait_c >= 1, "ready_condition waits");
+    check(condition_totals.condition_wait_ns >= min_wait_ns, "ready_condition wait time");
+    check(
+        log_text.str().find("contention = queue_mutex: lock wait ") != std::string::npos,
+        "the queue_mutex wait is logged");
+    check(
+        log_text.str().find("contention = table_mutex: shared lock wait ") != std::string::npos,
+        "the table_mutex wait is logged");
+
+    // A thread, which doesn't log, waits for a lock.  Its event is queued,
+    // and logged by this thread:
+    operation_log::Mutex work_mutex("work_mutex");
+
+    {
+        BackgroundHolder<operation_log::Mutex> holder(work_mutex, 30);
+        std::thread worker(
+            [&work_mutex]()
+            {
+                std::lock_guard<operation_log::Mutex> lock(work_mutex);
+            });
+
+        worker.join();
+    }
+    check(
+        LockContention::has_pending_events() &&
+            log_text.str().find("contention = work_mutex: lock wait ") == std::string::npos,
+        "another thread's wait is queued, rather than logged by that thread");
+    log_message("after the worker");
+    check(
+        !LockContention::has_pending_events() &&
+            log_text.str().find("contention = work_mutex: lock wait ") != std::string::npos,
+        "another thread's wait is logged by the thread, which logs");
+
+    if (is_log_written)
+    {
+        std::cout << log_text.str() << std::endl;
+        LockContention::write_report(std::cout);
+        std::cout << std::endl;
+    }
+
+    // Measure uncontended locks:
+    const int lock_c = 10000000;
+    std::mutex plain_mutex;
+    operation_log::Mutex instrumented_mutex("instrumented_mutex");
+
+    measure_ns_per_lock(plain_mutex, lock_c);
+
+    double plain_ns = measure_ns_per_lock(plain_mutex, lock_c);
+    double instrumented_ns = measure_ns_per_lock(instrumented_mutex, lock_c);
+
+    LockContention::set_all_holds_measured(true);
+
+    double all_holds_ns = measure_ns_per_lock(instrumented_mutex, lock_c);
+
+    std::cout << "uncontended lock, and unlock: std::mutex: " << plain_ns <<
+        " ns, Mutex: " << instrumented_ns << " ns, measuring all holds: " << all_holds_ns <<
+        " ns" << std::endl;
+    if (failure_c == 0)
+    {
+        std::cout << "Lock contention check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
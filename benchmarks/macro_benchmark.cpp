@@ -0,0 +1,340 @@
+// Measures the cost of each operation log macro in nanoseconds, and heap
+// allocations per event, for the following configurations:
+//
+// * compiled_out: The macros are compiled out with `disable.h`.
+// * filtered: The macros are compiled in, but their call sites are disabled.
+// * plain_text: Events are formatted by `PlainTextFormatter` to a null stream.
+// * html: Events are formatted by `HtmlFormatter` to a null stream.
+// * deferred_plain_text, deferred_html: Events are recorded by a
+//   `DeferredFormatter`, and formatted on its background thread.  (Only the
+//   logging thread's time, and allocations are measured.)
+//
+// Usage:
+//
+//     operation_log_macro_benchmark [--output=FILE] [--threads=1,2,4]
+//         [--min-time-ms=MS]
+//
+// Results are written to a JSON file (`macro_benchmark.json`, by default).
+//
+// The operation log formatters aren't thread-safe, so the formatting
+// configurations only run on a single thread.
+
+#define OPERATION_LOG_ENABLE
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <operation_log.h>
+
+#include "benchmark_utils.h"
+
+
+namespace operation_log
+{
+
+// A value formatter for the large container case.
+template <>
+class ValueFormatter<std::vector<double>> : public ValueFormatterI
+{
+    private:
+
+    const std::vector<double> &value;
+
+    public:
+
+    ValueFormatter(const std::vector<double> &value)
+    : value(value)
+    {}
+
+    std::string to_text() override
+    {
+        std::stringstream res;
+
+        res << "[";
+        for (std::size_t i = 0; i < value.size(); ++i)
+        {
+            res << (i > 0 ? ", " : "") << value[i];
+        }
+        res << "]";
+
+        return res.str();
+    }
+
+    std::string to_html() override
+    {
+        return HtmlUtils::escape(to_text());
+    }
+};
+
+}
+
+
+namespace compiled_out_cases
+{
+#include <operation_log/disable.h>
+#include "macro_cases.inc"
+}
+
+namespace enabled_cases
+{
+#include <operation_log/enable.h>
+#include "macro_cases.inc"
+}
+
+
+namespace operation_log_benchmarks
+{
+
+struct Arguments
+{
+    int int_value = 42;
+    double double_value = 3.14159;
+    std::string string_value = "A string that doesn't fit in small string storage.";
+    std::tuple<int, double, std::string> tuple_value =
+        std::make_tuple(1, 2.5, std::string("three"));
+    std::vector<double> container_value = std::vector<double>(1000, 0.5);
+};
+
+struct Measurement
+{
+    unsigned long long iterations;
+    double ns_per_event;
+    double allocations_per_event;
+};
+
+class MacroBenchmark
+{
+public:
+    MacroBenchmark(double min_time_ns, JsonResultWriter &results)
+    : min_time_ns(min_time_ns),
+    results(results)
+    {}
+
+    // Runs every macro case of the given namespace for every argument type.
+    template <class Cases>
+    void run_cases(
+        const std::string &configuration, const std::vector<int> &thread_counts)
+    {
+        for (int thread_count : thread_counts)
+        {
+            run_argument_types<Cases>(configuration, thread_count);
+            run_case(configuration, "MESSAGE", "none", thread_count,
+                &Cases::template message<int>, arguments.int_value);
+            run_case(configuration, "MESSAGE_STREAM", "none", thread_count,
+                &Cases::template message_stream<int>, arguments.int_value);
+            run_case(configuration, "ENTER_NO_ARG_FUNCTION", "none", thread_count,
+                &Cases::template enter_no_arg_function<int>, arguments.int_value);
+        }
+    }
+
+private:
+    double min_time_ns;
+    JsonResultWriter &results;
+    Arguments arguments;
+
+    template <class Cases>
+    void run_argument_types(const std::string &configuration, int thread_count)
+    {
+        run_argument_type<Cases>(configuration, "int", thread_count, arguments.int_value);
+        run_argument_type<Cases>(configuration, "double", thread_count, arguments.double_value);
+        run_argument_type<Cases>(configuration, "string", thread_count, arguments.string_value);
+        run_argument_type<Cases>(configuration, "tuple", thread_count, arguments.tuple_value);
+        run_argument_type<Cases>(configuration, "container", thread_count, arguments.container_value);
+    }
+
+    template <class Cases, typename T>
+    void run_argument_type(
+        const std::string &configuration, const std::string &argument_type,
+        int thread_count, const T &value)
+    {
+        run_case(configuration, "ENTER_FUNCTION", argument_type, thread_count,
+            &Cases::template enter_function<T>, value);
+        run_case(configuration, "DUMP_VARS", argument_type, thread_count,
+            &Cases::template dump_vars<T>, value);
+    }
+
+    template <typename T>
+    void run_case(
+        const std::string &configuration, const std::string &macro,
+        const std::string &argument_type, int thread_count,
+        void (*function)(const T &), const T &value)
+    {
+        // Warm up (e.g., register the call sites), and find an iteration
+        // count that runs for long enough:
+        unsigned long long iterations = 1;
+
+        while (measure(function, value, iterations).ns_per_event * iterations < min_time_ns)
+        {
+            iterations *= 2;
+        }
+
+        Measurement measurement;
+
+        if (thread_count == 1)
+        {
+            measurement = measure(function, value, iterations);
+        }
+        else
+        {
+            std::vector<std::thread> threads;
+            std::vector<Measurement> thread_measurements(thread_count);
+
+            for (int thread_i = 0; thread_i < thread_count; ++thread_i)
+            {
+                threads.emplace_back([&, thread_i]() {
+                    thread_measurements[thread_i] = measure(function, value, iterations);
+                });
+            }
+
+            measurement = Measurement { iterations, 0, 0 };
+            for (int thread_i = 0; thread_i < thread_count; ++thread_i)
+            {
+                threads[thread_i].join();
+                measurement.ns_per_event +=
+                    thread_measurements[thread_i].ns_per_event / thread_count;
+                measurement.allocations_per_event +=
+                    thread_measurements[thread_i].allocations_per_event / thread_count;
+            }
+        }
+
+        std::cout << std::left <<
+            std::setw(21) << configuration <<
+            std::setw(24) << macro <<
+            std::setw(11) << argument_type <<
+            std::right <<
+            std::setw(3) << thread_count << " threads" <<
+            std::setw(12) << std::fixed << std::setprecision(1) <<
+                measurement.ns_per_event << " ns" <<
+            std::setw(8) << std::setprecision(2) <<
+                measurement.allocations_per_event << " allocs" << std::endl;
+
+        results.add_result().
+            field("configuration", configuration).
+            field("macro", macro).
+            field("argument_type", argument_type).
+            field("threads", static_cast<long long>(thread_count)).
+            field("iterations", static_cast<long long>(measurement.iterations)).
+            field("ns_per_event", measurement.ns_per_event).
+            field("allocations_per_event", measurement.allocations_per_event);
+    }
+
+    template <typename T>
+    static Measurement measure(
+        void (*function)(const T &), const T &value,
+        unsigned long long iterations)
+    {
+        unsigned long long start_allocation_count = thread_allocation_count();
+        Stopwatch stopwatch;
+
+        for (unsigned long long i = 0; i < iterations; ++i)
+        {
+            function(value);
+            do_not_optimize(i);
+        }
+
+        double elapsed_ns = stopwatch.get_elapsed_ns();
+
+        return Measurement {
+            iterations,
+            elapsed_ns / iterations,
+            static_cast<double>(thread_allocation_count() - start_allocation_count) /
+                iterations };
+    }
+};
+
+// Wraps the case function templates of a namespace in a class, so they can
+// be passed as a template argument.
+#define OPERATION_LOG_BENCHMARK_CASES(class_name, cases_namespace) \
+    struct class_name \
+    { \
+        template <typename T> \
+        static void enter_no_arg_function(const T &value) \
+        { \
+            cases_namespace::enter_no_arg_function(value); \
+        } \
+        template <typename T> \
+        static void enter_function(const T &value) \
+        { \
+            cases_namespace::enter_function(value); \
+        } \
+        template <typename T> \
+        static void dump_vars(const T &value) \
+        { \
+            cases_namespace::dump_vars(value); \
+        } \
+        template <typename T> \
+        static void message(const T &value) \
+        { \
+            cases_namespace::message(value); \
+        } \
+        template <typename T> \
+        static void message_stream(const T &value) \
+        { \
+            cases_namespace::message_stream(value); \
+        } \
+    };
+
+OPERATION_LOG_BENCHMARK_CASES(CompiledOutCases, compiled_out_cases)
+OPERATION_LOG_BENCHMARK_CASES(EnabledCases, enabled_cases)
+
+}
+
+
+int main(int argc, char **argv)
+{
+    using namespace operation_log_benchmarks;
+
+    std::string output_path = get_option(argc, argv, "output", "macro_benchmark.json");
+    std::vector<int> thread_counts =
+        parse_int_list(get_option(argc, argv, "threads", "1,2,4"));
+    double min_time_ns =
+        std::stod(get_option(argc, argv, "min-time-ms", "50")) * 1e6;
+
+    JsonResultWriter results("macro");
+    MacroBenchmark benchmark(min_time_ns, results);
+    operation_log::CallSiteRegistry &registry = operation_log::CallSiteRegistry::get();
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+
+    NullBuffer null_buffer;
+    std::ostream null_stream(&null_buffer);
+    operation_log::PlainTextFormatter plain_text_formatter(null_stream);
+    operation_log::HtmlFormatter html_formatter(null_stream, "Benchmark");
+
+    benchmark.run_cases<CompiledOutCases>("compiled_out", thread_counts);
+
+    registry.set_enabled("enabled_cases::*", false);
+    benchmark.run_cases<EnabledCases>("filtered", thread_counts);
+    registry.set_enabled("enabled_cases::*", true);
+
+    log.set_formatter(plain_text_formatter);
+    benchmark.run_cases<EnabledCases>("plain_text", { 1 });
+
+    log.set_formatter(html_formatter);
+    benchmark.run_cases<EnabledCases>("html", { 1 });
+
+    {
+        operation_log::DeferredFormatter deferred_formatter(plain_text_formatter);
+
+        log.set_formatter(deferred_formatter);
+        benchmark.run_cases<EnabledCases>("deferred_plain_text", { 1 });
+    }
+    {
+        operation_log::DeferredFormatter deferred_formatter(html_formatter);
+
+        log.set_formatter(deferred_formatter);
+        benchmark.run_cases<EnabledCases>("deferred_html", { 1 });
+    }
+    log.set_formatter(plain_text_formatter);
+
+    if (!results.write_file(output_path))
+    {
+        std::cerr << "Can't write " << output_path << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << output_path << std::endl;
+
+    return 0;
+}
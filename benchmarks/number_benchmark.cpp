@@ -0,0 +1,219 @@
+// Compares `NumberFormatter` with the ways values used to be formatted:
+// `std::to_string()` (`ValueFormatterBase::to_text()`), `snprintf()` with the
+// `std::to_string()` formats (`ValueFormatterBase::write_text()`), and a
+// `std::stringstream` per value (the `operator <<` path).
+//
+// For each method, and value type it reports the nanoseconds, and heap
+// allocations per value, the output bytes per value, and the fraction of
+// values that read back exactly.
+//
+// Usage:
+//
+//     operation_log_number_benchmark [--iterations=N] [--output=FILE]
+//
+// Results are written to a JSON file (`number_benchmark.json`, by default).
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <operation_log/number_formatter.h>
+
+#include "benchmark_utils.h"
+
+
+namespace operation_log_benchmarks
+{
+
+// Coordinates, and angles, like the ones in the sphere tessellation log:
+std::vector<double> make_double_values()
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+    std::vector<double> res;
+
+    for (int i = 0; i < 1024; ++i)
+    {
+        double latitude = angle(random) / 2;
+        double longitude = angle(random);
+
+        res.push_back(i % 2 ? longitude / M_PI : 10 * std::cos(latitude) * std::sin(longitude));
+    }
+
+    return res;
+}
+
+std::vector<long long> make_integer_values()
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<long long> magnitude(0, 18);
+    std::vector<long long> res;
+
+    for (int i = 0; i < 1024; ++i)
+    {
+        long long value = static_cast<long long>(std::pow(10.0, magnitude(random))) + i;
+
+        res.push_back(i % 3 ? value : -value);
+    }
+
+    return res;
+}
+
+bool reads_back(const std::string &text, double value)
+{
+    return std::strtod(text.c_str(), nullptr) == value;
+}
+
+bool reads_back(const std::string &text, long long value)
+{
+    return std::strtoll(text.c_str(), nullptr, 10) == value;
+}
+
+class NumberBenchmark
+{
+public:
+    NumberBenchmark(unsigned long long iterations)
+    : iterations(iterations),
+      null_stream(&null_buffer),
+      results("number_formatting")
+    {}
+
+    template <typename T>
+    void run_methods(const std::string &value_type, const std::vector<T> &values)
+    {
+        run(value_type, "std::to_string", values, [](std::ostream &out, T value) {
+            std::string text = std::to_string(value);
+
+            out.write(text.data(), text.size());
+        });
+        run(value_type, "snprintf", values, [](std::ostream &out, T value) {
+            char buffer[64];
+            int length = std::snprintf(
+                buffer, sizeof(buffer), std::is_integral<T>::value ? "%lld" : "%f", value);
+
+            out.write(buffer, length);
+        });
+        run(value_type, "stringstream", values, [](std::ostream &out, T value) {
+            std::stringstream text;
+
+            text << value;
+            out << text.rdbuf();
+        });
+        run(value_type, "NumberFormatter", values, [](std::ostream &out, T value) {
+            operation_log::NumberFormatter::write(out, value);
+        });
+        if (!std::is_integral<T>::value)
+        {
+            run(value_type, "NumberFormatter (fixed 6)", values, [](std::ostream &out, T value) {
+                char buffer[operation_log::NumberFormatter::get_buffer_size<T>()];
+
+                out.write(buffer, operation_log::NumberFormatter::format(
+                    buffer, value,
+                    operation_log::NumberFormat(operation_log::NumberFormat::fixed, 6)));
+            });
+        }
+    }
+
+    bool write_results(const std::string &path) const
+    {
+        return results.write_file(path);
+    }
+
+private:
+    unsigned long long iterations;
+    NullBuffer null_buffer;
+    std::ostream null_stream;
+    JsonResultWriter results;
+
+    template <typename T, typename FormatFunction>
+    void run(
+        const std::string &value_type, const std::string &method,
+        const std::vector<T> &values, FormatFunction format)
+    {
+        // Check how many values read back exactly:
+        std::size_t exact_c = 0;
+
+        for (T value : values)
+        {
+            std::stringstream text;
+
+            format(text, value);
+            exact_c += reads_back(text.str(), value);
+        }
+
+        // Warm up:
+        for (T value : values)
+        {
+            format(null_stream, value);
+        }
+
+        std::size_t start_byte_count = null_buffer.get_byte_count();
+        unsigned long long start_allocation_count = thread_allocation_count();
+        Stopwatch stopwatch;
+
+        for (unsigned long long i = 0; i < iterations; ++i)
+        {
+            format(null_stream, values[i % values.size()]);
+        }
+
+        double ns_per_value = stopwatch.get_elapsed_ns() / iterations;
+        double allocations_per_value =
+            static_cast<double>(thread_allocation_count() - start_allocation_count) /
+            iterations;
+        double bytes_per_value =
+            static_cast<double>(null_buffer.get_byte_count() - start_byte_count) /
+            iterations;
+        double exact_fraction = static_cast<double>(exact_c) / values.size();
+
+        std::cout << std::left <<
+            std::setw(8) << value_type <<
+            std::setw(27) << method <<
+            std::right << std::fixed << std::setprecision(1) <<
+            std::setw(8) << ns_per_value << " ns" <<
+            std::setprecision(2) <<
+            std::setw(8) << allocations_per_value << " allocs" <<
+            std::setprecision(1) <<
+            std::setw(7) << bytes_per_value << " bytes" <<
+            std::setprecision(3) <<
+            std::setw(8) << exact_fraction << " exact" << std::endl;
+
+        results.add_result().
+            field("value_type", value_type).
+            field("method", method).
+            field("ns_per_value", ns_per_value).
+            field("allocations_per_value", allocations_per_value).
+            field("bytes_per_value", bytes_per_value).
+            field("exact_fraction", exact_fraction);
+    }
+};
+
+}
+
+
+int main(int argc, char **argv)
+{
+    using namespace operation_log_benchmarks;
+
+    unsigned long long iterations =
+        std::stoull(get_option(argc, argv, "iterations", "1000000"));
+    std::string output_path = get_option(argc, argv, "output", "number_benchmark.json");
+    NumberBenchmark benchmark(iterations);
+
+    benchmark.run_methods("double", make_double_values());
+    benchmark.run_methods("integer", make_integer_values());
+
+    if (!benchmark.write_results(output_path))
+    {
+        std::cerr << "Can't write " << output_path << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << output_path << std::endl;
+
+    return 0;
+}
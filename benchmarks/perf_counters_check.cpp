@@ -0,0 +1,187 @@
+// Checks that the CPU time, and hardware counters of logged function calls
+// (see `operation_log/perf_counters.h`) are measured, and that a call's
+// values include its nested calls.  Then, measures the cost of a logged
+// function call, with, and without the counters.
+//
+// Usage:
+//
+//     operation_log_perf_counters_check [--log=0|1]
+//
+// `--log=1` writes the log, and the report of each function's totals to the
+// standard output.  Where the kernel has no hardware counters, only the CPU
+// time is checked.  It exits with 1, if a check fails.
+
+#define OPERATION_LOG_ENABLE
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+const operation_log::PerfFunctionTotals* find_function(
+    const std::vector<operation_log::PerfFunctionTotals> &functions,
+    const std::string &function_name)
+{
+    for (const operation_log::PerfFunctionTotals &function_totals : functions)
+    {
+        if (function_totals.function_name == function_name)
+        {
+            return &function_totals;
+        }
+    }
+    check(false, function_name + " is reported");
+
+    return nullptr;
+}
+
+__attribute__((noinline))
+double spin(int iteration_c)
+{
+    OPERATION_LOG_ENTER_FUNCTION(iteration_c);
+
+    volatile double sum = 0;
+
+    for (int iteration_i = 0; iteration_i < iteration_c; ++iteration_i)
+    {
+        sum = sum + iteration_i * 0.5;
+    }
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return sum;
+}
+
+__attribute__((noinline))
+double spin_twice(int iteration_c)
+{
+    OPERATION_LOG_ENTER_FUNCTION(iteration_c);
+
+    double res = spin(iteration_c) + spin(iteration_c);
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return res;
+}
+
+__attribute__((noinline))
+void empty()
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+double measure_ns_per_call(int call_c)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int call_i = 0; call_i < call_c; ++call_i)
+    {
+        empty();
+    }
+
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / call_c;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    using operation_log::PerfCounterValues;
+    using operation_log::PerfCounters;
+
+    bool is_log_written = argc > 1 && std::string(argv[1]) == "--log=1";
+    std::stringstream null_log;
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+
+    if (!is_log_written)
+    {
+        log.set_output_stream(null_log);
+    }
+
+    PerfCounters::set_active(true);
+    spin_twice(10000000);
+
+    std::vector<operation_log::PerfFunctionTotals> functions = PerfCounters::list_functions();
+    const operation_log::PerfFunctionTotals *outer =
+        find_function(functions, "{anonymous}::spin_twice");
+    const operation_log::PerfFunctionTotals *inner =
+        find_function(functions, "{anonymous}::spin");
+    bool has_hardware_counters = PerfCounters::has_hardware_counters();
+
+    if (outer && inner)
+    {
+        check(inner->call_c == 2, "spin calls");
+        check(inner->totals.cpu_time_ns > 0, "spin CPU time");
+        check(
+            outer->totals.cpu_time_ns >= inner->totals.cpu_time_ns,
+            "spin_twice CPU time includes spin");
+        for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+        {
+            std::string name = PerfCounters::get_counter_name(counter_i);
+
+            if (!has_hardware_counters)
+            {
+                check(inner->totals.counters[counter_i] == -1, name + " is unavailable");
+                continue;
+            }
+            if (inner->totals.counters[counter_i] >= 0)
+            {
+                check(
+                    outer->totals.counters[counter_i] >= inner->totals.counters[counter_i],
+                    "spin_twice " + name + " include spin");
+            }
+        }
+        if (has_hardware_counters)
+        {
+            check(
+                inner->totals.counters[PerfCounterValues::instructions] > 10000000,
+                "spin instructions");
+        }
+    }
+
+    // Measure logged calls to a null stream:
+    const int call_c = 200000;
+
+    log.set_output_stream(null_log);
+    PerfCounters::set_active(false);
+    measure_ns_per_call(call_c);
+
+    double plain_ns = measure_ns_per_call(call_c);
+
+    PerfCounters::set_active(true);
+
+    double counters_ns = measure_ns_per_call(call_c);
+
+    if (is_log_written)
+    {
+        std::cout << std::endl;
+        PerfCounters::write_report(std::cout);
+    }
+    std::cout << "hardware counters: " << (has_hardware_counters ? "yes" : "no") << std::endl <<
+        "logged call: " << plain_ns << " ns, with counters: " << counters_ns << " ns" <<
+        std::endl;
+    if (failure_c == 0)
+    {
+        std::cout << "Performance counter check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+// Checks that the sampling profiler (see `operation_log/sampling_profiler.h`)
+// attributes samples to the stacks of logged functions, in proportion to
+// their CPU time, on each thread, while logging is switched off.  Then,
+// measures the cost of a disabled logged function call, with, and without
+// the profiler.
+//
+// Usage:
+//
+//     operation_log_sampling_profiler_check [--profile=0|1]
+//
+// `--profile=1` writes the call tree, and the folded stacks to the standard
+// output.  It exits with 1, if a check fails.
+
+#define OPERATION_LOG_ENABLE
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+long long count_samples(const std::vector<std::string> &function_names)
+{
+    long long res = 0;
+
+    for (const operation_log::SampledStack &stack :
+        operation_log::SamplingProfiler::list_stacks())
+    {
+        if (stack.function_names == function_names)
+        {
+            res += stack.sample_c;
+        }
+    }
+
+    return res;
+}
+
+__attribute__((noinline))
+double spin(int iteration_c)
+{
+    volatile double sum = 0;
+
+    for (int iteration_i = 0; iteration_i < iteration_c; ++iteration_i)
+    {
+        sum = sum + iteration_i * 0.5;
+    }
+
+    return sum;
+}
+
+__attribute__((noinline))
+double heavy(int iteration_c)
+{
+    OPERATION_LOG_ENTER_FUNCTION(iteration_c);
+
+    double res = spin(3 * iteration_c);
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return res;
+}
+
+__attribute__((noinline))
+double light(int iteration_c)
+{
+    OPERATION_LOG_ENTER_FUNCTION(iteration_c);
+
+    double res = spin(iteration_c);
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return res;
+}
+
+__attribute__((noinline))
+double compute(int repetition_c)
+{
+    OPERATION_LOG_ENTER_FUNCTION(repetition_c);
+
+    double res = 0;
+
+    for (int repetition_i = 0; repetition_i < repetition_c; ++repetition_i)
+    {
+        res += heavy(100000) + light(100000);
+    }
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return res;
+}
+
+__attribute__((noinline))
+void worker()
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+
+    spin(100000000);
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+__attribute__((noinline))
+void empty()
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+double measure_ns_per_call(int call_c)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int call_i = 0; call_i < call_c; ++call_i)
+    {
+        empty();
+    }
+
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / call_c;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    using operation_log::SamplingProfiler;
+
+    bool is_profile_written = argc > 1 && std::string(argv[1]) == "--profile=1";
+
+    operation_log::CallSiteRegistry::get().set_master_enabled(false);
+    check(SamplingProfiler::start(1000), "the profiler starts");
+    compute(1000);
+
+    std::thread worker_thread(worker);
+
+    worker_thread.join();
+    SamplingProfiler::stop();
+
+    long long heavy_c = count_samples({ "{anonymous}::compute", "{anonymous}::heavy" });
+    long long light_c = count_samples({ "{anonymous}::compute", "{anonymous}::light" });
+    long long worker_c = count_samples({ "{anonymous}::worker" });
+    double heavy_share = heavy_c + light_c > 0 ?
+        static_cast<double>(heavy_c) / (heavy_c + light_c) : 0;
+
+    check(heavy_c + light_c >= 50, "compute is sampled");
+    check(heavy_share > 0.6 && heavy_share < 0.9, "heavy takes about 3/4 of the samples");
+    check(worker_c >= 10, "the worker thread is sampled");
+    check(SamplingProfiler::get_dropped_sample_count() == 0, "no samples are dropped");
+
+    if (is_profile_written)
+    {
+        SamplingProfiler::write_call_tree(std::cout);
+        std::cout << std::endl;
+        SamplingProfiler::write_folded_stacks(std::cout);
+        std::cout << std::endl;
+    }
+
+    // Measure disabled logged calls:
+    const int call_c = 10000000;
+
+    measure_ns_per_call(call_c);
+
+    double plain_ns = measure_ns_per_call(call_c);
+
+    SamplingProfiler::start(1000);
+
+    double profiled_ns = measure_ns_per_call(call_c);
+
+    SamplingProfiler::stop();
+
+    std::cout << "samples: " << SamplingProfiler::get_sample_count() <<
+        ", heavy share: " << heavy_share << std::endl <<
+        "disabled logged call: " << plain_ns << " ns, profiled: " << profiled_ns << " ns" <<
+        std::endl;
+    if (failure_c == 0)
+    {
+        std::cout << "Sampling profiler check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
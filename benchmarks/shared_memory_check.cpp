@@ -0,0 +1,444 @@
+// Checks that a log, which is written to a shared memory ring (see
+// `operation_log/shared_memory_formatter.h`), and formatted by a
+// `SharedMemoryCollector`, is the same as when it's formatted directly, that
+// a full ring drops, and counts events, instead of blocking, without
+// unbalancing the functions' entries, and exits, and that the events a
+// crashed producer committed can be collected.  Both with the strings
+// of call sites sent once, and with each event.  Then, measures the cost of
+// logging a function to the ring, and the bytes it takes.
+//
+// Usage:
+//
+//     operation_log_shared_memory_check [--log=0|1]
+//
+// `--log=1` writes the collected log to the standard output.  It exits with
+// 1, if a check fails.
+
+#define OPERATION_LOG_ENABLE
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+std::string get_ring_name(const char *purpose)
+{
+    return "/operation_log_check_" + std::to_string(getpid()) + "_" + purpose;
+}
+
+__attribute__((noinline))
+int add(int a, double b, const std::string &label, const char *note)
+{
+    OPERATION_LOG_ENTER_FUNCTION(a, b, label, note);
+
+    std::tuple<int, std::string> pair(a, label);
+    long long total = a + static_cast<long long>(b);
+    bool is_large = total > 100;
+
+    OPERATION_LOG_DUMP_VARS(pair, total, is_large, 'x');
+    OPERATION_LOG_MESSAGE("<adding> & \"returning\"");
+
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return static_cast<int>(total);
+}
+
+void log_events()
+{
+    for (int call_i = 0; call_i < 3; ++call_i)
+    {
+        add(call_i * 60, 0.25 * call_i, "call " + std::to_string(call_i), "a note");
+    }
+}
+
+// Returns the text of the events, formatted directly, or through a ring.
+std::string format_events(bool is_shared, bool are_strings_interned)
+{
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+    std::stringstream res;
+    operation_log::PlainTextFormatter formatter(res);
+
+    if (!is_shared)
+    {
+        log.set_formatter(formatter);
+        log_events();
+
+        return res.str();
+    }
+
+    std::string name = get_ring_name("equal");
+    std::string error;
+
+    {
+        operation_log::SharedMemoryFormatter producer(name);
+        operation_log::SharedMemoryCollector collector(formatter);
+
+        check(producer.is_open(), "the ring is created");
+        check(collector.attach(name, error), "the collector attaches: " + error);
+        producer.set_strings_interned(are_strings_interned);
+        log.set_formatter(producer);
+        log_events();
+        collector.drain();
+        log.set_formatter(formatter);
+        check(!collector.is_producer_closed(), "the log isn't closed");
+    }
+    operation_log::SharedMemoryRing::unlink(name);
+
+    return res.str();
+}
+
+void check_overrun()
+{
+    std::string name = get_ring_name("overrun");
+    operation_log::SharedMemoryFormatter producer(name, 4096);
+    std::stringstream collected;
+    operation_log::PlainTextFormatter formatter(collected);
+    operation_log::SharedMemoryCollector collector(formatter);
+    std::string error;
+    const int message_c = 1000;
+
+    check(collector.attach(name, error), "the collector attaches: " + error);
+    for (int message_i = 0; message_i < message_c; ++message_i)
+    {
+        producer.write_message("message " + std::to_string(message_i));
+    }
+    check(producer.get_overrun_record_count() > 0, "a full ring drops events");
+
+    std::size_t record_c = collector.drain();
+
+    check(
+        record_c + producer.get_overrun_record_count() == message_c,
+        "every event is collected, or counted as dropped");
+    producer.write_message("after the overrun");
+    collector.drain();
+    check(
+        collected.str().find(
+            std::to_string(producer.get_overrun_record_count()) +
+            " events were dropped") != std::string::npos,
+        "the dropped events are reported");
+    check(
+        collected.str().find("after the overrun") != std::string::npos,
+        "events are collected after an overrun");
+    operation_log::SharedMemoryRing::unlink(name);
+}
+
+// Checks that an event, whose strings' definition didn't fit in the ring, is
+// dropped, and the strings are defined again later.
+void check_definition_overrun()
+{
+    std::string name = get_ring_name("definition");
+    operation_log::SharedMemoryFormatter producer(name, 4096);
+    std::stringstream collected;
+    operation_log::PlainTextFormatter formatter(collected);
+    operation_log::SharedMemoryCollector collector(formatter);
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+    std::string error;
+
+    check(collector.attach(name, error), "the collector attaches: " + error);
+    while (producer.get_overrun_record_count() == 0)
+    {
+        producer.write_message("filling the ring");
+    }
+    log.set_formatter(producer);
+    add(1, 2, "unsent", "note");
+    log.set_formatter(formatter);
+    collector.drain();
+    check(
+        collected.str().find("unsent") == std::string::npos,
+        "an event without its strings is dropped");
+    log.set_formatter(producer);
+    add(3, 4, "collected", "note");
+    log.set_formatter(formatter);
+    collector.drain();
+    check(
+        collected.str().find("int add(") != std::string::npos &&
+            collected.str().find("\"collected\"") != std::string::npos,
+        "the strings are defined again");
+    operation_log::SharedMemoryRing::unlink(name);
+}
+
+__attribute__((noinline))
+void call_logged(const std::function<void()> &body)
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+    body();
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+// (A function, whose strings are first defined while the ring is full.)
+__attribute__((noinline))
+void call_logged_inner(const std::function<void()> &body)
+{
+    OPERATION_LOG_ENTER_NO_ARG_FUNCTION();
+    body();
+    OPERATION_LOG_LEAVE_FUNCTION();
+}
+
+// Returns the number of `<div`s in HTML, which aren't closed.
+long count_open_divs(const std::string &html)
+{
+    long res = 0;
+
+    for (std::size_t p = html.find("<div"); p != std::string::npos; p = html.find("<div", p + 1))
+    {
+        ++res;
+    }
+    for (std::size_t p = html.find("</div>"); p != std::string::npos; p = html.find("</div>", p + 1))
+    {
+        --res;
+    }
+
+    return res;
+}
+
+// Checks that a function's exit is dropped, when its entry didn't fit in the
+// ring, and sent later, when only the exit didn't fit, so the collected
+// functions stay nested.
+void check_nesting_overrun(bool are_strings_interned)
+{
+    std::string name = get_ring_name("nesting");
+    operation_log::SharedMemoryFormatter producer(name, 4096);
+    std::stringstream collected;
+    operation_log::HtmlFormatter formatter(collected);
+    operation_log::SharedMemoryCollector collector(formatter);
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+    std::string error;
+    auto fill_ring = [&producer]()
+    {
+        std::uint64_t overrun_record_c = producer.get_overrun_record_count();
+
+        while (producer.get_overrun_record_count() == overrun_record_c)
+        {
+            producer.write_message("filling the ring");
+        }
+    };
+
+    check(collector.attach(name, error), "the collector attaches: " + error);
+    producer.set_strings_interned(are_strings_interned);
+    log.set_formatter(producer);
+    // An entry (and, with interned strings, its strings' definition) is
+    // dropped, and its exit would fit:
+    call_logged([&]()
+    {
+        fill_ring();
+        call_logged_inner([&]() { collector.drain(); });
+    });
+    // An exit doesn't fit, after its entry was sent:
+    call_logged([&]()
+    {
+        call_logged(fill_ring);
+    });
+    collector.drain();
+    producer.write_message("at the top level");
+    log.set_formatter(formatter);
+    collector.drain();
+
+    std::stringstream direct;
+    operation_log::HtmlFormatter direct_formatter(direct);
+
+    direct_formatter.write_message("at the top level");
+    check(
+        count_open_divs(collected.str()) == count_open_divs(direct.str()),
+        std::string("the collected functions are balanced, with strings ") +
+            (are_strings_interned ? "interned" : "in each event"));
+    check(
+        collected.str().find("at the top level") != std::string::npos,
+        "the events after the pending exits are collected");
+    operation_log::SharedMemoryRing::unlink(name);
+}
+
+void check_crash()
+{
+    std::string name = get_ring_name("crash");
+    pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        operation_log::SharedMemoryFormatter *producer =
+            new operation_log::SharedMemoryFormatter(name);
+
+        producer->write_message("before the crash");
+        // Exit without closing the log:
+        _exit(0);
+    }
+
+    int status;
+
+    waitpid(pid, &status, 0);
+
+    std::stringstream collected;
+    operation_log::PlainTextFormatter formatter(collected);
+    operation_log::SharedMemoryCollector collector(formatter);
+    std::string error;
+
+    check(collector.attach(name, error), "the collector attaches after a crash: " + error);
+    if (collector.is_attached())
+    {
+        check(!collector.is_producer_closed(), "a crashed producer doesn't close the log");
+        check(!collector.is_producer_alive(), "a crashed producer is detected");
+        collector.drain();
+        check(
+            collected.str().find("before the crash") != std::string::npos,
+            "events logged before a crash are collected");
+        check(collector.get_pending_byte_count() == 0, "no events are pending");
+    }
+    operation_log::SharedMemoryRing::unlink(name);
+}
+
+// Returns the bytes it takes to log one call to a ring.
+double measure_bytes_per_call(bool are_strings_interned)
+{
+    const int call_c = 1000;
+    std::string name = get_ring_name("bytes");
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+    operation_log::FormatterBase &previous_formatter = log.get_formatter();
+    double res;
+
+    {
+        operation_log::SharedMemoryFormatter producer(name);
+        operation_log::SharedMemoryRing::Header *header;
+        operation_log::SharedMemoryRing ring;
+        std::string error;
+
+        ring.attach(name, error);
+        header = &ring.get_header();
+        producer.set_strings_interned(are_strings_interned);
+        log.set_formatter(producer);
+        for (int call_i = 0; call_i < call_c; ++call_i)
+        {
+            add(call_i, 0.5, "measured", "note");
+        }
+        log.set_formatter(previous_formatter);
+        res = static_cast<double>(header->reserve_position.load()) / call_c;
+    }
+    operation_log::SharedMemoryRing::unlink(name);
+
+    return res;
+}
+
+double measure_ns_per_call(int call_c)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int call_i = 0; call_i < call_c; ++call_i)
+    {
+        add(call_i, 0.5, "measured", "note");
+    }
+
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / call_c;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    bool is_log_written = argc > 1 && std::string(argv[1]) == "--log=1";
+    std::string direct_text = format_events(false, false);
+
+    check(!direct_text.empty(), "the log isn't empty");
+    for (bool are_strings_interned : { true, false })
+    {
+        std::string collected_text = format_events(true, are_strings_interned);
+
+        check(
+            collected_text == direct_text,
+            std::string("the collected log is the same as the direct log, with strings ") +
+                (are_strings_interned ? "interned" : "in each event"));
+        if (is_log_written || collected_text != direct_text)
+        {
+            std::cout << "Direct:" << std::endl << direct_text << std::endl <<
+                "Collected:" << std::endl << collected_text << std::endl;
+        }
+    }
+
+    check_overrun();
+    check_definition_overrun();
+    for (bool are_strings_interned : { true, false })
+    {
+        check_nesting_overrun(are_strings_interned);
+    }
+    check_crash();
+
+    // Measure the producer, while a collector thread drains the ring:
+    const int call_c = 200000;
+    std::string name = get_ring_name("measure");
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+    std::stringstream direct_log;
+    operation_log::PlainTextFormatter direct_formatter(direct_log);
+    double shared_ns;
+    std::uint64_t overrun_record_c;
+
+    log.set_formatter(direct_formatter);
+    measure_ns_per_call(call_c);
+
+    double direct_ns = measure_ns_per_call(call_c);
+
+    {
+        std::stringstream collected_log;
+        operation_log::PlainTextFormatter collected_formatter(collected_log);
+        operation_log::SharedMemoryFormatter producer(name);
+        operation_log::SharedMemoryCollector collector(collected_formatter);
+        std::string error;
+
+        collector.attach(name, error);
+
+        std::thread collector_thread(
+            [&collector]()
+            {
+                while (!collector.is_producer_closed())
+                {
+                    if (collector.drain() == 0)
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                }
+                collector.drain();
+            });
+
+        log.set_formatter(producer);
+        shared_ns = measure_ns_per_call(call_c);
+        overrun_record_c = producer.get_overrun_record_count();
+        log.set_formatter(direct_formatter);
+        producer.close();
+        collector_thread.join();
+    }
+    operation_log::SharedMemoryRing::unlink(name);
+
+    std::cout << "logged call: PlainTextFormatter: " << direct_ns <<
+        " ns, SharedMemoryFormatter: " << shared_ns << " ns (" << overrun_record_c <<
+        " events dropped)" << std::endl;
+    std::cout << "logged call: " << measure_bytes_per_call(false) <<
+        " bytes with strings in each event, " << measure_bytes_per_call(true) <<
+        " bytes with interned strings" << std::endl;
+    if (failure_c == 0)
+    {
+        std::cout << "Shared memory check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+// An end-to-end benchmark based on the sphere tessellation HTML log example
+// in the documentation.  It runs the tessellation with, and without operation
+// logging compiled in, and reports the run time overhead, log output size,
+// and peak resident set size.
+//
+// Usage:
+//
+//     operation_log_sphere_benchmark [--subdivisions=N] [--repetitions=N]
+//         [--formatter=plain_text|html|html_viewer] [--filter=RULES] [--scenes=0|1]
+//         [--collapse=0|1] [--log=FILE] [--output=FILE]
+//
+// `--filter` takes `FunctionNameFilter` rules, e.g., `*::add_face;!*::add_*`.
+// `--scenes=1` logs a three.js scene for each added vertex (like the
+// example).  `--collapse=1` passes the events through a
+// `RepetitionCollapsingFormatter`.  `--log` keeps the log output in a file
+// (otherwise it's only counted).
+//
+// Each run is made in a separate child process, so its peak resident set size
+// can be measured.  Results are written to a JSON file
+// (`sphere_benchmark.json`, by default).
+
+#define OPERATION_LOG_ENABLE
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <operation_log.h>
+
+#include "benchmark_utils.h"
+#include "sphere_tessellation.h"
+
+
+namespace instrumented
+{
+#include <operation_log/enable.h>
+#include "sphere_tessellation.inc"
+}
+
+namespace uninstrumented
+{
+#include <operation_log/disable.h>
+#include "sphere_tessellation.inc"
+}
+
+#include <operation_log/enable.h>
+
+
+namespace operation_log_benchmarks
+{
+
+struct Options
+{
+    int subdivisions;
+    int repetitions;
+    std::string formatter;
+    std::string filter;
+    bool log_scenes;
+    bool collapse_repetitions;
+    std::string log_path;
+};
+
+struct RunResult
+{
+    double elapsed_ns;
+    unsigned long long output_byte_count;
+    std::size_t vertex_count;
+    std::size_t face_count;
+    long peak_rss_kb;
+};
+
+template <class Builder>
+RunResult tessellate(const Options &options)
+{
+    RunResult res { 0, 0, 0, 0, 0 };
+    Stopwatch stopwatch;
+
+    for (int i = 0; i < options.repetitions; ++i)
+    {
+        sphere_tessellation::PolyhedronBuilder polyhedron_builder;
+        Builder builder(
+            polyhedron_builder, 10.0, options.subdivisions, options.log_scenes);
+
+        builder.run();
+        res.vertex_count = polyhedron_builder.get_vertex_count();
+        res.face_count = polyhedron_builder.get_face_count();
+    }
+    res.elapsed_ns = stopwatch.get_elapsed_ns();
+
+    return res;
+}
+
+RunResult run_instrumented(const Options &options)
+{
+    NullBuffer null_buffer;
+    std::ofstream log_file;
+    std::ostream null_stream(&null_buffer);
+    std::ostream *output = &null_stream;
+
+    if (!options.log_path.empty())
+    {
+        log_file.open(options.log_path);
+        output = &log_file;
+    }
+
+    operation_log::PlainTextFormatter plain_text_formatter(*output);
+    operation_log::HtmlFormatter html_formatter(*output, "Sphere Benchmark");
+    operation_log::DefaultOperationLog &log = operation_log::OperationLogInstance::get();
+
+    operation_log::HtmlViewerFormatter html_viewer_formatter(*output, "Sphere Benchmark");
+
+    html_formatter.extra_header_code = operation_log::HtmlFormatter::three_js_header_code;
+    html_viewer_formatter.extra_header_code = operation_log::HtmlFormatter::three_js_header_code;
+    operation_log::FormatterBase *formatter = &plain_text_formatter;
+
+    if (options.formatter == "html")
+    {
+        formatter = &html_formatter;
+    }
+    else if (options.formatter == "html_viewer")
+    {
+        formatter = &html_viewer_formatter;
+    }
+
+    operation_log::RepetitionCollapsingFormatter collapsing_formatter(*formatter);
+
+    log.set_formatter(options.collapse_repetitions ? collapsing_formatter : *formatter);
+    operation_log::CallSiteRegistry::get().set_filter(
+        operation_log::FunctionNameFilter::parse(options.filter));
+
+    RunResult res = tessellate<instrumented::Sphere_3_TessalationBuilder>(options);
+
+    collapsing_formatter.flush();
+    output->flush();
+    res.output_byte_count = options.log_path.empty() ?
+        null_buffer.get_byte_count() :
+        static_cast<unsigned long long>(log_file.tellp());
+
+    return res;
+}
+
+// Runs a function in a child process, and returns its result with the
+// child's peak resident set size.
+template <typename Function>
+RunResult run_in_child_process(Function function)
+{
+    int pipe_fds[2];
+
+    if (pipe(pipe_fds) != 0)
+    {
+        std::perror("pipe");
+        std::exit(1);
+    }
+
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        std::perror("fork");
+        std::exit(1);
+    }
+    if (pid == 0)
+    {
+        close(pipe_fds[0]);
+
+        RunResult res = function();
+
+        if (write(pipe_fds[1], &res, sizeof(res)) != sizeof(res))
+        {
+            _exit(1);
+        }
+        // Skip destructors, e.g., of the operation log formatters:
+        _exit(0);
+    }
+
+    close(pipe_fds[1]);
+
+    RunResult res;
+    int status;
+    struct rusage usage;
+    bool has_result = read(pipe_fds[0], &res, sizeof(res)) == sizeof(res);
+
+    close(pipe_fds[0]);
+    if (wait4(pid, &status, 0, &usage) < 0 || !has_result ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::cerr << "A benchmark child process failed." << std::endl;
+        std::exit(1);
+    }
+    res.peak_rss_kb = usage.ru_maxrss;
+
+    return res;
+}
+
+}
+
+
+int main(int argc, char **argv)
+{
+    using namespace operation_log_benchmarks;
+
+    Options options {
+        std::stoi(get_option(argc, argv, "subdivisions", "24")),
+        std::stoi(get_option(argc, argv, "repetitions", "1")),
+        get_option(argc, argv, "formatter", "html"),
+        get_option(argc, argv, "filter", ""),
+        get_option(argc, argv, "scenes", "1") == "1",
+        get_option(argc, argv, "collapse", "0") == "1",
+        get_option(argc, argv, "log", "") };
+    std::string output_path = get_option(argc, argv, "output", "sphere_benchmark.json");
+
+    RunResult baseline = run_in_child_process([&]() {
+        return tessellate<uninstrumented::Sphere_3_TessalationBuilder>(options);
+    });
+    RunResult instrumented = run_in_child_process([&]() {
+        return run_instrumented(options);
+    });
+
+    double overhead = instrumented.elapsed_ns / std::max(baseline.elapsed_ns, 1.0);
+
+    std::cout <<
+        "Vertices: " << instrumented.vertex_count <<
+        ", faces: " << instrumented.face_count << std::endl <<
+        "Uninstrumented: " << baseline.elapsed_ns / 1e6 << " ms, peak RSS " <<
+            baseline.peak_rss_kb << " KiB" << std::endl <<
+        "Instrumented (" << options.formatter << "): " <<
+            instrumented.elapsed_ns / 1e6 << " ms, peak RSS " <<
+            instrumented.peak_rss_kb << " KiB, output " <<
+            instrumented.output_byte_count << " bytes" << std::endl <<
+        "Overhead: " << overhead << "x" << std::endl;
+
+    JsonResultWriter results("sphere_tessellation");
+
+    results.add_result().
+        field("subdivisions", static_cast<long long>(options.subdivisions)).
+        field("repetitions", static_cast<long long>(options.repetitions)).
+        field("formatter", options.formatter).
+        field("filter", options.filter).
+        field("scenes", static_cast<long long>(options.log_scenes)).
+        field("collapse", static_cast<long long>(options.collapse_repetitions)).
+        field("vertex_count", static_cast<long long>(instrumented.vertex_count)).
+        field("face_count", static_cast<long long>(instrumented.face_count)).
+        field("uninstrumented_ms", baseline.elapsed_ns / 1e6).
+        field("instrumented_ms", instrumented.elapsed_ns / 1e6).
+        field("overhead_factor", overhead).
+        field("output_bytes", static_cast<long long>(instrumented.output_byte_count)).
+        field("uninstrumented_peak_rss_kb", static_cast<long long>(baseline.peak_rss_kb)).
+        field("instrumented_peak_rss_kb", static_cast<long long>(instrumented.peak_rss_kb));
+    if (!results.write_file(output_path))
+    {
+        std::cerr << "Can't write " << output_path << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << output_path << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef _OPERATION_LOG_BENCHMARKS_SPHERE_TESSELLATION_H
+#define _OPERATION_LOG_BENCHMARKS_SPHERE_TESSELLATION_H
+
+// Data types for the sphere tessellation benchmark.  They stand in for the
+// CGAL types used by the HTML log example in the documentation.
+
+#include <ostream>
+#include <vector>
+
+
+namespace sphere_tessellation
+{
+
+struct Point_3
+{
+    double x;
+    double y;
+    double z;
+};
+
+inline std::ostream& operator<<(std::ostream &out, const Point_3 &point)
+{
+    return out << point.x << " " << point.y << " " << point.z;
+}
+
+// Collects the vertices and faces of a polyhedron.
+class PolyhedronBuilder
+{
+public:
+    void begin_surface(int vertex_count, int face_count)
+    {
+        vertices.reserve(vertex_count);
+        faces.reserve(3 * face_count);
+    }
+
+    void add_vertex(const Point_3 &point)
+    {
+        vertices.push_back(point);
+    }
+
+    const Point_3& vertex(int i) const
+    {
+        return vertices[i];
+    }
+
+    void add_face(int v0_index, int v1_index, int v2_index)
+    {
+        faces.push_back(v0_index);
+        faces.push_back(v1_index);
+        faces.push_back(v2_index);
+    }
+
+    std::size_t get_vertex_count() const
+    {
+        return vertices.size();
+    }
+
+    std::size_t get_face_count() const
+    {
+        return faces.size() / 3;
+    }
+
+private:
+    std::vector<Point_3> vertices;
+    std::vector<int> faces;
+};
+
+}
+
+#endif // _OPERATION_LOG_BENCHMARKS_SPHERE_TESSELLATION_H
@@ -0,0 +1,468 @@
+// Checks the USDT probes of the operation log macros (see
+// `operation_log/usdt.h`): that the binary has their notes, and semaphores,
+// and, on x86-64, that the probes of the function, message, and variable
+// macros fire with the documented arguments, while logging is switched off.
+// Then, measures the cost of a switched off call site with a probe, with, and
+// without a tracer.
+//
+// Without a system tracer, the check traces itself like one: it reads the
+// probes' notes from `/proc/self/exe`, increments their semaphores, replaces
+// their `nop`s with breakpoints, and decodes the arguments in the `SIGTRAP`
+// handler.
+//
+// Usage:
+//
+//     operation_log_usdt_check
+//
+// It exits with 1, if a check fails.
+
+#define OPERATION_LOG_ENABLE
+
+#include <elf.h>
+#include <link.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+int failure_c = 0;
+
+void check(bool condition, const std::string &description)
+{
+    if (!condition)
+    {
+        std::cerr << "Failed: " << description << std::endl;
+        ++failure_c;
+    }
+}
+
+// A probe, as described by its note.
+struct Probe
+{
+    std::string provider;
+    std::string name;
+    std::string arguments;
+    // The addresses in the running process:
+    std::uintptr_t address;
+    std::uintptr_t semaphore_address;
+    unsigned char original_byte;
+};
+
+// The arguments of a probe, which fired, and the values of `scale()`'s
+// entry, and its message's text, which only live while they fire.
+struct FiredProbe
+{
+    const Probe *probe;
+    std::uint64_t arguments[7];
+    int a;
+    std::string label;
+    std::string text;
+};
+
+std::vector<Probe> probes;
+// The symbols of this program, for arguments, which are addressed relative
+// to the instruction pointer:
+std::map<std::string, std::uintptr_t> symbols;
+std::vector<FiredProbe> fired_probes;
+bool is_decoding_failed = false;
+
+int find_load_bias(dl_phdr_info *info, std::size_t size, void *data)
+{
+    // The first object is the program:
+    *static_cast<std::uintptr_t*>(data) = info->dlpi_addr;
+
+    return 1;
+}
+
+// Reads the probes' notes, and the symbols of this program.
+void read_probes()
+{
+    std::ifstream input("/proc/self/exe", std::ios::binary);
+    std::string elf((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    const Elf64_Ehdr *elf_header = reinterpret_cast<const Elf64_Ehdr*>(elf.data());
+    const Elf64_Shdr *sections =
+        reinterpret_cast<const Elf64_Shdr*>(elf.data() + elf_header->e_shoff);
+    const char *section_names = elf.data() + sections[elf_header->e_shstrndx].sh_offset;
+    std::uintptr_t load_bias = 0;
+
+    dl_iterate_phdr(&find_load_bias, &load_bias);
+    for (int section_i = 0; section_i < elf_header->e_shnum; ++section_i)
+    {
+        const Elf64_Shdr &section = sections[section_i];
+
+        if (section.sh_type == SHT_SYMTAB)
+        {
+            const Elf64_Sym *entries =
+                reinterpret_cast<const Elf64_Sym*>(elf.data() + section.sh_offset);
+            const char *names = elf.data() + sections[section.sh_link].sh_offset;
+
+            for (std::size_t entry_i = 0; entry_i < section.sh_size / sizeof(Elf64_Sym);
+                ++entry_i)
+            {
+                symbols[names + entries[entry_i].st_name] =
+                    load_bias + entries[entry_i].st_value;
+            }
+        }
+        if (std::strcmp(section_names + section.sh_name, ".note.stapsdt") != 0)
+        {
+            continue;
+        }
+
+        const char *note = elf.data() + section.sh_offset;
+        const char *end = note + section.sh_size;
+
+        while (note < end)
+        {
+            const Elf64_Nhdr *note_header = reinterpret_cast<const Elf64_Nhdr*>(note);
+            const char *description =
+                note + sizeof(Elf64_Nhdr) + ((note_header->n_namesz + 3) & ~3);
+            const std::uint64_t *addresses =
+                reinterpret_cast<const std::uint64_t*>(description);
+            Probe probe;
+
+            probe.provider = description + 3 * sizeof(std::uint64_t);
+            probe.name = description + 3 * sizeof(std::uint64_t) + probe.provider.size() + 1;
+            probe.arguments = description + 3 * sizeof(std::uint64_t) +
+                probe.provider.size() + 1 + probe.name.size() + 1;
+            // (`.stapsdt.base` isn't moved after linking, so the addresses
+            // only need the load bias.)
+            probe.address = load_bias + addresses[0];
+            probe.semaphore_address = addresses[2] ? load_bias + addresses[2] : 0;
+            probe.original_byte = 0;
+            if (note_header->n_type == 3 && probe.provider == "operation_log")
+            {
+                probes.push_back(probe);
+            }
+            note = description + ((note_header->n_descsz + 3) & ~3);
+        }
+    }
+}
+
+#if defined(__x86_64__)
+
+std::uint64_t read_register(const ucontext_t &context, const std::string &name)
+{
+    static const std::map<std::string, int> registers = {
+        { "rax", REG_RAX }, { "rbx", REG_RBX }, { "rcx", REG_RCX }, { "rdx", REG_RDX },
+        { "rsi", REG_RSI }, { "rdi", REG_RDI }, { "rbp", REG_RBP }, { "rsp", REG_RSP },
+        { "r8", REG_R8 }, { "r9", REG_R9 }, { "r10", REG_R10 }, { "r11", REG_R11 },
+        { "r12", REG_R12 }, { "r13", REG_R13 }, { "r14", REG_R14 }, { "r15", REG_R15 } };
+    std::map<std::string, int>::const_iterator found = registers.find(name);
+
+    if (found == registers.end())
+    {
+        is_decoding_failed = true;
+
+        return 0;
+    }
+
+    return static_cast<std::uint64_t>(context.uc_mcontext.gregs[found->second]);
+}
+
+// Decodes an argument (e.g., `8@%rdi`, `-8@$12`, `8@16(%rsp)`, or
+// `8@_ZZ4mainE4site+8(%rip)`).
+std::uint64_t decode_argument(const ucontext_t &context, const std::string &argument)
+{
+    std::string location = argument.substr(argument.find('@') + 1);
+
+    if (location[0] == '%')
+    {
+        return read_register(context, location.substr(1));
+    }
+    if (location[0] == '$')
+    {
+        return static_cast<std::uint64_t>(std::strtoll(location.c_str() + 1, nullptr, 10));
+    }
+
+    std::size_t open = location.find('(');
+    std::string displacement = location.substr(0, open);
+    std::string base = location.substr(open + 2, location.find(')') - open - 2);
+    std::uintptr_t address;
+
+    if (base == "rip")
+    {
+        std::size_t offset_start = displacement.find_first_of("+-");
+        std::string symbol = displacement.substr(0, offset_start);
+
+        if (symbols.count(symbol) == 0)
+        {
+            is_decoding_failed = true;
+
+            return 0;
+        }
+        address = symbols[symbol] + (offset_start == std::string::npos ? 0 :
+            std::strtoll(displacement.c_str() + offset_start, nullptr, 10));
+    }
+    else
+    {
+        address = read_register(context, base) +
+            std::strtoll(displacement.c_str(), nullptr, 10);
+    }
+
+    std::uint64_t res;
+
+    std::memcpy(&res, reinterpret_cast<const void*>(address), sizeof(res));
+
+    return res;
+}
+
+void handle_breakpoint(int, siginfo_t *, void *context_pointer)
+{
+    ucontext_t &context = *static_cast<ucontext_t*>(context_pointer);
+    std::uintptr_t address = context.uc_mcontext.gregs[REG_RIP] - 1;
+
+    for (const Probe &probe : probes)
+    {
+        if (probe.address != address)
+        {
+            continue;
+        }
+
+        FiredProbe fired = { &probe, {}, 0, "", "" };
+        std::stringstream arguments(probe.arguments);
+        std::string argument;
+
+        for (int argument_i = 0; argument_i < 7 && arguments >> argument; ++argument_i)
+        {
+            fired.arguments[argument_i] = decode_argument(context, argument);
+        }
+        if (probe.name == "function_entry" && fired.arguments[5] == 2)
+        {
+            const void *const *values =
+                reinterpret_cast<const void *const *>(fired.arguments[6]);
+
+            fired.a = *static_cast<const int*>(values[0]);
+            fired.label = *static_cast<const std::string*>(values[1]);
+        }
+        if (probe.name == "message")
+        {
+            fired.text.assign(
+                reinterpret_cast<const char*>(fired.arguments[6]), fired.arguments[5]);
+        }
+        fired_probes.push_back(fired);
+        // Skip the `nop`:
+        context.uc_mcontext.gregs[REG_RIP] = address + 1;
+
+        return;
+    }
+    std::abort();
+}
+
+void set_breakpoints(bool are_set)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    for (Probe &probe : probes)
+    {
+        unsigned char *code = reinterpret_cast<unsigned char*>(probe.address);
+        void *page = reinterpret_cast<void*>(probe.address & ~(page_size - 1));
+
+        mprotect(page, 2 * page_size, PROT_READ | PROT_WRITE | PROT_EXEC);
+        if (are_set)
+        {
+            probe.original_byte = *code;
+            *code = 0xcc;
+        }
+        else
+        {
+            *code = probe.original_byte;
+        }
+        mprotect(page, 2 * page_size, PROT_READ | PROT_EXEC);
+    }
+}
+
+#endif // defined(__x86_64__)
+
+void attach(bool is_attached)
+{
+    for (const Probe &probe : probes)
+    {
+        *reinterpret_cast<volatile unsigned short*>(probe.semaphore_address) +=
+            is_attached ? 1 : -1;
+    }
+}
+
+__attribute__((noinline))
+int scale(int a, const std::string &label)
+{
+    OPERATION_LOG_ENTER_FUNCTION(a, label);
+
+    int res = a * 3;
+
+    OPERATION_LOG_DUMP_VARS(res);
+    OPERATION_LOG_ACCUMULATE_VARS(a);
+    OPERATION_LOG_MESSAGE("scaled " + label);
+    OPERATION_LOG_MESSAGE_STREAM(<< "streamed " << res);
+    OPERATION_LOG_LEAVE_FUNCTION();
+
+    return res;
+}
+
+// Returns the probe with the name, which fired `fired_i`-th, or `nullptr`.
+const FiredProbe* find_fired(const std::string &name, int fired_i = 0)
+{
+    for (const FiredProbe &fired : fired_probes)
+    {
+        if (fired.probe->name == name && fired_i-- == 0)
+        {
+            return &fired;
+        }
+    }
+
+    return nullptr;
+}
+
+std::string get_string(std::uint64_t pointer)
+{
+    return reinterpret_cast<const char*>(pointer);
+}
+
+void check_fired_probes()
+{
+    const FiredProbe *entry = find_fired("function_entry");
+    const FiredProbe *dump = find_fired("dump_vars");
+    const FiredProbe *accumulation = find_fired("dump_vars", 1);
+    const FiredProbe *message = find_fired("message");
+    const FiredProbe *stream_message = find_fired("message", 1);
+    const FiredProbe *exit = find_fired("function_exit");
+
+    check(!is_decoding_failed, "the probes' arguments are decoded");
+    check(fired_probes.size() == 6, "each probe fires once");
+    check(
+        entry && dump && accumulation && message && stream_message && exit,
+        "all probes fire");
+    if (failure_c > 0)
+    {
+        return;
+    }
+    check(
+        get_string(entry->arguments[1]).find("usdt_check.cpp") != std::string::npos,
+        "the entry has the file");
+    check(
+        get_string(entry->arguments[3]).find("int {anonymous}::scale(") != std::string::npos,
+        "the entry has the function");
+    check(get_string(entry->arguments[4]) == "a, label", "the entry has the argument names");
+    check(entry->arguments[5] == 2, "the entry has the argument count");
+
+    check(entry->a == 2 && entry->label == "probed", "the entry has the argument values");
+    check(
+        exit->arguments[0] == entry->arguments[0] && exit->arguments[2] == entry->arguments[2],
+        "the exit has the entry's call site");
+    check(get_string(dump->arguments[4]) == "res", "the dump has the variable names");
+    check(dump->arguments[5] == 1, "the dump has the variable count");
+    check(
+        get_string(accumulation->arguments[4]) == "a" && accumulation->arguments[5] == 1,
+        "the accumulation has the variable");
+    check(message->text == "scaled probed", "the message has the text");
+    check(stream_message->text == "streamed 6", "the streamed message has the text");
+    check(
+        static_cast<long>(message->arguments[2]) > static_cast<long>(dump->arguments[2]),
+        "the message has its line");
+}
+
+double measure_ns_per_call(int call_c)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int total = 0;
+
+    for (int call_i = 0; call_i < call_c; ++call_i)
+    {
+        total += scale(call_i, "measured");
+    }
+    check(total != 1, "the calls aren't optimized away");
+
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / call_c;
+}
+
+}
+
+int main()
+{
+    std::stringstream log_text;
+    operation_log::PlainTextFormatter formatter(log_text);
+
+    operation_log::OperationLogInstance::get().set_formatter(formatter);
+    // Make the call sites known, then switch logging off:
+    scale(1, "logged");
+    operation_log::CallSiteRegistry::get().set_master_enabled(false);
+    log_text.str("");
+
+    read_probes();
+    for (const char *name : { "function_entry", "function_exit", "message", "dump_vars" })
+    {
+        bool is_found = false;
+
+        for (const Probe &probe : probes)
+        {
+            if (probe.name == name)
+            {
+                is_found = true;
+                check(probe.semaphore_address != 0, probe.name + " has a semaphore");
+                check(
+                    std::count(probe.arguments.begin(), probe.arguments.end(), '@') == 7,
+                    probe.name + " has 7 arguments: " + probe.arguments);
+            }
+        }
+        check(is_found, std::string("the binary has the ") + name + " probe");
+    }
+
+#if defined(__x86_64__)
+    struct sigaction action;
+
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &handle_breakpoint;
+    action.sa_flags = SA_SIGINFO;
+    sigaction(SIGTRAP, &action, nullptr);
+    fired_probes.reserve(16);
+    attach(true);
+    set_breakpoints(true);
+    scale(2, "probed");
+    set_breakpoints(false);
+    attach(false);
+    check_fired_probes();
+    for (const FiredProbe &fired : fired_probes)
+    {
+        std::cout << fired.probe->name << ": " << fired.probe->arguments << std::endl;
+    }
+#endif // defined(__x86_64__)
+    check(log_text.str().empty(), "switched off call sites don't log");
+
+    const int call_c = 10000000;
+
+    measure_ns_per_call(call_c);
+
+    double unattached_ns = measure_ns_per_call(call_c);
+
+    attach(true);
+
+    double attached_ns = measure_ns_per_call(call_c / 10);
+
+    attach(false);
+    std::cout << "switched off call: " << unattached_ns << " ns without a tracer, " <<
+        attached_ns << " ns with a tracer (without its breakpoints)" << std::endl;
+    if (failure_c == 0)
+    {
+        std::cout << "USDT check passed." << std::endl;
+    }
+
+    return failure_c == 0 ? 0 : 1;
+}
@@ -7,14 +7,34 @@
 #include <tuple>
 #include <vector>
 
+#include "operation_log/blob.h"
+#include "operation_log/call_site.h"
 #include "operation_log/cpp_parsing.h"
+#include "operation_log/deferred_formatter.h"
+#include "operation_log/fork_handling.h"
 #include "operation_log/function_entry.h"
 #include "operation_log/function_info.h"
+#include "operation_log/heap_accounting.h"
 #include "operation_log/html_formatter.h"
+#include "operation_log/html_viewer_formatter.h"
+#include "operation_log/instrumented_mutex.h"
+#include "operation_log/levels.h"
+#include "operation_log/lock_contention.h"
 #include "operation_log/message_stream.h"
 #include "operation_log/operation_log_instance.h"
 #include "operation_log/operation_log.h"
+#include "operation_log/perf_counters.h"
 #include "operation_log/plain_text_formatter.h"
+#include "operation_log/process_log_file.h"
+#include "operation_log/repetition_collapsing_formatter.h"
+#include "operation_log/sampling_profiler.h"
+#include "operation_log/shared_memory_collector.h"
+#include "operation_log/shared_memory_formatter.h"
+#include "operation_log/shared_memory_ring.h"
+#include "operation_log/three_js_geometry.h"
+#include "operation_log/usdt.h"
+#include "operation_log/var_accumulator.h"
+#include "operation_log/var_statistics.h"
 
 
 // Should we enable operation logging:
@@ -32,6 +52,18 @@
 #    define OPERATION_LOG_FUNCTION_VAR_NAME operation_log__function
 #endif // OPERATION_LOG_FUNCTION_VAR_NAME
 
+#ifndef OPERATION_LOG_FUNCTION_CALL_SITE_VAR_NAME
+#    define OPERATION_LOG_FUNCTION_CALL_SITE_VAR_NAME operation_log__function_call_site
+#endif // OPERATION_LOG_FUNCTION_CALL_SITE_VAR_NAME
+
+#ifndef OPERATION_LOG_CALL_SITE_VAR_NAME
+#    define OPERATION_LOG_CALL_SITE_VAR_NAME operation_log__call_site
+#endif // OPERATION_LOG_CALL_SITE_VAR_NAME
+
+#ifndef OPERATION_LOG_ACCUMULATOR_VAR_NAME
+#    define OPERATION_LOG_ACCUMULATOR_VAR_NAME operation_log__accumulator
+#endif // OPERATION_LOG_ACCUMULATOR_VAR_NAME
+
 
 // Unused:
 #define OPERATION_LOG_ARGUMENT_COUNT(...) \
@@ -0,0 +1,262 @@
+#ifndef _OPERATION_LOG_ACCOUNT_ALLOCATIONS_H
+#define _OPERATION_LOG_ACCOUNT_ALLOCATIONS_H
+
+// Counts heap allocations for each logged function call (see
+// `HeapAccounting`).
+//
+// This header replaces the global `operator new`, and `operator delete`
+// (including their C++17 `std::align_val_t` overloads), so it must be
+// included in exactly one translation unit of a program.  When
+// `OPERATION_LOG_ACCOUNT_MALLOC` is defined, it replaces glibc's `malloc()`,
+// `calloc()`, `realloc()`, `memalign()`, `aligned_alloc()`, and
+// `posix_memalign()` instead, so C allocations are counted too.  (`operator
+// new` calls `malloc()`, or `aligned_alloc()`.)  The obsolete `valloc()`, and
+// `pvalloc()` aren't counted.
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#include "heap_accounting.h"
+
+
+namespace operation_log
+{
+
+namespace helpers
+{
+
+// Switches the accounting on before `main()` runs.
+struct HeapAccountingActivator
+{
+    HeapAccountingActivator()
+    {
+        HeapAccounting::set_active(true);
+    }
+};
+
+static HeapAccountingActivator heap_accounting_activator;
+
+}
+
+}
+
+#ifdef OPERATION_LOG_ACCOUNT_MALLOC
+
+extern "C"
+{
+
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void *pointer, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+void* malloc(std::size_t size) noexcept
+{
+    operation_log::HeapAccounting::add_allocation(size);
+
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) noexcept
+{
+    operation_log::HeapAccounting::add_allocation(count * size);
+
+    return __libc_calloc(count, size);
+}
+
+// A reallocation counts as an allocation of the new size.
+void* realloc(void *pointer, std::size_t size) noexcept
+{
+    operation_log::HeapAccounting::add_allocation(size);
+
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(std::size_t alignment, std::size_t size) noexcept
+{
+    operation_log::HeapAccounting::add_allocation(size);
+
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+{
+    operation_log::HeapAccounting::add_allocation(size);
+
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, std::size_t alignment, std::size_t size) noexcept
+{
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0 ||
+        alignment == 0)
+    {
+        return EINVAL;
+    }
+    operation_log::HeapAccounting::add_allocation(size);
+
+    void *res = __libc_memalign(alignment, size);
+
+    if (!res)
+    {
+        return ENOMEM;
+    }
+    *pointer = res;
+
+    return 0;
+}
+
+}
+
+#else // OPERATION_LOG_ACCOUNT_MALLOC
+
+namespace operation_log
+{
+
+namespace helpers
+{
+
+// Allocates with `std::malloc()`, or, for an over-aligned type, with
+// `posix_memalign()`, so `operator delete` frees both with `std::free()`.
+inline void* allocate(std::size_t size, std::size_t alignment = 0)
+{
+    HeapAccounting::add_allocation(size);
+    for (;;)
+    {
+        void *res = nullptr;
+
+        if (alignment == 0)
+        {
+            res = std::malloc(size > 0 ? size : 1);
+        }
+        else if (posix_memalign(
+            &res, alignment > sizeof(void*) ? alignment : sizeof(void*),
+            size > 0 ? size : 1) != 0)
+        {
+            res = nullptr;
+        }
+
+        if (res)
+        {
+            return res;
+        }
+
+        std::new_handler handler = std::get_new_handler();
+
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+inline void* allocate(
+    std::size_t size, const std::nothrow_t &, std::size_t alignment = 0) noexcept
+{
+    try
+    {
+        return allocate(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    return operation_log::helpers::allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return operation_log::helpers::allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t &nothrow) noexcept
+{
+    return operation_log::helpers::allocate(size, nothrow);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t &nothrow) noexcept
+{
+    return operation_log::helpers::allocate(size, nothrow);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+
+#ifdef __cpp_aligned_new
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return operation_log::helpers::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operation_log::helpers::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(
+    std::size_t size, std::align_val_t alignment, const std::nothrow_t &nothrow) noexcept
+{
+    return operation_log::helpers::allocate(
+        size, nothrow, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](
+    std::size_t size, std::align_val_t alignment, const std::nothrow_t &nothrow) noexcept
+{
+    return operation_log::helpers::allocate(
+        size, nothrow, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+
+#endif // __cpp_aligned_new
+
+#endif // OPERATION_LOG_ACCOUNT_MALLOC
+
+#endif // _OPERATION_LOG_ACCOUNT_ALLOCATIONS_H
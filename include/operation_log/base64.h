@@ -0,0 +1,77 @@
+#ifndef _OPERATION_LOG_BASE64_H
+#define _OPERATION_LOG_BASE64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+
+namespace operation_log
+{
+
+class Base64
+{
+    public:
+
+    // Writes the base64 encoding of the bytes (with the standard alphabet,
+    // and `=` padding, which JavaScript's `atob()` decodes).
+    static void write(std::ostream &out, const void *data, std::size_t size)
+    {
+        static const char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        // (A multiple of 4 characters.)
+        char buffer[4096];
+        std::size_t buffer_len = 0;
+        std::size_t byte_i = 0;
+
+        for (; byte_i + 3 <= size; byte_i += 3)
+        {
+            std::uint32_t group =
+                static_cast<std::uint32_t>(bytes[byte_i]) << 16 |
+                static_cast<std::uint32_t>(bytes[byte_i + 1]) << 8 |
+                bytes[byte_i + 2];
+
+            buffer[buffer_len] = alphabet[group >> 18];
+            buffer[buffer_len + 1] = alphabet[(group >> 12) & 63];
+            buffer[buffer_len + 2] = alphabet[(group >> 6) & 63];
+            buffer[buffer_len + 3] = alphabet[group & 63];
+            buffer_len += 4;
+            if (buffer_len == sizeof(buffer))
+            {
+                out.write(buffer, buffer_len);
+                buffer_len = 0;
+            }
+        }
+        if (byte_i < size)
+        {
+            std::uint32_t group = static_cast<std::uint32_t>(bytes[byte_i]) << 16;
+
+            if (byte_i + 1 < size)
+            {
+                group |= static_cast<std::uint32_t>(bytes[byte_i + 1]) << 8;
+            }
+            buffer[buffer_len] = alphabet[group >> 18];
+            buffer[buffer_len + 1] = alphabet[(group >> 12) & 63];
+            buffer[buffer_len + 2] = byte_i + 1 < size ? alphabet[(group >> 6) & 63] : '=';
+            buffer[buffer_len + 3] = '=';
+            buffer_len += 4;
+        }
+        out.write(buffer, buffer_len);
+    }
+
+    static std::string encode(const void *data, std::size_t size)
+    {
+        std::stringstream res;
+
+        write(res, data, size);
+
+        return res.str();
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_BASE64_H
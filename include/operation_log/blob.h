@@ -0,0 +1,376 @@
+#ifndef _OPERATION_LOG_BLOB_H
+#define _OPERATION_LOG_BLOB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "base64.h"
+#include "string_ref.h"
+
+
+namespace operation_log
+{
+
+// A 128 bit hash of a blob's content, which identifies it.
+struct BlobId
+{
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;
+
+    // Returns the id of the data (a MurmurHash3 x64 128 hash).
+    static BlobId get(const void *data, std::size_t size)
+    {
+        const std::uint64_t c1 = 0x87c37b91114253d5ULL;
+        const std::uint64_t c2 = 0x4cf5ad432745937fULL;
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        std::size_t block_c = size / 16;
+        std::uint64_t h1 = 0;
+        std::uint64_t h2 = 0;
+
+        for (std::size_t block_i = 0; block_i < block_c; ++block_i)
+        {
+            std::uint64_t k1;
+            std::uint64_t k2;
+
+            std::memcpy(&k1, bytes + 16 * block_i, 8);
+            std::memcpy(&k2, bytes + 16 * block_i + 8, 8);
+
+            k1 *= c1;
+            k1 = rotate_left(k1, 31);
+            k1 *= c2;
+            h1 ^= k1;
+            h1 = rotate_left(h1, 27);
+            h1 += h2;
+            h1 = h1 * 5 + 0x52dce729;
+
+            k2 *= c2;
+            k2 = rotate_left(k2, 33);
+            k2 *= c1;
+            h2 ^= k2;
+            h2 = rotate_left(h2, 31);
+            h2 += h1;
+            h2 = h2 * 5 + 0x38495ab5;
+        }
+
+        const unsigned char *tail = bytes + 16 * block_c;
+        std::size_t tail_size = size & 15;
+
+        if (tail_size > 8)
+        {
+            std::uint64_t k2 = 0;
+
+            for (std::size_t byte_i = tail_size; byte_i > 8; --byte_i)
+            {
+                k2 ^= static_cast<std::uint64_t>(tail[byte_i - 1]) << (8 * (byte_i - 9));
+            }
+            k2 *= c2;
+            k2 = rotate_left(k2, 33);
+            k2 *= c1;
+            h2 ^= k2;
+        }
+        if (tail_size > 0)
+        {
+            std::uint64_t k1 = 0;
+
+            for (std::size_t byte_i = tail_size < 8 ? tail_size : 8; byte_i > 0; --byte_i)
+            {
+                k1 ^= static_cast<std::uint64_t>(tail[byte_i - 1]) << (8 * (byte_i - 1));
+            }
+            k1 *= c1;
+            k1 = rotate_left(k1, 31);
+            k1 *= c2;
+            h1 ^= k1;
+        }
+
+        h1 ^= size;
+        h2 ^= size;
+        h1 += h2;
+        h2 += h1;
+        h1 = mix(h1);
+        h2 = mix(h2);
+        h1 += h2;
+        h2 += h1;
+
+        BlobId res;
+
+        res.high = h1;
+        res.low = h2;
+
+        return res;
+    }
+
+    bool is_null() const
+    {
+        return high == 0 && low == 0;
+    }
+
+    bool operator==(const BlobId &other) const
+    {
+        return high == other.high && low == other.low;
+    }
+
+    bool operator!=(const BlobId &other) const
+    {
+        return !(*this == other);
+    }
+
+    // Writes the id as 32 hexadecimal digits.
+    void write(std::ostream &out) const
+    {
+        char text[32];
+
+        format(text);
+        out.write(text, sizeof(text));
+    }
+
+    std::string to_string() const
+    {
+        char text[32];
+
+        format(text);
+
+        return std::string(text, sizeof(text));
+    }
+
+    struct Hash
+    {
+        std::size_t operator()(const BlobId &id) const
+        {
+            return static_cast<std::size_t>(id.low);
+        }
+    };
+
+    private:
+
+    void format(char *text) const
+    {
+        const char hex_digits[] = "0123456789abcdef";
+
+        for (int digit_i = 0; digit_i < 16; ++digit_i)
+        {
+            text[15 - digit_i] = hex_digits[(high >> (4 * digit_i)) & 0xF];
+            text[31 - digit_i] = hex_digits[(low >> (4 * digit_i)) & 0xF];
+        }
+    }
+
+    static std::uint64_t rotate_left(std::uint64_t value, int bit_c)
+    {
+        return (value << bit_c) | (value >> (64 - bit_c));
+    }
+
+    static std::uint64_t mix(std::uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+
+        return value;
+    }
+};
+
+// Binary data which HTML messages share, such as the vertices of a mesh drawn
+// in many scenes.
+//
+// The HTML formatters write each distinct blob once, in a
+// `<script type="application/x-operation-log-blob">` element, and messages
+// load it with `operation_log_3js.getBlob(id)` (see `ThreeJsGeometry`).  The
+// id is a hash of the content, so logging the same data again only costs
+// hashing it:
+//
+//     operation_log::Blob blob(data, size);
+//
+//     log.write_blob(blob);
+//     code << "var bytes = operation_log_3js.getBlob(\"" << blob.id << "\");";
+//     log.write_html(code.str());
+//
+// A blob can also carry a delta of the previous version of the data (see
+// `BlobSeries`), which is written instead of the data, if the formatter has
+// written that version.
+struct Blob
+{
+    BlobId id;
+    // The content (which can be empty, if there's a delta):
+    StringRef data;
+    // The content as a delta of the `base_id` blob's content (see
+    // `BlobSeries`), or empty:
+    StringRef delta;
+    BlobId base_id;
+
+    Blob()
+    {}
+
+    Blob(const void *data, std::size_t size)
+    : id(BlobId::get(data, size)),
+    data(static_cast<const char*>(data), size)
+    {}
+};
+
+inline std::ostream& operator<<(std::ostream &out, const BlobId &id)
+{
+    id.write(out);
+
+    return out;
+}
+
+// The versions of data which changes a little at a time (e.g., the vertices
+// of a mesh, which an iterative algorithm moves), as blobs with deltas of the
+// previous version.
+//
+// A delta lists the runs of 32 bit words which changed, so it only helps for
+// data of the same size, made of 32 bit values (like `Float32Array`s).  It's
+// left out, if it isn't less than half the size of the data.  Every
+// `max_chain_length` versions, the data is written in full, so loading a
+// version doesn't apply too many deltas.
+class BlobSeries
+{
+    public:
+
+    explicit BlobSeries(int max_chain_length = 32)
+    : max_chain_length(max_chain_length)
+    {}
+
+    // Returns the blob for the next version of the data.  It refers to
+    // `data`, and to the series' buffers, until the next call.
+    Blob add(const void *data, std::size_t size)
+    {
+        Blob res(data, size);
+        const char *bytes = static_cast<const char*>(data);
+
+        if (res.id == previous_id)
+        {
+            return res;
+        }
+        if (!previous_id.is_null() && previous.size() == size && size % 4 == 0 &&
+            chain_length < max_chain_length && make_delta(bytes, size))
+        {
+            res.delta = StringRef(
+                reinterpret_cast<const char*>(delta.data()), 4 * delta.size());
+            res.base_id = previous_id;
+            ++chain_length;
+        }
+        else
+        {
+            chain_length = 0;
+        }
+        previous.assign(bytes, bytes + size);
+        previous_id = res.id;
+
+        return res;
+    }
+
+    private:
+
+    int max_chain_length;
+    int chain_length = 0;
+    std::vector<char> previous;
+    BlobId previous_id;
+    // Runs of changed words: the offset, and count of words (little endian),
+    // followed by the words.
+    std::vector<std::uint32_t> delta;
+
+    // Returns whether the delta is less than half the size of the data.
+    bool make_delta(const char *bytes, std::size_t size)
+    {
+        const std::size_t word_c = size / 4;
+        const std::size_t max_delta_word_c = word_c / 2;
+
+        delta.clear();
+        for (std::size_t word_i = 0; word_i < word_c; )
+        {
+            if (std::memcmp(bytes + 4 * word_i, &previous[4 * word_i], 4) == 0)
+            {
+                ++word_i;
+                continue;
+            }
+
+            // Runs are joined across up to 2 unchanged words, which take as
+            // much space as a new run's offset, and count:
+            std::size_t run_end = word_i + 1;
+
+            for (std::size_t next_i = run_end; next_i < word_c && next_i <= run_end + 2; ++next_i)
+            {
+                if (std::memcmp(bytes + 4 * next_i, &previous[4 * next_i], 4) != 0)
+                {
+                    run_end = next_i + 1;
+                }
+            }
+            if (delta.size() + 2 + (run_end - word_i) >= max_delta_word_c)
+            {
+                return false;
+            }
+
+            std::size_t run_offset = delta.size() + 2;
+
+            delta.push_back(to_little_endian(static_cast<std::uint32_t>(word_i)));
+            delta.push_back(to_little_endian(static_cast<std::uint32_t>(run_end - word_i)));
+            delta.resize(run_offset + run_end - word_i);
+            std::memcpy(&delta[run_offset], bytes + 4 * word_i, 4 * (run_end - word_i));
+            word_i = run_end;
+        }
+
+        return true;
+    }
+
+    static std::uint32_t to_little_endian(std::uint32_t value)
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_bswap32(value);
+#else
+        return value;
+#endif
+    }
+};
+
+// Writes blobs as HTML `<script>` elements, once for each id.
+class HtmlBlobWriter
+{
+    public:
+
+    // Writes the blob, unless one with the same id was written.  A delta is
+    // written instead of the data, if its base was written (or there's no
+    // data).
+    void write(std::ostream &out, const Blob &blob)
+    {
+        if (written_ids.count(blob.id) > 0)
+        {
+            return;
+        }
+
+        bool is_delta_written =
+            !blob.base_id.is_null() &&
+            (blob.data.size() == 0 || written_ids.count(blob.base_id) > 0);
+
+        out << "<script type=\"application/x-operation-log-blob\" id=\"operation-log-blob-" <<
+            blob.id << '"';
+        if (is_delta_written)
+        {
+            out << " data-base=\"" << blob.base_id << '"';
+        }
+        out << '>';
+        if (is_delta_written)
+        {
+            Base64::write(out, blob.delta.data(), blob.delta.size());
+        }
+        else
+        {
+            Base64::write(out, blob.data.data(), blob.data.size());
+        }
+        out << "</script>" << std::endl;
+        written_ids.insert(blob.id);
+    }
+
+    private:
+
+    std::unordered_set<BlobId, BlobId::Hash> written_ids;
+};
+
+}
+
+#endif // _OPERATION_LOG_BLOB_H
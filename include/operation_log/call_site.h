@@ -0,0 +1,448 @@
+#ifndef _OPERATION_LOG_CALL_SITE_H
+#define _OPERATION_LOG_CALL_SITE_H
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "function_info.h"
+#include "function_name_filter.h"
+#include "glob.h"
+#include "heap_accounting.h"
+#include "levels.h"
+
+
+namespace operation_log
+{
+
+// A location in the source code where an operation log macro is used.
+//
+// Each `OPERATION_LOG_*` macro defines a static `CallSite` object.  It has a
+// `constexpr` constructor, so it's initialized at compile time, and checking
+// it doesn't need a static initialization guard.
+//
+// A call site registers itself with the `CallSiteRegistry` the first time
+// it's reached.  After that, checking whether the call site is enabled costs
+// a single relaxed atomic load.  (The run-time level threshold is folded into
+// the same flag.)
+//
+// The registry also parses the function information for the call site once,
+// so logging from an enabled call site doesn't parse, or copy any strings.
+class CallSite
+{
+public:
+    enum State : unsigned char
+    {
+        state_disabled = 0,
+        state_enabled = 1,
+        state_unregistered = 2
+    };
+
+    // `stringified_args` is the stringified list of logged arguments, or
+    // variables (e.g., `"x, y"`).
+    constexpr CallSite(
+        const char *file, int line, const char *pretty_function,
+        int level = OPERATION_LOG_LEVEL_INFO, const char *stringified_args = "")
+    : file(file),
+    line(line),
+    pretty_function(pretty_function),
+    stringified_args(stringified_args),
+    level(level),
+    state(state_unregistered),
+    function_info(nullptr)
+    {}
+
+    CallSite(const CallSite &) = delete;
+    CallSite& operator=(const CallSite &) = delete;
+
+    inline bool is_enabled()
+    {
+        unsigned char current_state = state.load(std::memory_order_relaxed);
+
+        if (__builtin_expect(current_state == state_disabled, 1))
+        {
+            return false;
+        }
+        if (current_state == state_enabled)
+        {
+            return true;
+        }
+
+        return register_site();
+    }
+
+    inline const char* get_file() const
+    {
+        return file;
+    }
+
+    inline int get_line() const
+    {
+        return line;
+    }
+
+    inline const char* get_pretty_function() const
+    {
+        return pretty_function;
+    }
+
+    inline const char* get_stringified_args() const
+    {
+        return stringified_args;
+    }
+
+    inline int get_level() const
+    {
+        return level;
+    }
+
+    // Returns the parsed function information, with the logged argument, or
+    // variable names as the argument names.
+    inline const FunctionInfo& get_function_info()
+    {
+        const FunctionInfo *res = function_info.load(std::memory_order_acquire);
+
+        if (__builtin_expect(res != nullptr, 1))
+        {
+            return *res;
+        }
+
+        return find_function_info();
+    }
+
+private:
+    friend class CallSiteRegistry;
+
+    const char *file;
+    int line;
+    const char *pretty_function;
+    const char *stringified_args;
+    int level;
+    std::atomic<unsigned char> state;
+    // Owned by the registry:
+    std::atomic<const FunctionInfo*> function_info;
+
+    bool register_site();
+
+    const FunctionInfo& find_function_info();
+};
+
+// A description of a registered call site returned by
+// `CallSiteRegistry::list_sites()`.
+struct CallSiteDescription
+{
+    std::string file;
+    int line;
+    std::string function_name;
+    int level;
+    bool is_enabled;
+};
+
+// A class that keeps track of all operation log call sites that have been
+// reached, and switches them on and off at run time.
+//
+// Call sites can be switched by a glob pattern (see `Glob`) over either the
+// full name of the function they're in (e.g., `mesh::*`), or their location
+// (e.g., `*/mesh.cpp:*`).  Switching rules are remembered, and applied, in
+// order, to call sites that are reached later, so you can disable a whole
+// namespace before any of its code has run.
+//
+// Before the switching rules, call sites are selected by a
+// `FunctionNameFilter` over their function names.  It's evaluated once per
+// call site, when the site is registered, or the filter is replaced.  At
+// start up, the filter rules are read from the environment variables named
+// by `FunctionNameFilter::rules_environment_variable`, and
+// `FunctionNameFilter::rules_file_environment_variable`.
+//
+// A global master switch, and a run-time level threshold override the
+// per-site switches.  At start up, the threshold is read from the environment
+// variable named by `level_environment_variable` (`trace`, `debug`, or
+// `info`).
+//
+// All methods are thread-safe.
+class CallSiteRegistry
+{
+public:
+    static constexpr const char *level_environment_variable = "OPERATION_LOG_LEVEL";
+
+    static CallSiteRegistry& get()
+    {
+        static CallSiteRegistry instance;
+
+        return instance;
+    }
+
+    CallSiteRegistry()
+    {
+        const char *rules_text =
+            std::getenv(FunctionNameFilter::rules_environment_variable);
+        const char *rules_file_path =
+            std::getenv(FunctionNameFilter::rules_file_environment_variable);
+
+        const char *level_name = std::getenv(level_environment_variable);
+
+        if (level_name && !parse_level(level_name, min_level))
+        {
+            std::cerr << "operation_log: Unknown log level: " <<
+                level_name << std::endl;
+        }
+        startup_min_level = min_level;
+        if (rules_text)
+        {
+            filter.add_rules(rules_text);
+        }
+        if (rules_file_path && !filter.add_rules_from_file(rules_file_path))
+        {
+            std::cerr << "operation_log: Can't read the filter rules file: " <<
+                rules_file_path << std::endl;
+        }
+    }
+
+    // Replaces the function name filter, and re-evaluates it for all
+    // registered call sites.
+    void set_filter(const FunctionNameFilter &value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        filter = value;
+        for (Entry &entry : sites)
+        {
+            evaluate(entry);
+        }
+    }
+
+    bool is_master_enabled()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return master_enabled;
+    }
+
+    void set_master_enabled(bool value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        master_enabled = value;
+        for (Entry &entry : sites)
+        {
+            update_state(entry);
+        }
+    }
+
+    int get_min_level()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return min_level;
+    }
+
+    // Disables all call sites below the given level (e.g.,
+    // `OPERATION_LOG_LEVEL_DEBUG`).
+    void set_min_level(int value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        min_level = value;
+        for (Entry &entry : sites)
+        {
+            update_state(entry);
+        }
+    }
+
+    // Parses a level name (`trace`, `debug`, or `info`).
+    static bool parse_level(const std::string &name, int &level)
+    {
+        if (name == "trace")
+        {
+            level = OPERATION_LOG_LEVEL_TRACE;
+        }
+        else if (name == "debug")
+        {
+            level = OPERATION_LOG_LEVEL_DEBUG;
+        }
+        else if (name == "info")
+        {
+            level = OPERATION_LOG_LEVEL_INFO;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    // Enables, or disables all call sites whose function name, or location
+    // (`file:line`) match the given glob pattern.
+    //
+    // Returns the number of already registered call sites that matched.
+    std::size_t set_enabled(const std::string &pattern, bool value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::size_t match_c = 0;
+
+        rules.push_back(Rule { pattern, value });
+        for (Entry &entry : sites)
+        {
+            if (rule_matches(rules.back(), entry))
+            {
+                entry.is_requested = value;
+                update_state(entry);
+                ++match_c;
+            }
+        }
+
+        return match_c;
+    }
+
+    // Forgets all switching rules, turns the master switch on, and resets the
+    // level threshold to the one read from `OPERATION_LOG_LEVEL` at startup.
+    // Call sites are left as selected by the function name filter.
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        rules.clear();
+        master_enabled = true;
+        min_level = startup_min_level;
+        for (Entry &entry : sites)
+        {
+            evaluate(entry);
+        }
+    }
+
+    std::vector<CallSiteDescription> list_sites()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<CallSiteDescription> res;
+
+        res.reserve(sites.size());
+        for (const Entry &entry : sites)
+        {
+            res.push_back(CallSiteDescription {
+                entry.site->file,
+                entry.site->line,
+                entry.function_info->get_full_name(),
+                entry.site->level,
+                entry.site->state.load(std::memory_order_relaxed) ==
+                    CallSite::state_enabled });
+        }
+
+        return res;
+    }
+
+    // Adds a call site to the registry, and returns whether it's enabled.
+    bool register_site(CallSite &site)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        std::lock_guard<std::mutex> lock(mutex);
+        unsigned char state = site.state.load(std::memory_order_relaxed);
+
+        if (state != CallSite::state_unregistered)
+        {
+            // Another thread registered the site first.
+            return state == CallSite::state_enabled;
+        }
+
+        std::unique_ptr<FunctionInfo> function_info(
+            new FunctionInfo(site.pretty_function, site.stringified_args));
+
+        site.function_info.store(function_info.get(), std::memory_order_release);
+        sites.push_back(Entry {
+            &site,
+            std::move(function_info),
+            std::string(site.file) + ":" + std::to_string(site.line),
+            true });
+
+        evaluate(sites.back());
+
+        return site.state.load(std::memory_order_relaxed) ==
+            CallSite::state_enabled;
+    }
+
+    // Returns the parsed function information of a call site, registering
+    // it first, if needed.
+    const FunctionInfo& get_function_info(CallSite &site)
+    {
+        if (site.state.load(std::memory_order_relaxed) ==
+            CallSite::state_unregistered)
+        {
+            register_site(site);
+        }
+
+        // The lock makes the registering thread's writes visible:
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return *site.function_info.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry
+    {
+        CallSite *site;
+        std::unique_ptr<FunctionInfo> function_info;
+        std::string location;
+        bool is_requested;
+    };
+
+    struct Rule
+    {
+        std::string pattern;
+        bool is_enabled;
+    };
+
+    std::mutex mutex;
+    FunctionNameFilter filter;
+    bool master_enabled = true;
+    int min_level = OPERATION_LOG_LEVEL_TRACE;
+    // The threshold `reset()` restores:
+    int startup_min_level = OPERATION_LOG_LEVEL_TRACE;
+    std::vector<Entry> sites;
+    std::vector<Rule> rules;
+
+    static bool rule_matches(const Rule &rule, const Entry &entry)
+    {
+        return Glob::matches(rule.pattern, entry.function_info->get_full_name()) ||
+            Glob::matches(rule.pattern, entry.location);
+    }
+
+    void evaluate(Entry &entry)
+    {
+        entry.is_requested = filter.matches(entry.function_info->get_full_name());
+        for (const Rule &rule : rules)
+        {
+            if (rule_matches(rule, entry))
+            {
+                entry.is_requested = rule.is_enabled;
+            }
+        }
+        update_state(entry);
+    }
+
+    void update_state(Entry &entry)
+    {
+        entry.site->state.store(
+            master_enabled && entry.is_requested &&
+                entry.site->level >= min_level ?
+                CallSite::state_enabled : CallSite::state_disabled,
+            std::memory_order_relaxed);
+    }
+};
+
+inline bool CallSite::register_site()
+{
+    return CallSiteRegistry::get().register_site(*this);
+}
+
+inline const FunctionInfo& CallSite::find_function_info()
+{
+    return CallSiteRegistry::get().get_function_info(*this);
+}
+
+}
+
+#endif // _OPERATION_LOG_CALL_SITE_H
@@ -0,0 +1,203 @@
+#ifndef _OPERATION_LOG_CHAR_SEARCH_H
+#define _OPERATION_LOG_CHAR_SEARCH_H
+
+// Searching for characters 32 (AVX2), or 16 (SSE2) bytes at a time, when the
+// compiler targets those instruction sets.  Define
+// `OPERATION_LOG_DISABLE_SIMD` to search one character at a time.
+#if !defined(OPERATION_LOG_DISABLE_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define OPERATION_LOG_CHAR_SEARCH_AVX2
+#define OPERATION_LOG_CHAR_SEARCH_SSE2
+#elif !defined(OPERATION_LOG_DISABLE_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define OPERATION_LOG_CHAR_SEARCH_SSE2
+#endif
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+
+namespace operation_log
+{
+
+namespace helpers
+{
+
+// Writes characters to a stream, or appends them to a string, so escaping
+// code can produce either.
+inline void append(std::ostream &out, const char *value, std::size_t len)
+{
+    out.write(value, static_cast<std::streamsize>(len));
+}
+
+inline void append(std::string &out, const char *value, std::size_t len)
+{
+    out.append(value, len);
+}
+
+}
+
+class CharSearch
+{
+    public:
+
+    // Returns the first character in `[begin, end)` which is one of `Chars`,
+    // or `end`, if there's none.
+    template <char... Chars>
+    static const char* find_first_of(const char *begin, const char *end)
+    {
+        return find<false, Chars...>(begin, end);
+    }
+
+    // Returns the first control character (below 0x20), or one of `Chars`
+    // in `[begin, end)`, or `end`, if there's none.
+    template <char... Chars>
+    static const char* find_first_control_or_of(const char *begin, const char *end)
+    {
+        return find<true, Chars...>(begin, end);
+    }
+
+    private:
+
+    template <bool IsControlSearched, char... Chars>
+    static const char* find(const char *begin, const char *end)
+    {
+        const char *p = begin;
+
+#ifdef OPERATION_LOG_CHAR_SEARCH_SSE2
+        typedef std::integral_constant<bool, IsControlSearched> IsControlSearchedType;
+#endif
+
+#ifdef OPERATION_LOG_CHAR_SEARCH_AVX2
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            unsigned mask = static_cast<unsigned>(
+                _mm256_movemask_epi8(_mm256_or_si256(
+                    match<Chars...>(chunk),
+                    match_control(chunk, IsControlSearchedType()))));
+
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+#endif
+#ifdef OPERATION_LOG_CHAR_SEARCH_SSE2
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            unsigned mask = static_cast<unsigned>(
+                _mm_movemask_epi8(_mm_or_si128(
+                    match<Chars...>(chunk),
+                    match_control(chunk, IsControlSearchedType()))));
+
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+#endif
+        const bool *is_searched =
+            CharTable<IsControlSearched, Chars...>::get().is_searched;
+
+        for (; p < end; ++p)
+        {
+            if (is_searched[static_cast<unsigned char>(*p)])
+            {
+                return p;
+            }
+        }
+
+        return end;
+    }
+
+    template <bool IsControlSearched, char... Chars>
+    struct CharTable
+    {
+        bool is_searched[256];
+
+        CharTable()
+        : is_searched()
+        {
+            const char chars[] = { Chars... };
+
+            for (int ch = 0; ch < 0x20; ++ch)
+            {
+                is_searched[ch] = IsControlSearched;
+            }
+
+            for (char ch : chars)
+            {
+                is_searched[static_cast<unsigned char>(ch)] = true;
+            }
+        }
+
+        static const CharTable& get()
+        {
+            static const CharTable table;
+
+            return table;
+        }
+    };
+
+#ifdef OPERATION_LOG_CHAR_SEARCH_SSE2
+    // Returns 0xFF for the bytes equal to one of `Chars`, and 0 for the rest.
+    template <char Char>
+    static __m128i match(__m128i chunk)
+    {
+        return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(Char));
+    }
+
+    template <char Char, char NextChar, char... OtherChars>
+    static __m128i match(__m128i chunk)
+    {
+        return _mm_or_si128(match<Char>(chunk), match<NextChar, OtherChars...>(chunk));
+    }
+
+    // Returns 0xFF for the bytes below 0x20.
+    static __m128i match_control(__m128i chunk, std::true_type)
+    {
+        const __m128i max_control = _mm_set1_epi8(0x1F);
+
+        return _mm_cmpeq_epi8(_mm_max_epu8(chunk, max_control), max_control);
+    }
+
+    static __m128i match_control(__m128i, std::false_type)
+    {
+        return _mm_setzero_si128();
+    }
+#endif
+
+#ifdef OPERATION_LOG_CHAR_SEARCH_AVX2
+    template <char Char>
+    static __m256i match(__m256i chunk)
+    {
+        return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(Char));
+    }
+
+    template <char Char, char NextChar, char... OtherChars>
+    static __m256i match(__m256i chunk)
+    {
+        return _mm256_or_si256(match<Char>(chunk), match<NextChar, OtherChars...>(chunk));
+    }
+
+    static __m256i match_control(__m256i chunk, std::true_type)
+    {
+        const __m256i max_control = _mm256_set1_epi8(0x1F);
+
+        return _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, max_control), max_control);
+    }
+
+    static __m256i match_control(__m256i, std::false_type)
+    {
+        return _mm256_setzero_si256();
+    }
+#endif
+};
+
+}
+
+#endif // _OPERATION_LOG_CHAR_SEARCH_H
@@ -0,0 +1,957 @@
+#ifndef _OPERATION_LOG_DEFERRED_FORMATTER_H
+#define _OPERATION_LOG_DEFERRED_FORMATTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "blob.h"
+#include "formatter_base.h"
+#include "function_info.h"
+#include "message_stream_pool.h"
+#include "string_ref.h"
+#include "value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// A formatter which records log events on the logging thread, and passes
+// them to another formatter on a background thread.
+//
+// Values which can be captured (see `ValueCapture`, and
+// `IsTriviallyCapturable`) are copied as raw bytes, together with functions
+// that format them with their `ValueFormatter` on the background thread.
+// Other values are formatted right away, the way the target formatter
+// formats values (see `FormatterBase::write_value()`), and their text is
+// recorded instead.
+//
+// Each logging thread writes its events to its own ring buffer, which is
+// removed, once the thread has exited, and its events are written.  The
+// background thread passes events to the target formatter in the order they
+// were logged.  (Events logged by different threads at the same time can be
+// reordered slightly.)  When a thread's buffer is full, the thread waits for
+// the background thread to catch up.  An event too large for the buffer is
+// written to the target formatter directly, after all earlier events.
+//
+// While the deferred formatter exists, the target formatter should only be
+// used through it.  Destroying the deferred formatter writes all pending
+// events.  Use it like:
+//
+//     static operation_log::HtmlFormatter html_formatter(output_stream);
+//     static operation_log::DeferredFormatter formatter(html_formatter);
+//
+//     log.set_formatter(formatter);
+class DeferredFormatter : public FormatterBase
+{
+public:
+    // The default size of each thread's buffer in bytes:
+    static const std::size_t default_buffer_capacity = 1 << 20;
+
+    DeferredFormatter(
+        FormatterBase &target,
+        std::size_t buffer_capacity = default_buffer_capacity)
+    : FormatterBase(target.get_output_stream()),
+    target(target),
+    buffer_capacity(round_up_to_power_of_2(std::max<std::size_t>(buffer_capacity, 4096))),
+    id(get_next_id()),
+    consumer_thread(&DeferredFormatter::consume, this)
+    {}
+
+    DeferredFormatter(const DeferredFormatter &) = delete;
+    DeferredFormatter& operator=(const DeferredFormatter &) = delete;
+
+    ~DeferredFormatter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+
+            is_stopping = true;
+        }
+        wake_condition.notify_one();
+        consumer_thread.join();
+    }
+
+    FormatterBase& get_target()
+    {
+        return target;
+    }
+
+    // Returns the number of threads' buffers (including the ones of exited
+    // threads, which haven't been drained yet).
+    std::size_t get_thread_buffer_count()
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+
+        return thread_buffers.size();
+    }
+
+    // Waits until all events logged by this thread so far have been passed
+    // to the target formatter.
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(state_mutex);
+        std::uint64_t ticket = ++flush_requested_c;
+
+        wake_condition.notify_one();
+        drained_condition.wait(lock, [&]() { return flush_done_c >= ticket; });
+    }
+
+    void write_message(StringRef message) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(record_message, 0);
+        record.add_string(message);
+        publish(record, nullptr, [&]() { target.write_message(message); });
+    }
+
+    void write_html(StringRef code) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(record_html, 0);
+        record.add_string(code);
+        publish(record, nullptr, [&]() { target.write_html(code); });
+    }
+
+    // Blobs the target formatter has been passed already are left out here,
+    // so they aren't copied again.
+    void write_blob(const Blob &blob) override
+    {
+        bool is_delta_written;
+
+        {
+            std::lock_guard<std::mutex> lock(blob_ids_mutex);
+
+            if (!written_blob_ids.insert(blob.id).second)
+            {
+                return;
+            }
+            is_delta_written =
+                !blob.base_id.is_null() &&
+                (blob.data.size() == 0 || written_blob_ids.count(blob.base_id) > 0);
+        }
+
+        RecordBuilder &record = RecordBuilder::get();
+        BlobId base_id = is_delta_written ? blob.base_id : BlobId();
+
+        record.begin(record_blob, 0);
+        record.add_string(StringRef(reinterpret_cast<const char*>(&blob.id), sizeof(BlobId)));
+        record.add_string(StringRef(reinterpret_cast<const char*>(&base_id), sizeof(BlobId)));
+        record.add_string(is_delta_written ? blob.delta : blob.data);
+        publish(record, nullptr, [&]() { target.write_blob(blob); });
+    }
+
+    void dump_values(
+        const std::vector<std::string> &names,
+        ValueFormatterI *const *values, std::size_t value_count) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(record_dump_values, value_count);
+        for (std::size_t var_i = 0; var_i < value_count; ++var_i)
+        {
+            record.add_string(names[var_i]);
+        }
+        add_values(record, values, value_count);
+        publish(record, nullptr,
+            [&]() { target.dump_values(names, values, value_count); });
+    }
+
+    void log_function_entry_values(
+        const FunctionInfo &function_info,
+        ValueFormatterI *const *values, std::size_t value_count) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(record_function_entry, value_count);
+        record.add_function_info();
+        add_values(record, values, value_count);
+        publish(record, &function_info,
+            [&]() { target.log_function_entry_values(function_info, values, value_count); });
+    }
+
+    void enter_function() override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(record_enter_function, 0);
+        publish(record, nullptr, [&]() { target.enter_function(); });
+    }
+
+    void log_function_exit(const FunctionInfo &function_info) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(record_function_exit, 0);
+        record.add_function_info();
+        publish(record, &function_info,
+            [&]() { target.log_function_exit(function_info); });
+    }
+
+    void exit_function() override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(record_exit_function, 0);
+        publish(record, nullptr, [&]() { target.exit_function(); });
+    }
+
+    void write_value(std::ostream &out, ValueFormatterI &value_formatter) const override
+    {
+        target.write_value(out, value_formatter);
+    }
+
+    // Writes the pending events, and holds the locks the background thread
+    // uses, so the child process gets them unlocked.
+    void prepare_fork() override
+    {
+        flush();
+        target.prepare_fork();
+        buffers_mutex.lock();
+        blob_ids_mutex.lock();
+        target_mutex.lock();
+        state_mutex.lock();
+    }
+
+    void after_fork_in_parent() override
+    {
+        state_mutex.unlock();
+        target_mutex.unlock();
+        blob_ids_mutex.unlock();
+        buffers_mutex.unlock();
+        target.after_fork_in_parent();
+    }
+
+    // The background thread doesn't exist in the child, so a new one is
+    // started (after the events other threads logged since `prepare_fork()`
+    // are discarded, since the parent writes them).
+    void after_fork_in_child() override
+    {
+        state_mutex.unlock();
+        target_mutex.unlock();
+        blob_ids_mutex.unlock();
+        buffers_mutex.unlock();
+        target.after_fork_in_child();
+
+        // The other threads don't exist in the child, so their buffers are
+        // retired:
+        std::shared_ptr<ThreadBuffer> own_buffer = ThreadBufferOwner::get().find(id);
+
+        for (const std::shared_ptr<ThreadBuffer> &buffer : thread_buffers)
+        {
+            buffer->read_position.store(
+                buffer->write_position.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+            if (buffer != own_buffer)
+            {
+                buffer->is_retired.store(true, std::memory_order_relaxed);
+            }
+        }
+        flush_done_c = flush_requested_c;
+        // The vanished thread may have been waiting on the conditions, and
+        // its `std::thread` can't be joined, or destroyed:
+        new (&wake_condition) std::condition_variable();
+        new (&drained_condition) std::condition_variable();
+        new (&consumer_thread) std::thread(&DeferredFormatter::consume, this);
+    }
+
+protected:
+    // This formatter passes events on, instead of writing them:
+    void write_message_value(StringRef message) override
+    {}
+
+    void write_dump_var(
+        const std::string &name, ValueFormatterI &value_formatter) override
+    {}
+
+    void write_function_return_type_and_name(
+        const std::string &return_type, const std::string &name) override
+    {}
+
+    void write_function_args_prefix() override
+    {}
+
+    void write_function_args_suffix() override
+    {}
+
+    void write_function_arg(
+        const std::string &type_name, const std::string &parameter_name,
+        ValueFormatterI &value_formatter) override
+    {}
+
+    void write_function_extra_info(const std::string &info) override
+    {}
+
+private:
+    enum RecordType : std::uint16_t
+    {
+        record_padding,
+        record_message,
+        record_html,
+        record_dump_values,
+        record_function_entry,
+        record_enter_function,
+        record_function_exit,
+        record_exit_function,
+        record_blob
+    };
+
+    // Records, and their parts are aligned to this many bytes:
+    static const std::size_t alignment = 16;
+
+    struct RecordHeader
+    {
+        std::uint32_t size;
+        std::uint16_t type;
+        std::uint16_t value_count;
+        std::uint64_t sequence_number;
+    };
+
+    struct ValueHeader
+    {
+        const CapturedValueType *type;
+        std::uint64_t size;
+    };
+
+    // Builds a record in a per-thread buffer, before it's copied to a ring
+    // buffer.
+    class RecordBuilder : public ValueCaptureSinkI
+    {
+    public:
+        std::size_t size = 0;
+        // Where the record's `FunctionInfo` goes, if it has one:
+        std::size_t function_info_offset = 0;
+
+        static RecordBuilder& get()
+        {
+            static thread_local RecordBuilder instance;
+
+            return instance;
+        }
+
+        const char* data() const
+        {
+            return bytes.data();
+        }
+
+        RecordHeader& get_header()
+        {
+            return *reinterpret_cast<RecordHeader*>(bytes.data());
+        }
+
+        void begin(RecordType type, std::size_t value_count)
+        {
+            size = 0;
+            function_info_offset = 0;
+            new (add(sizeof(RecordHeader))) RecordHeader {
+                0, type, static_cast<std::uint16_t>(value_count), 0 };
+        }
+
+        void add_string(StringRef value)
+        {
+            *reinterpret_cast<std::uint64_t*>(add(sizeof(std::uint64_t))) =
+                value.size();
+            std::memcpy(add(value.size()), value.data(), value.size());
+        }
+
+        void add_function_info()
+        {
+            function_info_offset = size;
+            add(sizeof(FunctionInfo));
+        }
+
+        char* add_value(const CapturedValueType &type, std::size_t value_size) override
+        {
+            new (add(sizeof(ValueHeader))) ValueHeader { &type, value_size };
+
+            return add(value_size);
+        }
+
+    private:
+        std::vector<char> bytes = std::vector<char>(1024);
+
+        // Returns where to write `count` more bytes.
+        char* add(std::size_t count)
+        {
+            std::size_t offset = size;
+
+            size += align(count);
+            if (size > bytes.size())
+            {
+                bytes.resize(std::max(size, 2 * bytes.size()));
+            }
+
+            return bytes.data() + offset;
+        }
+    };
+
+    // A single producer, single consumer ring buffer of records.
+    struct ThreadBuffer
+    {
+        std::vector<char> bytes;
+        // Positions grow without wrapping around.  The offset in `bytes` is
+        // the position modulo the capacity:
+        std::atomic<std::size_t> write_position;
+        std::atomic<std::size_t> read_position;
+        // Set, after the last write, when the thread exits:
+        std::atomic<bool> is_retired;
+
+        ThreadBuffer(std::size_t capacity)
+        : bytes(capacity),
+        write_position(0),
+        read_position(0),
+        is_retired(false)
+        {}
+
+        char* at(std::size_t position)
+        {
+            return bytes.data() + (position & (bytes.size() - 1));
+        }
+    };
+
+    // The buffers of a thread in each deferred formatter, by the formatter's
+    // id.  When the thread exits, it retires its buffers, so the background
+    // threads remove them, once they have written their events.
+    class ThreadBufferOwner
+    {
+    public:
+        static ThreadBufferOwner& get()
+        {
+            static thread_local ThreadBufferOwner instance;
+
+            return instance;
+        }
+
+        ~ThreadBufferOwner()
+        {
+            for (const Entry &entry : entries)
+            {
+                if (std::shared_ptr<ThreadBuffer> buffer = entry.buffer.lock())
+                {
+                    buffer->is_retired.store(true, std::memory_order_release);
+                }
+            }
+        }
+
+        std::shared_ptr<ThreadBuffer> find(std::uint64_t formatter_id) const
+        {
+            for (const Entry &entry : entries)
+            {
+                if (entry.formatter_id == formatter_id)
+                {
+                    return entry.buffer.lock();
+                }
+            }
+
+            return nullptr;
+        }
+
+        // (The entries of destroyed formatters are removed.)
+        void add(std::uint64_t formatter_id, const std::shared_ptr<ThreadBuffer> &buffer)
+        {
+            entries.erase(
+                std::remove_if(
+                    entries.begin(), entries.end(),
+                    [](const Entry &entry) { return entry.buffer.expired(); }),
+                entries.end());
+            entries.push_back(Entry { formatter_id, buffer });
+        }
+
+    private:
+        struct Entry
+        {
+            std::uint64_t formatter_id;
+            std::weak_ptr<ThreadBuffer> buffer;
+        };
+
+        std::vector<Entry> entries;
+    };
+
+    // Formats a value from its captured bytes on the background thread.
+    class CapturedValueFormatter : public ValueFormatterI
+    {
+    public:
+        const CapturedValueType *type;
+        const char *bytes;
+        std::size_t size;
+
+        std::string to_text() override
+        {
+            std::stringstream res;
+
+            write_text(res);
+
+            return res.str();
+        }
+
+        std::string to_html() override
+        {
+            std::stringstream res;
+
+            write_html(res);
+
+            return res.str();
+        }
+
+        void write_text(std::ostream &out) override
+        {
+            type->write_text(bytes, size, out);
+        }
+
+        void write_html(std::ostream &out) override
+        {
+            type->write_html(bytes, size, out);
+        }
+    };
+
+    FormatterBase &target;
+    std::size_t buffer_capacity;
+    std::uint64_t id;
+    std::atomic<std::uint64_t> next_sequence_number { 0 };
+
+    // Guards `thread_buffers`:
+    std::mutex buffers_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> thread_buffers;
+    std::atomic<std::uint64_t> buffers_generation { 0 };
+
+    // Guards the target formatter:
+    std::mutex target_mutex;
+
+    // Guards `written_blob_ids`:
+    std::mutex blob_ids_mutex;
+    std::unordered_set<BlobId, BlobId::Hash> written_blob_ids;
+
+    // Guards the consumer thread's state:
+    std::mutex state_mutex;
+    std::condition_variable wake_condition;
+    std::condition_variable drained_condition;
+    bool is_stopping = false;
+    std::uint64_t flush_requested_c = 0;
+    std::uint64_t flush_done_c = 0;
+
+    // Reused by the consumer thread:
+    std::vector<std::string> replayed_names;
+    std::vector<CapturedValueFormatter> replayed_values;
+    std::vector<ValueFormatterI*> replayed_value_pointers;
+
+    // Started last, after the other members are initialized:
+    std::thread consumer_thread;
+
+    static std::size_t align(std::size_t size)
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    static std::size_t round_up_to_power_of_2(std::size_t value)
+    {
+        std::size_t res = 1;
+
+        while (res < value)
+        {
+            res *= 2;
+        }
+
+        return res;
+    }
+
+    static std::uint64_t get_next_id()
+    {
+        static std::atomic<std::uint64_t> next_id { 1 };
+
+        return next_id++;
+    }
+
+    // Writes values which were recorded as text:
+    static void write_preformatted(const char *bytes, std::size_t size, std::ostream &out)
+    {
+        out.write(bytes, size);
+    }
+
+    static const CapturedValueType& get_preformatted_type()
+    {
+        static const CapturedValueType type = { &write_preformatted, &write_preformatted };
+
+        return type;
+    }
+
+    void add_values(
+        RecordBuilder &record, ValueFormatterI *const *values, std::size_t value_count)
+    {
+        for (std::size_t value_i = 0; value_i < value_count; ++value_i)
+        {
+            if (values[value_i]->capture(record))
+            {
+                continue;
+            }
+
+            // Format the value right away:
+            MessageStreamPool::Slot &slot = MessageStreamPool::get().acquire();
+
+            NumberFormat::set(slot.stream, target.get_number_format());
+            target.write_value(slot.stream, *values[value_i]);
+
+            StringRef text = slot.buffer.view();
+
+            std::memcpy(
+                record.add_value(get_preformatted_type(), text.size()),
+                text.data(), text.size());
+            MessageStreamPool::get().release(slot);
+        }
+    }
+
+    ThreadBuffer& get_thread_buffer()
+    {
+        struct Cache
+        {
+            std::uint64_t formatter_id;
+            ThreadBuffer *buffer;
+        };
+        static thread_local Cache cache = { 0, nullptr };
+
+        if (cache.formatter_id == id)
+        {
+            return *cache.buffer;
+        }
+
+        ThreadBufferOwner &owner = ThreadBufferOwner::get();
+        std::shared_ptr<ThreadBuffer> buffer = owner.find(id);
+
+        if (!buffer)
+        {
+            buffer = std::make_shared<ThreadBuffer>(buffer_capacity);
+            owner.add(id, buffer);
+
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+
+            thread_buffers.push_back(buffer);
+            ++buffers_generation;
+        }
+        cache = Cache { id, buffer.get() };
+
+        return *buffer;
+    }
+
+    // Copies a record to this thread's ring buffer.  If it doesn't fit, calls
+    // `write_directly()` after all earlier events have been written.
+    template <typename WriteDirectlyT>
+    void publish(
+        RecordBuilder &record, const FunctionInfo *function_info,
+        WriteDirectlyT write_directly)
+    {
+        if (record.size > buffer_capacity / 2)
+        {
+            flush();
+
+            std::lock_guard<std::mutex> lock(target_mutex);
+
+            write_directly();
+
+            return;
+        }
+
+        ThreadBuffer &buffer = get_thread_buffer();
+        std::size_t write_position = buffer.write_position.load(std::memory_order_relaxed);
+        std::size_t space_to_end =
+            buffer_capacity - (write_position & (buffer_capacity - 1));
+        std::size_t padding_size = space_to_end < record.size ? space_to_end : 0;
+
+        wait_for_space(buffer, write_position, padding_size + record.size);
+        if (padding_size > 0)
+        {
+            new (buffer.at(write_position)) RecordHeader {
+                static_cast<std::uint32_t>(padding_size), record_padding, 0, 0 };
+            write_position += padding_size;
+        }
+
+        RecordHeader &header = record.get_header();
+
+        header.size = static_cast<std::uint32_t>(record.size);
+        header.sequence_number =
+            next_sequence_number.fetch_add(1, std::memory_order_relaxed);
+
+        char *dest = buffer.at(write_position);
+
+        std::memcpy(dest, record.data(), record.size);
+        if (function_info)
+        {
+            new (dest + record.function_info_offset) FunctionInfo(*function_info);
+        }
+        buffer.write_position.store(write_position + record.size, std::memory_order_release);
+
+        if (write_position + record.size -
+            buffer.read_position.load(std::memory_order_relaxed) > buffer_capacity / 2)
+        {
+            wake_condition.notify_one();
+        }
+    }
+
+    void wait_for_space(ThreadBuffer &buffer, std::size_t write_position, std::size_t size)
+    {
+        while (write_position + size -
+            buffer.read_position.load(std::memory_order_acquire) > buffer_capacity)
+        {
+            wake_condition.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+    // The background thread's main loop.
+    void consume()
+    {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::uint64_t seen_generation = static_cast<std::uint64_t>(-1);
+
+        while (true)
+        {
+            std::uint64_t flush_ticket;
+            bool was_stopping;
+
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+
+                flush_ticket = flush_requested_c;
+                was_stopping = is_stopping;
+            }
+
+            if (buffers_generation.load() != seen_generation)
+            {
+                std::lock_guard<std::mutex> lock(buffers_mutex);
+
+                seen_generation = buffers_generation.load();
+                buffers = thread_buffers;
+            }
+
+            bool was_idle = !drain(buffers);
+
+            remove_retired_buffers(buffers);
+            std::unique_lock<std::mutex> lock(state_mutex);
+
+            flush_done_c = flush_ticket;
+            drained_condition.notify_all();
+            if (was_stopping && was_idle)
+            {
+                break;
+            }
+            if (was_idle && !is_stopping && flush_requested_c == flush_ticket)
+            {
+                wake_condition.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    // Passes all available records to the target formatter, and returns
+    // whether there were any.
+    bool drain(std::vector<std::shared_ptr<ThreadBuffer>> &buffers)
+    {
+        std::lock_guard<std::mutex> lock(target_mutex);
+        bool did_work = false;
+
+        while (true)
+        {
+            ThreadBuffer *next_buffer = nullptr;
+            std::uint64_t next_sequence_number = 0;
+
+            for (const std::shared_ptr<ThreadBuffer> &buffer : buffers)
+            {
+                const RecordHeader *header = peek(*buffer);
+
+                if (header &&
+                    (!next_buffer || header->sequence_number < next_sequence_number))
+                {
+                    next_buffer = buffer.get();
+                    next_sequence_number = header->sequence_number;
+                }
+            }
+            if (!next_buffer)
+            {
+                return did_work;
+            }
+
+            std::size_t read_position =
+                next_buffer->read_position.load(std::memory_order_relaxed);
+            char *record = next_buffer->at(read_position);
+            std::size_t size = reinterpret_cast<RecordHeader*>(record)->size;
+
+            replay(record);
+            next_buffer->read_position.store(read_position + size, std::memory_order_release);
+            did_work = true;
+        }
+    }
+
+    // Removes the buffers of exited threads, which have been drained.
+    void remove_retired_buffers(std::vector<std::shared_ptr<ThreadBuffer>> &buffers)
+    {
+        // (The last events are visible, once the retirement is.)
+        std::vector<std::shared_ptr<ThreadBuffer>>::iterator removed_begin = std::partition(
+            buffers.begin(), buffers.end(),
+            [this](const std::shared_ptr<ThreadBuffer> &buffer)
+            {
+                return !buffer->is_retired.load(std::memory_order_acquire) || peek(*buffer);
+            });
+
+        if (removed_begin == buffers.end())
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+
+        for (std::vector<std::shared_ptr<ThreadBuffer>>::iterator removed = removed_begin;
+            removed != buffers.end(); ++removed)
+        {
+            thread_buffers.erase(
+                std::remove(thread_buffers.begin(), thread_buffers.end(), *removed),
+                thread_buffers.end());
+        }
+        buffers.erase(removed_begin, buffers.end());
+        ++buffers_generation;
+    }
+
+    // Returns the next record in a buffer, skipping padding, or `nullptr`.
+    const RecordHeader* peek(ThreadBuffer &buffer)
+    {
+        std::size_t read_position = buffer.read_position.load(std::memory_order_relaxed);
+
+        while (read_position != buffer.write_position.load(std::memory_order_acquire))
+        {
+            const RecordHeader *header =
+                reinterpret_cast<const RecordHeader*>(buffer.at(read_position));
+
+            if (header->type != record_padding)
+            {
+                return header;
+            }
+            read_position += header->size;
+            buffer.read_position.store(read_position, std::memory_order_release);
+        }
+
+        return nullptr;
+    }
+
+    // Passes a record to the target formatter.
+    void replay(char *record)
+    {
+        const RecordHeader &header = *reinterpret_cast<const RecordHeader*>(record);
+        const char *p = record + sizeof(RecordHeader);
+        FunctionInfo *function_info = nullptr;
+
+        if (header.type == record_function_entry || header.type == record_function_exit)
+        {
+            function_info = reinterpret_cast<FunctionInfo*>(record + sizeof(RecordHeader));
+            p += align(sizeof(FunctionInfo));
+        }
+
+        try
+        {
+            switch (header.type)
+            {
+                case record_message:
+                    target.write_message(read_string(p));
+                    break;
+                case record_html:
+                    target.write_html(read_string(p));
+                    break;
+                case record_dump_values:
+                    replayed_names.resize(header.value_count);
+                    for (std::string &name : replayed_names)
+                    {
+                        StringRef value = read_string(p);
+
+                        name.assign(value.data(), value.size());
+                    }
+                    read_values(p, header.value_count);
+                    target.dump_values(
+                        replayed_names, replayed_value_pointers.data(), header.value_count);
+                    break;
+                case record_function_entry:
+                    read_values(p, header.value_count);
+                    target.log_function_entry_values(
+                        *function_info, replayed_value_pointers.data(), header.value_count);
+                    break;
+                case record_enter_function:
+                    target.enter_function();
+                    break;
+                case record_function_exit:
+                    target.log_function_exit(*function_info);
+                    break;
+                case record_exit_function:
+                    target.exit_function();
+                    break;
+                case record_blob:
+                    replay_blob(p);
+                    break;
+            }
+        }
+        catch (...)
+        {
+            // There's nowhere to report errors from the background thread.
+        }
+
+        if (function_info)
+        {
+            function_info->~FunctionInfo();
+        }
+    }
+
+    void replay_blob(const char *p)
+    {
+        Blob blob;
+
+        std::memcpy(&blob.id, read_string(p).data(), sizeof(BlobId));
+        std::memcpy(&blob.base_id, read_string(p).data(), sizeof(BlobId));
+        if (blob.base_id.is_null())
+        {
+            blob.data = read_string(p);
+        }
+        else
+        {
+            blob.delta = read_string(p);
+        }
+        target.write_blob(blob);
+    }
+
+    static StringRef read_string(const char *&p)
+    {
+        std::size_t size = *reinterpret_cast<const std::uint64_t*>(p);
+        const char *data = p + align(sizeof(std::uint64_t));
+
+        p = data + align(size);
+
+        return StringRef(data, size);
+    }
+
+    void read_values(const char *&p, std::size_t value_count)
+    {
+        replayed_values.resize(value_count);
+        replayed_value_pointers.resize(value_count + 1);
+        for (std::size_t value_i = 0; value_i < value_count; ++value_i)
+        {
+            const ValueHeader &value_header = *reinterpret_cast<const ValueHeader*>(p);
+            CapturedValueFormatter &value = replayed_values[value_i];
+
+            value.type = value_header.type;
+            value.size = value_header.size;
+            value.bytes = p + align(sizeof(ValueHeader));
+            p = value.bytes + align(value.size);
+            replayed_value_pointers[value_i] = &value;
+        }
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_DEFERRED_FORMATTER_H
@@ -6,20 +6,64 @@
 #undef OPERATION_LOG_ENTER_FUNCTION
 #undef OPERATION_LOG_LEAVE_FUNCTION
 #undef OPERATION_LOG_DUMP_VARS
+#undef OPERATION_LOG_ACCUMULATE_VARS
 #undef OPERATION_LOG_MESSAGE
 #undef OPERATION_LOG_MESSAGE_STREAM
 #undef OPERATION_LOG_MESSAGE_STREAM_OPEN
 #undef OPERATION_LOG_MESSAGE_STREAM_WRITE
 #undef OPERATION_LOG_MESSAGE_STREAM_CLOSE
 #undef OPERATION_LOG_CODE
+#undef OPERATION_LOG_TRACE_ENTER_NO_ARG_FUNCTION
+#undef OPERATION_LOG_TRACE_ENTER_FUNCTION
+#undef OPERATION_LOG_TRACE_LEAVE_FUNCTION
+#undef OPERATION_LOG_TRACE_DUMP_VARS
+#undef OPERATION_LOG_TRACE_ACCUMULATE_VARS
+#undef OPERATION_LOG_TRACE_MESSAGE
+#undef OPERATION_LOG_TRACE_MESSAGE_STREAM
+#undef OPERATION_LOG_DEBUG_ENTER_NO_ARG_FUNCTION
+#undef OPERATION_LOG_DEBUG_ENTER_FUNCTION
+#undef OPERATION_LOG_DEBUG_LEAVE_FUNCTION
+#undef OPERATION_LOG_DEBUG_DUMP_VARS
+#undef OPERATION_LOG_DEBUG_ACCUMULATE_VARS
+#undef OPERATION_LOG_DEBUG_MESSAGE
+#undef OPERATION_LOG_DEBUG_MESSAGE_STREAM
+#undef OPERATION_LOG_INFO_ENTER_NO_ARG_FUNCTION
+#undef OPERATION_LOG_INFO_ENTER_FUNCTION
+#undef OPERATION_LOG_INFO_LEAVE_FUNCTION
+#undef OPERATION_LOG_INFO_DUMP_VARS
+#undef OPERATION_LOG_INFO_ACCUMULATE_VARS
+#undef OPERATION_LOG_INFO_MESSAGE
+#undef OPERATION_LOG_INFO_MESSAGE_STREAM
 
 #define OPERATION_LOG_ENTER_NO_ARG_FUNCTION()
 #define OPERATION_LOG_ENTER_FUNCTION(...)
 #define OPERATION_LOG_LEAVE_FUNCTION()
 #define OPERATION_LOG_DUMP_VARS(...)
+#define OPERATION_LOG_ACCUMULATE_VARS(...)
 #define OPERATION_LOG_MESSAGE(...)
 #define OPERATION_LOG_MESSAGE_STREAM(...)
 #define OPERATION_LOG_MESSAGE_STREAM_OPEN(...)
 #define OPERATION_LOG_MESSAGE_STREAM_WRITE(...)
 #define OPERATION_LOG_MESSAGE_STREAM_CLOSE(...)
 #define OPERATION_LOG_CODE(...)
+#define OPERATION_LOG_TRACE_ENTER_NO_ARG_FUNCTION()
+#define OPERATION_LOG_TRACE_ENTER_FUNCTION(...)
+#define OPERATION_LOG_TRACE_LEAVE_FUNCTION()
+#define OPERATION_LOG_TRACE_DUMP_VARS(...)
+#define OPERATION_LOG_TRACE_ACCUMULATE_VARS(...)
+#define OPERATION_LOG_TRACE_MESSAGE(msg)
+#define OPERATION_LOG_TRACE_MESSAGE_STREAM(args)
+#define OPERATION_LOG_DEBUG_ENTER_NO_ARG_FUNCTION()
+#define OPERATION_LOG_DEBUG_ENTER_FUNCTION(...)
+#define OPERATION_LOG_DEBUG_LEAVE_FUNCTION()
+#define OPERATION_LOG_DEBUG_DUMP_VARS(...)
+#define OPERATION_LOG_DEBUG_ACCUMULATE_VARS(...)
+#define OPERATION_LOG_DEBUG_MESSAGE(msg)
+#define OPERATION_LOG_DEBUG_MESSAGE_STREAM(args)
+#define OPERATION_LOG_INFO_ENTER_NO_ARG_FUNCTION()
+#define OPERATION_LOG_INFO_ENTER_FUNCTION(...)
+#define OPERATION_LOG_INFO_LEAVE_FUNCTION()
+#define OPERATION_LOG_INFO_DUMP_VARS(...)
+#define OPERATION_LOG_INFO_ACCUMULATE_VARS(...)
+#define OPERATION_LOG_INFO_MESSAGE(msg)
+#define OPERATION_LOG_INFO_MESSAGE_STREAM(args)
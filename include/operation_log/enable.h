@@ -7,41 +7,234 @@
 #undef OPERATION_LOG_ENTER_FUNCTION
 #undef OPERATION_LOG_LEAVE_FUNCTION
 #undef OPERATION_LOG_DUMP_VARS
+#undef OPERATION_LOG_ACCUMULATE_VARS
 #undef OPERATION_LOG_MESSAGE
 #undef OPERATION_LOG_MESSAGE_STREAM
 #undef OPERATION_LOG_MESSAGE_STREAM_OPEN
 #undef OPERATION_LOG_MESSAGE_STREAM_WRITE
 #undef OPERATION_LOG_MESSAGE_STREAM_CLOSE
 #undef OPERATION_LOG_CODE
-
+#undef OPERATION_LOG_AT_LEVEL_ENTER_NO_ARG_FUNCTION
+#undef OPERATION_LOG_AT_LEVEL_ENTER_FUNCTION
+#undef OPERATION_LOG_AT_LEVEL_DUMP_VARS
+#undef OPERATION_LOG_AT_LEVEL_ACCUMULATE_VARS
+#undef OPERATION_LOG_AT_LEVEL_MESSAGE
+#undef OPERATION_LOG_AT_LEVEL_MESSAGE_STREAM
+#undef OPERATION_LOG_TRACE_ENTER_NO_ARG_FUNCTION
+#undef OPERATION_LOG_TRACE_ENTER_FUNCTION
+#undef OPERATION_LOG_TRACE_LEAVE_FUNCTION
+#undef OPERATION_LOG_TRACE_DUMP_VARS
+#undef OPERATION_LOG_TRACE_ACCUMULATE_VARS
+#undef OPERATION_LOG_TRACE_MESSAGE
+#undef OPERATION_LOG_TRACE_MESSAGE_STREAM
+#undef OPERATION_LOG_DEBUG_ENTER_NO_ARG_FUNCTION
+#undef OPERATION_LOG_DEBUG_ENTER_FUNCTION
+#undef OPERATION_LOG_DEBUG_LEAVE_FUNCTION
+#undef OPERATION_LOG_DEBUG_DUMP_VARS
+#undef OPERATION_LOG_DEBUG_ACCUMULATE_VARS
+#undef OPERATION_LOG_DEBUG_MESSAGE
+#undef OPERATION_LOG_DEBUG_MESSAGE_STREAM
+#undef OPERATION_LOG_INFO_ENTER_NO_ARG_FUNCTION
+#undef OPERATION_LOG_INFO_ENTER_FUNCTION
+#undef OPERATION_LOG_INFO_LEAVE_FUNCTION
+#undef OPERATION_LOG_INFO_DUMP_VARS
+#undef OPERATION_LOG_INFO_ACCUMULATE_VARS
+#undef OPERATION_LOG_INFO_MESSAGE
+#undef OPERATION_LOG_INFO_MESSAGE_STREAM
+
+
+#include "levels.h"
+#include "usdt.h"
 
 // Operation logging is enabled for the current code section:
 #define OPERATION_LOG
 
-#define OPERATION_LOG_ENTER_NO_ARG_FUNCTION() \
-        operation_log::FunctionEntry OPERATION_LOG_FUNCTION_VAR_NAME(__PRETTY_FUNCTION__);
-
-#define OPERATION_LOG_ENTER_FUNCTION(...) \
-        operation_log::FunctionEntry OPERATION_LOG_FUNCTION_VAR_NAME(__PRETTY_FUNCTION__, #__VA_ARGS__, __VA_ARGS__);
+// Each macro defines a static `operation_log::CallSite`, which can be switched
+// on and off at run time.  Disabled call sites skip all further work,
+// including evaluating the logged values.
+//
+// The `stringified_*` arguments are stringified by the calling macros, so
+// macros in the logged expressions aren't expanded in the logged names.  They
+// are parsed once per call site.
+//
+// With `OPERATION_LOG_USDT`, the values are also evaluated for disabled call
+// sites, while a tracer is attached to their USDT probes (see `usdt.h`).
+#define OPERATION_LOG_AT_LEVEL_ENTER_NO_ARG_FUNCTION(level) \
+        static operation_log::CallSite OPERATION_LOG_FUNCTION_CALL_SITE_VAR_NAME( \
+            __FILE__, __LINE__, __PRETTY_FUNCTION__, level); \
+        operation_log::FunctionEntry OPERATION_LOG_FUNCTION_VAR_NAME( \
+            OPERATION_LOG_FUNCTION_CALL_SITE_VAR_NAME); \
+        if (OPERATION_LOG_FUNCTION_VAR_NAME.is_enabled() || \
+            OPERATION_LOG_USDT_IS_ATTACHED(function_entry)) \
+        { \
+            OPERATION_LOG_FUNCTION_VAR_NAME.enter(); \
+        }
+
+#define OPERATION_LOG_AT_LEVEL_ENTER_FUNCTION(level, stringified_args, ...) \
+        static operation_log::CallSite OPERATION_LOG_FUNCTION_CALL_SITE_VAR_NAME( \
+            __FILE__, __LINE__, __PRETTY_FUNCTION__, level, stringified_args); \
+        operation_log::FunctionEntry OPERATION_LOG_FUNCTION_VAR_NAME( \
+            OPERATION_LOG_FUNCTION_CALL_SITE_VAR_NAME); \
+        if (OPERATION_LOG_FUNCTION_VAR_NAME.is_enabled() || \
+            OPERATION_LOG_USDT_IS_ATTACHED(function_entry)) \
+        { \
+            OPERATION_LOG_FUNCTION_VAR_NAME.enter(__VA_ARGS__); \
+        }
 
 #define OPERATION_LOG_LEAVE_FUNCTION()  OPERATION_LOG_FUNCTION_VAR_NAME.exit_function();
 
-#define OPERATION_LOG_DUMP_VARS(...) \
-        operation_log::OperationLogInstance::get().dump_vars(\
-            operation_log::CppParsing::parse_stringified_list(#__VA_ARGS__), \
-            __VA_ARGS__);
+#define OPERATION_LOG_AT_LEVEL_DUMP_VARS(level, stringified_vars, ...) \
+        { \
+            static operation_log::CallSite OPERATION_LOG_CALL_SITE_VAR_NAME( \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, level, stringified_vars); \
+            if (OPERATION_LOG_CALL_SITE_VAR_NAME.is_enabled() || \
+                OPERATION_LOG_USDT_IS_ATTACHED(dump_vars)) \
+            { \
+                operation_log::OperationLogInstance::get().dump_vars( \
+                    OPERATION_LOG_CALL_SITE_VAR_NAME, __VA_ARGS__); \
+            } \
+        }
+
+// Accumulates numeric variables into statistics (count, minimum, maximum,
+// mean, variance, and a sparkline series), which are written once, when the
+// enclosing logged function exits (see `OperationLog::accumulate_vars()`).
+#define OPERATION_LOG_AT_LEVEL_ACCUMULATE_VARS(level, stringified_vars, ...) \
+        { \
+            static operation_log::CallSite OPERATION_LOG_CALL_SITE_VAR_NAME( \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, level, stringified_vars); \
+            if (OPERATION_LOG_CALL_SITE_VAR_NAME.is_enabled() || \
+                OPERATION_LOG_USDT_IS_ATTACHED(dump_vars)) \
+            { \
+                static operation_log::VarAccumulator OPERATION_LOG_ACCUMULATOR_VAR_NAME( \
+                    OPERATION_LOG_CALL_SITE_VAR_NAME); \
+                operation_log::OperationLogInstance::get().accumulate_vars( \
+                    OPERATION_LOG_ACCUMULATOR_VAR_NAME, __VA_ARGS__); \
+            } \
+        }
+
+#define OPERATION_LOG_AT_LEVEL_MESSAGE(level, msg)  \
+        { \
+            static operation_log::CallSite OPERATION_LOG_CALL_SITE_VAR_NAME( \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, level); \
+            if (OPERATION_LOG_CALL_SITE_VAR_NAME.is_enabled() || \
+                OPERATION_LOG_USDT_IS_ATTACHED(message)) \
+            { \
+                operation_log::OperationLogInstance::get().write_message( \
+                    OPERATION_LOG_CALL_SITE_VAR_NAME, msg); \
+            } \
+        }
+
+#define OPERATION_LOG_AT_LEVEL_MESSAGE_STREAM(level, args)  \
+        { \
+            static operation_log::CallSite OPERATION_LOG_CALL_SITE_VAR_NAME( \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, level); \
+            if (OPERATION_LOG_CALL_SITE_VAR_NAME.is_enabled() || \
+                OPERATION_LOG_USDT_IS_ATTACHED(message)) \
+            { \
+                operation_log::MessageStream(OPERATION_LOG_CALL_SITE_VAR_NAME) args; \
+            } \
+        }
+
+// Macros without a level log at the `OPERATION_LOG_LEVEL_INFO` level:
+#define OPERATION_LOG_ENTER_NO_ARG_FUNCTION() \
+        OPERATION_LOG_AT_LEVEL_ENTER_NO_ARG_FUNCTION(OPERATION_LOG_LEVEL_INFO)
 
-#define OPERATION_LOG_MESSAGE(msg)  \
-        operation_log::OperationLogInstance::get().write_message(msg);
+#define OPERATION_LOG_ENTER_FUNCTION(...) \
+        OPERATION_LOG_AT_LEVEL_ENTER_FUNCTION(OPERATION_LOG_LEVEL_INFO, #__VA_ARGS__, __VA_ARGS__)
 
-#define OPERATION_LOG_MESSAGE_STREAM(args)  \
-        { operation_log::MessageStream() args; }
+#define OPERATION_LOG_DUMP_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_DUMP_VARS(OPERATION_LOG_LEVEL_INFO, #__VA_ARGS__, __VA_ARGS__)
+
+#define OPERATION_LOG_ACCUMULATE_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_ACCUMULATE_VARS(OPERATION_LOG_LEVEL_INFO, #__VA_ARGS__, __VA_ARGS__)
+
+#define OPERATION_LOG_MESSAGE(msg) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE(OPERATION_LOG_LEVEL_INFO, msg)
+
+#define OPERATION_LOG_MESSAGE_STREAM(args) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE_STREAM(OPERATION_LOG_LEVEL_INFO, args)
+
+// Leveled macros below the `OPERATION_LOG_MIN_LEVEL` compile-time threshold
+// expand to nothing:
+#if OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_TRACE
+#    define OPERATION_LOG_TRACE_ENTER_NO_ARG_FUNCTION() \
+        OPERATION_LOG_AT_LEVEL_ENTER_NO_ARG_FUNCTION(OPERATION_LOG_LEVEL_TRACE)
+#    define OPERATION_LOG_TRACE_ENTER_FUNCTION(...) \
+        OPERATION_LOG_AT_LEVEL_ENTER_FUNCTION(OPERATION_LOG_LEVEL_TRACE, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_TRACE_LEAVE_FUNCTION()  OPERATION_LOG_LEAVE_FUNCTION()
+#    define OPERATION_LOG_TRACE_DUMP_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_DUMP_VARS(OPERATION_LOG_LEVEL_TRACE, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_TRACE_ACCUMULATE_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_ACCUMULATE_VARS(OPERATION_LOG_LEVEL_TRACE, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_TRACE_MESSAGE(msg) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE(OPERATION_LOG_LEVEL_TRACE, msg)
+#    define OPERATION_LOG_TRACE_MESSAGE_STREAM(args) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE_STREAM(OPERATION_LOG_LEVEL_TRACE, args)
+#else // OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_TRACE
+#    define OPERATION_LOG_TRACE_ENTER_NO_ARG_FUNCTION()
+#    define OPERATION_LOG_TRACE_ENTER_FUNCTION(...)
+#    define OPERATION_LOG_TRACE_LEAVE_FUNCTION()
+#    define OPERATION_LOG_TRACE_DUMP_VARS(...)
+#    define OPERATION_LOG_TRACE_ACCUMULATE_VARS(...)
+#    define OPERATION_LOG_TRACE_MESSAGE(msg)
+#    define OPERATION_LOG_TRACE_MESSAGE_STREAM(args)
+#endif // OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_TRACE
+
+#if OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_DEBUG
+#    define OPERATION_LOG_DEBUG_ENTER_NO_ARG_FUNCTION() \
+        OPERATION_LOG_AT_LEVEL_ENTER_NO_ARG_FUNCTION(OPERATION_LOG_LEVEL_DEBUG)
+#    define OPERATION_LOG_DEBUG_ENTER_FUNCTION(...) \
+        OPERATION_LOG_AT_LEVEL_ENTER_FUNCTION(OPERATION_LOG_LEVEL_DEBUG, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_DEBUG_LEAVE_FUNCTION()  OPERATION_LOG_LEAVE_FUNCTION()
+#    define OPERATION_LOG_DEBUG_DUMP_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_DUMP_VARS(OPERATION_LOG_LEVEL_DEBUG, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_DEBUG_ACCUMULATE_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_ACCUMULATE_VARS(OPERATION_LOG_LEVEL_DEBUG, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_DEBUG_MESSAGE(msg) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE(OPERATION_LOG_LEVEL_DEBUG, msg)
+#    define OPERATION_LOG_DEBUG_MESSAGE_STREAM(args) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE_STREAM(OPERATION_LOG_LEVEL_DEBUG, args)
+#else // OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_DEBUG
+#    define OPERATION_LOG_DEBUG_ENTER_NO_ARG_FUNCTION()
+#    define OPERATION_LOG_DEBUG_ENTER_FUNCTION(...)
+#    define OPERATION_LOG_DEBUG_LEAVE_FUNCTION()
+#    define OPERATION_LOG_DEBUG_DUMP_VARS(...)
+#    define OPERATION_LOG_DEBUG_ACCUMULATE_VARS(...)
+#    define OPERATION_LOG_DEBUG_MESSAGE(msg)
+#    define OPERATION_LOG_DEBUG_MESSAGE_STREAM(args)
+#endif // OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_DEBUG
+
+#if OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_INFO
+#    define OPERATION_LOG_INFO_ENTER_NO_ARG_FUNCTION() \
+        OPERATION_LOG_AT_LEVEL_ENTER_NO_ARG_FUNCTION(OPERATION_LOG_LEVEL_INFO)
+#    define OPERATION_LOG_INFO_ENTER_FUNCTION(...) \
+        OPERATION_LOG_AT_LEVEL_ENTER_FUNCTION(OPERATION_LOG_LEVEL_INFO, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_INFO_LEAVE_FUNCTION()  OPERATION_LOG_LEAVE_FUNCTION()
+#    define OPERATION_LOG_INFO_DUMP_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_DUMP_VARS(OPERATION_LOG_LEVEL_INFO, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_INFO_ACCUMULATE_VARS(...) \
+        OPERATION_LOG_AT_LEVEL_ACCUMULATE_VARS(OPERATION_LOG_LEVEL_INFO, #__VA_ARGS__, __VA_ARGS__)
+#    define OPERATION_LOG_INFO_MESSAGE(msg) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE(OPERATION_LOG_LEVEL_INFO, msg)
+#    define OPERATION_LOG_INFO_MESSAGE_STREAM(args) \
+        OPERATION_LOG_AT_LEVEL_MESSAGE_STREAM(OPERATION_LOG_LEVEL_INFO, args)
+#else // OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_INFO
+#    define OPERATION_LOG_INFO_ENTER_NO_ARG_FUNCTION()
+#    define OPERATION_LOG_INFO_ENTER_FUNCTION(...)
+#    define OPERATION_LOG_INFO_LEAVE_FUNCTION()
+#    define OPERATION_LOG_INFO_DUMP_VARS(...)
+#    define OPERATION_LOG_INFO_ACCUMULATE_VARS(...)
+#    define OPERATION_LOG_INFO_MESSAGE(msg)
+#    define OPERATION_LOG_INFO_MESSAGE_STREAM(args)
+#endif // OPERATION_LOG_MIN_LEVEL <= OPERATION_LOG_LEVEL_INFO
 
 #define OPERATION_LOG_MESSAGE_STREAM_OPEN(var_name)  \
-        operation_log::MessageStream var_name;
+        static operation_log::CallSite var_name##__call_site( \
+            __FILE__, __LINE__, __PRETTY_FUNCTION__); \
+        operation_log::MessageStream var_name(var_name##__call_site);
 
 #define OPERATION_LOG_MESSAGE_STREAM_WRITE(var_name, args)  \
-        { var_name args; }
+        { if (var_name.is_enabled()) { var_name args; } }
 
 #define OPERATION_LOG_MESSAGE_STREAM_CLOSE(var_name)  \
         { var_name.close(); }
@@ -0,0 +1,173 @@
+#ifndef _OPERATION_LOG_FORK_HANDLING_H
+#define _OPERATION_LOG_FORK_HANDLING_H
+
+#include <pthread.h>
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "forward_declarations.h"
+#include "heap_accounting.h"
+#include "operation_log_instance.h"
+#include "perf_counters.h"
+#include "process_log_file.h"
+#include "sampling_profiler.h"
+
+
+namespace operation_log
+{
+
+// Keeps the operation log usable in processes, which `fork()` (e.g.,
+// pre-forking servers).  Once it's enabled:
+//
+// * Before `fork()`, the log's formatter writes what it has buffered (a
+//   `DeferredFormatter` writes its pending events).
+// * In the child, the inherited formatter stops writing to the parent's
+//   output (even when it's destroyed), background formatting threads are
+//   restarted, the call stack is reset (the functions entered before
+//   `fork()` exit without being logged), the sampling profiler, and the
+//   performance counters are reset for the child, and the child's own
+//   formatter is set up by the given function.
+//
+// For example, to log each process to its own file, which
+// `tools/operation_log_merge` merges in time order:
+//
+//     operation_log::ForkHandling::enable_process_files("server");
+//
+// Or, to set up each child's log yourself:
+//
+//     operation_log::ForkHandling::enable(
+//         [](operation_log::DefaultOperationLog &log)
+//         {
+//             static std::ofstream output(
+//                 "server." + std::to_string(getpid()) + ".html");
+//             static operation_log::HtmlFormatter formatter(output);
+//
+//             log.set_formatter(formatter);
+//         });
+//
+// (The handlers are installed with `pthread_atfork()`, so they apply to
+// `fork()`, but not to `vfork()`, or `clone()`.)  The reports of
+// `HeapAccounting`, `PerfCounters`, and `LockContention` in a child start
+// with the parent's totals.
+class ForkHandling
+{
+public:
+    typedef std::function<void(DefaultOperationLog &log)> ChildSetUp;
+
+    static bool is_enabled()
+    {
+        return static_cast<bool>(get_state().set_up_child);
+    }
+
+    // Installs the fork handlers (once), and sets the function, which sets
+    // up the log of each child.
+    static void enable(ChildSetUp set_up_child)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        State &state = get_state();
+
+        state.set_up_child = set_up_child;
+        if (!state.is_installed)
+        {
+            if (pthread_atfork(&prepare, &resume_parent, &resume_child) != 0)
+            {
+                std::cerr << "operation_log: Can't install the fork handlers." << std::endl;
+            }
+            state.is_installed = true;
+        }
+    }
+
+    // Logs this process, and each child to its own `ProcessLogFile`
+    // (`<path prefix>.<pid>.log`).
+    static void enable_process_files(const std::string &path_prefix)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        open_process_file(path_prefix, OperationLogInstance::get());
+        enable(
+            [path_prefix](DefaultOperationLog &log)
+            {
+                open_process_file(path_prefix, log);
+            });
+    }
+
+    // Stops setting up the logs of children.  (The handlers stay installed,
+    // but do nothing.)
+    static void disable()
+    {
+        get_state().set_up_child = nullptr;
+    }
+
+private:
+    struct State
+    {
+        ChildSetUp set_up_child;
+        bool is_installed = false;
+        std::unique_ptr<ProcessLogFile> process_file;
+    };
+
+    static State& get_state()
+    {
+        static State state;
+
+        return state;
+    }
+
+    static void open_process_file(const std::string &path_prefix, DefaultOperationLog &log)
+    {
+        State &state = get_state();
+
+        state.process_file.reset(new ProcessLogFile(path_prefix));
+        if (!state.process_file->is_open())
+        {
+            std::cerr << "operation_log: Can't write " << state.process_file->get_path() <<
+                std::endl;
+        }
+        log.set_formatter(state.process_file->get_formatter());
+    }
+
+    static void prepare()
+    {
+        if (is_enabled())
+        {
+            HeapAccounting::Pause heap_accounting_pause;
+
+            OperationLogInstance::get().get_formatter().prepare_fork();
+        }
+    }
+
+    static void resume_parent()
+    {
+        if (is_enabled())
+        {
+            HeapAccounting::Pause heap_accounting_pause;
+
+            OperationLogInstance::get().get_formatter().after_fork_in_parent();
+        }
+    }
+
+    static void resume_child()
+    {
+        if (!is_enabled())
+        {
+            return;
+        }
+
+        HeapAccounting::Pause heap_accounting_pause;
+        DefaultOperationLog &log = OperationLogInstance::get();
+
+        log.get_formatter().after_fork_in_child();
+        log.reset_after_fork();
+        SamplingProfiler::reset_after_fork();
+        PerfCounters::reset_after_fork();
+        get_state().set_up_child(log);
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_FORK_HANDLING_H
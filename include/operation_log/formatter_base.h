@@ -5,7 +5,10 @@
 #include <string>
 #include <vector>
 
+#include "blob.h"
 #include "function_info.h"
+#include "number_formatter.h"
+#include "string_ref.h"
 #include "value_formatter.h"
 #include "value_formatter_i.h"
 
@@ -15,6 +18,12 @@ namespace operation_log
 
 // A base class for receiving operation log messages, formatting them, and
 // writing them to an `ostream`.
+//
+// The `dump_vars()`, and `log_function_entry()` templates wrap each value in
+// a `ValueFormatter`, and pass them on to the virtual `dump_values()`, and
+// `log_function_entry_values()` methods.  Together with the other virtual
+// public methods, they form the interface which formatters that forward log
+// events elsewhere (e.g., `DeferredFormatter`) override.
 class FormatterBase
 {
 public:
@@ -22,6 +31,9 @@ public:
     : output(output_stream)
     {}
 
+    virtual ~FormatterBase()
+    {}
+
     std::ostream& get_output_stream()
     {
         return output;
@@ -32,34 +44,70 @@ public:
         output = value;
     }
 
-    void write_message(std::string message)
+    // Sets how floating point values are written.  (The format is kept in the
+    // output stream, see `NumberFormat`.)
+    void set_number_format(const NumberFormat &format)
+    {
+        NumberFormat::set(output.get(), format);
+    }
+
+    NumberFormat get_number_format()
+    {
+        return NumberFormat::get(output.get());
+    }
+
+    virtual void write_message(StringRef message)
     {
         write_message_prefix();
         write_message_value(message);
     }
 
-    void write_html(std::string code)
+    virtual void write_html(StringRef code)
     {
         write_message_prefix();
         write_html_value(code);
     }
 
+    // Writes binary data which HTML messages load (see `Blob`).  Formatters
+    // which don't write HTML ignore it.
+    virtual void write_blob(const Blob &blob)
+    {}
+
     template <typename... VarTs>
-    void dump_vars(const std::vector<std::string> &names, VarTs... vars)
+    void dump_vars(const std::vector<std::string> &names, const VarTs&... vars)
     {
-        var_i = 0;
-        this->names = names;
+        dump_value_formatters(names, ValueFormatter<VarTs>(vars)...);
+    }
+
+    virtual void dump_values(
+        const std::vector<std::string> &names,
+        ValueFormatterI *const *values, std::size_t value_count)
+    {
+        this->names = &names;
         write_message_prefix();
         write_dump_vars_prefix();
-        write_vars(vars...);
+        for (var_i = 0; var_i < static_cast<int>(value_count); ++var_i)
+        {
+            if (var_i > 0)
+            {
+                write_dump_vars_separator();
+            }
+            write_dump_var(names[var_i], *values[var_i]);
+        }
         write_dump_vars_suffix();
     }
 
     template <typename... ArgTs>
-    void log_function_entry(FunctionInfo &function_info, ArgTs... args)
+    void log_function_entry(const FunctionInfo &function_info, const ArgTs&... args)
+    {
+        log_function_entry_formatters(function_info, ValueFormatter<ArgTs>(args)...);
+    }
+
+    virtual void log_function_entry_values(
+        const FunctionInfo &function_info,
+        ValueFormatterI *const *values, std::size_t value_count)
     {
-        argument_i = 0;
-        this->function_info = function_info;
+        this->function_info = &function_info;
         write_message_prefix();
         write_function_prefix();
         write_function_return_type_and_name(
@@ -68,7 +116,17 @@ public:
                 function_info.get_full_name() :
                 function_info.get_short_name());
         write_function_args_prefix();
-        write_function_args(args...);
+        for (argument_i = 0; argument_i < static_cast<int>(value_count); ++argument_i)
+        {
+            if (argument_i > 0)
+            {
+                write_function_args_separator();
+            }
+            write_function_arg(
+                function_info.get_argument_type(argument_i),
+                function_info.get_argument_name(argument_i),
+                *values[argument_i]);
+        }
         write_function_args_suffix();
         if (output_function_extra_info)
         {
@@ -78,22 +136,51 @@ public:
         ++filtered_stack_depth;
     }
 
-    void enter_function()
+    virtual void enter_function()
     {
         ++stack_depth;
     }
 
-    void log_function_exit(FunctionInfo &function_info)
+    virtual void log_function_exit(const FunctionInfo &function_info)
     {
         write_function_exit(function_info);
         --filtered_stack_depth;
     }
 
-    void exit_function()
+    virtual void exit_function()
     {
         --stack_depth;
     }
 
+    // Writes a value the way this formatter writes logged values (e.g., as
+    // plain text, or as HTML).
+    //
+    // It mustn't change the formatter's state, so it can be called from
+    // other threads than the one the formatter writes on.
+    virtual void write_value(std::ostream &out, ValueFormatterI &value_formatter) const
+    {
+        value_formatter.write_text(out);
+    }
+
+    // Called before `fork()` (see `ForkHandling`).  Writes the buffered
+    // output, so the child process doesn't inherit it.
+    virtual void prepare_fork()
+    {
+        output.get().flush();
+    }
+
+    // Called in the parent process after `fork()`.
+    virtual void after_fork_in_parent()
+    {}
+
+    // Called in the child process after `fork()`.  The output belongs to the
+    // parent, so nothing more is written to it (not even when the formatter
+    // is destroyed).
+    virtual void after_fork_in_child()
+    {
+        output = get_null_stream();
+    }
+
 protected:
     bool output_function_extra_info = false;
     bool use_function_long_name = false;
@@ -103,15 +190,24 @@ protected:
     int argument_i;
     int stack_depth = 0;
     int filtered_stack_depth = 0;
-    std::vector<std::string> names;
-    FunctionInfo function_info;
+    // The variable names, and the function of the message being written:
+    const std::vector<std::string> *names = nullptr;
+    const FunctionInfo *function_info = nullptr;
+
+    // A stream without a buffer, which discards what's written to it:
+    static std::ostream& get_null_stream()
+    {
+        static std::ostream stream(nullptr);
+
+        return stream;
+    }
 
     virtual void write_message_prefix()
     {}
 
-    virtual void write_message_value(std::string message) = 0;
+    virtual void write_message_value(StringRef message) = 0;
 
-    virtual void write_html_value(std::string code)
+    virtual void write_html_value(StringRef code)
     {}
 
     virtual void write_dump_vars_prefix()
@@ -123,28 +219,8 @@ protected:
     virtual void write_dump_vars_separator()
     {}
 
-    virtual void write_dump_var(std::string name, ValueFormatterI &value_formatter) = 0;
-
-    template <typename Var0T>
-    void write_vars(Var0T var0)
-    {
-        if (var_i > 0)
-        {
-            write_dump_vars_separator();
-        }
-
-        ValueFormatter<Var0T> value_formatter(var0);
-
-        write_dump_var(names[var_i], value_formatter);
-        ++var_i;
-    }
-
-    template <typename Var0T, typename... VarTs>
-    void write_vars(Var0T var0, VarTs... vars)
-    {
-        write_vars(var0);
-        write_vars(vars...);
-    }
+    virtual void write_dump_var(
+        const std::string &name, ValueFormatterI &value_formatter) = 0;
 
     virtual void write_function_prefix()
     {}
@@ -153,7 +229,7 @@ protected:
     {}
 
     virtual void write_function_return_type_and_name(
-        std::string return_type, std::string name) = 0;
+        const std::string &return_type, const std::string &name) = 0;
 
     virtual void write_function_args_prefix() = 0;
 
@@ -163,41 +239,37 @@ protected:
     {}
 
     virtual void write_function_arg(
-        std::string type_name, std::string parameter_name, ValueFormatterI &value_formatter) = 0;
+        const std::string &type_name, const std::string &parameter_name,
+        ValueFormatterI &value_formatter) = 0;
+
+    virtual void write_function_extra_info(const std::string &info) = 0;
 
-    void write_function_args()
+    virtual void write_function_exit(const FunctionInfo &function_info)
     {}
 
-    template <typename Arg0T>
-    void write_function_args(Arg0T arg0)
+private:
+    // The value formatters are temporaries, which live until the end of the
+    // calling `dump_vars()`, or `log_function_entry()` expression.
+    template <typename... FormatterTs>
+    void dump_value_formatters(
+        const std::vector<std::string> &names, FormatterTs&&... value_formatters)
     {
-        if (argument_i > 0)
-        {
-            write_function_args_separator();
-        }
-
-        ValueFormatter<Arg0T> value_formatter(arg0);
+        // (The extra element keeps the array from being empty.)
+        ValueFormatterI *values[] = { &value_formatters..., nullptr };
 
-        write_function_arg(
-            function_info.get_argument_type(argument_i),
-            function_info.get_argument_name(argument_i),
-            value_formatter);
-        ++argument_i;
+        dump_values(names, values, sizeof...(FormatterTs));
     }
 
-    template <typename Arg0T, typename... ArgTs>
-    void write_function_args(Arg0T arg0, ArgTs... args)
+    template <typename... FormatterTs>
+    void log_function_entry_formatters(
+        const FunctionInfo &function_info, FormatterTs&&... value_formatters)
     {
-        write_function_args(arg0);
-        write_function_args(args...);
-    }
+        ValueFormatterI *values[] = { &value_formatters..., nullptr };
 
-    virtual void write_function_extra_info(std::string info) = 0;
-
-    virtual void write_function_exit(FunctionInfo &function_info)
-    {}
+        log_function_entry_values(function_info, values, sizeof...(FormatterTs));
+    }
 };
 
 }
 
-#endif // _OPERATION_LOG_FORMATTER_BASE_H
\ No newline at end of file
+#endif // _OPERATION_LOG_FORMATTER_BASE_H
@@ -2,12 +2,21 @@
 #define _OPERATION_LOG_FORWARD_DECLARATIONS_H
 
 #include <stack>
+#include <vector>
 
 namespace operation_log
 {
 
 class FunctionInfo;
 
+// The stack of functions that have been entered, and not exited yet.
+//
+// It's kept in an `std::vector`, so pushing, and popping functions doesn't
+// allocate memory, once the stack has grown to its usual depth.  (Message
+// filter predicates take it as `const CallStack&`, rather than the default
+// `std::stack<FunctionInfo>`.)
+typedef std::stack<FunctionInfo, std::vector<FunctionInfo>> CallStack;
+
 class FormatterBase;
 
 template <typename... ArgTs>
@@ -20,7 +29,7 @@ typedef
     OperationLog<
         FormatterBase,
         RunTimePredicate<
-            const std::stack<FunctionInfo>&
+            const CallStack&
         >
     >
     DefaultOperationLog;
@@ -1,8 +1,13 @@
 #ifndef _OPERATION_LOG_FUNCTION_ENTRY_H
 #define _OPERATION_LOG_FUNCTION_ENTRY_H
 
+#include "call_site.h"
 #include "function_info.h"
+#include "heap_accounting.h"
 #include "operation_log_instance.h"
+#include "perf_counters.h"
+#include "sampling_profiler.h"
+#include "usdt.h"
 
 namespace operation_log
 {
@@ -25,28 +30,119 @@ namespace operation_log
 // For that purpose, the `exit_function()` should be called just before
 // returning from a fuction.  It will prevent the destructor from being called
 // early.
+//
+// When the object is created for a `CallSite`, the call site is checked
+// first, and nothing is logged if it's disabled.  In that case, the
+// `enter()` method, which receives the argument values, shouldn't be called.
+// The function information is parsed once per call site, and shared, so
+// entering, and exiting doesn't allocate memory.
+//
+// When heap allocations are counted (see `HeapAccounting`), or performance
+// counters are measured (see `PerfCounters`), an entered function's totals
+// are logged before its exit.
+//
+// While the `SamplingProfiler` is active, an object created for a `CallSite`
+// pushes the site onto the profiler's stack, whether the site is enabled, or
+// not, and pops it in the destructor.
+//
+// With USDT probes (see `usdt.h`), `enter()` is also called for a disabled
+// call site, while a tracer is attached to the `function_entry` probe.  It
+// only fires the probe then.
 class FunctionEntry
 {
 public:
-    FunctionEntry(std::string pretty_function)
+    FunctionEntry(const std::string &pretty_function)
     : function_info(pretty_function, "")
     {
-        OperationLogInstance::get().log_function_entry(function_info);
+        enter();
     }
 
     template <typename... ArgTs>
     FunctionEntry(
-        std::string pretty_function, std::string stringified_arg_list,
-        ArgTs... args)
+        const std::string &pretty_function,
+        const std::string &stringified_arg_list,
+        const ArgTs&... args)
     : function_info(pretty_function, stringified_arg_list)
     {
-        OperationLogInstance::get().log_function_entry(
-            function_info, args...);
+        enter(args...);
+    }
+
+    inline FunctionEntry(CallSite &call_site)
+    : call_site(&call_site),
+    is_site_enabled(call_site.is_enabled())
+    {
+        if (SamplingProfiler::is_active())
+        {
+            SamplingProfiler::push(call_site);
+            is_sampled = true;
+        }
     }
 
     ~FunctionEntry()
     {
-        OperationLogInstance::get().log_function_exit(function_info);
+        if (is_sampled)
+        {
+            SamplingProfiler::pop();
+        }
+        if (call_site)
+        {
+            Usdt::function_exit(*call_site);
+        }
+        if (is_entered)
+        {
+            if (perf_scope.is_entered())
+            {
+                PerfCounterValues values = perf_scope.exit();
+
+                OperationLogInstance::get().write_perf_counters(function_info, values);
+            }
+            if (heap_scope.is_entered())
+            {
+                OperationLogInstance::get().write_heap_totals(
+                    function_info, heap_scope.exit());
+            }
+            OperationLogInstance::get().log_function_exit(function_info);
+            get_innermost() = outer_function_info;
+        }
+    }
+
+    // Returns the function information of the innermost entered function on
+    // the current thread, or `nullptr`.
+    static const FunctionInfo* get_innermost_function_info()
+    {
+        return get_innermost();
+    }
+
+    inline bool is_enabled() const
+    {
+        return is_site_enabled;
+    }
+
+    template <typename... ArgTs>
+    void enter(const ArgTs&... args)
+    {
+        if (call_site)
+        {
+            Usdt::function_entry(*call_site, args...);
+            if (!is_site_enabled)
+            {
+                return;
+            }
+            function_info = call_site->get_function_info();
+        }
+        is_entered = true;
+        outer_function_info = get_innermost();
+        get_innermost() = &function_info;
+        OperationLogInstance::get().log_function_entry(
+            function_info, args...);
+        if (HeapAccounting::is_active())
+        {
+            heap_scope.enter();
+        }
+        if (PerfCounters::is_active())
+        {
+            perf_scope.enter();
+        }
     }
 
     // This method is used just to keep the object from being destroyed until
@@ -59,7 +155,21 @@ public:
     }
 
 private:
+    CallSite *call_site = nullptr;
+    bool is_site_enabled = true;
+    bool is_entered = false;
+    bool is_sampled = false;
     FunctionInfo function_info;
+    const FunctionInfo *outer_function_info = nullptr;
+    HeapAccounting::Scope heap_scope;
+    PerfCounters::Scope perf_scope;
+
+    static const FunctionInfo*& get_innermost()
+    {
+        static thread_local const FunctionInfo *innermost = nullptr;
+
+        return innermost;
+    }
 };
 
 }
@@ -1,6 +1,8 @@
 #ifndef _OPERATION_LOG_FUNCTION_INFO_H
 #define _OPERATION_LOG_FUNCTION_INFO_H
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -11,127 +13,381 @@ namespace operation_log
 
 // A class that describes the properties of a C++ function used in operation
 // logging.
+//
+// The parsed properties are shared between copies, so copying a
+// `FunctionInfo` (e.g., onto the operation log's call stack) doesn't allocate
+// memory.
 class FunctionInfo
 {
 private:
-    std::string return_type;
-    std::string full_name;
-    std::string short_name;
-    std::vector<std::string> argument_types;
-    std::vector<std::string> argument_names;
-    std::string extra_information;
+    struct Data
+    {
+        std::string return_type;
+        std::string full_name;
+        std::string short_name;
+        std::vector<std::string> argument_types;
+        std::vector<std::string> argument_names;
+        std::string extra_information;
+    };
+
+    std::shared_ptr<const Data> data;
 
 public:
     inline FunctionInfo()
     {}
 
-    inline FunctionInfo(std::string pretty_function, std::string stringified_arg_list)
+    inline FunctionInfo(
+        const std::string &pretty_function,
+        const std::string &stringified_arg_list)
+    {
+        std::shared_ptr<Data> parsed_data = parse(pretty_function);
+
+        parsed_data->argument_names =
+            CppParsing::parse_stringified_list(stringified_arg_list);
+        data = parsed_data;
+    }
+
+    // Creates the function information from its parsed parts (e.g., when
+    // they were read from another process's log, see
+    // `SharedMemoryCollector`).
+    static FunctionInfo from_parts(
+        const std::string &return_type, const std::string &full_name,
+        const std::string &short_name, const std::vector<std::string> &argument_types,
+        const std::vector<std::string> &argument_names,
+        const std::string &extra_information)
+    {
+        std::shared_ptr<Data> parts(new Data {
+            return_type, full_name, short_name, argument_types, argument_names,
+            extra_information });
+        FunctionInfo res;
+
+        res.data = parts;
+
+        return res;
+    }
+
+    inline void parse_pretty_function(const std::string &pretty_function)
     {
-        parse_pretty_function(pretty_function);
-        argument_names = CppParsing::parse_stringified_list(stringified_arg_list);
+        data = parse(pretty_function);
     }
 
-    void parse_pretty_function(const std::string &pretty_function);
+    inline const std::string& get_return_type() const
+    {
+        return get_data().return_type;
+    }
 
-    inline std::string get_return_type() const
+    inline const std::string& get_full_name() const
     {
-        return return_type;
+        return get_data().full_name;
     }
 
-    inline std::string get_full_name() const
+    inline const std::string& get_short_name() const
     {
-        return full_name;
+        return get_data().short_name;
     }
 
-    inline std::string get_short_name() const
+    inline const std::vector<std::string>& get_argument_types() const
     {
-        return short_name;
+        return get_data().argument_types;
     }
 
-    inline const std::vector<std::string> get_argument_types() const
+    inline const std::string& get_argument_type(int argument_i) const
     {
-        return argument_types;
+        return get_data().argument_types[argument_i];
     }
 
-    inline std::string get_argument_type(int argument_i) const
+    inline const std::vector<std::string>& get_argument_names() const
     {
-        return argument_types[argument_i];
+        return get_data().argument_names;
     }
 
-    inline const std::vector<std::string> get_argument_names() const
+    inline const std::string& get_argument_name(int argument_i) const
     {
-        return argument_names;
+        return get_data().argument_names[argument_i];
     }
 
-    std::string get_argument_name(int argument_i) const
+    inline const std::string& get_extra_information() const
     {
-        return argument_names[argument_i];
+        return get_data().extra_information;
     }
 
-    inline std::string get_extra_information() const
+    // Returns an id, which all copies of this function information share
+    // (i.e., one for each call site).
+    inline const void* get_id() const
     {
-        return extra_information;
+        return data.get();
     }
 
 private:
-    std::string arg_list_get_type_string(const std::string &s, size_t pos = 0);
-};
+    inline const Data& get_data() const
+    {
+        static const Data empty_data;
 
-void FunctionInfo::parse_pretty_function(const std::string &pretty_function)
-{
-    std::size_t name_end = pretty_function.find("(") - 1;
-    std::size_t name_begin = pretty_function.substr(0, name_end).rfind(" ") + 1;
+        return data ? *data : empty_data;
+    }
 
-    return_type = pretty_function.substr(0, name_begin - 1);
-    full_name = pretty_function.substr(name_begin, name_end - name_begin + 1);
+    static std::shared_ptr<Data> parse(const std::string &pretty_function);
 
-    std::size_t short_name_begin = full_name.rfind("::");
+    static std::string arg_list_get_type_string(const std::string &s, size_t pos = 0);
 
-    if (short_name_begin >= full_name.length())
-    {
-        short_name_begin = 0;
-    }
-    else
+    static std::size_t find_arg_list(const std::string &s, std::size_t &operator_begin);
+
+    static std::size_t find_name_begin(const std::string &s, std::size_t name_end);
+
+    static std::size_t find_closing_bracket(const std::string &s, std::size_t open);
+
+    static std::size_t find_short_name_begin(const std::string &full_name);
+
+    static bool is_identifier_char(char c)
     {
-        short_name_begin += 2;
+        return isalnum(static_cast<unsigned char>(c)) || c == '_';
     }
+};
+
+inline std::shared_ptr<FunctionInfo::Data> FunctionInfo::parse(const std::string &pretty_function)
+{
+    std::shared_ptr<Data> res = std::make_shared<Data>();
+    std::string &return_type = res->return_type;
+    std::string &full_name = res->full_name;
+    std::string &short_name = res->short_name;
+    std::vector<std::string> &argument_types = res->argument_types;
+    std::string &extra_information = res->extra_information;
+
+    std::size_t operator_begin;
+    std::size_t arg_list_open = find_arg_list(pretty_function, operator_begin);
+    std::size_t name_begin = find_name_begin(
+        pretty_function,
+        operator_begin != std::string::npos ? operator_begin : arg_list_open);
+
+    return_type = name_begin > 0 ? pretty_function.substr(0, name_begin - 1) : "";
+    full_name = pretty_function.substr(name_begin, arg_list_open - name_begin);
+
+    std::size_t short_name_begin = find_short_name_begin(full_name);
 
     short_name = full_name.substr(short_name_begin);
+    if (arg_list_open == pretty_function.length())
+    {
+        // (A name without an argument list, e.g., a C symbol.)
+        return res;
+    }
 
-    std::size_t arg_list_begin = name_end + 2;
-    std::size_t arg_list_end = pretty_function.rfind(")") - 1;
+    std::size_t arg_list_close = find_closing_bracket(pretty_function, arg_list_open);
 
-    for (std::size_t i = arg_list_begin; i < arg_list_end; )
+    for (std::size_t i = arg_list_open + 1; i < arg_list_close; )
     {
         if (pretty_function[i] == ',')
         {
             ++i;
         }
-        while (i < arg_list_end && isspace(pretty_function[i]))
+        while (i < arg_list_close && isspace(pretty_function[i]))
         {
             ++i;
         }
-        if (i >= arg_list_end)
+        if (i >= arg_list_close)
         {
             break;
         }
 
         std::string arg_type = arg_list_get_type_string(pretty_function, i);
 
+        if (arg_type.empty())
+        {
+            break;
+        }
         argument_types.emplace_back(arg_type);
         i += arg_type.length();
     }
 
-    std::size_t extra_information_begin = arg_list_end + 2;
     std::size_t len = pretty_function.length();
+    std::size_t extra_information_begin = std::min(arg_list_close + 1, len);
     while (extra_information_begin < len && isspace(pretty_function[extra_information_begin]))
     {
         ++extra_information_begin;
     }
     extra_information = pretty_function.substr(extra_information_begin);
+
+    return res;
+}
+
+// Returns the position of the `(` which opens the argument list (outside of
+// template arguments, lambda names, and after an `operator()` name), or the
+// length of the string, if there's none.  `operator_begin` is set to the position of the
+// function name's `operator` keyword, or `npos`.
+inline std::size_t FunctionInfo::find_arg_list(const std::string &s, std::size_t &operator_begin)
+{
+    static const std::string anonymous_namespace = "(anonymous namespace)";
+    std::size_t len = s.length();
+    int angle_count = 0;
+
+    operator_begin = std::string::npos;
+    for (std::size_t i = 0; i < len; ++i)
+    {
+        if (s.compare(i, 8, "operator") == 0 &&
+            (i == 0 || !is_identifier_char(s[i - 1])) &&
+            (i + 8 == len || !is_identifier_char(s[i + 8])))
+        {
+            // Skip the operator's symbol (e.g., `<<`, or `()`):
+            operator_begin = i;
+            i += 8;
+            while (i < len && s[i] == ' ')
+            {
+                ++i;
+            }
+            if (s.compare(i, 2, "()") == 0)
+            {
+                ++i;
+                continue;
+            }
+            while (i < len && s[i] != '(' && !is_identifier_char(s[i]) && s[i] != ' ')
+            {
+                ++i;
+            }
+            --i;
+            continue;
+        }
+        switch (s[i])
+        {
+            case '<':
+            case '{':
+                ++angle_count;
+                break;
+            case '>':
+            case '}':
+                --angle_count;
+                break;
+            case '(':
+                if (s.compare(i, anonymous_namespace.length(), anonymous_namespace) == 0)
+                {
+                    i += anonymous_namespace.length() - 1;
+                }
+                else if (angle_count == 0)
+                {
+                    std::size_t close = find_closing_bracket(s, i);
+
+                    // (A scope, like `main()::<lambda(int)>::`, isn't the
+                    // argument list.)
+                    if (close + 1 >= len || s.compare(close + 1, 2, "::") != 0)
+                    {
+                        return i;
+                    }
+                    i = close;
+                }
+                break;
+        }
+    }
+
+    return len;
+}
+
+// Returns the position of the `)` which closes the `(` at `open`, or the
+// length of the string.
+inline std::size_t FunctionInfo::find_closing_bracket(const std::string &s, std::size_t open)
+{
+    std::size_t len = s.length();
+    int bracket_count = 0;
+
+    for (std::size_t i = open; i < len; ++i)
+    {
+        if (s[i] == '(')
+        {
+            ++bracket_count;
+        }
+        else if (s[i] == ')' && --bracket_count == 0)
+        {
+            return i;
+        }
+    }
+
+    return len;
+}
+
+// Returns the position of the function name, which ends at `name_end`: after
+// the last space outside of template arguments, lambda names, and
+// parentheses, or 0 (if
+// there's no return type).
+inline std::size_t FunctionInfo::find_name_begin(const std::string &s, std::size_t name_end)
+{
+    int angle_count = 0;
+    int bracket_count = 0;
+
+    for (std::size_t i = name_end; i > 0; --i)
+    {
+        switch (s[i - 1])
+        {
+            case '>':
+            case '}':
+                ++angle_count;
+                break;
+            case '<':
+            case '{':
+                --angle_count;
+                break;
+            case ')':
+                ++bracket_count;
+                break;
+            case '(':
+                --bracket_count;
+                break;
+            case ' ':
+                if (angle_count == 0 && bracket_count == 0)
+                {
+                    return i;
+                }
+                break;
+        }
+    }
+
+    return 0;
+}
+
+// Returns the position after the last `::` outside of template arguments,
+// lambda names, and parentheses (or 0).
+inline std::size_t FunctionInfo::find_short_name_begin(const std::string &full_name)
+{
+    std::size_t operator_begin;
+    std::size_t end = full_name.length();
+
+    // (The name may end with an operator, like `operator<`.)
+    find_arg_list(full_name, operator_begin);
+    if (operator_begin != std::string::npos)
+    {
+        end = operator_begin;
+    }
+
+    int angle_count = 0;
+    int bracket_count = 0;
+
+    for (std::size_t i = end; i > 1; --i)
+    {
+        switch (full_name[i - 1])
+        {
+            case '>':
+            case '}':
+                ++angle_count;
+                break;
+            case '<':
+            case '{':
+                --angle_count;
+                break;
+            case ')':
+                ++bracket_count;
+                break;
+            case '(':
+                --bracket_count;
+                break;
+            case ':':
+                if (full_name[i - 2] == ':' && angle_count == 0 && bracket_count == 0)
+                {
+                    return i;
+                }
+                break;
+        }
+    }
+
+    return 0;
 }
 
-std::string FunctionInfo::arg_list_get_type_string(const std::string &s, size_t pos)
+inline std::string FunctionInfo::arg_list_get_type_string(const std::string &s, size_t pos)
 {
     std::size_t len = s.length();
     std::size_t i;
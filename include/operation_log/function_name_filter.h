@@ -0,0 +1,320 @@
+#ifndef _OPERATION_LOG_FUNCTION_NAME_FILTER_H
+#define _OPERATION_LOG_FUNCTION_NAME_FILTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace operation_log
+{
+
+// A filter that selects functions by a set of include and exclude glob
+// patterns over their full names (see `FunctionInfo::get_full_name()`).
+//
+// Rules are written as glob patterns (see `Glob`), and exclude rules are
+// prefixed with a `!`, e.g.:
+//
+//     mesh::*
+//     !*::operator<*
+//
+// The last rule that matches a name decides whether it's included.  A name
+// that matches no rule is included only if there are no include rules.
+//
+// All rules are matched at the same time by a combined deterministic
+// automaton, whose states are built lazily, when a name first leads to them.
+// Characters which don't appear literally in any pattern share a single
+// transition, so the transition tables stay small.
+//
+// Matching updates the automaton, so a filter shouldn't be used by several
+// threads at the same time.  (The `CallSiteRegistry` serializes its use of
+// its filter.)
+class FunctionNameFilter
+{
+public:
+    // The environment variable with `;`, or new line separated rules, which
+    // `CallSiteRegistry` reads at start up:
+    static constexpr const char *rules_environment_variable = "OPERATION_LOG_FILTER";
+    // The environment variable with the path to a file with one rule per line,
+    // which `CallSiteRegistry` reads at start up:
+    static constexpr const char *rules_file_environment_variable = "OPERATION_LOG_FILTER_FILE";
+
+    FunctionNameFilter()
+    {}
+
+    FunctionNameFilter(const std::vector<std::string> &rules)
+    {
+        for (const std::string &rule : rules)
+        {
+            add_rule(rule);
+        }
+    }
+
+    // Parses rules separated by `;`, or new lines.  Blank rules, and lines
+    // starting with `#` are ignored.
+    static FunctionNameFilter parse(const std::string &rules_text)
+    {
+        FunctionNameFilter res;
+
+        res.add_rules(rules_text);
+
+        return res;
+    }
+
+    bool empty() const
+    {
+        return rules.empty();
+    }
+
+    // Adds a rule.  Rules starting with `!` are exclude rules.
+    void add_rule(const std::string &rule)
+    {
+        if (!rule.empty() && rule[0] == '!')
+        {
+            add_rule(rule.substr(1), false);
+        }
+        else
+        {
+            add_rule(rule, true);
+        }
+    }
+
+    void add_rule(const std::string &pattern, bool is_include)
+    {
+        rules.push_back(Rule { pattern, is_include });
+        has_include_rules = has_include_rules || is_include;
+        clear_automaton();
+    }
+
+    // Adds rules separated by `;`, or new lines.  (See `parse()`.)
+    void add_rules(const std::string &rules_text)
+    {
+        std::size_t len = rules_text.length();
+
+        for (std::size_t i = 0; i <= len; )
+        {
+            std::size_t rule_end = std::min(rules_text.find_first_of(";\n", i), len);
+            std::string rule = trim(rules_text.substr(i, rule_end - i));
+
+            if (!rule.empty() && rule[0] != '#')
+            {
+                add_rule(rule);
+            }
+            i = rule_end + 1;
+        }
+    }
+
+    // Adds the rules from a file with one rule per line.
+    //
+    // Returns `false`, if the file can't be read.
+    bool add_rules_from_file(const std::string &path)
+    {
+        std::ifstream input(path);
+
+        if (!input)
+        {
+            return false;
+        }
+
+        std::stringstream rules_text;
+
+        rules_text << input.rdbuf();
+        add_rules(rules_text.str());
+
+        return true;
+    }
+
+    bool matches(const std::string &function_name)
+    {
+        if (states.empty() || states.size() > max_state_count)
+        {
+            build_start_state();
+        }
+
+        int state_i = 0;
+
+        for (char ch : function_name)
+        {
+            int class_i = char_classes[static_cast<unsigned char>(ch)];
+            int next_state_i = states[state_i].transitions[class_i];
+
+            if (next_state_i < 0)
+            {
+                next_state_i = build_transition(state_i, class_i);
+            }
+            state_i = next_state_i;
+        }
+
+        int rule_i = states[state_i].matching_rule_i;
+
+        return rule_i < 0 ? !has_include_rules : rules[rule_i].is_include;
+    }
+
+private:
+    struct Rule
+    {
+        std::string pattern;
+        bool is_include;
+    };
+
+    // A set of positions in the patterns of all rules:
+    typedef std::vector<std::pair<std::uint32_t, std::uint32_t>> PositionSet;
+
+    struct State
+    {
+        PositionSet positions;
+        // The index of the last rule whose pattern is completely matched in
+        // this state, or -1:
+        int matching_rule_i;
+        // The next state index for each character class, or -1 if not built
+        // yet:
+        std::vector<int> transitions;
+    };
+
+    // Limits the memory used by the automaton.  It's rebuilt from scratch if
+    // it grows beyond this.
+    static const std::size_t max_state_count = 4096;
+
+    std::vector<Rule> rules;
+    bool has_include_rules = false;
+
+    // Characters which appear literally in a pattern have their own class.
+    // All others belong to class 0.
+    std::vector<int> char_classes;
+    std::vector<char> class_chars;
+    std::vector<State> states;
+    std::map<PositionSet, int> state_indices;
+
+    static std::string trim(const std::string &s)
+    {
+        std::size_t begin = s.find_first_not_of(" \t\r");
+
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+
+        return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+    }
+
+    void clear_automaton()
+    {
+        states.clear();
+        state_indices.clear();
+    }
+
+    void build_start_state()
+    {
+        clear_automaton();
+        char_classes.assign(256, 0);
+        class_chars.assign(1, '\0');
+        for (const Rule &rule : rules)
+        {
+            for (char ch : rule.pattern)
+            {
+                unsigned char uch = static_cast<unsigned char>(ch);
+
+                if (ch != '*' && ch != '?' && char_classes[uch] == 0)
+                {
+                    char_classes[uch] = class_chars.size();
+                    class_chars.push_back(ch);
+                }
+            }
+        }
+
+        PositionSet start_positions;
+
+        for (std::uint32_t rule_i = 0; rule_i < rules.size(); ++rule_i)
+        {
+            add_position(start_positions, rule_i, 0);
+        }
+        add_state(start_positions);
+    }
+
+    // Adds a position, and all positions reachable from it without consuming
+    // a character (i.e., past `*`s):
+    void add_position(PositionSet &positions, std::uint32_t rule_i, std::uint32_t pos)
+    {
+        const std::string &pattern = rules[rule_i].pattern;
+
+        positions.emplace_back(rule_i, pos);
+        while (pos < pattern.length() && pattern[pos] == '*')
+        {
+            positions.emplace_back(rule_i, ++pos);
+        }
+    }
+
+    int add_state(PositionSet &positions)
+    {
+        std::sort(positions.begin(), positions.end());
+        positions.erase(
+            std::unique(positions.begin(), positions.end()), positions.end());
+
+        auto found = state_indices.find(positions);
+
+        if (found != state_indices.end())
+        {
+            return found->second;
+        }
+
+        int matching_rule_i = -1;
+
+        for (const auto &position : positions)
+        {
+            if (position.second == rules[position.first].pattern.length())
+            {
+                matching_rule_i = std::max(matching_rule_i, static_cast<int>(position.first));
+            }
+        }
+
+        int state_i = states.size();
+
+        states.push_back(State {
+            positions, matching_rule_i, std::vector<int>(class_chars.size(), -1) });
+        state_indices[positions] = state_i;
+
+        return state_i;
+    }
+
+    int build_transition(int state_i, int class_i)
+    {
+        PositionSet next_positions;
+
+        for (const auto &position : states[state_i].positions)
+        {
+            const std::string &pattern = rules[position.first].pattern;
+
+            if (position.second >= pattern.length())
+            {
+                continue;
+            }
+
+            char pattern_ch = pattern[position.second];
+
+            if (pattern_ch == '*')
+            {
+                add_position(next_positions, position.first, position.second);
+            }
+            else if (pattern_ch == '?' ||
+                (class_i != 0 && pattern_ch == class_chars[class_i]))
+            {
+                add_position(next_positions, position.first, position.second + 1);
+            }
+        }
+
+        int next_state_i = add_state(next_positions);
+
+        states[state_i].transitions[class_i] = next_state_i;
+
+        return next_state_i;
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_FUNCTION_NAME_FILTER_H
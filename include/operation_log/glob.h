@@ -0,0 +1,64 @@
+#ifndef _OPERATION_LOG_GLOB_H
+#define _OPERATION_LOG_GLOB_H
+
+#include <string>
+
+
+namespace operation_log
+{
+
+// Matches text against shell-style wildcard patterns.
+//
+// A `*` in a pattern matches any sequence of characters (including an empty
+// one), and a `?` matches any single character.  All other characters match
+// themselves.
+class Glob
+{
+public:
+    static bool matches(const std::string &pattern, const std::string &text)
+    {
+        std::size_t pattern_len = pattern.length();
+        std::size_t text_len = text.length();
+        std::size_t p = 0;
+        std::size_t t = 0;
+        // Where to resume matching, if the characters following the last
+        // `*` fail to match:
+        std::size_t star_p = std::string::npos;
+        std::size_t star_t = 0;
+
+        while (t < text_len)
+        {
+            if (p < pattern_len && pattern[p] == '*')
+            {
+                star_p = p++;
+                star_t = t;
+            }
+            else if (p < pattern_len &&
+                (pattern[p] == '?' || pattern[p] == text[t]))
+            {
+                ++p;
+                ++t;
+            }
+            else if (star_p != std::string::npos)
+            {
+                // Let the last `*` swallow one more character:
+                p = star_p + 1;
+                t = ++star_t;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        while (p < pattern_len && pattern[p] == '*')
+        {
+            ++p;
+        }
+
+        return p == pattern_len;
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_GLOB_H
@@ -0,0 +1,269 @@
+#ifndef _OPERATION_LOG_HEAP_ACCOUNTING_H
+#define _OPERATION_LOG_HEAP_ACCOUNTING_H
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "type_traits.h"
+
+
+namespace operation_log
+{
+
+// The number of heap allocations, and the bytes they requested.
+struct HeapTotals
+{
+    long long allocation_c;
+    long long byte_c;
+};
+
+// The heap allocations made in a logged function call: including the calls
+// it made (inclusive), and excluding logged nested calls (exclusive).
+struct HeapScopeTotals
+{
+    HeapTotals inclusive;
+    HeapTotals exclusive;
+};
+
+// The heap allocations of all calls of a logged function (see
+// `HeapAccounting::list_functions()`).
+struct HeapFunctionTotals
+{
+    std::string function_name;
+    long long call_c;
+    HeapTotals inclusive;
+    HeapTotals exclusive;
+};
+
+// Counts heap allocations, and attributes them to the innermost logged
+// function (`FunctionEntry`) on the thread that made them.
+//
+// Allocations are counted by the hooks in `account_allocations.h`, which
+// replace the global `operator new`, and `operator delete` (or `malloc()`,
+// and its aligned variants), and switch the accounting on.  A hook only increments the thread's running
+// totals, so it doesn't allocate, or lock.  Logged function calls remember
+// the totals when they're entered, and subtract them when they exit.
+// Allocations the operation log makes itself aren't counted (see `Pause`).
+//
+// The totals of each call are logged before its exit (as a `heap` value),
+// and added up for each function, for `write_report()`.
+class HeapAccounting
+{
+public:
+    static bool is_active()
+    {
+        return get_active().load(std::memory_order_relaxed);
+    }
+
+    static void set_active(bool value)
+    {
+        get_active().store(value, std::memory_order_relaxed);
+    }
+
+    // Counts an allocation on the current thread.  (Called by the hooks.)
+    static void add_allocation(std::size_t byte_c)
+    {
+        ThreadState &state = get_thread_state();
+
+        if (state.pause_c == 0)
+        {
+            ++state.totals.allocation_c;
+            state.totals.byte_c += static_cast<long long>(byte_c);
+        }
+    }
+
+    // Returns the allocations the current thread made so far.
+    static HeapTotals get_thread_totals()
+    {
+        return get_thread_state().totals;
+    }
+
+    // Stops counting the current thread's allocations while it exists.
+    class Pause
+    {
+    public:
+        Pause()
+        {
+            ++get_thread_state().pause_c;
+        }
+
+        ~Pause()
+        {
+            --get_thread_state().pause_c;
+        }
+
+        Pause(const Pause &) = delete;
+        Pause& operator=(const Pause &) = delete;
+    };
+
+    // The allocations of a logged function call.  Scopes are entered, and
+    // exited in the order of the calls on each thread.
+    class Scope
+    {
+    public:
+        bool is_entered() const
+        {
+            return is_scope_entered;
+        }
+
+        void enter()
+        {
+            ThreadState &state = get_thread_state();
+
+            entry_totals = state.totals;
+            parent = state.innermost_scope;
+            state.innermost_scope = this;
+            is_scope_entered = true;
+        }
+
+        HeapScopeTotals exit()
+        {
+            ThreadState &state = get_thread_state();
+            HeapScopeTotals res;
+
+            res.inclusive.allocation_c = state.totals.allocation_c - entry_totals.allocation_c;
+            res.inclusive.byte_c = state.totals.byte_c - entry_totals.byte_c;
+            res.exclusive.allocation_c = res.inclusive.allocation_c - nested_totals.allocation_c;
+            res.exclusive.byte_c = res.inclusive.byte_c - nested_totals.byte_c;
+            if (parent)
+            {
+                parent->nested_totals.allocation_c += res.inclusive.allocation_c;
+                parent->nested_totals.byte_c += res.inclusive.byte_c;
+            }
+            state.innermost_scope = parent;
+            is_scope_entered = false;
+
+            return res;
+        }
+
+    private:
+        HeapTotals entry_totals = { 0, 0 };
+        // The inclusive totals of the nested scopes, which have exited:
+        HeapTotals nested_totals = { 0, 0 };
+        Scope *parent = nullptr;
+        bool is_scope_entered = false;
+    };
+
+    // Adds a call's totals to the function's totals.
+    static void add_to_report(const std::string &function_name, const HeapScopeTotals &totals)
+    {
+        Pause pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+        HeapFunctionTotals &function_totals = report.functions[function_name];
+
+        ++function_totals.call_c;
+        function_totals.inclusive.allocation_c += totals.inclusive.allocation_c;
+        function_totals.inclusive.byte_c += totals.inclusive.byte_c;
+        function_totals.exclusive.allocation_c += totals.exclusive.allocation_c;
+        function_totals.exclusive.byte_c += totals.exclusive.byte_c;
+    }
+
+    // Returns the totals of each function, which has exited, by exclusive
+    // bytes, in descending order.  (The inclusive totals of recursive
+    // functions count the nested calls at each level.)
+    static std::vector<HeapFunctionTotals> list_functions()
+    {
+        Pause pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+        std::vector<HeapFunctionTotals> res;
+
+        res.reserve(report.functions.size());
+        for (const auto &name_and_totals : report.functions)
+        {
+            res.push_back(name_and_totals.second);
+            res.back().function_name = name_and_totals.first;
+        }
+        std::sort(
+            res.begin(), res.end(),
+            [](const HeapFunctionTotals &a, const HeapFunctionTotals &b)
+            {
+                return a.exclusive.byte_c > b.exclusive.byte_c;
+            });
+
+        return res;
+    }
+
+    // Writes the totals of each function as a table.
+    static void write_report(std::ostream &out)
+    {
+        std::vector<HeapFunctionTotals> functions = list_functions();
+        Pause pause;
+
+        out << std::setw(14) << "excl. allocs" << std::setw(14) << "excl. bytes" <<
+            std::setw(14) << "incl. allocs" << std::setw(14) << "incl. bytes" <<
+            std::setw(10) << "calls" << "  function" << std::endl;
+        for (const HeapFunctionTotals &function_totals : functions)
+        {
+            out << std::setw(14) << function_totals.exclusive.allocation_c <<
+                std::setw(14) << function_totals.exclusive.byte_c <<
+                std::setw(14) << function_totals.inclusive.allocation_c <<
+                std::setw(14) << function_totals.inclusive.byte_c <<
+                std::setw(10) << function_totals.call_c <<
+                "  " << function_totals.function_name << std::endl;
+        }
+    }
+
+    static void reset_report()
+    {
+        Pause pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+
+        report.functions.clear();
+    }
+
+private:
+    // It's trivially constructible, so it's accessed without a thread-local
+    // initialization guard (and the hooks can use it at any time).
+    struct ThreadState
+    {
+        int pause_c;
+        HeapTotals totals;
+        Scope *innermost_scope;
+    };
+
+    struct Report
+    {
+        std::mutex mutex;
+        std::map<std::string, HeapFunctionTotals> functions;
+    };
+
+    static ThreadState& get_thread_state()
+    {
+        static thread_local ThreadState state;
+
+        return state;
+    }
+
+    static std::atomic<bool>& get_active()
+    {
+        static std::atomic<bool> value(false);
+
+        return value;
+    }
+
+    static Report& get_report()
+    {
+        static Report report;
+
+        return report;
+    }
+};
+
+// The totals are plain numbers, so they're formatted on the background
+// thread by `DeferredFormatter`.
+template <>
+struct IsTriviallyCapturable<HeapScopeTotals> : public std::true_type {};
+
+}
+
+#endif // _OPERATION_LOG_HEAP_ACCOUNTING_H
@@ -7,9 +7,11 @@
 #include <string>
 #include <vector>
 
+#include "blob.h"
 #include "formatter_base.h"
 #include "function_info.h"
 #include "html_utils.h"
+#include "string_ref.h"
 #include "value_formatter_i.h"
 
 
@@ -32,10 +34,15 @@ public:
         write_footer();
     }
 
-    void exit_function()
+    void write_blob(const Blob &blob) override
     {
-        output.get() << "</div>" << std::endl;
-        this->FormatterBase::exit_function();
+        write_message_prefix();
+        blob_writer.write(output.get(), blob);
+    }
+
+    void write_value(std::ostream &out, ValueFormatterI &value_formatter) const override
+    {
+        value_formatter.write_html(out);
     }
 
     std::string get_style_code()
@@ -56,6 +63,7 @@ public:
 private:
     bool was_header_written;
     std::string log_name;
+    HtmlBlobWriter blob_writer;
     std::string style_code = R"code(
   <style>
     .operation-log {
@@ -92,9 +100,9 @@ private:
   </style>
 )code";
 
-    void write_escaped(std::string value)
+    void write_escaped(StringRef value)
     {
-        HtmlUtils::write_escaped(output.get(), value);
+        HtmlUtils::write_escaped(output.get(), value.data(), value.size());
     }
 
     void write_header()
@@ -142,7 +150,7 @@ private:
         }
     }
 
-    void write_message_value(std::string message) override
+    void write_message_value(StringRef message) override
     {
         output.get() << "  <div class=\"operation-log-message\">";
         write_escaped(message);
@@ -157,7 +165,7 @@ private:
 )code";
     }
 
-    void write_html_value(std::string code) override
+    void write_html_value(StringRef code) override
     {
         output.get() << "  <div class=\"operation-log-html-message\">" <<
             code <<
@@ -175,21 +183,17 @@ private:
     void write_dump_vars_separator() override
     {}
 
-    void write_dump_var_lm(std::string name, std::string value_formatted)
+    void write_dump_var(
+        const std::string &name, ValueFormatterI &value_formatter) override
     {
         output.get() <<
             "    <div class=\"operation-log-var\"><span class=\"operation-log-var-name\">";
         write_escaped(name);
-        output.get() << "</span> = <span class=\"operation-log-var-value\">" <<
-            value_formatted;
+        output.get() << "</span> = <span class=\"operation-log-var-value\">";
+        write_value(output.get(), value_formatter);
         output.get() << "</span></div>" << std::endl;
     }
 
-    void write_dump_var(std::string name, ValueFormatterI &value_formatter)
-    {
-        write_dump_var_lm(name, value_formatter.to_html());
-    }
-
     void write_function_prefix() override
     {
         output.get() <<
@@ -202,13 +206,13 @@ private:
         output.get() << "  </div>" << std::endl;
     }
 
-    void write_function_exit(FunctionInfo &function_info) override
+    void write_function_exit(const FunctionInfo &function_info) override
     {
         output.get() << "</div>" << std::endl;
     }
 
     void write_function_return_type_and_name(
-        std::string return_type, std::string name) override
+        const std::string &return_type, const std::string &name) override
     {
         output.get() <<
             "<span class=\"operation-log-function-return-type\">";
@@ -233,26 +237,20 @@ private:
         output.get() << ", ";
     }
 
-    void write_function_arg_lms(
-        std::string type_name, std::string parameter_name,
-        std::string value_formatted)
+    void write_function_arg(
+        const std::string &type_name, const std::string &parameter_name,
+        ValueFormatterI &value_formatter) override
     {
         output.get() << "<span class=\"operation-log-function-arg-type\">";
         write_escaped(type_name);
         output.get() << "</span> <span class=\"operation-log-function-arg-name\">";
         write_escaped(parameter_name);
-        output.get() << "</span> = <span class=\"operation-log-function-arg-value\">" <<
-            value_formatted;
+        output.get() << "</span> = <span class=\"operation-log-function-arg-value\">";
+        write_value(output.get(), value_formatter);
         output.get() << "</span>";
     }
 
-    void write_function_arg(
-        std::string type_name, std::string parameter_name, ValueFormatterI &value_formatter)
-    {
-        write_function_arg_lms(type_name, parameter_name, value_formatter.to_html());
-    }
-
-    void write_function_extra_info(std::string info) override
+    void write_function_extra_info(const std::string &info) override
     {
         output.get() << " <span class=\"operation-log-function-extra-info\">";
         write_escaped(info);
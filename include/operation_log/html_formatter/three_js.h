@@ -2,11 +2,6 @@
 R"code(
 
 <style>
-    .operation-log-3js-scene-container > canvas {
-        width: 500;
-        height: 500;
-    }
-
     .operation-log-3js-scene-container {
         position: relative;
     }
@@ -25,59 +20,296 @@ R"code(
 
 var operation_log_3js = (function() {
 
+// Returns the number of vertices of a `THREE.Geometry`, or a
+// `THREE.BufferGeometry`.
+function getVertexCount(geometry)
+{
+    if (geometry.isBufferGeometry)
+    {
+        return geometry.getAttribute('position').count;
+    }
+    return geometry.vertices.length;
+}
+
+function copyVertex(target, geometry, vertexIndex)
+{
+    if (geometry.isBufferGeometry)
+    {
+        return target.fromBufferAttribute(geometry.getAttribute('position'), vertexIndex);
+    }
+    return target.copy(geometry.vertices[vertexIndex]);
+}
+
+// Decodes base64 data (see `Base64::write()`) to a byte array, which typed
+// arrays can view.
+function decodeBase64(data)
+{
+    var binary = atob(data);
+    var bytes = new Uint8Array(binary.length);
+
+    for (var i = 0; i < binary.length; ++i)
+    {
+        bytes[i] = binary.charCodeAt(i);
+    }
+    return bytes;
+}
+
+const BLOB_ELEMENT_ID_PREFIX = 'operation-log-blob-';
+
+// The blobs loaded so far, by id:
+const blobs = new Map();
+
+// Returns the bytes of a blob the log formatter wrote (see `Blob`), applying
+// the deltas it was written as.
+function getBlob(id)
+{
+    var bytes = blobs.get(id);
+
+    if (bytes)
+    {
+        return bytes;
+    }
+
+    // The blob, and the blobs it's a delta of, up to one that was loaded, or
+    // was written in full:
+    var elements = [];
+
+    for (var blobId = id; blobId && !bytes; )
+    {
+        var element = document.getElementById(BLOB_ELEMENT_ID_PREFIX + blobId);
+
+        if (!element)
+        {
+            throw new Error('The log has no blob ' + blobId + '.');
+        }
+        elements.push(element);
+        blobId = element.getAttribute('data-base');
+        bytes = blobId && blobs.get(blobId);
+    }
+    for (var element_i = elements.length - 1; element_i >= 0; --element_i)
+    {
+        var data = decodeBase64(elements[element_i].textContent);
+
+        bytes = elements[element_i].hasAttribute('data-base') ?
+            applyDelta(bytes, data) : data;
+        blobs.set(elements[element_i].id.substr(BLOB_ELEMENT_ID_PREFIX.length), bytes);
+    }
+    return bytes;
+}
+
+// Applies a delta (see `BlobSeries`) to a copy of a blob's bytes.
+function applyDelta(baseBytes, deltaBytes)
+{
+    var bytes = baseBytes.slice();
+    var delta = new DataView(deltaBytes.buffer);
+
+    for (var offset = 0; offset < deltaBytes.length; )
+    {
+        var word_i = delta.getUint32(offset, true);
+        var word_c = delta.getUint32(offset + 4, true);
+
+        bytes.set(deltaBytes.subarray(offset + 8, offset + 8 + 4 * word_c), 4 * word_i);
+        offset += 8 + 4 * word_c;
+    }
+    return bytes;
+}
+
+// Returns the bytes of base64 data, or a blob (which is already bytes).
+function getBytes(data)
+{
+    return typeof data == 'string' ? decodeBase64(data) : data;
+}
+
+// Creates a `THREE.BufferGeometry` from `Float32Array` vertex positions (x,
+// y, z), and optionally `Uint32Array` indices, and `Float32Array` vertex
+// colors (r, g, b), which are base64 packed, or blobs.  (See
+// `ThreeJsGeometry`.)
+function createBufferGeometry(positionData, indexData, colorData)
+{
+    var geometry = new THREE.BufferGeometry();
+    // (`addAttribute()` was renamed to `setAttribute()` in three.js r110.)
+    var setAttribute = (geometry.setAttribute || geometry.addAttribute).bind(geometry);
+
+    setAttribute('position', new THREE.BufferAttribute(
+        new Float32Array(getBytes(positionData).buffer), 3));
+    if (colorData)
+    {
+        setAttribute('color', new THREE.BufferAttribute(
+            new Float32Array(getBytes(colorData).buffer), 3));
+    }
+    if (indexData)
+    {
+        geometry.setIndex(new THREE.BufferAttribute(
+            new Uint32Array(getBytes(indexData).buffer), 1));
+        geometry.computeVertexNormals();
+    }
+    geometry.computeBoundingSphere();
+
+    return geometry;
+}
+
+// Draws the scene views in the document with one shared `WebGLRenderer`, so
+// a log with any number of scenes needs a single WebGL context.
+//
+// A view is only built (see `addLazySceneView()`), drawn, and animated while
+// it's scrolled into view.  Its scene is drawn to an offscreen canvas, and
+// copied to the view's own canvas.  When the view is scrolled out, its
+// scene's GPU resources are released, and the canvas keeps the last frame.
 class ThreeJsDocument
 {
     constructor()
     {
-        this.renderers = [];
+        this.renderer = null; // Created when a view is first drawn.
+        this.sceneViews = new Set();
+        this.visibleSceneViews = new Set();
+        this.observer = null;
 
         var self = this;
 
+        if (typeof IntersectionObserver != 'undefined')
+        {
+            // (Views are prepared a little before they're scrolled into view.)
+            this.observer = new IntersectionObserver(function(entries) {
+                    for (var entry_i = 0; entry_i < entries.length; ++entry_i)
+                    {
+                        var entry = entries[entry_i];
+
+                        entry.target.operationLogSceneViewContainer.setVisible(
+                            entry.isIntersecting);
+                    }
+                    self.removeDetachedSceneViews();
+                },
+                { rootMargin: '200px' });
+        }
+
         this.animate = function animate(timestamp)
         {
-            for (var i = 0; i < self.renderers.length; ++i)
+            var wasViewDetached = false;
+
+            self.visibleSceneViews.forEach(function(sceneView) {
+                    if (!sceneView.containerElement.isConnected)
+                    {
+                        wasViewDetached = true;
+                    }
+                    else if (sceneView.animationFrame)
+                    {
+                        sceneView.animationFrame(timestamp, sceneView);
+                    }
+                    else if (sceneView.controls)
+                    {
+                        sceneView.render();
+                    }
+                });
+            if (wasViewDetached)
             {
-                var sceneView = self.renderers[i];
-
-                if (sceneView.animationFrame)
-                {
-                    sceneView.animationFrame(timestamp, sceneView);
-                    continue;
-                }
-                sceneView.render();
+                self.removeDetachedSceneViews();
             }
 
             requestAnimationFrame(self.animate);
         };
     }
 
+    // Returns the shared renderer.
+    getRenderer()
+    {
+        if (!this.renderer)
+        {
+            this.renderer = new THREE.WebGLRenderer({ antialias: true });
+            this.renderer.setPixelRatio(window.devicePixelRatio || 1);
+            this.renderer.autoClear = false;
+        }
+        return this.renderer;
+    }
+
+    // Adds the view's container element after the script which is running,
+    // and draws the view when it's scrolled into view.
     addSceneView(sceneView)
     {
-        var scripts = document.getElementsByTagName('script');
-        var currentScript = scripts[scripts.length - 1];
-        var containerElement = document.createElement('div');
+        this.addSceneViewContainer(
+            sceneView.width, sceneView.height).setSceneView(sceneView);
+    }
+
+    // Like `addSceneView()`, but the view is only built by
+    // `createSceneView()`, which returns it, when it's first scrolled into
+    // view.  Until then, an empty area of the given size takes its place.
+    addLazySceneView(createSceneView, width, height)
+    {
+        this.addSceneViewContainer(width, height).createSceneView = createSceneView;
+    }
 
-        containerElement.className = sceneView.containerElementClassName;
-        containerElement.appendChild(sceneView.renderer.domElement);
-        currentScript.parentNode.appendChild(containerElement);
-        sceneView.containerElement = containerElement;
+    addSceneViewContainer(width, height)
+    {
+        var scripts = document.getElementsByTagName('script');
+        // (Scripts inserted later, e.g., by the log viewer, aren't last.)
+        var currentScript = document.currentScript || scripts[scripts.length - 1];
+        var container = new SceneViewContainer(this, width, height);
 
-        if (sceneView.animationFrame || sceneView.controls)
+        currentScript.parentNode.appendChild(container.element);
+        if (this.observer)
         {
-            this.renderers.push(sceneView);
+            this.observer.observe(container.element);
         }
-        if (sceneView.renderer)
+        else
         {
-            sceneView.renderer.render(sceneView.scene, sceneView.camera);
-            for (var label_i = 0; label_i < sceneView.labels.length; ++label_i)
-            {
-                var label = sceneView.labels[label_i];
+            container.setVisible(true);
+        }
+        return container;
+    }
 
-                containerElement.appendChild(label.domElement);
-                label.updatePosition(
-                    sceneView.camera, sceneView.renderer);
-            }
+    // Forgets the views which were removed from the document (e.g., by the
+    // log viewer).
+    removeDetachedSceneViews()
+    {
+        var self = this;
+
+        this.sceneViews.forEach(function(sceneView) {
+                if (!sceneView.containerElement.isConnected)
+                {
+                    sceneView.releaseResources();
+                    self.sceneViews.delete(sceneView);
+                    self.visibleSceneViews.delete(sceneView);
+                    if (self.observer)
+                    {
+                        self.observer.unobserve(sceneView.containerElement);
+                    }
+                }
+            });
+    }
+
+    // Draws a view's scene with the shared renderer, and copies it to the
+    // view's canvas.
+    renderSceneView(sceneView)
+    {
+        var renderer = this.getRenderer();
+        var pixelRatio = renderer.getPixelRatio();
+        var canvas = renderer.domElement;
+        var width = Math.ceil(sceneView.width * pixelRatio);
+        var height = Math.ceil(sceneView.height * pixelRatio);
+
+        if (canvas.width < width || canvas.height < height)
+        {
+            renderer.setSize(
+                Math.max(canvas.width / pixelRatio, sceneView.width),
+                Math.max(canvas.height / pixelRatio, sceneView.height),
+                false);
         }
+        renderer.setViewport(0, 0, sceneView.width, sceneView.height);
+        renderer.setScissor(0, 0, sceneView.width, sceneView.height);
+        renderer.setScissorTest(true);
+        renderer.setClearColor(sceneView.clearColor, 1);
+        renderer.clear();
+        renderer.render(sceneView.scene, sceneView.camera);
+
+        var context = sceneView.domElement.getContext('2d');
+
+        if (sceneView.domElement.width != width || sceneView.domElement.height != height)
+        {
+            sceneView.domElement.width = width;
+            sceneView.domElement.height = height;
+        }
+        // (The viewport is at the bottom of the canvas.)
+        context.clearRect(0, 0, width, height);
+        context.drawImage(canvas, 0, canvas.height - height, width, height, 0, 0, width, height);
     }
 
     addListeners()
@@ -90,20 +322,110 @@ class ThreeJsDocument
     }
 }
 
+// The element which holds a scene view, and its labels, in the document.
+class SceneViewContainer
+{
+    constructor(l3jsDocument, width, height)
+    {
+        this.l3jsDocument = l3jsDocument;
+        this.sceneView = null;
+        this.createSceneView = null;
+        this.isVisible = false;
+        this.element = document.createElement('div');
+        this.element.className = 'operation-log-3js-scene-container';
+        this.element.style.width = (width || SCENE_VIEW_DEFAULT_SIZE) + 'px';
+        this.element.style.height = (height || SCENE_VIEW_DEFAULT_SIZE) + 'px';
+        this.element.operationLogSceneViewContainer = this;
+    }
+
+    setSceneView(sceneView)
+    {
+        this.sceneView = sceneView;
+        sceneView.containerElement = this.element;
+        this.element.style.width = sceneView.width + 'px';
+        this.element.style.height = sceneView.height + 'px';
+        this.element.appendChild(sceneView.domElement);
+        for (var label_i = 0; label_i < sceneView.labels.length; ++label_i)
+        {
+            this.element.appendChild(sceneView.labels[label_i].domElement);
+        }
+        this.l3jsDocument.sceneViews.add(sceneView);
+        if (this.isVisible)
+        {
+            this.setVisible(true);
+        }
+    }
+
+    setVisible(isVisible)
+    {
+        this.isVisible = isVisible;
+        if (isVisible && !this.sceneView && this.createSceneView)
+        {
+            var createSceneView = this.createSceneView;
+
+            this.createSceneView = null;
+            this.setSceneView(createSceneView());
+            return;
+        }
+        if (!this.sceneView)
+        {
+            return;
+        }
+        if (isVisible)
+        {
+            this.l3jsDocument.visibleSceneViews.add(this.sceneView);
+            this.sceneView.render();
+        }
+        else
+        {
+            this.l3jsDocument.visibleSceneViews.delete(this.sceneView);
+            this.sceneView.releaseResources();
+        }
+    }
+}
+
+const SCENE_VIEW_DEFAULT_SIZE = 250;
+
 class SceneView
 {
+    // @renderer: Ignored, the views share one renderer, but its size is
+    // used, and it's disposed, so it doesn't hold on to a WebGL context.
+    // Pass null, and set `width`, and `height` instead.
     constructor(scene, renderer, camera)
     {
         this.scene = scene;
-        this.renderer = renderer;
         this.camera = camera;
+        this.width = SCENE_VIEW_DEFAULT_SIZE;
+        this.height = SCENE_VIEW_DEFAULT_SIZE;
+        this.clearColor = 0x000000;
         this.labels = [];
         this.labelClassName = 'operation-log-3js-scene-view-label';
         this.controls = null; // E.g., mouse controls for rotating the view camera.
         this.controlsUpdating = false;
-        this.animationFrame = null; // Call back for each scene frame.
-        this.containerElement = null; // Set when the view is added to the DOM.
-        this.containerElementClassName = 'operation-log-3js-scene-container';
+        this.animationFrame = null; // Call back for each frame, while the view is visible.
+        this.containerElement = null; // Set when the view is added to the document.
+        // The canvas the scene is copied to (e.g., for the controls to listen on):
+        this.domElement = document.createElement('canvas');
+        this.domElement.style.width = '100%';
+        this.domElement.style.height = '100%';
+
+        if (renderer)
+        {
+            var size = renderer.getSize(new THREE.Vector2());
+
+            this.width = size.width || size.x;
+            this.height = size.height || size.y;
+            if (renderer.forceContextLoss)
+            {
+                renderer.forceContextLoss();
+            }
+            renderer.dispose();
+        }
+    }
+
+    get renderer()
+    {
+        return l3js_document.getRenderer();
     }
 
     createLabel(
@@ -142,19 +464,19 @@ class SceneView
     {
         const vertex_ofs = new THREE.Vector3(0, 0, 0);
 
-        for (var v_i = 0; v_i < mesh.geometry.vertices.length; ++v_i)
+        for (var v_i = 0; v_i < getVertexCount(mesh.geometry); ++v_i)
         {
             var label;
             
             if (labelHtmlLambda)
             {
                 label = this.createLabel(
-                    labelHtmlLambda(v_i), this.renderer, vertex_ofs, mesh, v_i, true);
+                    labelHtmlLambda(v_i), null, vertex_ofs, mesh, v_i, true);
             }
             else
             {
                 label = this.createLabel(
-                    'v<sub>' + v_i + '</sub>', this.renderer, vertex_ofs, mesh, v_i, true);
+                    'v<sub>' + v_i + '</sub>', null, vertex_ofs, mesh, v_i, true);
             }
             this.labels.push(label);
         }
@@ -162,23 +484,51 @@ class SceneView
 
     render()
     {
+        if (!this.containerElement)
+        {
+            return;
+        }
         if (this.controls && !this.controlsUpdating)
         {
             this.controlsUpdating = true;
             this.controls.update();
             this.controlsUpdating = false;
         }
-        this.renderer.render(this.scene, this.camera);
-        if (this.labels)
+        l3js_document.renderSceneView(this);
+        for (var label_i = 0; label_i < this.labels.length; ++label_i)
         {
-            for (var label_i = 0; label_i < this.labels.length; ++label_i)
-            {
-                var label = this.labels[label_i];
-
-                label.updatePosition(this.camera, this.renderer);
-            }
+            this.labels[label_i].updatePosition(this.camera, this.width, this.height);
         }
     }
+
+    // Releases the GPU resources of the scene's geometries, materials, and
+    // textures.  (They're uploaded again, when the scene is drawn again.)
+    releaseResources()
+    {
+        this.scene.traverse(function(object) {
+                if (object.geometry)
+                {
+                    object.geometry.dispose();
+                }
+
+                var materials = Array.isArray(object.material) ?
+                    object.material : (object.material ? [object.material] : []);
+
+                for (var material_i = 0; material_i < materials.length; ++material_i)
+                {
+                    var material = materials[material_i];
+
+                    for (var key in material)
+                    {
+                        if (material[key] && material[key].isTexture)
+                        {
+                            material[key].dispose();
+                        }
+                    }
+                    material.dispose();
+                }
+            });
+    }
 }
 
 class SceneReferencedDomElement
@@ -194,12 +544,12 @@ class SceneReferencedDomElement
         this.position3dBuf = this.position3d;
     }
 
-    updatePosition(camera, renderer)
+    updatePosition(camera, width, height)
     {
         var position2d = this.position3dBuf.project(camera);
 
-        position2d.x = (1 + position2d.x) / 2 * renderer.domElement.clientWidth;
-        position2d.y = (1 - position2d.y) / 2 * renderer.domElement.clientHeight;
+        position2d.x = (1 + position2d.x) / 2 * width;
+        position2d.y = (1 - position2d.y) / 2 * height;
 
         this.domElement.style.left = position2d.x + 'px';
         this.domElement.style.top = position2d.y + 'px';
@@ -217,7 +567,7 @@ class MeshReferencedDomElement extends SceneReferencedDomElement
         this.position3dBuf = new THREE.Vector3(0, 0, 0);
     }
 
-    updatePosition(camera, renderer)
+    updatePosition(camera, width, height)
     {
         if (this.transformPosition)
         {
@@ -230,7 +580,7 @@ class MeshReferencedDomElement extends SceneReferencedDomElement
             this.position3dBuf.copy(this.position3d);
             this.position3dBuf.add(this.referenceMesh.position);
         }
-        super.updatePosition(camera, renderer);
+        super.updatePosition(camera, width, height);
     }
 }
 
@@ -247,25 +597,25 @@ class MeshVertexReferencedDomElement extends SceneReferencedDomElement
         this.position3dBuf = new THREE.Vector3(0, 0, 0);
     }
 
-    updatePosition(camera, renderer)
+    updatePosition(camera, width, height)
     {
         if (this.transformPosition)
         {
-            this.position3dBuf.copy(
-                this.referenceMesh.geometry.vertices[this.referenceVertexIndex]);
+            copyVertex(
+                this.position3dBuf, this.referenceMesh.geometry, this.referenceVertexIndex);
             this.position3dBuf.add(this.position3d);
             this.referenceMesh.updateMatrixWorld();
             this.position3dBuf.applyMatrix4(this.referenceMesh.matrixWorld);
         }
         else
         {
-            this.position3dBuf.copy(
-                this.referenceMesh.geometry.vertices[this.referenceVertexIndex]);
+            copyVertex(
+                this.position3dBuf, this.referenceMesh.geometry, this.referenceVertexIndex);
             this.referenceMesh.updateMatrixWorld();
             this.position3dBuf.applyMatrix4(this.referenceMesh.matrixWorld);
             this.position3dBuf.add(this.position3d);
         }
-        super.updatePosition(camera, renderer);
+        super.updatePosition(camera, width, height);
     }
 }
 
@@ -275,7 +625,10 @@ l3js_document.addListeners();
 
 return {
     document: l3js_document,
-    SceneView: SceneView
+    SceneView: SceneView,
+    decodeBase64: decodeBase64,
+    getBlob: getBlob,
+    createBufferGeometry: createBufferGeometry
 };
 
 })();
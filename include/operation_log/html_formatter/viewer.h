@@ -0,0 +1,555 @@
+R"code(
+
+<style>
+    .operation-log-viewer {
+        margin: -8px;
+    }
+
+    .operation-log-viewer-toolbar {
+        display: flex;
+        gap: 0.5em;
+        align-items: center;
+        height: 32px;
+        padding: 0 8px;
+        border-bottom: 1px solid #3c3c3c;
+        font: 13px sans-serif;
+    }
+
+    .operation-log-viewer-rows {
+        position: relative;
+        height: calc(100vh - 33px);
+        overflow: auto;
+    }
+
+    .operation-log-viewer-row {
+        position: absolute;
+        left: 0;
+        right: 0;
+        white-space: pre;
+        overflow: hidden;
+    }
+
+    .operation-log-viewer-html-row {
+        overflow: auto;
+        white-space: normal;
+    }
+
+    .operation-log-viewer-toggle {
+        display: inline-block;
+        width: 1em;
+        cursor: pointer;
+    }
+
+    .operation-log-viewer-match {
+        background-color: #264f78;
+    }
+</style>
+
+<script>
+
+var operation_log_viewer = (function() {
+
+const MESSAGE_ROW = 0;
+const HTML_ROW = 1;
+const VAR_ROW = 2;
+const FUNCTION_ROW = 3;
+const ROWS_SCRIPT_TYPE = 'application/x-operation-log-rows';
+
+// Parses the rows of a `<script>` element.  The last one may be cut short,
+// if the program which wrote the log didn't finish.
+function parseRowChunk(text)
+{
+    try
+    {
+        return JSON.parse(text);
+    }
+    catch (e)
+    {
+    }
+    try
+    {
+        return JSON.parse(text + '\n]');
+    }
+    catch (e)
+    {
+    }
+
+    var lastRowEnd = text.lastIndexOf(',\n');
+
+    try
+    {
+        return lastRowEnd < 0 ? [] : JSON.parse(text.substring(0, lastRowEnd) + '\n]');
+    }
+    catch (e)
+    {
+        return [];
+    }
+}
+
+function countLines(text)
+{
+    var lineC = 1;
+
+    for (var i = text.indexOf('\n'); i >= 0 && i < text.length - 1; i = text.indexOf('\n', i + 1))
+    {
+        ++lineC;
+    }
+
+    return lineC;
+}
+
+// Shows the rows in a scrolled container, and only creates the elements of
+// the rows in view.
+class LogViewer
+{
+    constructor(rootElement)
+    {
+        this.rootElement = rootElement;
+        this.rows = [];
+        this.overscanHeight = 400;
+        this.indentWidth = 16;
+        this.renderedRows = new Map();
+        this.searchText = '';
+        this.matchRowIndex = -1;
+        this.matchC = 0;
+    }
+
+    load()
+    {
+        var chunks = document.querySelectorAll('script[type="' + ROWS_SCRIPT_TYPE + '"]');
+
+        for (var chunk_i = 0; chunk_i < chunks.length; ++chunk_i)
+        {
+            var chunkRows = parseRowChunk(chunks[chunk_i].textContent);
+
+            for (var row_i = 0; row_i < chunkRows.length; ++row_i)
+            {
+                this.rows.push(chunkRows[row_i]);
+            }
+        }
+        this.createElements();
+        this.indexRows();
+        this.updateVisibleRows();
+        this.render();
+    }
+
+    createElements()
+    {
+        var self = this;
+
+        this.toolbar = document.createElement('div');
+        this.toolbar.className = 'operation-log-viewer-toolbar';
+        this.toolbar.innerHTML =
+            '<input type="search" placeholder="Search (Enter: next, Shift+Enter: previous)" size="40">' +
+            '<span></span>' +
+            '<button>Collapse all</button>' +
+            '<button>Expand all</button>' +
+            '<span>' + this.rows.length + ' events</span>';
+        this.searchInput = this.toolbar.children[0];
+        this.searchStatus = this.toolbar.children[1];
+        this.searchInput.addEventListener('keydown', function(event) {
+            if (event.key == 'Enter')
+            {
+                self.search(self.searchInput.value, event.shiftKey ? -1 : 1);
+            }
+        });
+        this.toolbar.children[2].addEventListener('click', function() {
+            self.setAllCollapsed(true);
+        });
+        this.toolbar.children[3].addEventListener('click', function() {
+            self.setAllCollapsed(false);
+        });
+
+        this.scrollElement = document.createElement('div');
+        this.scrollElement.className = 'operation-log-viewer-rows';
+        this.contentElement = document.createElement('div');
+        this.scrollElement.appendChild(this.contentElement);
+        this.scrollElement.addEventListener('scroll', function() {
+            self.render();
+        });
+        window.addEventListener('resize', function() {
+            self.render();
+        });
+
+        this.rootElement.appendChild(this.toolbar);
+        this.rootElement.appendChild(this.scrollElement);
+
+        // Row heights come from the style sheet:
+        this.lineHeight = this.measureHeight('operation-log-viewer-row', 'X') || 18;
+        this.htmlRowHeight = this.measureHeight(
+            'operation-log-viewer-row operation-log-viewer-html-row', '') || 520;
+    }
+
+    measureHeight(className, text)
+    {
+        var element = document.createElement('div');
+
+        element.className = className;
+        element.style.position = 'static';
+        element.textContent = text;
+        this.contentElement.appendChild(element);
+
+        var res = element.offsetHeight;
+
+        this.contentElement.removeChild(element);
+
+        return res;
+    }
+
+    // Finds each row's parent function row, where each function's subtree
+    // ends, and how tall each row is.
+    indexRows()
+    {
+        var rowC = this.rows.length;
+        var openFunctions = [];
+
+        this.parents = new Int32Array(rowC);
+        this.subtreeEnds = new Int32Array(rowC);
+        this.heights = new Float64Array(rowC);
+        this.isCollapsed = new Uint8Array(rowC);
+
+        for (var row_i = 0; row_i < rowC; ++row_i)
+        {
+            var row = this.rows[row_i];
+            var depth = row[1];
+
+            while (openFunctions.length > depth)
+            {
+                this.subtreeEnds[openFunctions.pop()] = row_i;
+            }
+            this.parents[row_i] = openFunctions.length > 0 ?
+                openFunctions[openFunctions.length - 1] : -1;
+            this.subtreeEnds[row_i] = row_i + 1;
+            if (row[0] == FUNCTION_ROW)
+            {
+                openFunctions.push(row_i);
+            }
+            this.heights[row_i] = row[0] == HTML_ROW ?
+                this.htmlRowHeight :
+                this.lineHeight * countLines(this.getRowText(row_i));
+        }
+        while (openFunctions.length > 0)
+        {
+            this.subtreeEnds[openFunctions.pop()] = rowC;
+        }
+    }
+
+    // Lists the rows which aren't in collapsed subtrees, and their offsets.
+    updateVisibleRows()
+    {
+        var rowC = this.rows.length;
+        var top = 0;
+        var visibleC = 0;
+
+        this.visibleRows = new Int32Array(rowC);
+        this.offsets = new Float64Array(rowC + 1);
+        for (var row_i = 0; row_i < rowC;)
+        {
+            this.visibleRows[visibleC] = row_i;
+            this.offsets[visibleC] = top;
+            top += this.heights[row_i];
+            ++visibleC;
+            row_i = this.isCollapsed[row_i] ? this.subtreeEnds[row_i] : row_i + 1;
+        }
+        this.offsets[visibleC] = top;
+        this.visibleC = visibleC;
+        this.contentElement.style.height = top + 'px';
+    }
+
+    // Returns the index of the first visible row which ends below `y`.
+    findVisibleRow(y)
+    {
+        var begin = 0;
+        var end = this.visibleC;
+
+        while (begin < end)
+        {
+            var middle = (begin + end) >> 1;
+
+            if (this.offsets[middle + 1] <= y)
+            {
+                begin = middle + 1;
+            }
+            else
+            {
+                end = middle;
+            }
+        }
+
+        return begin;
+    }
+
+    render()
+    {
+        var top = this.scrollElement.scrollTop;
+        var bottom = top + this.scrollElement.clientHeight;
+        var first = this.findVisibleRow(top - this.overscanHeight);
+        var end = Math.min(this.findVisibleRow(bottom + this.overscanHeight) + 1, this.visibleC);
+        var renderedRows = new Map();
+
+        for (var visible_i = first; visible_i < end; ++visible_i)
+        {
+            var row_i = this.visibleRows[visible_i];
+            var element = this.renderedRows.get(row_i);
+
+            if (element)
+            {
+                this.renderedRows.delete(row_i);
+            }
+            else
+            {
+                element = this.createRowElement(row_i);
+                this.contentElement.appendChild(element);
+                if (this.rows[row_i][0] == HTML_ROW)
+                {
+                    this.runScripts(element);
+                }
+            }
+            element.style.top = this.offsets[visible_i] + 'px';
+            element.classList.toggle('operation-log-viewer-match', row_i == this.matchRowIndex);
+            this.updateToggle(element, row_i);
+            renderedRows.set(row_i, element);
+        }
+        this.renderedRows.forEach(function(element) {
+            element.remove();
+        });
+        this.renderedRows = renderedRows;
+    }
+
+    createRowElement(row_i)
+    {
+        var row = this.rows[row_i];
+        var element = document.createElement('div');
+
+        element.className = 'operation-log-viewer-row';
+        element.style.paddingLeft = (row[1] + 1) * this.indentWidth + 'px';
+        element.style.height = this.heights[row_i] + 'px';
+        switch (row[0])
+        {
+            case MESSAGE_ROW:
+                element.classList.add('operation-log-message');
+                element.textContent = row[2];
+                break;
+            case HTML_ROW:
+                element.classList.add('operation-log-viewer-html-row', 'operation-log-html-message');
+                element.innerHTML = row[2];
+                break;
+            case VAR_ROW:
+                element.classList.add('operation-log-var');
+                element.appendChild(this.createSpan('operation-log-var-name', row[2]));
+                element.appendChild(document.createTextNode(' = '));
+                element.appendChild(this.createSpan('operation-log-var-value', null, row[3]));
+                break;
+            case FUNCTION_ROW:
+                this.fillFunctionRow(element, row, row_i);
+                break;
+        }
+
+        return element;
+    }
+
+    fillFunctionRow(element, row, row_i)
+    {
+        var self = this;
+        var toggle = this.createSpan('operation-log-viewer-toggle', '');
+        var args = row[4] || [];
+
+        element.classList.add('operation-log-function');
+        element.style.paddingLeft = row[1] * this.indentWidth + 'px';
+        toggle.addEventListener('click', function() {
+            self.setCollapsed(row_i, !self.isCollapsed[row_i]);
+        });
+        element.appendChild(toggle);
+        element.appendChild(this.createSpan('operation-log-function-return-type', row[2]));
+        element.appendChild(document.createTextNode(' '));
+        element.appendChild(this.createSpan('operation-log-function-name', row[3]));
+        element.appendChild(document.createTextNode('('));
+        for (var arg_i = 0; arg_i + 2 < args.length; arg_i += 3)
+        {
+            if (arg_i > 0)
+            {
+                element.appendChild(document.createTextNode(', '));
+            }
+            element.appendChild(this.createSpan('operation-log-function-arg-type', args[arg_i]));
+            element.appendChild(document.createTextNode(' '));
+            element.appendChild(this.createSpan('operation-log-function-arg-name', args[arg_i + 1]));
+            element.appendChild(document.createTextNode(' = '));
+            element.appendChild(this.createSpan('operation-log-function-arg-value', null, args[arg_i + 2]));
+        }
+        element.appendChild(document.createTextNode(')'));
+        if (row.length > 5)
+        {
+            element.appendChild(document.createTextNode(' '));
+            element.appendChild(this.createSpan('operation-log-function-extra-info', row[5]));
+        }
+    }
+
+    createSpan(className, text, html)
+    {
+        var span = document.createElement('span');
+
+        span.className = className;
+        if (html === undefined)
+        {
+            span.textContent = text;
+        }
+        else
+        {
+            span.innerHTML = html;
+        }
+
+        return span;
+    }
+
+    updateToggle(element, row_i)
+    {
+        if (this.rows[row_i][0] != FUNCTION_ROW)
+        {
+            return;
+        }
+
+        var toggle = element.firstChild;
+
+        toggle.textContent = this.subtreeEnds[row_i] == row_i + 1 ? '' :
+            this.isCollapsed[row_i] ? '▸' : '▾';
+    }
+
+    // Scripts inserted through `innerHTML` don't run, so they're replaced
+    // with new script elements.
+    runScripts(element)
+    {
+        var scripts = element.querySelectorAll('script');
+
+        for (var script_i = 0; script_i < scripts.length; ++script_i)
+        {
+            var script = scripts[script_i];
+            var newScript = document.createElement('script');
+
+            for (var attribute_i = 0; attribute_i < script.attributes.length; ++attribute_i)
+            {
+                newScript.setAttribute(
+                    script.attributes[attribute_i].name, script.attributes[attribute_i].value);
+            }
+            newScript.textContent = script.textContent;
+            script.parentNode.replaceChild(newScript, script);
+        }
+    }
+
+    setCollapsed(row_i, isCollapsed)
+    {
+        this.isCollapsed[row_i] = isCollapsed ? 1 : 0;
+        this.updateVisibleRows();
+        this.render();
+    }
+
+    setAllCollapsed(isCollapsed)
+    {
+        for (var row_i = 0; row_i < this.rows.length; ++row_i)
+        {
+            this.isCollapsed[row_i] = isCollapsed && this.subtreeEnds[row_i] > row_i + 1 ? 1 : 0;
+        }
+        this.updateVisibleRows();
+        this.scrollElement.scrollTop = 0;
+        this.render();
+    }
+
+    // Returns the text of a row's strings, for searching.
+    getRowText(row_i)
+    {
+        var row = this.rows[row_i];
+
+        if (row[0] != FUNCTION_ROW)
+        {
+            return row.slice(2).join(' = ');
+        }
+
+        return row[2] + ' ' + row[3] + '(' + (row[4] || []).join(' ') + ')' +
+            (row.length > 5 ? ' ' + row[5] : '');
+    }
+
+    // Finds the next (or previous, for `direction < 0`) row with the text,
+    // expands the functions it's in, and scrolls to it.
+    search(text, direction)
+    {
+        var rowC = this.rows.length;
+        var query = text.toLowerCase();
+
+        if (query != this.searchText)
+        {
+            this.searchText = query;
+            this.matchRowIndex = direction > 0 ? -1 : rowC;
+            this.matchC = 0;
+            for (var row_i = 0; query && row_i < rowC; ++row_i)
+            {
+                this.matchC += this.getRowText(row_i).toLowerCase().indexOf(query) >= 0;
+            }
+        }
+        if (!query || this.matchC == 0)
+        {
+            this.searchStatus.textContent = query ? 'No matches' : '';
+            this.matchRowIndex = -1;
+            this.render();
+            return;
+        }
+
+        var row_i = this.matchRowIndex;
+
+        for (var step_c = 0; step_c < rowC; ++step_c)
+        {
+            row_i = (row_i + direction + rowC) % rowC;
+            if (this.getRowText(row_i).toLowerCase().indexOf(query) >= 0)
+            {
+                break;
+            }
+        }
+        this.matchRowIndex = row_i;
+        this.searchStatus.textContent = this.matchC + ' matches';
+        for (var parent_i = this.parents[row_i]; parent_i >= 0; parent_i = this.parents[parent_i])
+        {
+            this.isCollapsed[parent_i] = 0;
+        }
+        this.updateVisibleRows();
+
+        // The visible rows are in log order:
+        var begin = 0;
+        var end = this.visibleC;
+
+        while (begin < end)
+        {
+            var middle = (begin + end) >> 1;
+
+            if (this.visibleRows[middle] < row_i)
+            {
+                begin = middle + 1;
+            }
+            else
+            {
+                end = middle;
+            }
+        }
+        this.scrollElement.scrollTop = Math.max(
+            0, this.offsets[begin] - this.scrollElement.clientHeight / 3);
+        this.render();
+    }
+}
+
+document.addEventListener('DOMContentLoaded', function() {
+    var rootElement = document.querySelector('.operation-log-viewer');
+
+    if (rootElement)
+    {
+        operation_log_viewer.viewer = new LogViewer(rootElement);
+        operation_log_viewer.viewer.load();
+    }
+});
+
+return {
+    LogViewer: LogViewer,
+    viewer: null
+};
+
+})();
+
+</script>
+
+)code"
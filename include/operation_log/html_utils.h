@@ -2,9 +2,11 @@
 #define _OPERATION_LOG_HTML_UTILS_H
 
 #include <ostream>
-#include <sstream>
+#include <streambuf>
 #include <string>
 
+#include "char_search.h"
+
 
 namespace operation_log
 {
@@ -13,29 +15,106 @@ class HtmlUtils
 {
     public:
 
-    static void write_escaped(std::ostream &out, std::string value)
+    // A stream buffer that escapes everything written to it, and writes it
+    // to another stream.
+    //
+    // It lets values be formatted straight into an HTML log, without a
+    // temporary string, e.g.:
+    //
+    //     HtmlUtils::EscapingStreamBuffer buffer(out);
+    //     std::ostream escaped(&buffer);
+    //
+    //     escaped << value;
+    class EscapingStreamBuffer : public std::streambuf
+    {
+        public:
+
+        EscapingStreamBuffer(std::ostream &out)
+        : out(out)
+        {}
+
+        protected:
+
+        int_type overflow(int_type ch) override
+        {
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                char value = traits_type::to_char_type(ch);
+
+                write_escaped(out, &value, 1);
+            }
+
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize count) override
+        {
+            write_escaped(out, s, count);
+
+            return count;
+        }
+
+        private:
+
+        std::ostream &out;
+    };
+
+    // Writes the escaped value to an `std::ostream`, or appends it to an
+    // `std::string`.
+    //
+    // The characters which don't need escaping are found in bulk (see
+    // `CharSearch`), and copied with one write per run.
+    template <typename OutT>
+    static void write_escaped(OutT &out, const char *value, std::size_t len)
     {
-        for (char ch : value)
+        const char *end = value + len;
+        // The beginning of the characters that don't need escaping:
+        const char *run_begin = value;
+
+        for (;;)
         {
-            switch (ch)
+            const char *p =
+                CharSearch::find_first_of<'&', '"', '\'', '<', '>'>(run_begin, end);
+
+            helpers::append(out, run_begin, p - run_begin);
+            if (p == end)
             {
-                case '&':  out << "&amp;";       break;
-                case '\"': out << "&quot;";      break;
-                case '\'': out << "&apos;";      break;
-                case '<':  out << "&lt;";        break;
-                case '>':  out << "&gt;";        break;
-                default:   out << ch;            break;
+                break;
             }
+            write_entity(out, *p);
+            run_begin = p + 1;
         }
     }
 
-    static std::string escape(std::string value)
+    template <typename OutT>
+    static void write_escaped(OutT &out, const std::string &value)
+    {
+        write_escaped(out, value.data(), value.length());
+    }
+
+    static std::string escape(const std::string &value)
     {
-        std::stringstream res;
+        std::string res;
 
+        res.reserve(value.length());
         write_escaped(res, value);
 
-        return res.str();
+        return res;
+    }
+
+    // Writes the entity of one of the characters that need escaping.
+    template <typename OutT>
+    static void write_entity(OutT &out, char ch)
+    {
+        switch (ch)
+        {
+            case '&':  helpers::append(out, "&amp;", 5);  break;
+            case '\"': helpers::append(out, "&quot;", 6); break;
+            case '\'': helpers::append(out, "&apos;", 6); break;
+            case '<':  helpers::append(out, "&lt;", 4);   break;
+            case '>':  helpers::append(out, "&gt;", 4);   break;
+            default:   helpers::append(out, &ch, 1);
+        }
     }
 };
 
@@ -0,0 +1,316 @@
+#ifndef _OPERATION_LOG_HTML_VIEWER_FORMATTER_H
+#define _OPERATION_LOG_HTML_VIEWER_FORMATTER_H
+
+#include <ostream>
+#include <string>
+
+#include "blob.h"
+#include "formatter_base.h"
+#include "function_info.h"
+#include "html_utils.h"
+#include "json_utils.h"
+#include "number_formatter.h"
+#include "string_ref.h"
+#include "value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// A class which formats operation log messages as an HTML page with the
+// events embedded as data, and a viewer script, which only builds the rows
+// scrolled into view.
+//
+// Unlike the nested `<div>`s `HtmlFormatter` writes, such a page opens
+// quickly with millions of events.  The viewer collapses, and expands
+// function frames, and searches the events without building their elements.
+//
+// The events are written as JSON arrays in `<script>` elements of
+// `rows_per_chunk` rows each, so a log which was cut short (e.g., by a crash)
+// still opens.  Each row starts with its type, and function nesting depth:
+//
+//     [0, depth, "message"]
+//     [1, depth, "HTML code"]
+//     [2, depth, "variable name", "value HTML"]
+//     [3, depth, "return type", "function name",
+//         ["argument type", "argument name", "value HTML", ...],
+//         "extra information"]
+//
+// HTML messages are rendered in rows of a fixed height (see `set_style_code()`),
+// and their scripts run each time they're scrolled into view.
+class HtmlViewerFormatter : public FormatterBase
+{
+public:
+    inline HtmlViewerFormatter(
+        std::ostream &output_stream, std::string log_name="", int rows_per_chunk=4096)
+    : FormatterBase(output_stream),
+    log_name(log_name),
+    rows_per_chunk(rows_per_chunk)
+    {}
+
+    inline ~HtmlViewerFormatter()
+    {
+        write_footer();
+    }
+
+    // Blobs are written between the `<script>` elements with the rows, so
+    // HTML rows can load them, whichever rows were built.
+    void write_blob(const Blob &blob) override
+    {
+        write_message_prefix();
+        end_chunk();
+        blob_writer.write(output.get(), blob);
+    }
+
+    void write_value(std::ostream &out, ValueFormatterI &value_formatter) const override
+    {
+        value_formatter.write_html(out);
+    }
+
+    std::string get_style_code()
+    {
+        return style_code;
+    }
+
+    void set_style_code(std::string html_code)
+    {
+        style_code = html_code;
+    }
+
+public:
+    // E.g., `HtmlFormatter::three_js_header_code`:
+    std::string extra_header_code = "";
+
+    // The viewer's JavaScript code.  (It's a function-local static, so the
+    // header can be included from several translation units.)
+    static const std::string& get_viewer_code()
+    {
+        static const std::string viewer_code =
+#include "html_formatter/viewer.h"
+        ;
+
+        return viewer_code;
+    }
+
+private:
+    enum RowType
+    {
+        message_row = 0,
+        html_row = 1,
+        var_row = 2,
+        function_row = 3
+    };
+
+    bool was_header_written = false;
+    std::string log_name;
+    int rows_per_chunk;
+    // The rows written to the current `<script>` element:
+    int chunk_row_c = 0;
+    HtmlBlobWriter blob_writer;
+    std::string style_code = R"code(
+  <style>
+    .operation-log {
+        color: #dcdcaa;
+        background-color: #1e1e1e;
+    }
+
+    .operation-log-viewer-row {
+        font: 13px/18px monospace;
+    }
+
+    .operation-log-viewer-html-row {
+        height: 520px;
+    }
+
+    .operation-log-function-return-type, .operation-log-function-arg-type {
+        color: #388cd6;
+    }
+
+    .operation-log-function-name, .operation-log-var-name {
+        color: #dcb856;
+    }
+  </style>
+)code";
+
+    void write_json_string(StringRef value)
+    {
+        JsonUtils::write_string(output.get(), value.data(), value.size());
+    }
+
+    void write_json_value(ValueFormatterI &value_formatter)
+    {
+        JsonUtils::EscapingStreamBuffer escaping_buffer(output.get());
+        std::ostream escaped_out(&escaping_buffer);
+
+        NumberFormat::set(escaped_out, get_number_format());
+        output.get() << '"';
+        write_value(escaped_out, value_formatter);
+        output.get() << '"';
+    }
+
+    void begin_row(RowType type)
+    {
+        std::ostream &out = output.get();
+
+        if (chunk_row_c == 0)
+        {
+            out << "<script type=\"application/x-operation-log-rows\">[\n";
+        }
+        else
+        {
+            out << ",\n";
+        }
+        out << '[' << static_cast<int>(type) << ',';
+        NumberFormatter::write(out, filtered_stack_depth);
+    }
+
+    void end_row()
+    {
+        output.get() << ']';
+        if (++chunk_row_c >= rows_per_chunk)
+        {
+            end_chunk();
+        }
+    }
+
+    void end_chunk()
+    {
+        if (chunk_row_c > 0)
+        {
+            output.get() << "\n]</script>\n";
+            chunk_row_c = 0;
+        }
+    }
+
+    void write_header()
+    {
+        output.get() << R"code(<!DOCTYPE html>
+<html>
+<head>
+  <meta charset="utf-8">
+  <title>Operation Log)code";
+        if (!log_name.empty())
+        {
+            output.get() << " ";
+            HtmlUtils::write_escaped(output.get(), log_name);
+        }
+        output.get() << "</title>" << std::endl <<
+            style_code <<
+            get_viewer_code() <<
+            extra_header_code <<
+            R"code(
+</head>
+
+<body>
+
+<div class="operation-log operation-log-viewer"></div>
+
+)code";
+
+        was_header_written = true;
+    }
+
+    void write_footer()
+    {
+        if (!was_header_written)
+        {
+            return;
+        }
+        end_chunk();
+        output.get() << R"code(
+</body>
+
+</html>
+)code";
+    }
+
+    void write_message_prefix() override
+    {
+        if (!was_header_written)
+        {
+            write_header();
+        }
+    }
+
+    void write_message_value(StringRef message) override
+    {
+        begin_row(message_row);
+        output.get() << ',';
+        write_json_string(message);
+        end_row();
+    }
+
+    void write_html_value(StringRef code) override
+    {
+        begin_row(html_row);
+        output.get() << ',';
+        write_json_string(code);
+        end_row();
+    }
+
+    void write_dump_var(
+        const std::string &name, ValueFormatterI &value_formatter) override
+    {
+        begin_row(var_row);
+        output.get() << ',';
+        write_json_string(name);
+        output.get() << ',';
+        write_json_value(value_formatter);
+        end_row();
+    }
+
+    void write_function_prefix() override
+    {
+        begin_row(function_row);
+    }
+
+    void write_function_suffix() override
+    {
+        end_row();
+    }
+
+    void write_function_return_type_and_name(
+        const std::string &return_type, const std::string &name) override
+    {
+        output.get() << ',';
+        write_json_string(return_type);
+        output.get() << ',';
+        write_json_string(name);
+    }
+
+    void write_function_args_prefix() override
+    {
+        output.get() << ",[";
+    }
+
+    void write_function_args_suffix() override
+    {
+        output.get() << ']';
+    }
+
+    void write_function_args_separator() override
+    {
+        output.get() << ',';
+    }
+
+    void write_function_arg(
+        const std::string &type_name, const std::string &parameter_name,
+        ValueFormatterI &value_formatter) override
+    {
+        write_json_string(type_name);
+        output.get() << ',';
+        write_json_string(parameter_name);
+        output.get() << ',';
+        write_json_value(value_formatter);
+    }
+
+    void write_function_extra_info(const std::string &info) override
+    {
+        output.get() << ',';
+        write_json_string(info);
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_HTML_VIEWER_FORMATTER_H
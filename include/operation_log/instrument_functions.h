@@ -0,0 +1,365 @@
+#ifndef _OPERATION_LOG_INSTRUMENT_FUNCTIONS_H
+#define _OPERATION_LOG_INSTRUMENT_FUNCTIONS_H
+
+// Logs the entry into, and exit from every function of code compiled with
+// `-finstrument-functions` (see the `operationlog_instrument_functions` CMake
+// target), without any operation log macros.
+//
+// This header defines the `__cyg_profile_func_enter()`, and
+// `__cyg_profile_func_exit()` hooks the compiler calls, so it must be
+// included in exactly one translation unit of a program.
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "call_site.h"
+#include "levels.h"
+#include "operation_log_instance.h"
+#include "sampling_profiler.h"
+
+
+// The maximum number of distinct instrumented functions which are logged:
+#ifndef OPERATION_LOG_INSTRUMENTED_FUNCTION_CAPACITY
+#    define OPERATION_LOG_INSTRUMENTED_FUNCTION_CAPACITY (1 << 16)
+#endif // OPERATION_LOG_INSTRUMENTED_FUNCTION_CAPACITY
+
+// The level of the call sites of instrumented functions:
+#ifndef OPERATION_LOG_INSTRUMENTED_FUNCTION_LEVEL
+#    define OPERATION_LOG_INSTRUMENTED_FUNCTION_LEVEL OPERATION_LOG_LEVEL_TRACE
+#endif // OPERATION_LOG_INSTRUMENTED_FUNCTION_LEVEL
+
+
+namespace operation_log
+{
+
+// A table of the instrumented functions which have been called, each with a
+// `CallSite`, so they're switched on, and off like the call sites of the
+// macros (by function name filters, switching rules, and levels).
+//
+// The first call to a function looks up its symbol with `dladdr()` (which
+// needs the program to be linked with `-rdynamic`), and demangles it.
+// Functions without a symbol are named by their module, and offset (e.g.,
+// `libfoo.so+0x1a2b`).  After that, the function's call site is found in a
+// lock-free open addressing table, so calling a disabled function costs a
+// hash, a few atomic loads, and the call site check.
+class InstrumentedFunctions
+{
+public:
+    static const int capacity = OPERATION_LOG_INSTRUMENTED_FUNCTION_CAPACITY;
+
+    static_assert(
+        (capacity & (capacity - 1)) == 0,
+        "The instrumented function capacity must be a power of 2.");
+
+    __attribute__((no_instrument_function))
+    static InstrumentedFunctions& get()
+    {
+        static InstrumentedFunctions instance;
+
+        return instance;
+    }
+
+    __attribute__((no_instrument_function))
+    InstrumentedFunctions()
+    {
+        // (Instrumented static initializers can be called before the
+        // standard streams are initialized, and so, `ios_init` initializes
+        // them.)
+        // Create the log first, so it outlives the table:
+        OperationLogInstance::get();
+    }
+
+    __attribute__((no_instrument_function))
+    ~InstrumentedFunctions()
+    {
+        is_destroyed() = true;
+    }
+
+    // Whether the table has been destroyed at exit.  (The log is destroyed
+    // after it, so code run after that isn't logged.)
+    __attribute__((no_instrument_function))
+    static bool& is_destroyed()
+    {
+        static bool value = false;
+
+        return value;
+    }
+
+    // Returns the call site of the function at the given address, or
+    // `nullptr`, if the table is full.
+    __attribute__((no_instrument_function))
+    CallSite* find_site(void *function)
+    {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(function);
+
+        for (std::size_t slot_i = hash(address), probe_c = 0;
+            probe_c < capacity; slot_i = (slot_i + 1) & (capacity - 1), ++probe_c)
+        {
+            std::uintptr_t slot_address = slots[slot_i].address.load(std::memory_order_acquire);
+
+            if (slot_address == address)
+            {
+                return slots[slot_i].site.load(std::memory_order_relaxed);
+            }
+            if (slot_address == 0)
+            {
+                return add_site(address);
+            }
+        }
+
+        return nullptr;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<std::uintptr_t> address;
+        std::atomic<CallSite*> site;
+    };
+
+    // The call site of an instrumented function, with the strings it points
+    // to.
+    struct Symbol
+    {
+        std::string file;
+        std::string name;
+        CallSite site;
+
+        __attribute__((no_instrument_function))
+        Symbol(const std::string &file, const std::string &name)
+        : file(file),
+        name(name),
+        site(this->file.c_str(), 0, this->name.c_str(),
+            OPERATION_LOG_INSTRUMENTED_FUNCTION_LEVEL)
+        {}
+    };
+
+    std::ios_base::Init ios_init;
+    Slot slots[capacity] = {};
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Symbol>> symbols;
+    bool is_full = false;
+
+    __attribute__((no_instrument_function))
+    static std::size_t hash(std::uintptr_t address)
+    {
+        return static_cast<std::size_t>(
+            (static_cast<std::uint64_t>(address) * 0x9e3779b97f4a7c15ull) >> 32) &
+            (capacity - 1);
+    }
+
+    __attribute__((no_instrument_function))
+    CallSite* add_site(std::uintptr_t address)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::size_t slot_i = hash(address);
+
+        for (std::size_t probe_c = 0; probe_c < capacity;
+            slot_i = (slot_i + 1) & (capacity - 1), ++probe_c)
+        {
+            std::uintptr_t slot_address = slots[slot_i].address.load(std::memory_order_relaxed);
+
+            if (slot_address == address)
+            {
+                // Another thread added the function first.
+                return slots[slot_i].site.load(std::memory_order_relaxed);
+            }
+            if (slot_address == 0)
+            {
+                break;
+            }
+        }
+        if (symbols.size() == static_cast<std::size_t>(capacity) - 1)
+        {
+            // Keep one slot empty, so lookups end.
+            if (!is_full)
+            {
+                std::fprintf(
+                    stderr,
+                    "operation_log: More than %d instrumented functions were "
+                    "called.  Increase OPERATION_LOG_INSTRUMENTED_FUNCTION_CAPACITY "
+                    "to log the rest.\n", capacity - 1);
+                is_full = true;
+            }
+
+            return nullptr;
+        }
+
+        std::unique_ptr<Symbol> symbol(symbolize(address));
+
+        symbols.push_back(std::move(symbol));
+
+        CallSite *site = &symbols.back()->site;
+
+        slots[slot_i].site.store(site, std::memory_order_relaxed);
+        slots[slot_i].address.store(address, std::memory_order_release);
+
+        return site;
+    }
+
+    __attribute__((no_instrument_function))
+    static Symbol* symbolize(std::uintptr_t address)
+    {
+        Dl_info info;
+
+        if (!dladdr(reinterpret_cast<void*>(address), &info))
+        {
+            return new Symbol("", format_offset("", address));
+        }
+
+        std::string file = info.dli_fname ? info.dli_fname : "";
+
+        if (!info.dli_sname ||
+            reinterpret_cast<std::uintptr_t>(info.dli_saddr) != address)
+        {
+            std::size_t name_begin = file.rfind('/');
+
+            return new Symbol(
+                file,
+                format_offset(
+                    name_begin == std::string::npos ? file : file.substr(name_begin + 1),
+                    address - reinterpret_cast<std::uintptr_t>(info.dli_fbase)));
+        }
+
+        int status = 0;
+        char *demangled_name = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+
+        if (status != 0 || !demangled_name)
+        {
+            // (A C function.)
+            return new Symbol(file, info.dli_sname);
+        }
+
+        Symbol *res = new Symbol(file, demangled_name);
+
+        std::free(demangled_name);
+
+        return res;
+    }
+
+    __attribute__((no_instrument_function))
+    static std::string format_offset(const std::string &module, std::uintptr_t offset)
+    {
+        char buffer[2 + 2 * sizeof(std::uintptr_t) + 1];
+
+        std::snprintf(
+            buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(offset));
+
+        return module + "+" + buffer;
+    }
+};
+
+// The instrumented functions entered by a thread, which haven't exited yet.
+//
+// It's trivially constructible, so it's accessed without a thread-local
+// initialization guard.
+struct InstrumentedCallStack
+{
+    static const int max_depth = 512;
+
+    // Whether the thread is in a hook (so the functions the hook calls aren't
+    // logged):
+    bool is_in_hook;
+    int depth;
+    // The call sites of the logged functions, or `nullptr`, for each depth:
+    CallSite *sites[max_depth];
+    // Whether the function at each depth was pushed onto the
+    // `SamplingProfiler`'s stack:
+    bool is_sampled[max_depth];
+
+    __attribute__((no_instrument_function))
+    static InstrumentedCallStack& get()
+    {
+        static thread_local InstrumentedCallStack instance;
+
+        return instance;
+    }
+};
+
+}
+
+extern "C"
+{
+
+__attribute__((no_instrument_function))
+void __cyg_profile_func_enter(void *function, void *call_site)
+{
+    using namespace operation_log;
+
+    InstrumentedCallStack &call_stack = InstrumentedCallStack::get();
+
+    if (call_stack.is_in_hook || InstrumentedFunctions::is_destroyed())
+    {
+        return;
+    }
+    call_stack.is_in_hook = true;
+
+    int depth = call_stack.depth++;
+
+    if (depth < InstrumentedCallStack::max_depth)
+    {
+        CallSite *site = InstrumentedFunctions::get().find_site(function);
+
+        call_stack.is_sampled[depth] = site && SamplingProfiler::is_active();
+        if (call_stack.is_sampled[depth])
+        {
+            SamplingProfiler::push(*site);
+        }
+        if (site && site->is_enabled())
+        {
+            call_stack.sites[depth] = site;
+            OperationLogInstance::get().log_function_entry(site->get_function_info());
+        }
+        else
+        {
+            call_stack.sites[depth] = nullptr;
+        }
+    }
+    call_stack.is_in_hook = false;
+}
+
+__attribute__((no_instrument_function))
+void __cyg_profile_func_exit(void *function, void *call_site)
+{
+    using namespace operation_log;
+
+    InstrumentedCallStack &call_stack = InstrumentedCallStack::get();
+
+    if (call_stack.is_in_hook || call_stack.depth == 0 ||
+        InstrumentedFunctions::is_destroyed())
+    {
+        return;
+    }
+    call_stack.is_in_hook = true;
+
+    int depth = --call_stack.depth;
+
+    if (depth < InstrumentedCallStack::max_depth)
+    {
+        if (call_stack.sites[depth])
+        {
+            OperationLogInstance::get().log_function_exit(
+                call_stack.sites[depth]->get_function_info());
+        }
+        if (call_stack.is_sampled[depth])
+        {
+            SamplingProfiler::pop();
+        }
+    }
+    call_stack.is_in_hook = false;
+}
+
+}
+
+#endif // _OPERATION_LOG_INSTRUMENT_FUNCTIONS_H
@@ -0,0 +1,340 @@
+#ifndef _OPERATION_LOG_INSTRUMENTED_MUTEX_H
+#define _OPERATION_LOG_INSTRUMENTED_MUTEX_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#if __cplusplus >= 201402L
+#    include <shared_mutex>
+#endif // __cplusplus >= 201402L
+
+#include "function_entry.h"
+#include "function_info.h"
+#include "heap_accounting.h"
+#include "lock_contention.h"
+
+
+namespace operation_log
+{
+
+namespace helpers
+{
+
+inline long long read_lock_clock_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Adds a wait, or a hold to the totals of the lock in the innermost logged
+// function, and queues it for the log, if it took at least the threshold.
+// (It runs on any thread, so it doesn't touch the log itself.)
+inline void record_lock_event(
+    const char *lock_name, LockContentionEvent::Kind kind, long long duration_ns)
+{
+    HeapAccounting::Pause heap_accounting_pause;
+    LockContentionEvent event = { lock_name, kind, duration_ns };
+    const FunctionInfo *function_info = FunctionEntry::get_innermost_function_info();
+
+    LockContention::add_to_report(
+        event, function_info ? function_info->get_full_name() : std::string());
+    if (duration_ns >= LockContention::get_threshold_ns())
+    {
+        LockContention::add_pending_event(event);
+    }
+}
+
+// The exclusive locking of `Mutex`, and `SharedMutex`.
+template <typename NativeMutexT>
+class InstrumentedMutexBase
+{
+public:
+    // The name must have static storage (e.g., a string literal).
+    explicit InstrumentedMutexBase(const char *name)
+    : name(name)
+    {}
+
+    InstrumentedMutexBase(const InstrumentedMutexBase &) = delete;
+    InstrumentedMutexBase& operator=(const InstrumentedMutexBase &) = delete;
+
+    const char* get_name() const
+    {
+        return name;
+    }
+
+    void lock()
+    {
+        if (mutex.try_lock())
+        {
+            begin_uncontended_hold();
+
+            return;
+        }
+        if (!LockContention::is_active())
+        {
+            mutex.lock();
+            hold_start_ns = -1;
+
+            return;
+        }
+
+        long long wait_start_ns = read_lock_clock_ns();
+
+        mutex.lock();
+        record_lock_event(
+            name, LockContentionEvent::lock_wait, read_lock_clock_ns() - wait_start_ns);
+        hold_start_ns = read_lock_clock_ns();
+    }
+
+    bool try_lock()
+    {
+        if (!mutex.try_lock())
+        {
+            return false;
+        }
+        begin_uncontended_hold();
+
+        return true;
+    }
+
+    void unlock()
+    {
+        long long hold_ns = hold_start_ns >= 0 ? read_lock_clock_ns() - hold_start_ns : -1;
+
+        mutex.unlock();
+        if (hold_ns >= 0)
+        {
+            record_lock_event(name, LockContentionEvent::hold, hold_ns);
+        }
+    }
+
+protected:
+    const char *name;
+    NativeMutexT mutex;
+    // When the current exclusive hold began, or -1, if it isn't timed (it's
+    // only accessed by the holding thread):
+    long long hold_start_ns = -1;
+
+    void begin_uncontended_hold()
+    {
+        hold_start_ns = LockContention::are_all_holds_measured() && LockContention::is_active() ?
+            read_lock_clock_ns() : -1;
+    }
+
+    // Records the hold so far (before a condition variable releases the
+    // mutex).
+    void end_hold()
+    {
+        if (hold_start_ns >= 0)
+        {
+            record_lock_event(
+                name, LockContentionEvent::hold, read_lock_clock_ns() - hold_start_ns);
+        }
+    }
+};
+
+}
+
+// A drop-in replacement for `std::mutex`, which records its contention (see
+// `LockContention`) under its name.
+//
+// When `try_lock()` acquires the mutex on the first try, nothing is timed
+// (unless all holds are measured).  Otherwise, the wait, and the hold are
+// timed.  A wait is logged after the mutex is acquired, and a hold, after
+// it's released.
+class Mutex : public helpers::InstrumentedMutexBase<std::mutex>
+{
+public:
+    explicit Mutex(const char *name = "mutex")
+    : InstrumentedMutexBase(name)
+    {}
+
+private:
+    friend class ConditionVariable;
+};
+
+#if __cplusplus >= 201402L
+
+#    if __cplusplus >= 201703L
+typedef std::shared_mutex NativeSharedMutex;
+#    else // __cplusplus >= 201703L
+typedef std::shared_timed_mutex NativeSharedMutex;
+#    endif // __cplusplus >= 201703L
+
+// A drop-in replacement for `std::shared_mutex` (or, before C++17,
+// `std::shared_timed_mutex`), which records its contention like `Mutex`.
+// The waits for shared locks are timed, but not their holds.
+class SharedMutex : public helpers::InstrumentedMutexBase<NativeSharedMutex>
+{
+public:
+    explicit SharedMutex(const char *name = "shared mutex")
+    : InstrumentedMutexBase(name)
+    {}
+
+    void lock_shared()
+    {
+        if (mutex.try_lock_shared())
+        {
+            return;
+        }
+        if (!LockContention::is_active())
+        {
+            mutex.lock_shared();
+
+            return;
+        }
+
+        long long wait_start_ns = helpers::read_lock_clock_ns();
+
+        mutex.lock_shared();
+        helpers::record_lock_event(
+            name, LockContentionEvent::shared_lock_wait,
+            helpers::read_lock_clock_ns() - wait_start_ns);
+    }
+
+    bool try_lock_shared()
+    {
+        return mutex.try_lock_shared();
+    }
+
+    void unlock_shared()
+    {
+        mutex.unlock_shared();
+    }
+};
+
+#endif // __cplusplus >= 201402L
+
+// A drop-in replacement for `std::condition_variable`, which waits with a
+// `std::unique_lock<Mutex>`, and records the time each wait takes (as a
+// `condition wait` of its name).
+//
+// The hold of the mutex before the wait is recorded when the wait begins, and
+// a new hold begins when the wait ends.
+class ConditionVariable
+{
+public:
+    // The name must have static storage (e.g., a string literal).
+    explicit ConditionVariable(const char *name = "condition variable")
+    : name(name)
+    {}
+
+    ConditionVariable(const ConditionVariable &) = delete;
+    ConditionVariable& operator=(const ConditionVariable &) = delete;
+
+    const char* get_name() const
+    {
+        return name;
+    }
+
+    void notify_one() noexcept
+    {
+        condition.notify_one();
+    }
+
+    void notify_all() noexcept
+    {
+        condition.notify_all();
+    }
+
+    void wait(std::unique_lock<Mutex> &lock)
+    {
+        Wait wait(*this, *lock.mutex());
+
+        condition.wait(wait.native_lock);
+    }
+
+    template <typename Predicate>
+    void wait(std::unique_lock<Mutex> &lock, Predicate predicate)
+    {
+        while (!predicate())
+        {
+            wait(lock);
+        }
+    }
+
+    template <typename Clock, typename Duration>
+    std::cv_status wait_until(
+        std::unique_lock<Mutex> &lock,
+        const std::chrono::time_point<Clock, Duration> &timeout_time)
+    {
+        Wait wait(*this, *lock.mutex());
+
+        return condition.wait_until(wait.native_lock, timeout_time);
+    }
+
+    template <typename Clock, typename Duration, typename Predicate>
+    bool wait_until(
+        std::unique_lock<Mutex> &lock,
+        const std::chrono::time_point<Clock, Duration> &timeout_time,
+        Predicate predicate)
+    {
+        while (!predicate())
+        {
+            if (wait_until(lock, timeout_time) == std::cv_status::timeout)
+            {
+                return predicate();
+            }
+        }
+
+        return true;
+    }
+
+    template <typename Rep, typename Period>
+    std::cv_status wait_for(
+        std::unique_lock<Mutex> &lock, const std::chrono::duration<Rep, Period> &timeout)
+    {
+        return wait_until(lock, std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <typename Rep, typename Period, typename Predicate>
+    bool wait_for(
+        std::unique_lock<Mutex> &lock, const std::chrono::duration<Rep, Period> &timeout,
+        Predicate predicate)
+    {
+        return wait_until(lock, std::chrono::steady_clock::now() + timeout, predicate);
+    }
+
+private:
+    // Lends the `Mutex`'s native mutex to a wait, and times the wait.
+    class Wait
+    {
+    public:
+        std::unique_lock<std::mutex> native_lock;
+
+        Wait(ConditionVariable &condition_variable, Mutex &mutex)
+        : native_lock(mutex.mutex, std::adopt_lock),
+        condition_variable(condition_variable),
+        mutex(mutex)
+        {
+            mutex.end_hold();
+            start_ns = LockContention::is_active() ? helpers::read_lock_clock_ns() : -1;
+        }
+
+        ~Wait()
+        {
+            native_lock.release();
+            if (start_ns >= 0)
+            {
+                helpers::record_lock_event(
+                    condition_variable.name, LockContentionEvent::condition_wait,
+                    helpers::read_lock_clock_ns() - start_ns);
+            }
+            mutex.begin_uncontended_hold();
+        }
+
+    private:
+        ConditionVariable &condition_variable;
+        Mutex &mutex;
+        long long start_ns;
+    };
+
+    const char *name;
+    std::condition_variable condition;
+};
+
+}
+
+#endif // _OPERATION_LOG_INSTRUMENTED_MUTEX_H
@@ -0,0 +1,122 @@
+#ifndef _OPERATION_LOG_JSON_UTILS_H
+#define _OPERATION_LOG_JSON_UTILS_H
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "char_search.h"
+
+
+namespace operation_log
+{
+
+class JsonUtils
+{
+    public:
+
+    // A stream buffer that escapes everything written to it for a JSON
+    // string, and writes it to another stream.  (See
+    // `HtmlUtils::EscapingStreamBuffer`.)
+    class EscapingStreamBuffer : public std::streambuf
+    {
+        public:
+
+        EscapingStreamBuffer(std::ostream &out)
+        : out(out)
+        {}
+
+        protected:
+
+        int_type overflow(int_type ch) override
+        {
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                char value = traits_type::to_char_type(ch);
+
+                write_escaped(out, &value, 1);
+            }
+
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize count) override
+        {
+            write_escaped(out, s, count);
+
+            return count;
+        }
+
+        private:
+
+        std::ostream &out;
+    };
+
+    // Writes the contents of a JSON string (without the quotes).
+    //
+    // `<` is escaped too, so the JSON can be embedded in an HTML `<script>`
+    // element.
+    template <typename OutT>
+    static void write_escaped(OutT &out, const char *value, std::size_t len)
+    {
+        const char *end = value + len;
+        const char *run_begin = value;
+
+        for (;;)
+        {
+            const char *p =
+                CharSearch::find_first_control_or_of<'"', '\\', '<'>(run_begin, end);
+
+            helpers::append(out, run_begin, p - run_begin);
+            if (p == end)
+            {
+                break;
+            }
+            write_escape_sequence(out, *p);
+            run_begin = p + 1;
+        }
+    }
+
+    template <typename OutT>
+    static void write_escaped(OutT &out, const std::string &value)
+    {
+        write_escaped(out, value.data(), value.length());
+    }
+
+    // Writes a quoted JSON string.
+    template <typename OutT>
+    static void write_string(OutT &out, const char *value, std::size_t len)
+    {
+        helpers::append(out, "\"", 1);
+        write_escaped(out, value, len);
+        helpers::append(out, "\"", 1);
+    }
+
+    private:
+
+    template <typename OutT>
+    static void write_escape_sequence(OutT &out, char ch)
+    {
+        switch (ch)
+        {
+            case '"':  helpers::append(out, "\\\"", 2); return;
+            case '\\': helpers::append(out, "\\\\", 2); return;
+            case '\n': helpers::append(out, "\\n", 2);  return;
+            case '\r': helpers::append(out, "\\r", 2);  return;
+            case '\t': helpers::append(out, "\\t", 2);  return;
+            default:   break;
+        }
+
+        const char hex_digits[] = "0123456789abcdef";
+        char sequence[] = {
+            '\\', 'u', '0', '0',
+            hex_digits[(static_cast<unsigned char>(ch) >> 4) & 0xF],
+            hex_digits[static_cast<unsigned char>(ch) & 0xF] };
+
+        helpers::append(out, sequence, sizeof(sequence));
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_JSON_UTILS_H
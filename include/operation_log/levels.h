@@ -0,0 +1,22 @@
+#ifndef _OPERATION_LOG_LEVELS_H
+#define _OPERATION_LOG_LEVELS_H
+
+// Verbosity levels of the leveled operation log macros, e.g.
+// `OPERATION_LOG_TRACE_ENTER_FUNCTION()`, or `OPERATION_LOG_DEBUG_DUMP_VARS()`.
+// Macros without a level in their name log at the `OPERATION_LOG_LEVEL_INFO`
+// level.
+#define OPERATION_LOG_LEVEL_TRACE  0
+#define OPERATION_LOG_LEVEL_DEBUG  1
+#define OPERATION_LOG_LEVEL_INFO   2
+
+// The compile-time threshold.  Leveled macros below it expand to nothing.
+//
+// Define it globally (e.g., `-DOPERATION_LOG_MIN_LEVEL=OPERATION_LOG_LEVEL_INFO`),
+// or before the first `<operation_log.h>` include in a translation unit.  To
+// change it for a section of code (e.g., a namespace), redefine it, and
+// include `<operation_log/enable.h>` again.
+#ifndef OPERATION_LOG_MIN_LEVEL
+#    define OPERATION_LOG_MIN_LEVEL OPERATION_LOG_LEVEL_TRACE
+#endif // OPERATION_LOG_MIN_LEVEL
+
+#endif // _OPERATION_LOG_LEVELS_H
@@ -0,0 +1,302 @@
+#ifndef _OPERATION_LOG_LOCK_CONTENTION_H
+#define _OPERATION_LOG_LOCK_CONTENTION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heap_accounting.h"
+#include "type_traits.h"
+
+
+namespace operation_log
+{
+
+// A wait for, or a hold of a lock, which took at least the threshold (see
+// `LockContention::set_threshold_ns()`).
+struct LockContentionEvent
+{
+    enum Kind
+    {
+        lock_wait,
+        shared_lock_wait,
+        hold,
+        condition_wait
+    };
+
+    // The lock's name (which has static storage):
+    const char *lock_name;
+    Kind kind;
+    long long duration_ns;
+};
+
+// The contention of a lock, which has the same name, in a logged function
+// (see `LockContention::list_locks()`).
+struct LockContentionTotals
+{
+    std::string lock_name;
+    // The innermost logged function the lock was used in, or an empty
+    // string, outside of logged functions:
+    std::string function_name;
+    // The acquisitions, which had to wait:
+    long long wait_c;
+    long long wait_ns;
+    long long max_wait_ns;
+    // The measured holds (see `LockContention::set_all_holds_measured()`):
+    long long hold_c;
+    long long hold_ns;
+    long long max_hold_ns;
+    long long condition_wait_c;
+    long long condition_wait_ns;
+};
+
+// Records the contention of the instrumented locks (`Mutex`, `SharedMutex`,
+// and `ConditionVariable` in `instrumented_mutex.h`).
+//
+// A lock, which is acquired with `try_lock()` on the first try isn't timed.
+// Otherwise, the time the thread waits for it, and holds it is measured.  The
+// waits, and holds, which take at least the threshold, are logged (as a
+// `contention` value), and all of them are added up for each lock name, and
+// innermost logged function, for `write_report()`.
+//
+// The log, and its formatters aren't thread-safe, so the thread, which waited
+// for, or held the lock, only adds the event to the report, and queues it for
+// the log.  The thread, which logs, writes the queued events before its next
+// event (see `take_pending_events()`).  Up to `max_pending_event_c` events are
+// queued, the later ones are only added to the report.
+class LockContention
+{
+public:
+    static const std::size_t max_pending_event_c = 1024;
+
+    static bool is_active()
+    {
+        return get_settings().is_active.load(std::memory_order_relaxed);
+    }
+
+    // Switches recording on, or off.  (It's on by default.)
+    static void set_active(bool value)
+    {
+        get_settings().is_active.store(value, std::memory_order_relaxed);
+    }
+
+    static long long get_threshold_ns()
+    {
+        return get_settings().threshold_ns.load(std::memory_order_relaxed);
+    }
+
+    // Sets the shortest wait, or hold, which is logged.  (It's 1 ms by
+    // default.)
+    static void set_threshold_ns(long long value)
+    {
+        get_settings().threshold_ns.store(value, std::memory_order_relaxed);
+    }
+
+    static bool are_all_holds_measured()
+    {
+        return get_settings().are_all_holds_measured.load(std::memory_order_relaxed);
+    }
+
+    // Measures the hold time of uncontended acquisitions too, which costs
+    // reading the clock twice for each of them.  (By default, only the holds
+    // of contended acquisitions are measured.)
+    static void set_all_holds_measured(bool value)
+    {
+        get_settings().are_all_holds_measured.store(value, std::memory_order_relaxed);
+    }
+
+    // Adds a wait, or a hold to the totals of the lock in the function.
+    static void add_to_report(
+        const LockContentionEvent &event, const std::string &function_name)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+        LockContentionTotals &totals =
+            report.locks[std::make_pair(std::string(event.lock_name), function_name)];
+
+        switch (event.kind)
+        {
+        case LockContentionEvent::lock_wait:
+        case LockContentionEvent::shared_lock_wait:
+            ++totals.wait_c;
+            totals.wait_ns += event.duration_ns;
+            totals.max_wait_ns = std::max(totals.max_wait_ns, event.duration_ns);
+            break;
+        case LockContentionEvent::hold:
+            ++totals.hold_c;
+            totals.hold_ns += event.duration_ns;
+            totals.max_hold_ns = std::max(totals.max_hold_ns, event.duration_ns);
+            break;
+        case LockContentionEvent::condition_wait:
+            ++totals.condition_wait_c;
+            totals.condition_wait_ns += event.duration_ns;
+            break;
+        }
+    }
+
+    // Queues an event for the log (see above).
+    static void add_pending_event(const LockContentionEvent &event)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        PendingEvents &pending = get_pending_events();
+        std::lock_guard<std::mutex> lock(pending.mutex);
+
+        if (pending.events.size() < max_pending_event_c)
+        {
+            pending.events.push_back(event);
+            pending.has_events.store(true, std::memory_order_release);
+        }
+    }
+
+    static bool has_pending_events()
+    {
+        return get_pending_events().has_events.load(std::memory_order_acquire);
+    }
+
+    // Moves the queued events to `events` (whose memory is reused).
+    static void take_pending_events(std::vector<LockContentionEvent> &events)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        PendingEvents &pending = get_pending_events();
+        std::lock_guard<std::mutex> lock(pending.mutex);
+
+        events.clear();
+        events.swap(pending.events);
+        pending.has_events.store(false, std::memory_order_relaxed);
+    }
+
+    // Returns the totals of each lock in each function, by wait time, in
+    // descending order.
+    static std::vector<LockContentionTotals> list_locks()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+        std::vector<LockContentionTotals> res;
+
+        res.reserve(report.locks.size());
+        for (const auto &key_and_totals : report.locks)
+        {
+            res.push_back(key_and_totals.second);
+            res.back().lock_name = key_and_totals.first.first;
+            res.back().function_name = key_and_totals.first.second;
+        }
+        std::sort(
+            res.begin(), res.end(),
+            [](const LockContentionTotals &a, const LockContentionTotals &b)
+            {
+                return a.wait_ns > b.wait_ns;
+            });
+
+        return res;
+    }
+
+    // Writes the totals of each lock in each function as a table.
+    static void write_report(std::ostream &out)
+    {
+        std::vector<LockContentionTotals> locks = list_locks();
+        HeapAccounting::Pause heap_accounting_pause;
+
+        out << std::setw(8) << "waits" << std::setw(14) << "wait ns" <<
+            std::setw(14) << "max wait ns" << std::setw(8) << "holds" <<
+            std::setw(14) << "hold ns" << std::setw(14) << "max hold ns" <<
+            std::setw(8) << "cond." << std::setw(14) << "cond. wait ns" <<
+            "  lock (function)" << std::endl;
+        for (const LockContentionTotals &totals : locks)
+        {
+            out << std::setw(8) << totals.wait_c << std::setw(14) << totals.wait_ns <<
+                std::setw(14) << totals.max_wait_ns << std::setw(8) << totals.hold_c <<
+                std::setw(14) << totals.hold_ns << std::setw(14) << totals.max_hold_ns <<
+                std::setw(8) << totals.condition_wait_c <<
+                std::setw(14) << totals.condition_wait_ns <<
+                "  " << totals.lock_name << " (" <<
+                (totals.function_name.empty() ? "-" : totals.function_name) << ")" <<
+                std::endl;
+        }
+    }
+
+    static void reset_report()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+
+        report.locks.clear();
+    }
+
+    // Returns the name of a kind of event (e.g., `lock wait`).
+    static const char* get_kind_name(LockContentionEvent::Kind kind)
+    {
+        static const char *names[] = {
+            "lock wait", "shared lock wait", "hold", "condition wait" };
+
+        return names[kind];
+    }
+
+private:
+    struct Settings
+    {
+        std::atomic<bool> is_active;
+        std::atomic<long long> threshold_ns;
+        std::atomic<bool> are_all_holds_measured;
+
+        Settings()
+        : is_active(true),
+        threshold_ns(1000000),
+        are_all_holds_measured(false)
+        {}
+    };
+
+    struct Report
+    {
+        std::mutex mutex;
+        // By lock name, and function name:
+        std::map<std::pair<std::string, std::string>, LockContentionTotals> locks;
+    };
+
+    struct PendingEvents
+    {
+        std::mutex mutex;
+        std::vector<LockContentionEvent> events;
+        std::atomic<bool> has_events { false };
+    };
+
+    static Settings& get_settings()
+    {
+        static Settings settings;
+
+        return settings;
+    }
+
+    static Report& get_report()
+    {
+        static Report report;
+
+        return report;
+    }
+
+    static PendingEvents& get_pending_events()
+    {
+        static PendingEvents pending;
+
+        return pending;
+    }
+};
+
+// The events are plain values (with a static lock name), so they're
+// formatted on the background thread by `DeferredFormatter`.
+template <>
+struct IsTriviallyCapturable<LockContentionEvent> : public std::true_type {};
+
+}
+
+#endif // _OPERATION_LOG_LOCK_CONTENTION_H
@@ -1,9 +1,16 @@
 #ifndef _OPERATION_LOG_MESSAGE_STREAM_H
 #define _OPERATION_LOG_MESSAGE_STREAM_H
 
-#include <sstream>
+#include <ios>
+#include <ostream>
+#include <string>
 
+#include "call_site.h"
+#include "heap_accounting.h"
+#include "message_stream_pool.h"
 #include "operation_log_instance.h"
+#include "string_ref.h"
+#include "usdt.h"
 
 namespace operation_log
 {
@@ -12,15 +19,60 @@ namespace operation_log
 // message before it's destroyed.
 //
 // You can use this class to format log messages as you would format output
-// to an `std::ostream`.
-class MessageStream : public std::stringstream
+// to an `std::ostream`.  (It converts to `std::ostream&`, when it needs to be
+// passed to a function.)
+//
+// The stream, and its buffer are borrowed from a per-thread
+// `MessageStreamPool`, and the message is passed to the log without copying
+// it.  Each message starts with the default formatting state.
+//
+// A stream created for a disabled `CallSite` doesn't borrow a stream, and
+// doesn't write anything to the log, unless a tracer is attached to the
+// `message` USDT probe (see `usdt.h`).  Then, the message is only passed to
+// the probe.
+//
+// Formatting into the stream is the log's work, so its allocations aren't
+// counted by `HeapAccounting`.
+class MessageStream
 {
     private:
 
+    MessageStreamPool::Slot *slot = nullptr;
+    std::ostream *stream;
+    CallSite *call_site = nullptr;
     bool is_closed = false;
+    bool is_site_enabled = true;
 
     public:
 
+    MessageStream()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        slot = &MessageStreamPool::get().acquire();
+        stream = &slot->stream;
+    }
+
+    MessageStream(CallSite &call_site)
+    : call_site(&call_site),
+    is_site_enabled(call_site.is_enabled())
+    {
+        if (is_site_enabled || OPERATION_LOG_USDT_IS_ATTACHED(message))
+        {
+            HeapAccounting::Pause heap_accounting_pause;
+
+            slot = &MessageStreamPool::get().acquire();
+            stream = &slot->stream;
+        }
+        else
+        {
+            stream = &get_null_stream();
+        }
+    }
+
+    MessageStream(const MessageStream &) = delete;
+    MessageStream& operator=(const MessageStream &) = delete;
+
     ~MessageStream()
     {
         close();
@@ -28,11 +80,98 @@ class MessageStream : public std::stringstream
 
     void close()
     {
-        if (!is_closed)
+        if (!is_closed && slot)
         {
-            OperationLogInstance::get().write_message(str());
-            is_closed = true;
+            HeapAccounting::Pause heap_accounting_pause;
+            StringRef message = slot->buffer.view();
+
+            if (call_site)
+            {
+                Usdt::message(*call_site, message.data(), message.size());
+            }
+            if (is_site_enabled)
+            {
+                OperationLogInstance::get().write_message(message);
+            }
+            MessageStreamPool::get().release(*slot);
         }
+        is_closed = true;
+    }
+
+    // Returns whether the message is logged, or passed to a USDT probe.
+    bool is_enabled() const
+    {
+        return slot != nullptr;
+    }
+
+    // Returns the message text written so far.  The reference is valid until
+    // the stream is written to, or closed.
+    StringRef view() const
+    {
+        return slot && !is_closed ? slot->buffer.view() : StringRef();
+    }
+
+    std::string str() const
+    {
+        return view().str();
+    }
+
+    std::ostream& get_stream()
+    {
+        return *stream;
+    }
+
+    operator std::ostream&()
+    {
+        return *stream;
+    }
+
+    template <typename T>
+    MessageStream& operator<<(const T &value)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        *stream << value;
+
+        return *this;
+    }
+
+    // Manipulators (e.g., `std::endl`, `std::hex`):
+    MessageStream& operator<<(std::ostream& (*manipulator)(std::ostream&))
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        manipulator(*stream);
+
+        return *this;
+    }
+
+    MessageStream& operator<<(std::ios& (*manipulator)(std::ios&))
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        manipulator(*stream);
+
+        return *this;
+    }
+
+    MessageStream& operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        manipulator(*stream);
+
+        return *this;
+    }
+
+    private:
+
+    // A stream without a buffer, which ignores everything written to it:
+    static std::ostream& get_null_stream()
+    {
+        static thread_local std::ostream null_stream(nullptr);
+
+        return null_stream;
     }
 };
 
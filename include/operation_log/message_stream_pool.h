@@ -0,0 +1,165 @@
+#ifndef _OPERATION_LOG_MESSAGE_STREAM_POOL_H
+#define _OPERATION_LOG_MESSAGE_STREAM_POOL_H
+
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include "string_ref.h"
+
+
+namespace operation_log
+{
+
+// A stream buffer that collects the text of a log message in memory.
+//
+// Unlike `std::stringbuf`, its contents can be viewed without copying them,
+// and it keeps its memory when it's reset.
+class MessageStreamBuffer : public std::streambuf
+{
+public:
+    static const std::size_t initial_capacity = 256;
+    // Larger buffers are shrunk when they're reset, so a single long message
+    // doesn't keep its memory for the life of the thread:
+    static const std::size_t max_retained_capacity = 64 * 1024;
+
+    MessageStreamBuffer()
+    : storage(initial_capacity)
+    {
+        setp(storage.data(), storage.data() + storage.size());
+    }
+
+    StringRef view() const
+    {
+        return StringRef(pbase(), pptr() - pbase());
+    }
+
+    void reset()
+    {
+        if (storage.size() > max_retained_capacity)
+        {
+            std::vector<char>(initial_capacity).swap(storage);
+        }
+        setp(storage.data(), storage.data() + storage.size());
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            return traits_type::not_eof(ch);
+        }
+        reserve(1);
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+
+        return ch;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize count) override
+    {
+        reserve(count);
+        std::memcpy(pptr(), s, count);
+        pbump(static_cast<int>(count));
+
+        return count;
+    }
+
+private:
+    std::vector<char> storage;
+
+    // Makes room for `count` more characters.
+    void reserve(std::streamsize count)
+    {
+        std::size_t size = pptr() - pbase();
+
+        if (size + count <= storage.size())
+        {
+            return;
+        }
+
+        std::size_t capacity = storage.size();
+
+        while (capacity < size + count)
+        {
+            capacity *= 2;
+        }
+        storage.resize(capacity);
+        setp(storage.data(), storage.data() + storage.size());
+        pbump(static_cast<int>(size));
+    }
+};
+
+// A per-thread pool of output streams for formatting log messages.
+//
+// Constructing an `std::ostream` sets up its locale, and its buffer, so
+// `MessageStream`s borrow a stream from this pool, instead.  A thread needs
+// as many streams as it has message streams open at the same time (usually,
+// one).
+class MessageStreamPool
+{
+public:
+    struct Slot
+    {
+        MessageStreamBuffer buffer;
+        std::ostream stream;
+        bool is_in_use = false;
+
+        Slot()
+        : stream(&buffer)
+        {}
+    };
+
+    static MessageStreamPool& get()
+    {
+        static thread_local MessageStreamPool instance;
+
+        return instance;
+    }
+
+    // Returns an empty stream with the default formatting state.
+    Slot& acquire()
+    {
+        for (const std::unique_ptr<Slot> &slot : slots)
+        {
+            if (!slot->is_in_use)
+            {
+                return prepare(*slot);
+            }
+        }
+        slots.emplace_back(new Slot());
+
+        return prepare(*slots.back());
+    }
+
+    void release(Slot &slot)
+    {
+        slot.is_in_use = false;
+    }
+
+private:
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    static Slot& prepare(Slot &slot)
+    {
+        std::ostream &stream = slot.stream;
+
+        slot.is_in_use = true;
+        slot.buffer.reset();
+        stream.clear();
+        stream.flags(std::ios_base::skipws | std::ios_base::dec);
+        stream.precision(6);
+        stream.width(0);
+        stream.fill(' ');
+
+        return slot;
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_MESSAGE_STREAM_POOL_H
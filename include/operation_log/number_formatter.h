@@ -0,0 +1,859 @@
+#ifndef _OPERATION_LOG_NUMBER_FORMATTER_H
+#define _OPERATION_LOG_NUMBER_FORMATTER_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ios>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace operation_log
+{
+
+// How `NumberFormatter` writes floating point values:
+//
+// * `shortest`: the fewest significant digits that read back as the same
+//   value, e.g., `0.1`, `2.0`, `-1.5e-07`, `1e+100`.  (The precision is
+//   ignored.)
+// * `general`, `fixed`, `scientific`: like the `%g`, `%f`, and `%e`
+//   `printf()` conversions, with `precision` significant digits, or digits
+//   after the decimal point.
+//
+// Integers are always written in full.  The decimal point is always `.`,
+// whatever the locale.
+//
+// A format is stored in the `iword()` storage of the stream the values are
+// written to, so each log (i.e., each formatter's output stream) can have its
+// own:
+//
+//     NumberFormat::set(log_file, NumberFormat(NumberFormat::fixed, 3));
+class NumberFormat
+{
+public:
+    enum Notation
+    {
+        shortest,
+        general,
+        fixed,
+        scientific
+    };
+
+    enum
+    {
+        max_precision = 100
+    };
+
+    NumberFormat(Notation notation = shortest, int precision = 6)
+    : notation(notation),
+      precision(
+          precision < 0 ? 0 :
+          precision > max_precision ? static_cast<int>(max_precision) :
+          precision)
+    {}
+
+    Notation get_notation() const
+    {
+        return notation;
+    }
+
+    int get_precision() const
+    {
+        return precision;
+    }
+
+    // Returns the format stored in a stream, or the default (`shortest`)
+    // format, if none was stored.
+    static NumberFormat get(std::ios_base &stream)
+    {
+        long value = stream.iword(get_index());
+
+        if (value == 0)
+        {
+            return NumberFormat();
+        }
+        --value;
+
+        return NumberFormat(
+            static_cast<Notation>(value % 4), static_cast<int>(value / 4));
+    }
+
+    static void set(std::ios_base &stream, const NumberFormat &format)
+    {
+        stream.iword(get_index()) = 1 + format.notation + 4L * format.precision;
+    }
+
+private:
+    Notation notation;
+    int precision;
+
+    static int get_index()
+    {
+        static const int index = std::ios_base::xalloc();
+
+        return index;
+    }
+};
+
+
+namespace helpers
+{
+
+// Florian Loitsch's Grisu2 algorithm ("Printing Floating-Point Numbers Quickly
+// and Accurately with Integers", PLDI 2010), as laid out in Milo Yip's, and
+// Niels Lohmann's implementations.
+//
+// It generates the digits of a positive, finite `float`, or `double` using
+// 64 bit integer arithmetic only.  The digits always read back as the same
+// value.  They're the shortest such digits for all but about 0.1% of values,
+// which get one digit more than needed.
+namespace grisu
+{
+
+// A floating point number `f * 2^e`.
+struct DiyFp
+{
+    std::uint64_t f;
+    int e;
+
+    DiyFp(std::uint64_t f, int e)
+    : f(f), e(e)
+    {}
+
+    // Returns `x - y`.  (`x.e` must equal `y.e`, and `x.f >= y.f`.)
+    static DiyFp sub(const DiyFp &x, const DiyFp &y)
+    {
+        return DiyFp(x.f - y.f, x.e);
+    }
+
+    // Returns the upper 64 bits of the product, rounded.
+    static DiyFp mul(const DiyFp &x, const DiyFp &y)
+    {
+        const std::uint64_t mask = 0xFFFFFFFFu;
+        const std::uint64_t x_lo = x.f & mask;
+        const std::uint64_t x_hi = x.f >> 32;
+        const std::uint64_t y_lo = y.f & mask;
+        const std::uint64_t y_hi = y.f >> 32;
+        const std::uint64_t p0 = x_lo * y_lo;
+        const std::uint64_t p1 = x_lo * y_hi;
+        const std::uint64_t p2 = x_hi * y_lo;
+        const std::uint64_t p3 = x_hi * y_hi;
+        const std::uint64_t middle =
+            (p0 >> 32) + (p1 & mask) + (p2 & mask) + (std::uint64_t(1) << 31);
+
+        return DiyFp(p3 + (p1 >> 32) + (p2 >> 32) + (middle >> 32), x.e + y.e + 64);
+    }
+
+    static DiyFp normalize(DiyFp x)
+    {
+        while ((x.f >> 63) == 0)
+        {
+            x.f <<= 1;
+            --x.e;
+        }
+
+        return x;
+    }
+
+    static DiyFp normalize_to(const DiyFp &x, int target_e)
+    {
+        return DiyFp(x.f << (x.e - target_e), target_e);
+    }
+};
+
+// A value, and the boundaries of the interval of numbers which round to it.
+struct Boundaries
+{
+    DiyFp w;
+    DiyFp minus;
+    DiyFp plus;
+};
+
+template <typename FloatT, typename BitsT>
+Boundaries compute_boundaries(FloatT value)
+{
+    // (The digits include the hidden bit.)
+    const int digits = std::numeric_limits<FloatT>::digits;
+    const int bias = std::numeric_limits<FloatT>::max_exponent - 1 + (digits - 1);
+    const std::uint64_t hidden_bit = std::uint64_t(1) << (digits - 1);
+    BitsT bits;
+
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const std::uint64_t biased_e = bits >> (digits - 1);
+    const std::uint64_t f = bits & (hidden_bit - 1);
+    const DiyFp v = biased_e == 0 ?
+        DiyFp(f, 1 - bias) :
+        DiyFp(f + hidden_bit, static_cast<int>(biased_e) - bias);
+    // At powers of 2 the next smaller value is closer than the next larger
+    // one:
+    const bool is_lower_boundary_closer = f == 0 && biased_e > 1;
+    const DiyFp m_plus(2 * v.f + 1, v.e - 1);
+    const DiyFp m_minus = is_lower_boundary_closer ?
+        DiyFp(4 * v.f - 1, v.e - 2) :
+        DiyFp(2 * v.f - 1, v.e - 1);
+    const DiyFp w_plus = DiyFp::normalize(m_plus);
+
+    return Boundaries {
+        DiyFp::normalize(v), DiyFp::normalize_to(m_minus, w_plus.e), w_plus };
+}
+
+inline Boundaries compute_boundaries(float value)
+{
+    return compute_boundaries<float, std::uint32_t>(value);
+}
+
+inline Boundaries compute_boundaries(double value)
+{
+    return compute_boundaries<double, std::uint64_t>(value);
+}
+
+// The range of binary exponents the scaled value is brought into, so its
+// integral part fits in 32 bits:
+const int min_target_exponent = -60;
+const int max_target_exponent = -32;
+
+// A power of ten, `10^k ~= f * 2^e`.
+struct CachedPower
+{
+    std::uint64_t f;
+    int e;
+    int k;
+};
+
+// The powers of ten 10^-300, 10^-292, ..., 10^324, rounded to 64 bit
+// significands.
+//
+// They're computed once, with exact multiple precision arithmetic, rather than
+// listed as constants.
+class CachedPowers
+{
+public:
+    static const int min_k = -300;
+    static const int k_step = 8;
+    static const int count = 79;
+
+    CachedPowers()
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            powers[i] = compute(min_k + i * k_step);
+        }
+    }
+
+    static const CachedPowers& get()
+    {
+        static const CachedPowers instance;
+
+        return instance;
+    }
+
+    // Returns a power of ten `c`, such that the exponent of `c * 2^e` is in
+    // `[min_target_exponent, max_target_exponent]`.
+    const CachedPower& get_for_binary_exponent(int e) const
+    {
+        // ceil((min_target_exponent - e - 1) * log10(2)):
+        const int f = min_target_exponent - e - 1;
+        const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+
+        return powers[(-min_k + k + (k_step - 1)) / k_step];
+    }
+
+private:
+    // Little endian 32 bit words:
+    typedef std::vector<std::uint32_t> BigUnsigned;
+
+    CachedPower powers[count];
+
+    static CachedPower compute(int k)
+    {
+        BigUnsigned power_of_ten(1, 1);
+
+        for (int i = 0; i < (k < 0 ? -k : k); ++i)
+        {
+            multiply(power_of_ten, 10);
+        }
+
+        if (k >= 0)
+        {
+            return round(power_of_ten, 0, k);
+        }
+
+        // 2^n / 10^-k, with 66, or 67 significant bits:
+        const int n = get_bit_length(power_of_ten) + 66;
+        BigUnsigned quotient((n + 32) / 32, 0);
+        BigUnsigned remainder(1, 0);
+
+        for (int bit_i = n; bit_i >= 0; --bit_i)
+        {
+            shift_left(remainder);
+            if (bit_i == n)
+            {
+                remainder[0] |= 1;
+            }
+            if (!is_less(remainder, power_of_ten))
+            {
+                subtract(remainder, power_of_ten);
+                quotient[bit_i / 32] |= std::uint32_t(1) << (bit_i % 32);
+            }
+        }
+
+        return round(quotient, -n, k);
+    }
+
+    // Returns the top 64 bits of `value * 2^e`, rounded to nearest.
+    static CachedPower round(const BigUnsigned &value, int e, int k)
+    {
+        const int bit_length = get_bit_length(value);
+        CachedPower res = { 0, e + bit_length - 64, k };
+
+        for (int bit_i = bit_length - 1; bit_i >= bit_length - 64; --bit_i)
+        {
+            res.f = (res.f << 1) | (bit_i >= 0 ? get_bit(value, bit_i) : 0);
+        }
+        if (bit_length > 64 && get_bit(value, bit_length - 65))
+        {
+            if (++res.f == 0)
+            {
+                res.f = std::uint64_t(1) << 63;
+                ++res.e;
+            }
+        }
+
+        return res;
+    }
+
+    static std::uint64_t get_bit(const BigUnsigned &value, int bit_i)
+    {
+        return (value[bit_i / 32] >> (bit_i % 32)) & 1;
+    }
+
+    static int get_bit_length(const BigUnsigned &value)
+    {
+        for (int word_i = static_cast<int>(value.size()) - 1; word_i >= 0; --word_i)
+        {
+            for (int bit_i = 31; bit_i >= 0; --bit_i)
+            {
+                if ((value[word_i] >> bit_i) & 1)
+                {
+                    return word_i * 32 + bit_i + 1;
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    static void multiply(BigUnsigned &value, std::uint32_t factor)
+    {
+        std::uint64_t carry = 0;
+
+        for (std::uint32_t &word : value)
+        {
+            carry += static_cast<std::uint64_t>(word) * factor;
+            word = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+        if (carry != 0)
+        {
+            value.push_back(static_cast<std::uint32_t>(carry));
+        }
+    }
+
+    static void shift_left(BigUnsigned &value)
+    {
+        std::uint32_t carry = 0;
+
+        for (std::uint32_t &word : value)
+        {
+            std::uint32_t next_carry = word >> 31;
+
+            word = (word << 1) | carry;
+            carry = next_carry;
+        }
+        if (carry != 0)
+        {
+            value.push_back(carry);
+        }
+    }
+
+    static bool is_less(const BigUnsigned &x, const BigUnsigned &y)
+    {
+        std::size_t size = x.size() > y.size() ? x.size() : y.size();
+
+        for (std::size_t word_i = size; word_i-- > 0;)
+        {
+            std::uint32_t x_word = word_i < x.size() ? x[word_i] : 0;
+            std::uint32_t y_word = word_i < y.size() ? y[word_i] : 0;
+
+            if (x_word != y_word)
+            {
+                return x_word < y_word;
+            }
+        }
+
+        return false;
+    }
+
+    // `x -= y`, for `x >= y`.
+    static void subtract(BigUnsigned &x, const BigUnsigned &y)
+    {
+        std::int64_t borrow = 0;
+
+        for (std::size_t word_i = 0; word_i < x.size(); ++word_i)
+        {
+            std::int64_t difference = static_cast<std::int64_t>(x[word_i]) -
+                (word_i < y.size() ? y[word_i] : 0) - borrow;
+
+            borrow = difference < 0;
+            x[word_i] = static_cast<std::uint32_t>(difference + (borrow << 32));
+        }
+    }
+};
+
+// Returns the number of decimal digits of `n`, and sets `power_of_ten` to
+// 10^(digit count - 1).
+inline int find_largest_power_of_ten(std::uint32_t n, std::uint32_t &power_of_ten)
+{
+    std::uint32_t power = 1000000000;
+
+    for (int digit_c = 10; digit_c > 1; --digit_c, power /= 10)
+    {
+        if (n >= power)
+        {
+            power_of_ten = power;
+
+            return digit_c;
+        }
+    }
+    power_of_ten = 1;
+
+    return 1;
+}
+
+// Moves the last digit closer to the value, while it stays in the rounding
+// interval.
+inline void round_weed(
+    char *buffer, int length, std::uint64_t distance, std::uint64_t delta,
+    std::uint64_t rest, std::uint64_t ten_k)
+{
+    while (rest < distance && delta - rest >= ten_k &&
+        (rest + ten_k < distance || distance - rest > rest + ten_k - distance))
+    {
+        --buffer[length - 1];
+        rest += ten_k;
+    }
+}
+
+// Generates the shortest digits of a number in `(m_minus, m_plus)`, close to
+// `w`.
+inline void generate_digits(
+    char *buffer, int &length, int &decimal_exponent,
+    const DiyFp &m_minus, const DiyFp &w, const DiyFp &m_plus)
+{
+    std::uint64_t delta = DiyFp::sub(m_plus, m_minus).f;
+    std::uint64_t distance = DiyFp::sub(m_plus, w).f;
+    // 1 = 2^-e, in the scaled representation:
+    const DiyFp one(std::uint64_t(1) << -m_plus.e, m_plus.e);
+    std::uint32_t integral = static_cast<std::uint32_t>(m_plus.f >> -one.e);
+    std::uint64_t fractional = m_plus.f & (one.f - 1);
+    std::uint32_t power_of_ten;
+    int remaining_c = find_largest_power_of_ten(integral, power_of_ten);
+
+    while (remaining_c > 0)
+    {
+        buffer[length++] = static_cast<char>('0' + integral / power_of_ten);
+        integral %= power_of_ten;
+        --remaining_c;
+
+        const std::uint64_t rest =
+            (static_cast<std::uint64_t>(integral) << -one.e) + fractional;
+
+        if (rest <= delta)
+        {
+            decimal_exponent += remaining_c;
+            round_weed(
+                buffer, length, distance, delta, rest,
+                static_cast<std::uint64_t>(power_of_ten) << -one.e);
+
+            return;
+        }
+        power_of_ten /= 10;
+    }
+
+    int fractional_digit_c = 0;
+
+    for (;;)
+    {
+        fractional *= 10;
+        buffer[length++] = static_cast<char>('0' + (fractional >> -one.e));
+        fractional &= one.f - 1;
+        ++fractional_digit_c;
+        delta *= 10;
+        distance *= 10;
+        if (fractional <= delta)
+        {
+            break;
+        }
+    }
+    decimal_exponent -= fractional_digit_c;
+    round_weed(buffer, length, distance, delta, fractional, one.f);
+}
+
+// Writes the digits of a positive, finite value to `buffer` (without a
+// terminating null), so that `value = digits * 10^decimal_exponent`.
+//
+// The buffer must fit 17 characters.
+template <typename FloatT>
+void grisu2(char *buffer, int &length, int &decimal_exponent, FloatT value)
+{
+    const Boundaries boundaries = compute_boundaries(value);
+    const CachedPower &cached =
+        CachedPowers::get().get_for_binary_exponent(boundaries.plus.e);
+    const DiyFp c_minus_k(cached.f, cached.e);
+    const DiyFp w = DiyFp::mul(boundaries.w, c_minus_k);
+    const DiyFp w_minus = DiyFp::mul(boundaries.minus, c_minus_k);
+    const DiyFp w_plus = DiyFp::mul(boundaries.plus, c_minus_k);
+
+    length = 0;
+    decimal_exponent = -cached.k;
+    // (The products may be off by one ulp, so the interval is narrowed by
+    // one.)
+    generate_digits(
+        buffer, length, decimal_exponent,
+        DiyFp(w_minus.f + 1, w_minus.e), w, DiyFp(w_plus.f - 1, w_plus.e));
+}
+
+}
+}
+
+
+// Formats integers, and floating point numbers to text without allocating
+// memory, or depending on the locale.
+//
+// Floating point values are written in the `NumberFormat` stored in the output
+// stream (or in the given format).  Integers are written in full.
+class NumberFormatter
+{
+public:
+    // Returns the size of a buffer which fits any value of type `T` formatted
+    // by `format()`.
+    template <typename T>
+    static constexpr std::size_t get_buffer_size()
+    {
+        return std::numeric_limits<T>::is_integer ?
+            32 :
+            std::numeric_limits<T>::max_exponent10 + NumberFormat::max_precision + 16;
+    }
+
+    // Writes an arithmetic value.  (Types narrower than `int` are written as
+    // `int`s, like `std::to_string()` does.)
+    template <typename T>
+    static void write(std::ostream &out, T value)
+    {
+        write_promoted(out, +value);
+    }
+
+    template <typename T>
+    static std::string to_string(T value, const NumberFormat &format = NumberFormat())
+    {
+        return to_string_promoted(+value, format);
+    }
+
+    // Formats a value into a buffer of at least `get_buffer_size<T>()` bytes,
+    // and returns the length of the text.  (It isn't null terminated.)
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value, std::size_t>::type
+    format(char *buffer, T value, const NumberFormat & = NumberFormat())
+    {
+        typedef typename std::make_unsigned<T>::type UnsignedT;
+        UnsignedT magnitude = static_cast<UnsignedT>(value);
+        std::size_t sign_length = 0;
+
+        if (value < 0)
+        {
+            buffer[0] = '-';
+            sign_length = 1;
+            magnitude = static_cast<UnsignedT>(0 - magnitude);
+        }
+
+        char digits[32];
+        char *digits_end = digits + sizeof(digits);
+        char *digits_begin = write_digits(digits_end, magnitude);
+        std::size_t digit_c = static_cast<std::size_t>(digits_end - digits_begin);
+
+        std::memcpy(buffer + sign_length, digits_begin, digit_c);
+
+        return sign_length + digit_c;
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, std::size_t>::type
+    format(char *buffer, T value, const NumberFormat &format = NumberFormat())
+    {
+        if (std::isnan(value))
+        {
+            return copy(buffer, std::signbit(value) ? "-nan" : "nan");
+        }
+        if (std::isinf(value))
+        {
+            return copy(buffer, value < 0 ? "-inf" : "inf");
+        }
+
+        switch (format.get_notation())
+        {
+        case NumberFormat::general:
+            return format_printf(
+                buffer, get_buffer_size<T>(), 'g', format.get_precision(), value);
+        case NumberFormat::fixed:
+            return format_printf(
+                buffer, get_buffer_size<T>(), 'f', format.get_precision(), value);
+        case NumberFormat::scientific:
+            return format_printf(
+                buffer, get_buffer_size<T>(), 'e', format.get_precision(), value);
+        default:
+            return format_shortest(buffer, value);
+        }
+    }
+
+private:
+    template <typename T>
+    static void write_promoted(std::ostream &out, T value)
+    {
+        char buffer[get_buffer_size<T>()];
+
+        out.write(
+            buffer,
+            static_cast<std::streamsize>(format(buffer, value, get_format(out, value))));
+    }
+
+    template <typename T>
+    static std::string to_string_promoted(T value, const NumberFormat &number_format)
+    {
+        char buffer[get_buffer_size<T>()];
+
+        return std::string(buffer, format(buffer, value, number_format));
+    }
+
+    // (Integers don't need the stream's format.)
+    template <typename T>
+    static NumberFormat get_format(std::ostream &out, T)
+    {
+        return std::is_integral<T>::value ? NumberFormat() : NumberFormat::get(out);
+    }
+
+    // Writes the digits of `value` backwards, ending at `end`, and returns
+    // their beginning.
+    template <typename UnsignedT>
+    static char* write_digits(char *end, UnsignedT value)
+    {
+        static const char digit_pairs[] =
+            "0001020304050607080910111213141516171819"
+            "2021222324252627282930313233343536373839"
+            "4041424344454647484950515253545556575859"
+            "6061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        while (value >= 100)
+        {
+            unsigned pair_i = static_cast<unsigned>(value % 100) * 2;
+
+            value /= 100;
+            *--end = digit_pairs[pair_i + 1];
+            *--end = digit_pairs[pair_i];
+        }
+        if (value >= 10)
+        {
+            unsigned pair_i = static_cast<unsigned>(value) * 2;
+
+            *--end = digit_pairs[pair_i + 1];
+            *--end = digit_pairs[pair_i];
+        }
+        else
+        {
+            *--end = static_cast<char>('0' + value);
+        }
+
+        return end;
+    }
+
+    static std::size_t copy(char *buffer, const char *text)
+    {
+        std::size_t length = std::strlen(text);
+
+        std::memcpy(buffer, text, length);
+
+        return length;
+    }
+
+    template <typename T>
+    static std::size_t format_shortest(char *buffer, T value)
+    {
+        char *digits = buffer;
+
+        if (std::signbit(value))
+        {
+            *digits++ = '-';
+            value = -value;
+        }
+        if (value == 0)
+        {
+            return static_cast<std::size_t>(digits - buffer) + copy(digits, "0.0");
+        }
+
+        int length;
+        int decimal_exponent;
+
+        helpers::grisu::grisu2(digits, length, decimal_exponent, value);
+
+        return static_cast<std::size_t>(digits - buffer) + format_decimal(
+            digits, length, decimal_exponent, std::numeric_limits<T>::digits10);
+    }
+
+    // Grisu2 needs 128 bit integers for `long double`s, so they're written
+    // with enough digits to read back the same instead.
+    static std::size_t format_shortest(char *buffer, long double value)
+    {
+        std::size_t length = format_printf(
+            buffer, get_buffer_size<long double>(), 'g',
+            std::numeric_limits<long double>::max_digits10, value);
+
+        for (std::size_t char_i = 0; char_i < length; ++char_i)
+        {
+            if (buffer[char_i] == '.' || buffer[char_i] == 'e')
+            {
+                return length;
+            }
+        }
+
+        return length + copy(buffer + length, ".0");
+    }
+
+    // Lays out the digits of `digits * 10^decimal_exponent` in place, in
+    // fixed notation for exponents down to -4, and up to `max_exponent`, and
+    // in scientific notation otherwise.  E.g., `0.001`, `123.45`, `2.0`, and
+    // `1.5e+20`.
+    static std::size_t format_decimal(
+        char *buffer, int length, int decimal_exponent, int max_exponent)
+    {
+        const int min_exponent = -4;
+        // The position of the decimal point, relative to the first digit:
+        const int point_i = length + decimal_exponent;
+
+        if (length <= point_i && point_i <= max_exponent)
+        {
+            // digits[000].0
+            std::memset(buffer + length, '0', point_i - length);
+            buffer[point_i] = '.';
+            buffer[point_i + 1] = '0';
+
+            return point_i + 2;
+        }
+        if (0 < point_i && point_i <= max_exponent)
+        {
+            // dig.its
+            std::memmove(buffer + point_i + 1, buffer + point_i, length - point_i);
+            buffer[point_i] = '.';
+
+            return length + 1;
+        }
+        if (min_exponent < point_i && point_i <= 0)
+        {
+            // 0.[000]digits
+            std::memmove(buffer + 2 - point_i, buffer, length);
+            buffer[0] = '0';
+            buffer[1] = '.';
+            std::memset(buffer + 2, '0', -point_i);
+
+            return 2 - point_i + length;
+        }
+
+        // d.igitse+XX
+        std::size_t res = 1;
+
+        if (length > 1)
+        {
+            std::memmove(buffer + 2, buffer + 1, length - 1);
+            buffer[1] = '.';
+            res = length + 1;
+        }
+
+        int exponent = point_i - 1;
+
+        buffer[res++] = 'e';
+        buffer[res++] = exponent < 0 ? '-' : '+';
+        exponent = exponent < 0 ? -exponent : exponent;
+        if (exponent < 10)
+        {
+            buffer[res++] = '0';
+        }
+
+        char digits[8];
+        char *digits_end = digits + sizeof(digits);
+        char *digits_begin = write_digits(digits_end, static_cast<unsigned>(exponent));
+
+        std::memcpy(buffer + res, digits_begin, digits_end - digits_begin);
+
+        return res + (digits_end - digits_begin);
+    }
+
+    static std::size_t format_printf(
+        char *buffer, std::size_t size, char conversion, int precision, double value)
+    {
+        const char printf_format[] = { '%', '.', '*', conversion, '\0' };
+
+        return finish_printf(
+            buffer, size, std::snprintf(buffer, size, printf_format, precision, value));
+    }
+
+    static std::size_t format_printf(
+        char *buffer, std::size_t size, char conversion, int precision, long double value)
+    {
+        const char printf_format[] = { '%', '.', '*', 'L', conversion, '\0' };
+
+        return finish_printf(
+            buffer, size, std::snprintf(buffer, size, printf_format, precision, value));
+    }
+
+    // `printf()` writes the decimal point of the C locale, which needn't be
+    // `.`, so anything that isn't a digit, letter, or sign is replaced with
+    // one.
+    static std::size_t finish_printf(char *buffer, std::size_t size, int printf_length)
+    {
+        std::size_t length = printf_length < 0 ? 0 :
+            static_cast<std::size_t>(printf_length) < size ?
+                static_cast<std::size_t>(printf_length) :
+                size - 1;
+        std::size_t res = 0;
+        bool is_in_point = false;
+
+        for (std::size_t char_i = 0; char_i < length; ++char_i)
+        {
+            char ch = buffer[char_i];
+            bool is_point_char = !(
+                (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+                (ch >= 'A' && ch <= 'Z') || ch == '+' || ch == '-');
+
+            if (!is_point_char)
+            {
+                buffer[res++] = ch;
+            }
+            else if (!is_in_point)
+            {
+                buffer[res++] = '.';
+            }
+            is_in_point = is_point_char;
+        }
+
+        return res;
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_NUMBER_FORMATTER_H
@@ -1,12 +1,24 @@
 #ifndef _OPERATION_LOG_OPERATION_LOG_H
 #define _OPERATION_LOG_OPERATION_LOG_H
 
+#include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <ostream>
 #include <stack>
+#include <vector>
 
+#include "blob.h"
+#include "call_site.h"
+#include "forward_declarations.h"
 #include "function_info.h"
+#include "heap_accounting.h"
+#include "lock_contention.h"
+#include "perf_counters.h"
 #include "predicate.h"
+#include "string_ref.h"
+#include "usdt.h"
+#include "var_accumulator.h"
 
 
 namespace operation_log
@@ -20,7 +32,10 @@ class OperationLog
 private:
     Formatter *formatter;
     std::reference_wrapper<MessageFilterPredicate> message_filter_predicate;
-    std::stack<FunctionInfo> call_stack;
+    CallStack call_stack;
+    // The accumulators with statistics to write, in the order they were
+    // reached (and so, by depth):
+    std::vector<VarAccumulator*> pending_accumulators;
 
 public:
     OperationLog(Formatter &formatter, MessageFilterPredicate &message_filter_predicate)
@@ -59,34 +74,137 @@ public:
         formatter->set_output_stream(value);
     }
 
-    void write_message(std::string message)
+    void write_message(StringRef message)
     {
+        HeapAccounting::Pause heap_accounting_pause;
+        write_pending_lock_contention();
         if (message_filter_predicate.get()(call_stack))
         {
             formatter->write_message(message);
         }
     }
 
-    void write_html(std::string code)
+    // Writes a message of the call site, if it's enabled, and fires its USDT
+    // probe, if a tracer is attached (see `usdt.h`).
+    void write_message(CallSite &call_site, StringRef message)
     {
+        Usdt::message(call_site, message.data(), message.size());
+        if (call_site.is_enabled())
+        {
+            write_message(message);
+        }
+    }
+
+    void write_html(StringRef code)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        write_pending_lock_contention();
         if (message_filter_predicate.get()(call_stack))
         {
             formatter->write_html(code);
         }
     }
 
+    // Writes binary data for the HTML messages which follow (see `Blob`).
+    void write_blob(const Blob &blob)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        write_pending_lock_contention();
+        if (message_filter_predicate.get()(call_stack))
+        {
+            formatter->write_blob(blob);
+        }
+    }
+
     template <typename... VarTs>
-    void dump_vars(const std::vector<std::string> &names, VarTs... vars)
+    void dump_vars(const std::vector<std::string> &names, const VarTs&... vars)
     {
+        HeapAccounting::Pause heap_accounting_pause;
+        write_pending_lock_contention();
         if (message_filter_predicate.get()(call_stack))
         {
             formatter->dump_vars(names, vars...);
         }
     }
 
+    // Dumps the variables of the call site, like `write_message()` for a call
+    // site.
+    template <typename... VarTs>
+    void dump_vars(CallSite &call_site, const VarTs&... vars)
+    {
+        Usdt::dump_vars(call_site, vars...);
+        if (call_site.is_enabled())
+        {
+            dump_vars(call_site.get_function_info().get_argument_names(), vars...);
+        }
+    }
+
+    // Adds the values of numeric variables to their statistics, which are
+    // written when the function the call site was reached in exits (see
+    // `OPERATION_LOG_ACCUMULATE_VARS()`).
+    //
+    // If the call site is reached in a different function call (e.g., in a
+    // recursive call), the statistics of the earlier call are written first.
+    // Statistics accumulated outside of logged functions are written by
+    // `write_accumulated_vars()`.
+    template <typename... VarTs>
+    void accumulate_vars(VarAccumulator &accumulator, const VarTs&... vars)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        // (With USDT probes, a disabled call site gets here, while a tracer
+        // is attached, see `usdt.h`.)
+        Usdt::dump_vars(accumulator.get_call_site(), vars...);
+        if (!accumulator.get_call_site().is_enabled())
+        {
+            return;
+        }
+
+        int depth = static_cast<int>(call_stack.size());
+
+        if (accumulator.get_depth() != depth)
+        {
+            if (accumulator.get_depth() >= 0)
+            {
+                pending_accumulators.erase(
+                    std::find(
+                        pending_accumulators.begin(), pending_accumulators.end(),
+                        &accumulator));
+                write_accumulator(accumulator);
+            }
+            accumulator.set_depth(depth);
+            pending_accumulators.push_back(&accumulator);
+        }
+        accumulator.add(vars...);
+    }
+
+    // Writes the statistics accumulated at the current, and deeper call stack
+    // depths.  (At the top level, it writes those accumulated outside of
+    // logged functions.)
+    void write_accumulated_vars()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        std::size_t depth = call_stack.size();
+        std::size_t begin_i = pending_accumulators.size();
+
+        while (begin_i > 0 &&
+            static_cast<std::size_t>(pending_accumulators[begin_i - 1]->get_depth()) >= depth)
+        {
+            --begin_i;
+        }
+        for (std::size_t accumulator_i = begin_i;
+            accumulator_i < pending_accumulators.size(); ++accumulator_i)
+        {
+            write_accumulator(*pending_accumulators[accumulator_i]);
+        }
+        pending_accumulators.resize(begin_i);
+    }
+
     template <typename... ArgTs>
-    void log_function_entry(FunctionInfo &function_info, ArgTs... args)
+    void log_function_entry(const FunctionInfo &function_info, const ArgTs&... args)
     {
+        HeapAccounting::Pause heap_accounting_pause;
+        write_pending_lock_contention();
         call_stack.push(function_info);
         if (message_filter_predicate.get()(call_stack))
         {
@@ -95,8 +213,19 @@ public:
         formatter->enter_function();
     }
 
-    void log_function_exit(FunctionInfo &function_info)
+    void log_function_exit(const FunctionInfo &function_info)
     {
+        HeapAccounting::Pause heap_accounting_pause;
+        write_pending_lock_contention();
+        if (call_stack.empty())
+        {
+            // It was entered before `reset_after_fork()`.
+            return;
+        }
+        if (!pending_accumulators.empty())
+        {
+            write_accumulated_vars();
+        }
         if (message_filter_predicate.get()(call_stack))
         {
             formatter->log_function_exit(function_info);
@@ -104,6 +233,103 @@ public:
         formatter->exit_function();
         call_stack.pop();
     }
+
+    // Logs the heap allocations of a function call, which is about to exit,
+    // and adds them to the function's totals (see `HeapAccounting`).
+    void write_heap_totals(const FunctionInfo &function_info, const HeapScopeTotals &totals)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        static const std::vector<std::string> names = { "heap" };
+
+        if (call_stack.empty())
+        {
+            return;
+        }
+        HeapAccounting::add_to_report(function_info.get_full_name(), totals);
+        if (totals.inclusive.allocation_c > 0 && message_filter_predicate.get()(call_stack))
+        {
+            formatter->dump_vars(names, totals);
+        }
+    }
+
+    // Logs the CPU time, and hardware counters of a function call, which is
+    // about to exit, and adds them to the function's totals (see
+    // `PerfCounters`).
+    void write_perf_counters(const FunctionInfo &function_info, const PerfCounterValues &values)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        static const std::vector<std::string> names = { "counters" };
+
+        if (call_stack.empty())
+        {
+            return;
+        }
+        PerfCounters::add_to_report(function_info.get_full_name(), values);
+        if (message_filter_predicate.get()(call_stack))
+        {
+            formatter->dump_vars(names, values);
+        }
+    }
+
+    // Logs a wait for, or a hold of an instrumented lock, which took at
+    // least the threshold (see `LockContention`).  It must be called on the
+    // thread, which logs.
+    void write_lock_contention(const LockContentionEvent &event)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        static const std::vector<std::string> names = { "contention" };
+
+        if (message_filter_predicate.get()(call_stack))
+        {
+            formatter->dump_vars(names, event);
+        }
+    }
+
+    // Forgets the functions, which were entered before `fork()`, in the
+    // child process (see `ForkHandling`), so the child's log starts at the
+    // top level.  Those functions exit without being logged, and their
+    // accumulated statistics are dropped.
+    void reset_after_fork()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+
+        call_stack = CallStack();
+        for (VarAccumulator *accumulator : pending_accumulators)
+        {
+            accumulator->reset();
+        }
+        pending_accumulators.clear();
+    }
+
+private:
+    // Logs the lock contention events, which threads queued since the last
+    // event (see `LockContention`).
+    void write_pending_lock_contention()
+    {
+        if (!LockContention::has_pending_events())
+        {
+            return;
+        }
+
+        static thread_local std::vector<LockContentionEvent> events;
+
+        LockContention::take_pending_events(events);
+        for (const LockContentionEvent &event : events)
+        {
+            write_lock_contention(event);
+        }
+    }
+
+    void write_accumulator(VarAccumulator &accumulator)
+    {
+        if (message_filter_predicate.get()(call_stack))
+        {
+            formatter->dump_values(
+                accumulator.get_names(), accumulator.get_values(),
+                accumulator.get_value_count());
+        }
+        accumulator.reset();
+    }
 };
 
 }
@@ -26,10 +26,10 @@ void OPERATION_LOG_INIT_FUNCTION_NAME(operation_log::DefaultOperationLog &log);
 namespace operation_log
 {
 
-class DefaultMessageFilter : public RunTimePredicate<const std::stack<FunctionInfo>&>
+class DefaultMessageFilter : public RunTimePredicate<const CallStack&>
 {
 public:
-    bool operator()(const std::stack<FunctionInfo> &call_stack)
+    bool operator()(const CallStack &call_stack)
     {
         return true;
     }
@@ -0,0 +1,517 @@
+#ifndef _OPERATION_LOG_PERF_COUNTERS_H
+#define _OPERATION_LOG_PERF_COUNTERS_H
+
+#include <time.h>
+
+#ifdef __linux__
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/mman.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif // __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "heap_accounting.h"
+#include "type_traits.h"
+
+
+namespace operation_log
+{
+
+// The thread CPU time, and hardware counter deltas of a logged function call
+// (see `PerfCounters`).  Hardware counters, which aren't available, are -1.
+struct PerfCounterValues
+{
+    enum Counter
+    {
+        cycles,
+        instructions,
+        cache_misses,
+        branch_misses,
+        counter_c
+    };
+
+    long long cpu_time_ns;
+    long long counters[counter_c];
+};
+
+// The counter totals of all calls of a logged function (see
+// `PerfCounters::list_functions()`).
+struct PerfFunctionTotals
+{
+    std::string function_name;
+    long long call_c;
+    PerfCounterValues totals;
+};
+
+// Measures the thread CPU time (`CLOCK_THREAD_CPUTIME_ID`), and hardware
+// performance counters (cycles, instructions, cache misses, and branch
+// misses) of each logged function call (`FunctionEntry`), when it's switched
+// on with `set_active()`.
+//
+// The hardware counters are opened as a `perf_event_open()` group for each
+// thread, the first time it enters a logged function.  They're read in user
+// space with `rdpmc` (on x86), when the kernel allows it, and with a single
+// `read()` of the group, otherwise.  If the kernel has no counters (e.g., in
+// a container, or a virtual machine), only the CPU time is measured.
+//
+// The deltas of each call are logged before its exit (as a `counters` value),
+// and added up for each function, for `write_report()`.  They include the
+// logging of nested calls.
+class PerfCounters
+{
+public:
+    static bool is_active()
+    {
+        return get_active().load(std::memory_order_relaxed);
+    }
+
+    static void set_active(bool value)
+    {
+        get_active().store(value, std::memory_order_relaxed);
+    }
+
+    // Returns whether the current thread's hardware counters are available.
+    static bool has_hardware_counters()
+    {
+        return get_thread_counters().has_hardware_counters();
+    }
+
+    // Returns the current thread's CPU time, and counter values.
+    static PerfCounterValues read()
+    {
+        PerfCounterValues res;
+
+        get_thread_counters().read(res.counters);
+        res.cpu_time_ns = read_cpu_time_ns();
+
+        return res;
+    }
+
+    // The counters of a logged function call.
+    class Scope
+    {
+    public:
+        bool is_entered() const
+        {
+            return is_scope_entered;
+        }
+
+        void enter()
+        {
+            entry_values = PerfCounters::read();
+            is_scope_entered = true;
+        }
+
+        PerfCounterValues exit()
+        {
+            PerfCounterValues res = PerfCounters::read();
+
+            res.cpu_time_ns -= entry_values.cpu_time_ns;
+            for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+            {
+                if (res.counters[counter_i] >= 0)
+                {
+                    res.counters[counter_i] -= entry_values.counters[counter_i];
+                }
+            }
+            is_scope_entered = false;
+
+            return res;
+        }
+
+    private:
+        PerfCounterValues entry_values;
+        bool is_scope_entered = false;
+    };
+
+    // Returns the name of a hardware counter (e.g., `cache misses`).
+    static const char* get_counter_name(int counter_i)
+    {
+        static const char *names[PerfCounterValues::counter_c] = {
+            "cycles", "instructions", "cache misses", "branch misses" };
+
+        return names[counter_i];
+    }
+
+    // Adds a call's counters to the function's totals.
+    static void add_to_report(const std::string &function_name, const PerfCounterValues &values)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+        auto found = report.functions.find(function_name);
+
+        if (found == report.functions.end())
+        {
+            PerfFunctionTotals &function_totals = report.functions[function_name];
+
+            function_totals.call_c = 1;
+            function_totals.totals = values;
+
+            return;
+        }
+
+        PerfFunctionTotals &function_totals = found->second;
+
+        ++function_totals.call_c;
+        function_totals.totals.cpu_time_ns += values.cpu_time_ns;
+        for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+        {
+            long long &total = function_totals.totals.counters[counter_i];
+
+            total = total >= 0 && values.counters[counter_i] >= 0 ?
+                total + values.counters[counter_i] : -1;
+        }
+    }
+
+    // Returns the totals of each function, which has exited, by CPU time, in
+    // descending order.
+    static std::vector<PerfFunctionTotals> list_functions()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+        std::vector<PerfFunctionTotals> res;
+
+        res.reserve(report.functions.size());
+        for (const auto &name_and_totals : report.functions)
+        {
+            res.push_back(name_and_totals.second);
+            res.back().function_name = name_and_totals.first;
+        }
+        std::sort(
+            res.begin(), res.end(),
+            [](const PerfFunctionTotals &a, const PerfFunctionTotals &b)
+            {
+                return a.totals.cpu_time_ns > b.totals.cpu_time_ns;
+            });
+
+        return res;
+    }
+
+    // Writes the totals of each function as a table.  (Counters, which
+    // aren't available, are shown as `-`.)
+    static void write_report(std::ostream &out)
+    {
+        std::vector<PerfFunctionTotals> functions = list_functions();
+        HeapAccounting::Pause heap_accounting_pause;
+
+        out << std::setw(10) << "calls" << std::setw(16) << "cpu time ns";
+        for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+        {
+            out << std::setw(16) << get_counter_name(counter_i);
+        }
+        out << "  function" << std::endl;
+        for (const PerfFunctionTotals &function_totals : functions)
+        {
+            out << std::setw(10) << function_totals.call_c <<
+                std::setw(16) << function_totals.totals.cpu_time_ns;
+            for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+            {
+                long long total = function_totals.totals.counters[counter_i];
+
+                out << std::setw(16);
+                if (total >= 0)
+                {
+                    out << total;
+                }
+                else
+                {
+                    out << "-";
+                }
+            }
+            out << "  " << function_totals.function_name << std::endl;
+        }
+    }
+
+    static void reset_report()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Report &report = get_report();
+        std::lock_guard<std::mutex> lock(report.mutex);
+
+        report.functions.clear();
+    }
+
+    // Reopens the forking thread's counters in a child process (see
+    // `ForkHandling`).  The inherited ones count the parent's thread.
+    static void reset_after_fork()
+    {
+        if (is_active())
+        {
+            ThreadCounters &counters = get_thread_counters();
+
+            counters.~ThreadCounters();
+            new (&counters) ThreadCounters();
+        }
+    }
+
+private:
+    // The hardware counter group of a thread.
+    class ThreadCounters
+    {
+    public:
+        ThreadCounters()
+        {
+            std::fill(fds, fds + PerfCounterValues::counter_c, -1);
+#ifdef __linux__
+            static const std::uint64_t configs[PerfCounterValues::counter_c] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+            long page_size = sysconf(_SC_PAGESIZE);
+            int error = 0;
+
+            for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+            {
+                perf_event_attr attributes;
+
+                std::memset(&attributes, 0, sizeof(attributes));
+                attributes.size = sizeof(attributes);
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = configs[counter_i];
+                attributes.read_format = PERF_FORMAT_GROUP;
+                attributes.disabled = leader_fd < 0 ? 1 : 0;
+                attributes.exclude_kernel = 1;
+                attributes.exclude_hv = 1;
+
+                int fd = static_cast<int>(syscall(
+                    SYS_perf_event_open, &attributes, 0, -1, leader_fd,
+                    PERF_FLAG_FD_CLOEXEC));
+
+                fds[counter_i] = fd;
+                pages[counter_i] = nullptr;
+                if (fd < 0)
+                {
+                    error = errno;
+                    continue;
+                }
+                if (leader_fd < 0)
+                {
+                    leader_fd = fd;
+                }
+                group_positions[counter_i] = group_size++;
+
+                void *page = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+
+                if (page != MAP_FAILED)
+                {
+                    pages[counter_i] = static_cast<perf_event_mmap_page*>(page);
+                }
+            }
+            if (leader_fd >= 0)
+            {
+                ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+            else
+            {
+                warn_unavailable(std::strerror(error));
+            }
+#else // __linux__
+            warn_unavailable("not Linux");
+#endif // __linux__
+        }
+
+        ~ThreadCounters()
+        {
+#ifdef __linux__
+            long page_size = sysconf(_SC_PAGESIZE);
+
+            for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+            {
+                if (pages[counter_i])
+                {
+                    munmap(pages[counter_i], page_size);
+                }
+                if (fds[counter_i] >= 0)
+                {
+                    close(fds[counter_i]);
+                }
+            }
+#endif // __linux__
+        }
+
+        ThreadCounters(const ThreadCounters &) = delete;
+        ThreadCounters& operator=(const ThreadCounters &) = delete;
+
+        bool has_hardware_counters() const
+        {
+            return leader_fd >= 0;
+        }
+
+        void read(long long *values)
+        {
+            std::fill(values, values + PerfCounterValues::counter_c, -1LL);
+#ifdef __linux__
+            if (leader_fd < 0)
+            {
+                return;
+            }
+
+            bool is_read = true;
+
+            for (int counter_i = 0;
+                counter_i < PerfCounterValues::counter_c && is_read; ++counter_i)
+            {
+                if (fds[counter_i] >= 0)
+                {
+                    is_read = read_user_space(pages[counter_i], values[counter_i]);
+                }
+            }
+            if (is_read)
+            {
+                return;
+            }
+
+            // Read the whole group with a system call:
+            std::uint64_t buffer[1 + PerfCounterValues::counter_c];
+
+            if (::read(leader_fd, buffer, sizeof(buffer)) <= 0)
+            {
+                std::fill(values, values + PerfCounterValues::counter_c, -1LL);
+
+                return;
+            }
+            for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+            {
+                if (fds[counter_i] >= 0)
+                {
+                    values[counter_i] =
+                        static_cast<long long>(buffer[1 + group_positions[counter_i]]);
+                }
+            }
+#endif // __linux__
+        }
+
+    private:
+        int fds[PerfCounterValues::counter_c];
+#ifdef __linux__
+        perf_event_mmap_page *pages[PerfCounterValues::counter_c];
+#endif // __linux__
+        // The position of each counter's value in a group read:
+        int group_positions[PerfCounterValues::counter_c];
+        int leader_fd = -1;
+        int group_size = 0;
+
+        // Reads a counter with `rdpmc`, as `perf_event_open(2)` describes,
+        // if the counter is scheduled, and the kernel allows it.
+#ifdef __linux__
+        static bool read_user_space(const perf_event_mmap_page *page, long long &value)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            if (!page)
+            {
+                return false;
+            }
+
+            const volatile perf_event_mmap_page *volatile_page = page;
+            std::uint32_t sequence;
+            long long count;
+
+            do
+            {
+                sequence = volatile_page->lock;
+                asm volatile("" : : : "memory");
+
+                std::uint32_t index = volatile_page->index;
+
+                if (!volatile_page->cap_user_rdpmc || index == 0)
+                {
+                    return false;
+                }
+
+                std::uint32_t low;
+                std::uint32_t high;
+                int shift = 64 - volatile_page->pmc_width;
+
+                asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1));
+                count = volatile_page->offset + static_cast<long long>(
+                    static_cast<std::int64_t>(
+                        ((static_cast<std::uint64_t>(high) << 32) | low) << shift) >> shift);
+                asm volatile("" : : : "memory");
+            }
+            while (volatile_page->lock != sequence);
+
+            value = count;
+
+            return true;
+#else // defined(__x86_64__) || defined(__i386__)
+            return false;
+#endif // defined(__x86_64__) || defined(__i386__)
+        }
+#endif // __linux__
+
+        // Tells, once, that only the CPU time is measured.
+        static void warn_unavailable(const char *reason)
+        {
+            static std::atomic<bool> is_warned(false);
+
+            if (!is_warned.exchange(true))
+            {
+                std::cerr << "operation_log: Hardware performance counters aren't "
+                    "available (" << reason << "), only CPU time is "
+                    "measured." << std::endl;
+            }
+        }
+    };
+
+    struct Report
+    {
+        std::mutex mutex;
+        std::map<std::string, PerfFunctionTotals> functions;
+    };
+
+    static long long read_cpu_time_ns()
+    {
+        timespec time;
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+        return static_cast<long long>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+    }
+
+    static ThreadCounters& get_thread_counters()
+    {
+        static thread_local ThreadCounters counters;
+
+        return counters;
+    }
+
+    static std::atomic<bool>& get_active()
+    {
+        static std::atomic<bool> value(false);
+
+        return value;
+    }
+
+    static Report& get_report()
+    {
+        static Report report;
+
+        return report;
+    }
+};
+
+// The counters are plain numbers, so they're formatted on the background
+// thread by `DeferredFormatter`.
+template <>
+struct IsTriviallyCapturable<PerfCounterValues> : public std::true_type {};
+
+}
+
+#endif // _OPERATION_LOG_PERF_COUNTERS_H
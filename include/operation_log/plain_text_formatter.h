@@ -8,6 +8,7 @@
 
 #include "formatter_base.h"
 #include "function_info.h"
+#include "string_ref.h"
 #include "value_formatter_i.h"
 
 
@@ -32,7 +33,7 @@ protected:
         }
     }
 
-    void write_message_value(std::string message) override
+    void write_message_value(StringRef message) override
     {
         output.get() << message << std::endl;
     }
@@ -47,9 +48,11 @@ protected:
         output.get() << "," << std::endl;
     }
 
-    void write_dump_var(std::string name, ValueFormatterI &value_formatter)
+    void write_dump_var(
+        const std::string &name, ValueFormatterI &value_formatter) override
     {
-        output.get() << name << " = " << value_formatter.to_text();
+        output.get() << name << " = ";
+        write_value(output.get(), value_formatter);
     }
 
     virtual void write_function_suffix()
@@ -58,9 +61,14 @@ protected:
     }
 
     void write_function_return_type_and_name(
-        std::string return_type, std::string name) override
+        const std::string &return_type, const std::string &name) override
     {
-        output.get() << return_type << " " << name;
+        if (!return_type.empty())
+        {
+            // (Demangled symbols have no return type.)
+            output.get() << return_type << " ";
+        }
+        output.get() << name;
     }
 
     void write_function_args_prefix() override
@@ -79,13 +87,14 @@ protected:
     }
 
     void write_function_arg(
-        std::string type_name, std::string parameter_name,
-        ValueFormatterI &value_formatter)
+        const std::string &type_name, const std::string &parameter_name,
+        ValueFormatterI &value_formatter) override
     {
-        output.get() << type_name << " " << parameter_name << " = " << value_formatter.to_text();
+        output.get() << type_name << " " << parameter_name << " = ";
+        write_value(output.get(), value_formatter);
     }
 
-    void write_function_extra_info(std::string info) override
+    void write_function_extra_info(const std::string &info) override
     {
         output.get() << " " << info;
     }
@@ -0,0 +1,147 @@
+#ifndef _OPERATION_LOG_PROCESS_LOG_FILE_H
+#define _OPERATION_LOG_PROCESS_LOG_FILE_H
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "formatter_base.h"
+#include "plain_text_formatter.h"
+
+
+namespace operation_log
+{
+
+// A plain text log of one process (`<path prefix>.<pid>.log`), whose lines
+// begin with the time (in nanoseconds of `std::chrono::steady_clock`, which
+// all processes share), and the process id, so `tools/operation_log_merge`
+// can merge the logs of several processes in time order:
+//
+//     1284630067112 4711 void serve(int worker_i = 2)
+//
+// Each line is written with a single `write()`, when it ends, so the file
+// has no buffer a child process could inherit (see `ForkHandling`).
+class ProcessLogFile
+{
+public:
+    explicit ProcessLogFile(const std::string &path_prefix)
+    : path(path_prefix + "." + std::to_string(getpid()) + ".log"),
+    stream(&buffer),
+    formatter(stream)
+    {
+        buffer.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        buffer.pid = getpid();
+    }
+
+    ProcessLogFile(const ProcessLogFile &) = delete;
+    ProcessLogFile& operator=(const ProcessLogFile &) = delete;
+
+    // An unfinished line isn't written.
+    ~ProcessLogFile()
+    {
+        if (buffer.fd >= 0)
+        {
+            close(buffer.fd);
+        }
+    }
+
+    bool is_open() const
+    {
+        return buffer.fd >= 0;
+    }
+
+    const std::string& get_path() const
+    {
+        return path;
+    }
+
+    FormatterBase& get_formatter()
+    {
+        return formatter;
+    }
+
+private:
+    class LineBuffer : public std::streambuf
+    {
+    public:
+        int fd = -1;
+        pid_t pid = 0;
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                return traits_type::not_eof(ch);
+            }
+            line.push_back(traits_type::to_char_type(ch));
+            if (line.back() == '\n')
+            {
+                write_line();
+            }
+
+            return ch;
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize count) override
+        {
+            const char *end = s + count;
+
+            while (s < end)
+            {
+                const char *line_end =
+                    static_cast<const char*>(std::memchr(s, '\n', end - s));
+
+                if (!line_end)
+                {
+                    line.append(s, end);
+                    break;
+                }
+                line.append(s, line_end + 1);
+                write_line();
+                s = line_end + 1;
+            }
+
+            return count;
+        }
+
+    private:
+        std::string line;
+
+        void write_line()
+        {
+            char prefix[48];
+            long long time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            int prefix_size = std::snprintf(
+                prefix, sizeof(prefix), "%lld %ld ", time_ns, static_cast<long>(pid));
+            iovec parts[2] = {
+                { prefix, static_cast<std::size_t>(prefix_size) },
+                { &line[0], line.size() } };
+
+            if (fd >= 0 && writev(fd, parts, 2) < 0)
+            {
+                close(fd);
+                fd = -1;
+            }
+            line.clear();
+        }
+    };
+
+    std::string path;
+    LineBuffer buffer;
+    std::ostream stream;
+    PlainTextFormatter formatter;
+};
+
+}
+
+#endif // _OPERATION_LOG_PROCESS_LOG_FILE_H
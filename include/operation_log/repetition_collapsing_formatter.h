@@ -0,0 +1,909 @@
+#ifndef _OPERATION_LOG_REPETITION_COLLAPSING_FORMATTER_H
+#define _OPERATION_LOG_REPETITION_COLLAPSING_FORMATTER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "blob.h"
+#include "formatter_base.h"
+#include "function_info.h"
+#include "message_stream_pool.h"
+#include "number_formatter.h"
+#include "string_ref.h"
+#include "value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// A formatter which passes log events on to another formatter, and collapses
+// runs of repeated blocks into a "Previous block repeated N more times"
+// message.
+//
+// A block is a message, or a variable dump, or a whole logged function call,
+// with everything logged inside it.  Blocks at the same function nesting
+// depth repeat, if they have the same shape: the same messages (whatever
+// numbers they have), and the same call sites, in the same order, whatever
+// values the variables, and arguments had.  (HTML messages have to be the
+// same.)  A run of up to `max_period` blocks which repeats (e.g., the body of a
+// loop, which logs a message, and calls a function) is written once, followed
+// by the message, and the values which changed in the repeats (their first,
+// and last value), or, for a single repeat, its values.  Repeats nested in a
+// block are collapsed first, so an outer block repeats, if its inner blocks
+// repeat the same number of times.
+//
+// Blocks are kept until they end, or until `max_buffered_event_c` events are
+// kept, at which point the outermost kept block is passed on, and can't be
+// collapsed.  The message is written at the nesting depth of the blocks, so
+// the target formatter indents it, or puts it in the function's frame, like
+// the blocks.  Values are formatted (by the target formatter) when they're
+// logged, so collapsed values don't have to be valid later.
+//
+// Like `OperationLog`, it's used from one thread.  Use it like:
+//
+//     static operation_log::HtmlFormatter html_formatter(output_stream);
+//     static operation_log::RepetitionCollapsingFormatter formatter(html_formatter);
+//
+//     log.set_formatter(formatter);
+class RepetitionCollapsingFormatter : public FormatterBase
+{
+public:
+    // The longest run of blocks which can repeat:
+    static const int period_limit = 8;
+
+    RepetitionCollapsingFormatter(
+        FormatterBase &target, int max_period = 4,
+        std::size_t max_buffered_event_c = 4096)
+    : FormatterBase(target.get_output_stream()),
+    target(target),
+    max_period(std::max(1, std::min(max_period, static_cast<int>(period_limit)))),
+    max_buffered_event_c(std::max<std::size_t>(max_buffered_event_c, 1)),
+    levels(1)
+    {}
+
+    RepetitionCollapsingFormatter(const RepetitionCollapsingFormatter &) = delete;
+    RepetitionCollapsingFormatter& operator=(const RepetitionCollapsingFormatter &) = delete;
+
+    ~RepetitionCollapsingFormatter()
+    {
+        flush();
+    }
+
+    FormatterBase& get_target()
+    {
+        return target;
+    }
+
+    // Ends the runs of repeats being collapsed, and passes all kept events to
+    // the target formatter.
+    void flush()
+    {
+        for (std::size_t level_i = level_c; level_i > 0; --level_i)
+        {
+            release(levels[level_i - 1]);
+        }
+        write_events(base_position + event_c);
+    }
+
+    void write_message(StringRef message) override
+    {
+        Event &event = add_event(message_event);
+
+        event.text.assign(message.data(), message.size());
+        add_block_event(get_token(message_event, hash_shape(message)));
+    }
+
+    void write_html(StringRef code) override
+    {
+        Event &event = add_event(html_event);
+
+        event.text.assign(code.data(), code.size());
+        add_block_event(get_token(html_event, hash(code)));
+    }
+
+    // Blobs aren't kept.  A new blob ends the runs of repeats, so it's
+    // written before the messages which load it.
+    void write_blob(const Blob &blob) override
+    {
+        if (!written_blob_ids.insert(blob.id).second)
+        {
+            return;
+        }
+        flush();
+        target.write_blob(blob);
+    }
+
+    void dump_values(
+        const std::vector<std::string> &names,
+        ValueFormatterI *const *values, std::size_t value_count) override
+    {
+        Event &event = add_event(dump_event);
+        std::uint64_t names_hash = hash(StringRef());
+
+        for (std::size_t var_i = 0; var_i < value_count; ++var_i)
+        {
+            set_string(event.names, var_i, names[var_i]);
+            names_hash = names_hash * 31 + hash(names[var_i]);
+        }
+        add_values(event, values, value_count);
+        add_block_event(get_token(dump_event, names_hash));
+    }
+
+    void log_function_entry_values(
+        const FunctionInfo &function_info,
+        ValueFormatterI *const *values, std::size_t value_count) override
+    {
+        Event &event = add_event(function_entry_event);
+
+        event.function_info = function_info;
+        add_values(event, values, value_count);
+
+        Level &level = get_level();
+
+        open_block(level);
+        mix(level.block, get_token(
+            function_entry_event,
+            reinterpret_cast<std::uintptr_t>(function_info.get_id()) + value_count));
+        write_released_events();
+    }
+
+    void enter_function() override
+    {
+        add_event(enter_function_event);
+
+        Level &level = get_level();
+
+        open_block(level);
+        mix(level.block, get_token(enter_function_event, 0));
+        if (level_c == levels.size())
+        {
+            levels.emplace_back();
+        }
+        levels[level_c++].reset();
+        write_released_events();
+    }
+
+    void log_function_exit(const FunctionInfo &function_info) override
+    {
+        Level &level = get_level();
+
+        end_collapse(level, get_end_position(level));
+        add_event(function_exit_event).function_info = function_info;
+        mix(level.frame, get_token(
+            function_exit_event, reinterpret_cast<std::uintptr_t>(function_info.get_id())));
+        write_released_events();
+    }
+
+    void exit_function() override
+    {
+        Level &inner_level = get_level();
+
+        end_collapse(inner_level, get_end_position(inner_level));
+        add_event(exit_function_event);
+        if (level_c > 1)
+        {
+            Signature frame = inner_level.frame;
+
+            --level_c;
+
+            Level &level = get_level();
+
+            open_block(level);
+            mix(level.block, frame.hash);
+            mix(level.block, frame.token_c);
+            mix(level.block, get_token(exit_function_event, 0));
+            complete_block(level);
+        }
+        write_released_events();
+    }
+
+    void write_value(std::ostream &out, ValueFormatterI &value_formatter) const override
+    {
+        target.write_value(out, value_formatter);
+    }
+
+    // The kept events are written by the parent.  (In the child, they go
+    // nowhere, with the rest of the target's output.)
+    void prepare_fork() override
+    {
+        target.prepare_fork();
+    }
+
+    void after_fork_in_parent() override
+    {
+        target.after_fork_in_parent();
+    }
+
+    void after_fork_in_child() override
+    {
+        target.after_fork_in_child();
+    }
+
+protected:
+    // This formatter passes events on, instead of writing them:
+    void write_message_value(StringRef message) override
+    {}
+
+    void write_dump_var(
+        const std::string &name, ValueFormatterI &value_formatter) override
+    {}
+
+    void write_function_return_type_and_name(
+        const std::string &return_type, const std::string &name) override
+    {}
+
+    void write_function_args_prefix() override
+    {}
+
+    void write_function_args_suffix() override
+    {}
+
+    void write_function_arg(
+        const std::string &type_name, const std::string &parameter_name,
+        ValueFormatterI &value_formatter) override
+    {}
+
+    void write_function_extra_info(const std::string &info) override
+    {}
+
+private:
+    enum EventType
+    {
+        message_event,
+        html_event,
+        dump_event,
+        function_entry_event,
+        enter_function_event,
+        function_exit_event,
+        exit_function_event
+    };
+
+    // The most values of a run whose changes are summarized:
+    static const std::size_t max_summarized_value_c = 16;
+    static const std::size_t no_position = static_cast<std::size_t>(-1);
+
+    // A kept event.  (The slots are reused, so their strings keep their
+    // capacity.)
+    struct Event
+    {
+        EventType type;
+        std::string text;
+        FunctionInfo function_info;
+        std::size_t value_c = 0;
+        std::vector<std::string> names;
+        // The values, formatted by the target formatter:
+        std::vector<std::string> values;
+    };
+
+    // A hash of a sequence of events, and their count.
+    struct Signature
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        std::uint64_t token_c = 0;
+
+        // (Empty signatures don't match, not even each other.)
+        bool matches(const Signature &other) const
+        {
+            return token_c != 0 && hash == other.hash && token_c == other.token_c;
+        }
+    };
+
+    // The state of a function nesting depth.
+    struct Level
+    {
+        // The position of the current block's first event, or `no_position`:
+        std::size_t block_begin;
+        Signature block;
+        // Whether the current block was passed on, before it ended:
+        bool is_block_streamed;
+        // The signatures of the last blocks written at this depth:
+        Signature history[period_limit];
+        std::size_t history_c;
+        // The signature of everything written at this depth:
+        Signature frame;
+
+        // The run of repeats being collapsed (if `period` isn't 0), and the
+        // position of the repeat being matched, if it has matched any blocks:
+        int period;
+        int iteration_block_i;
+        std::size_t iteration_begin;
+        long long repeat_c;
+        // The values of the collapsed repeats:
+        std::size_t value_c;
+        std::vector<std::string> value_names;
+        std::vector<std::string> first_values;
+        std::vector<std::string> last_values;
+        std::vector<bool> are_values_changed;
+
+        Level()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            block_begin = no_position;
+            block = Signature();
+            is_block_streamed = false;
+            history_c = 0;
+            frame = Signature();
+            period = 0;
+            iteration_block_i = 0;
+            iteration_begin = 0;
+            repeat_c = 0;
+            value_c = 0;
+        }
+
+        const Signature& get_history(int back_i) const
+        {
+            return history[(history_c - back_i) % period_limit];
+        }
+    };
+
+    // Writes a value, which was formatted when it was logged.
+    class FormattedValue : public ValueFormatterI
+    {
+    public:
+        const std::string *text = nullptr;
+
+        std::string to_text() override
+        {
+            return *text;
+        }
+
+        std::string to_html() override
+        {
+            return *text;
+        }
+
+        void write_text(std::ostream &out) override
+        {
+            out << *text;
+        }
+
+        void write_html(std::ostream &out) override
+        {
+            out << *text;
+        }
+    };
+
+    FormatterBase &target;
+    int max_period;
+    std::size_t max_buffered_event_c;
+    std::vector<Level> levels;
+    std::size_t level_c = 1;
+    // The kept events, and the position of the first of them (positions
+    // count all events passed on so far):
+    std::vector<Event> events;
+    std::size_t event_c = 0;
+    std::size_t base_position = 0;
+    std::unordered_set<BlobId, BlobId::Hash> written_blob_ids;
+    std::vector<FormattedValue> formatted_values;
+    std::vector<ValueFormatterI*> formatted_value_pointers;
+
+    Level& get_level()
+    {
+        return levels[level_c - 1];
+    }
+
+    static std::uint64_t hash(StringRef text)
+    {
+        return BlobId::get(text.data(), text.size()).low;
+    }
+
+    // Hashes a message, with each number in it replaced by `#`.
+    static std::uint64_t hash_shape(StringRef text)
+    {
+        std::uint64_t res = 0xcbf29ce484222325ULL;
+        const char *end = text.data() + text.size();
+
+        for (const char *p = text.data(); p != end; )
+        {
+            char c = *p;
+
+            if (is_digit(c) || (c == '-' && p + 1 != end && is_digit(p[1])))
+            {
+                c = '#';
+                for (++p; p != end; ++p)
+                {
+                    bool is_number_char =
+                        is_digit(*p) ||
+                        ((*p == '.' || *p == 'e' || *p == 'E') &&
+                            p + 1 != end && is_digit(p[1])) ||
+                        ((*p == '-' || *p == '+') && (p[-1] == 'e' || p[-1] == 'E'));
+
+                    if (!is_number_char)
+                    {
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                ++p;
+            }
+            res = (res ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        }
+
+        return res;
+    }
+
+    static bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static std::uint64_t get_token(EventType type, std::uint64_t value)
+    {
+        return (value ^ static_cast<std::uint64_t>(type)) * 0x9e3779b97f4a7c15ULL;
+    }
+
+    static void mix(Signature &signature, std::uint64_t token)
+    {
+        signature.hash = (signature.hash ^ token) * 0x100000001b3ULL;
+        ++signature.token_c;
+    }
+
+    static void set_string(std::vector<std::string> &strings, std::size_t string_i, StringRef value)
+    {
+        if (string_i < strings.size())
+        {
+            strings[string_i].assign(value.data(), value.size());
+        }
+        else
+        {
+            strings.emplace_back(value.data(), value.size());
+        }
+    }
+
+    Event& add_event(EventType type)
+    {
+        if (event_c == events.size())
+        {
+            events.emplace_back();
+        }
+
+        Event &event = events[event_c++];
+
+        event.type = type;
+        event.value_c = 0;
+
+        return event;
+    }
+
+    void add_values(Event &event, ValueFormatterI *const *values, std::size_t value_count)
+    {
+        for (std::size_t value_i = 0; value_i < value_count; ++value_i)
+        {
+            MessageStreamPool::Slot &slot = MessageStreamPool::get().acquire();
+
+            NumberFormat::set(slot.stream, target.get_number_format());
+            target.write_value(slot.stream, *values[value_i]);
+            set_string(event.values, value_i, slot.buffer.view());
+            MessageStreamPool::get().release(slot);
+        }
+        event.value_c = value_count;
+    }
+
+    // Starts a block at the last event, unless one was started.
+    void open_block(Level &level)
+    {
+        if (level.block_begin == no_position)
+        {
+            level.block_begin = base_position + event_c - 1;
+            level.block = Signature();
+            level.is_block_streamed = false;
+        }
+    }
+
+    // Adds the last event as a block of its own.
+    void add_block_event(std::uint64_t token)
+    {
+        Level &level = get_level();
+
+        open_block(level);
+        mix(level.block, token);
+        complete_block(level);
+        write_released_events();
+    }
+
+    // Where a note about the collapsed repeats goes: before the blocks kept
+    // for the next repeat.
+    std::size_t get_end_position(const Level &level) const
+    {
+        if (level.iteration_block_i > 0)
+        {
+            return level.iteration_begin;
+        }
+        if (level.block_begin != no_position)
+        {
+            return level.block_begin;
+        }
+
+        return base_position + event_c;
+    }
+
+    void complete_block(Level &level)
+    {
+        Signature signature = level.block;
+        bool is_streamed = level.is_block_streamed;
+
+        if (level.period > 0)
+        {
+            if (!is_streamed &&
+                signature.matches(level.get_history(level.period - level.iteration_block_i)))
+            {
+                if (level.iteration_block_i == 0)
+                {
+                    level.iteration_begin = level.block_begin;
+                }
+                level.block_begin = no_position;
+                if (++level.iteration_block_i == level.period)
+                {
+                    drop_repeat(level);
+                }
+
+                return;
+            }
+            end_collapse(level, get_end_position(level));
+        }
+
+        std::size_t begin = level.block_begin;
+
+        level.block_begin = no_position;
+        if (!is_streamed)
+        {
+            int max_block_period = static_cast<int>(
+                std::min<std::size_t>(max_period, level.history_c));
+
+            for (int period = 1; period <= max_block_period; ++period)
+            {
+                if (signature.matches(level.get_history(period)))
+                {
+                    level.period = period;
+                    level.iteration_block_i = 1;
+                    level.iteration_begin = begin;
+                    level.repeat_c = 0;
+                    if (period == 1)
+                    {
+                        drop_repeat(level);
+                    }
+
+                    return;
+                }
+            }
+        }
+        add_to_history(level, signature);
+    }
+
+    void add_to_history(Level &level, const Signature &signature)
+    {
+        level.history[level.history_c++ % period_limit] = signature;
+        mix(level.frame, signature.hash);
+        mix(level.frame, signature.token_c);
+    }
+
+    // Drops the kept repeat (the last events), and remembers its values.
+    // (The text of messages counts as a value, since their numbers can
+    // change.)
+    void drop_repeat(Level &level)
+    {
+        static const std::string message_name = "message";
+        std::size_t begin_i = level.iteration_begin - base_position;
+        std::size_t value_i = 0;
+
+        for (std::size_t event_i = begin_i;
+            event_i < event_c && value_i < max_summarized_value_c; ++event_i)
+        {
+            const Event &event = events[event_i];
+            const std::vector<std::string> &names =
+                event.type == function_entry_event ?
+                    event.function_info.get_argument_names() :
+                    event.names;
+
+            if (event.type == message_event)
+            {
+                MessageStreamPool::Slot &slot = MessageStreamPool::get().acquire();
+                ValueFormatter<std::string> value_formatter(event.text);
+
+                target.write_value(slot.stream, value_formatter);
+                add_repeat_value(level, value_i++, message_name, slot.buffer.view());
+                MessageStreamPool::get().release(slot);
+            }
+            for (std::size_t event_value_i = 0;
+                event_value_i < event.value_c && value_i < max_summarized_value_c;
+                ++event_value_i)
+            {
+                add_repeat_value(
+                    level, value_i++,
+                    event_value_i < names.size() ? StringRef(names[event_value_i]) : StringRef(),
+                    event.values[event_value_i]);
+            }
+        }
+        if (level.repeat_c == 0)
+        {
+            level.value_c = value_i;
+        }
+        ++level.repeat_c;
+        event_c = begin_i;
+        level.iteration_block_i = 0;
+    }
+
+    void add_repeat_value(Level &level, std::size_t value_i, StringRef name, StringRef value)
+    {
+        if (level.repeat_c == 0)
+        {
+            set_string(level.value_names, value_i, name);
+            set_string(level.first_values, value_i, value);
+            set_string(level.last_values, value_i, value);
+            if (value_i < level.are_values_changed.size())
+            {
+                level.are_values_changed[value_i] = false;
+            }
+            else
+            {
+                level.are_values_changed.push_back(false);
+            }
+        }
+        else if (value_i < level.value_c &&
+            level.last_values[value_i].compare(
+                0, std::string::npos, value.data(), value.size()) != 0)
+        {
+            level.last_values[value_i].assign(value.data(), value.size());
+            level.are_values_changed[value_i] = true;
+        }
+    }
+
+    // Writes a note about the collapsed repeats at `position`, and passes on
+    // the blocks kept for the next repeat.
+    void end_collapse(Level &level, std::size_t position)
+    {
+        if (level.period == 0)
+        {
+            return;
+        }
+
+        Signature kept_blocks[period_limit];
+        int kept_block_c = level.iteration_block_i;
+
+        for (int block_i = 0; block_i < kept_block_c; ++block_i)
+        {
+            kept_blocks[block_i] = level.get_history(level.period - block_i);
+        }
+        if (level.repeat_c > 0)
+        {
+            write_note(level, position);
+        }
+        for (int block_i = 0; block_i < kept_block_c; ++block_i)
+        {
+            add_to_history(level, kept_blocks[block_i]);
+        }
+        level.period = 0;
+        level.iteration_block_i = 0;
+        level.repeat_c = 0;
+    }
+
+    void write_note(Level &level, std::size_t position)
+    {
+        std::stringstream message;
+        // A single repeat's values are all written, since they may differ
+        // from the written block's:
+        std::size_t written_value_c = level.repeat_c == 1 ?
+            level.value_c :
+            std::count(
+                level.are_values_changed.begin(),
+                level.are_values_changed.begin() + level.value_c, true);
+        Event *note = insert_events(position, written_value_c > 0 ? 2 : 1);
+        Signature signature;
+
+        message << "Previous ";
+        if (level.period > 1)
+        {
+            message << level.period << " blocks";
+        }
+        else
+        {
+            message << "block";
+        }
+        message << " repeated ";
+        NumberFormatter::write(message, level.repeat_c);
+        message << (level.repeat_c == 1 ? " more time" : " more times");
+        note->type = message_event;
+        note->text = message.str();
+        note->value_c = 0;
+        mix(signature, get_token(message_event, hash(note->text)));
+        if (written_value_c > 0)
+        {
+            // The values which changed, from the first repeat to the last:
+            Event *changes = note + 1;
+            std::size_t change_i = 0;
+
+            changes->type = dump_event;
+            for (std::size_t value_i = 0; value_i < level.value_c; ++value_i)
+            {
+                if (level.repeat_c == 1 || level.are_values_changed[value_i])
+                {
+                    set_string(changes->names, change_i, level.value_names[value_i]);
+                    set_string(
+                        changes->values, change_i,
+                        level.are_values_changed[value_i] ?
+                            level.first_values[value_i] + " .. " + level.last_values[value_i] :
+                            level.last_values[value_i]);
+                    mix(signature, hash(changes->values[change_i]));
+                    ++change_i;
+                }
+            }
+            changes->value_c = change_i;
+        }
+        // The note breaks runs of repeats:
+        mix(level.frame, signature.hash);
+        level.history[level.history_c++ % period_limit] = Signature();
+    }
+
+    // Inserts `count` events at `position`, and returns the first of them.
+    Event* insert_events(std::size_t position, std::size_t count)
+    {
+        std::size_t event_i = position - base_position;
+
+        while (events.size() < event_c + count)
+        {
+            events.emplace_back();
+        }
+        std::rotate(
+            events.begin() + event_i, events.begin() + event_c,
+            events.begin() + event_c + count);
+        event_c += count;
+        for (std::size_t level_i = 0; level_i < level_c; ++level_i)
+        {
+            Level &level = levels[level_i];
+
+            if (level.block_begin != no_position && level.block_begin >= position)
+            {
+                level.block_begin += count;
+            }
+            if (level.iteration_block_i > 0 && level.iteration_begin >= position)
+            {
+                level.iteration_begin += count;
+            }
+        }
+
+        return &events[event_i];
+    }
+
+    // Returns the position of the first event a level keeps, or
+    // `no_position`.
+    static std::size_t get_kept_position(const Level &level)
+    {
+        if (level.iteration_block_i > 0)
+        {
+            return level.iteration_begin;
+        }
+        if (level.block_begin != no_position && !level.is_block_streamed)
+        {
+            return level.block_begin;
+        }
+
+        return no_position;
+    }
+
+    // Returns the outermost level which keeps events, or `level_c`.  (Its
+    // events come before those of the levels inside it.)
+    std::size_t get_keeping_level_i() const
+    {
+        std::size_t level_i = 0;
+
+        while (level_i < level_c && get_kept_position(levels[level_i]) == no_position)
+        {
+            ++level_i;
+        }
+
+        return level_i;
+    }
+
+    // Ends the level's run of repeats, and lets its current block be passed
+    // on, before it ends.
+    void release(Level &level)
+    {
+        end_collapse(level, get_end_position(level));
+        if (level.block_begin != no_position)
+        {
+            level.is_block_streamed = true;
+        }
+    }
+
+    // Passes on the events which no level keeps, and, if too many are kept,
+    // releases the outermost levels which keep them.
+    void write_released_events()
+    {
+        for (;;)
+        {
+            std::size_t level_i = get_keeping_level_i();
+
+            write_events(
+                level_i < level_c ?
+                    get_kept_position(levels[level_i]) :
+                    base_position + event_c);
+            if (event_c <= max_buffered_event_c || level_i == level_c)
+            {
+                return;
+            }
+            release(levels[level_i]);
+        }
+    }
+
+    // Passes on the events before `end_position`.
+    void write_events(std::size_t end_position)
+    {
+        std::size_t write_c = end_position - base_position;
+
+        if (write_c == 0)
+        {
+            return;
+        }
+        for (std::size_t event_i = 0; event_i < write_c; ++event_i)
+        {
+            write_event(events[event_i]);
+        }
+        std::rotate(events.begin(), events.begin() + write_c, events.begin() + event_c);
+        event_c -= write_c;
+        base_position += write_c;
+    }
+
+    void write_event(Event &event)
+    {
+        switch (event.type)
+        {
+            case message_event:
+                target.write_message(event.text);
+                break;
+            case html_event:
+                target.write_html(event.text);
+                break;
+            case dump_event:
+                target.dump_values(event.names, get_formatted_values(event), event.value_c);
+                break;
+            case function_entry_event:
+                target.log_function_entry_values(
+                    event.function_info, get_formatted_values(event), event.value_c);
+                break;
+            case enter_function_event:
+                target.enter_function();
+                break;
+            case function_exit_event:
+                target.log_function_exit(event.function_info);
+                break;
+            case exit_function_event:
+                target.exit_function();
+                break;
+        }
+    }
+
+    ValueFormatterI *const * get_formatted_values(const Event &event)
+    {
+        if (formatted_values.size() < event.value_c + 1)
+        {
+            formatted_values.resize(event.value_c + 1);
+            formatted_value_pointers.clear();
+            for (FormattedValue &value : formatted_values)
+            {
+                formatted_value_pointers.push_back(&value);
+            }
+        }
+        for (std::size_t value_i = 0; value_i < event.value_c; ++value_i)
+        {
+            formatted_values[value_i].text = &event.values[value_i];
+        }
+
+        return formatted_value_pointers.data();
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_REPETITION_COLLAPSING_FORMATTER_H
@@ -0,0 +1,589 @@
+#ifndef _OPERATION_LOG_SAMPLING_PROFILER_H
+#define _OPERATION_LOG_SAMPLING_PROFILER_H
+
+#include <signal.h>
+#include <time.h>
+
+#ifdef __linux__
+#    include <sys/syscall.h>
+#    include <unistd.h>
+// (Older C libraries don't name the thread ID of a `sigevent`.)
+#    ifndef sigev_notify_thread_id
+#        define sigev_notify_thread_id _sigev_un._tid
+#    endif // sigev_notify_thread_id
+#endif // __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "call_site.h"
+#include "heap_accounting.h"
+
+
+// The number of the outermost logged functions recorded in a sample:
+#ifndef OPERATION_LOG_SAMPLED_STACK_DEPTH
+#    define OPERATION_LOG_SAMPLED_STACK_DEPTH 64
+#endif // OPERATION_LOG_SAMPLED_STACK_DEPTH
+
+// The number of samples buffered until they're collected:
+#ifndef OPERATION_LOG_SAMPLE_CAPACITY
+#    define OPERATION_LOG_SAMPLE_CAPACITY 4096
+#endif // OPERATION_LOG_SAMPLE_CAPACITY
+
+
+namespace operation_log
+{
+
+// The number of samples taken in a call stack of logged functions (see
+// `SamplingProfiler::list_stacks()`).
+struct SampledStack
+{
+    // From the outermost function to the innermost:
+    std::vector<std::string> function_names;
+    long long sample_c;
+};
+
+// A statistical profiler, which samples the stack of logged functions
+// (`FunctionEntry`s with a `CallSite`, and instrumented functions) each
+// thread is in, at a fixed interval of the thread's CPU time.
+//
+// While the profiler is started, each logged function pushes its call site
+// onto a thread-local stack when it's entered, and pops it when it exits,
+// whether its call site is enabled, or not.  So, with logging switched off
+// (e.g., by `CallSiteRegistry::set_master_enabled()`), a logged function
+// costs a push, and a pop.
+//
+// Each thread, which enters a logged function after the profiler is started,
+// gets a `timer_create()` timer over its CPU time, which sends it `SIGPROF`.
+// The signal handler copies the thread's stack into a lock-free buffer of
+// `OPERATION_LOG_SAMPLE_CAPACITY` samples, without locking, or allocating.
+// `collect()` moves the buffered samples into the profile (and `stop()`, and
+// the methods, which write the profile, call it).  Samples taken when the
+// buffer is full are dropped (see `get_dropped_sample_count()`), so long
+// runs should call `collect()` periodically.
+//
+// The `SIGPROF` handler stays installed after the profiler is stopped.  The
+// profiler is only available on Linux.
+class SamplingProfiler
+{
+public:
+    static const int max_depth = OPERATION_LOG_SAMPLED_STACK_DEPTH;
+    static const int sample_capacity = OPERATION_LOG_SAMPLE_CAPACITY;
+
+    static_assert(
+        (sample_capacity & (sample_capacity - 1)) == 0,
+        "The sample capacity must be a power of 2.");
+
+    static bool is_active()
+    {
+        return get_control().is_active.load(std::memory_order_relaxed);
+    }
+
+    // Starts sampling every `interval_us` microseconds of each thread's CPU
+    // time.  Returns whether the profiler could be started.
+    static bool start(long interval_us = 1000)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Control &control = get_control();
+
+        {
+            std::lock_guard<std::mutex> lock(control.mutex);
+
+            if (control.is_active.load(std::memory_order_relaxed))
+            {
+                return true;
+            }
+#ifdef __linux__
+            if (!control.samples.load(std::memory_order_relaxed))
+            {
+                Sample *samples = new Sample[sample_capacity];
+
+                for (int sample_i = 0; sample_i < sample_capacity; ++sample_i)
+                {
+                    samples[sample_i].sequence.store(
+                        static_cast<std::size_t>(sample_i), std::memory_order_relaxed);
+                }
+                control.samples.store(samples, std::memory_order_release);
+
+                struct sigaction action;
+
+                std::memset(&action, 0, sizeof(action));
+                action.sa_handler = &handle_signal;
+                action.sa_flags = SA_RESTART;
+                sigemptyset(&action.sa_mask);
+                if (sigaction(SIGPROF, &action, nullptr) != 0)
+                {
+                    std::cerr << "operation_log: Can't handle SIGPROF: " <<
+                        std::strerror(errno) << std::endl;
+
+                    return false;
+                }
+            }
+            control.interval_us = interval_us;
+            control.generation.fetch_add(1, std::memory_order_relaxed);
+            control.is_active.store(true, std::memory_order_relaxed);
+#else // __linux__
+            std::cerr << "operation_log: The sampling profiler is only "
+                "available on Linux." << std::endl;
+
+            return false;
+#endif // __linux__
+        }
+        attach_thread(get_thread_state());
+
+        return true;
+    }
+
+    // Stops sampling, and collects the buffered samples.
+    static void stop()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Control &control = get_control();
+
+        {
+            std::lock_guard<std::mutex> lock(control.mutex);
+
+            control.is_active.store(false, std::memory_order_relaxed);
+            control.generation.fetch_add(1, std::memory_order_relaxed);
+#ifdef __linux__
+            for (timer_t timer : control.timers)
+            {
+                timer_delete(timer);
+            }
+#endif // __linux__
+            control.timers.clear();
+        }
+        collect();
+    }
+
+    // Records entering a logged function.  (It's called by `FunctionEntry`,
+    // and the instrumented function hooks, when the profiler is active.)
+    static void push(CallSite &site)
+    {
+        ThreadState &state = get_thread_state();
+
+        if (__builtin_expect(
+            state.generation != get_control().generation.load(std::memory_order_relaxed), 0))
+        {
+            attach_thread(state);
+        }
+        if (state.depth < max_depth)
+        {
+            state.sites[state.depth] = &site;
+        }
+        // The signal handler, which interrupts this thread, must see the
+        // site before the depth:
+        std::atomic_signal_fence(std::memory_order_release);
+        ++state.depth;
+        std::atomic_signal_fence(std::memory_order_release);
+    }
+
+    // Records exiting the innermost logged function.
+    static void pop()
+    {
+        ThreadState &state = get_thread_state();
+
+        --state.depth;
+        std::atomic_signal_fence(std::memory_order_release);
+    }
+
+    // Moves the buffered samples into the profile.
+    static void collect()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Control &control = get_control();
+        Sample *samples = control.samples.load(std::memory_order_acquire);
+
+        if (!samples)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(control.mutex);
+        std::vector<CallSite*> stack;
+
+        for (;;)
+        {
+            std::size_t position = control.read_position;
+            Sample &sample = samples[position & (sample_capacity - 1)];
+
+            if (sample.sequence.load(std::memory_order_acquire) != position + 1)
+            {
+                // It's empty, or the sample is still being written.
+                break;
+            }
+            stack.assign(sample.sites, sample.sites + sample.depth);
+            ++control.stacks[stack];
+            sample.sequence.store(position + sample_capacity, std::memory_order_release);
+            control.read_position = position + 1;
+        }
+    }
+
+    // Returns the number of collected samples.
+    static long long get_sample_count()
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Control &control = get_control();
+        std::lock_guard<std::mutex> lock(control.mutex);
+        long long res = 0;
+
+        for (const auto &stack_and_count : control.stacks)
+        {
+            res += stack_and_count.second;
+        }
+
+        return res;
+    }
+
+    // Returns the number of samples, which were dropped, because the buffer
+    // was full.
+    static long long get_dropped_sample_count()
+    {
+        return get_control().dropped_sample_c.load(std::memory_order_relaxed);
+    }
+
+    // Returns the sample counts of each collected stack of function names.
+    // (Stacks of different call sites in the same functions are merged.)  A
+    // sample taken outside of logged functions has no function names.
+    static std::vector<SampledStack> list_stacks()
+    {
+        collect();
+
+        HeapAccounting::Pause heap_accounting_pause;
+        Control &control = get_control();
+        std::map<std::vector<std::string>, long long> named_stacks;
+
+        {
+            std::lock_guard<std::mutex> lock(control.mutex);
+
+            for (const auto &stack_and_count : control.stacks)
+            {
+                std::vector<std::string> function_names;
+
+                function_names.reserve(stack_and_count.first.size());
+                for (CallSite *site : stack_and_count.first)
+                {
+                    function_names.push_back(site->get_function_info().get_full_name());
+                }
+                named_stacks[function_names] += stack_and_count.second;
+            }
+        }
+
+        std::vector<SampledStack> res;
+
+        res.reserve(named_stacks.size());
+        for (const auto &names_and_count : named_stacks)
+        {
+            res.push_back(SampledStack { names_and_count.first, names_and_count.second });
+        }
+
+        return res;
+    }
+
+    // Writes the profile as folded stacks (a line per stack, with its
+    // function names separated by `;`, and its sample count), which flame
+    // graph tools read.
+    static void write_folded_stacks(std::ostream &out)
+    {
+        std::vector<SampledStack> stacks = list_stacks();
+        HeapAccounting::Pause heap_accounting_pause;
+
+        for (const SampledStack &stack : stacks)
+        {
+            if (stack.function_names.empty())
+            {
+                out << outside_name;
+            }
+            for (std::size_t name_i = 0; name_i < stack.function_names.size(); ++name_i)
+            {
+                out << (name_i > 0 ? ";" : "") << stack.function_names[name_i];
+            }
+            out << " " << stack.sample_c << "\n";
+        }
+        out.flush();
+    }
+
+    // Writes the profile as a call tree with the samples taken in each
+    // function, including (`samples`), and excluding (`self`) its callees.
+    // The callees of each function are written by their samples, in
+    // descending order.
+    static void write_call_tree(std::ostream &out)
+    {
+        std::vector<SampledStack> stacks = list_stacks();
+        HeapAccounting::Pause heap_accounting_pause;
+        CallTreeCounts counts;
+
+        for (const SampledStack &stack : stacks)
+        {
+            std::vector<std::string> path;
+
+            if (stack.function_names.empty())
+            {
+                path.push_back(outside_name);
+            }
+            else
+            {
+                path = stack.function_names;
+            }
+            counts.total_c += stack.sample_c;
+            counts.self_counts[path] += stack.sample_c;
+            while (!path.empty())
+            {
+                counts.inclusive_counts[path] += stack.sample_c;
+                path.pop_back();
+            }
+        }
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << std::setw(10) << "samples" << std::setw(8) << "%" <<
+            std::setw(10) << "self" << "  function" << std::endl;
+        out << std::fixed << std::setprecision(1);
+        write_subtree(out, counts, std::vector<std::string>());
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    // Forgets the collected samples.
+    static void reset()
+    {
+        collect();
+
+        HeapAccounting::Pause heap_accounting_pause;
+        Control &control = get_control();
+        std::lock_guard<std::mutex> lock(control.mutex);
+
+        control.stacks.clear();
+        control.dropped_sample_c.store(0, std::memory_order_relaxed);
+    }
+
+    // Forgets the parent's samples, and timers in a child process (see
+    // `ForkHandling`).  Timers aren't inherited, so the forking thread
+    // creates one the next time it enters a logged function.
+    static void reset_after_fork()
+    {
+        Control &control = get_control();
+
+        // Another thread of the parent may have held the mutex:
+        new (&control.mutex) std::mutex();
+        control.timers.clear();
+        control.generation.fetch_add(1, std::memory_order_relaxed);
+        reset();
+    }
+
+private:
+    static constexpr const char *outside_name = "[outside logged functions]";
+
+    // A buffered sample.  The buffer is a bounded lock-free queue (with a
+    // sequence number in each slot, as in Dmitry Vyukov's MPMC queue), which
+    // the signal handlers only try to write to.
+    struct Sample
+    {
+        std::atomic<std::size_t> sequence;
+        int depth;
+        CallSite *sites[max_depth];
+    };
+
+    // The logged functions a thread is in.  It's trivially constructible, so
+    // it's accessed without a thread-local initialization guard (and the
+    // signal handler can use it).
+    struct ThreadState
+    {
+        int depth;
+        // The `Control::generation` the thread's timer was created in:
+        unsigned generation;
+        CallSite *sites[max_depth];
+    };
+
+    struct Control
+    {
+        std::atomic<bool> is_active;
+        // Changed when the profiler is started, or stopped, so threads
+        // create their timers the next time they enter a logged function:
+        std::atomic<unsigned> generation;
+        std::atomic<Sample*> samples;
+        std::atomic<std::size_t> write_position;
+        std::atomic<long long> dropped_sample_c;
+        // The rest is protected by the mutex:
+        std::mutex mutex;
+        long interval_us = 1000;
+        std::size_t read_position = 0;
+#ifdef __linux__
+        std::vector<timer_t> timers;
+#else // __linux__
+        std::vector<int> timers;
+#endif // __linux__
+        std::map<std::vector<CallSite*>, long long> stacks;
+
+        Control()
+        : is_active(false),
+        generation(0),
+        samples(nullptr),
+        write_position(0),
+        dropped_sample_c(0)
+        {}
+    };
+
+    struct CallTreeCounts
+    {
+        long long total_c = 0;
+        std::map<std::vector<std::string>, long long> inclusive_counts;
+        std::map<std::vector<std::string>, long long> self_counts;
+    };
+
+    static ThreadState& get_thread_state()
+    {
+        static thread_local ThreadState state;
+
+        return state;
+    }
+
+    static Control& get_control()
+    {
+        static Control control;
+
+        return control;
+    }
+
+    // Creates a timer for the current thread, if the profiler is active.
+    static void attach_thread(ThreadState &state)
+    {
+        HeapAccounting::Pause heap_accounting_pause;
+        Control &control = get_control();
+        std::lock_guard<std::mutex> lock(control.mutex);
+
+        state.generation = control.generation.load(std::memory_order_relaxed);
+        if (!control.is_active.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+#ifdef __linux__
+        sigevent event;
+        timer_t timer;
+
+        std::memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+        if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) != 0)
+        {
+            std::cerr << "operation_log: Can't create a profiling timer: " <<
+                std::strerror(errno) << std::endl;
+
+            return;
+        }
+
+        itimerspec spec;
+
+        spec.it_interval.tv_sec = control.interval_us / 1000000;
+        spec.it_interval.tv_nsec = (control.interval_us % 1000000) * 1000;
+        spec.it_value = spec.it_interval;
+        timer_settime(timer, 0, &spec, nullptr);
+        control.timers.push_back(timer);
+#endif // __linux__
+    }
+
+    // Copies the interrupted thread's stack into the buffer.  It only uses
+    // atomics, so it's async-signal-safe.
+    static void handle_signal(int)
+    {
+        int saved_errno = errno;
+        Control &control = get_control();
+        Sample *samples = control.samples.load(std::memory_order_acquire);
+        const ThreadState &state = get_thread_state();
+
+        std::atomic_signal_fence(std::memory_order_acquire);
+        if (samples)
+        {
+            std::size_t position = control.write_position.load(std::memory_order_relaxed);
+            Sample *sample;
+
+            for (;;)
+            {
+                sample = &samples[position & (sample_capacity - 1)];
+
+                std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(
+                    sample->sequence.load(std::memory_order_acquire) - position);
+
+                if (difference == 0)
+                {
+                    if (control.write_position.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // The buffer is full.
+                    control.dropped_sample_c.fetch_add(1, std::memory_order_relaxed);
+                    sample = nullptr;
+                    break;
+                }
+                else
+                {
+                    position = control.write_position.load(std::memory_order_relaxed);
+                }
+            }
+            if (sample)
+            {
+                sample->depth = std::min(std::max(state.depth, 0), static_cast<int>(max_depth));
+                std::copy(state.sites, state.sites + sample->depth, sample->sites);
+                sample->sequence.store(position + 1, std::memory_order_release);
+            }
+        }
+        errno = saved_errno;
+    }
+
+    static void write_subtree(
+        std::ostream &out, const CallTreeCounts &counts, const std::vector<std::string> &path)
+    {
+        // The children of a path follow it in the map, before its siblings:
+        std::vector<std::pair<long long, const std::vector<std::string>*>> children;
+
+        for (auto found = counts.inclusive_counts.upper_bound(path);
+            found != counts.inclusive_counts.end() &&
+                found->first.size() > path.size() &&
+                std::equal(path.begin(), path.end(), found->first.begin());
+            ++found)
+        {
+            if (found->first.size() == path.size() + 1)
+            {
+                children.push_back(std::make_pair(found->second, &found->first));
+            }
+        }
+        std::stable_sort(
+            children.begin(), children.end(),
+            [](const std::pair<long long, const std::vector<std::string>*> &a,
+                const std::pair<long long, const std::vector<std::string>*> &b)
+            {
+                return a.first > b.first;
+            });
+        for (const auto &child : children)
+        {
+            auto found_self = counts.self_counts.find(*child.second);
+
+            out << std::setw(10) << child.first <<
+                std::setw(7) << 100.0 * child.first / counts.total_c << "%" <<
+                std::setw(10) << (found_self == counts.self_counts.end() ? 0 : found_self->second) <<
+                "  " << std::string(2 * path.size(), ' ') << child.second->back() << std::endl;
+            write_subtree(out, counts, *child.second);
+        }
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_SAMPLING_PROFILER_H
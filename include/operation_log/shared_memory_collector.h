@@ -0,0 +1,504 @@
+#ifndef _OPERATION_LOG_SHARED_MEMORY_COLLECTOR_H
+#define _OPERATION_LOG_SHARED_MEMORY_COLLECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "blob.h"
+#include "formatter_base.h"
+#include "function_info.h"
+#include "html_utils.h"
+#include "shared_memory_ring.h"
+#include "string_ref.h"
+#include "value_capture.h"
+#include "value_formatter.h"
+#include "value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// Drains a shared memory ring, which another process logs to with a
+// `SharedMemoryFormatter`, and passes its events to a formatter (see
+// `tools/operation_log_collector`).
+//
+// When the producer has dropped events, because the ring was full, a message
+// with their number is written before the next event.  Function exits, whose
+// entries weren't collected (e.g., they were logged before the collector
+// attached), are skipped, so they don't close the enclosing functions.  The strings, which the
+// producer defined with ids, are kept, so the events, which refer to them,
+// are written with their full text.  Use it like:
+//
+//     operation_log::PlainTextFormatter formatter(std::cout);
+//     operation_log::SharedMemoryCollector collector(formatter);
+//     std::string error;
+//
+//     if (collector.attach("/my_log", error))
+//     {
+//         while (!collector.is_producer_closed())
+//         {
+//             if (collector.drain() == 0)
+//             {
+//                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
+//             }
+//         }
+//         collector.drain();
+//     }
+class SharedMemoryCollector
+{
+public:
+    explicit SharedMemoryCollector(FormatterBase &target)
+    : target(target)
+    {}
+
+    SharedMemoryCollector(const SharedMemoryCollector &) = delete;
+    SharedMemoryCollector& operator=(const SharedMemoryCollector &) = delete;
+
+    bool attach(const std::string &name, std::string &error)
+    {
+        reported_overrun_record_c = 0;
+
+        return ring.attach(name, error);
+    }
+
+    bool is_attached() const
+    {
+        return ring.is_mapped();
+    }
+
+    // Returns whether the producer has closed the log.  (Only the records,
+    // which are in the ring, are left.)
+    bool is_producer_closed()
+    {
+        return ring.get_header().state.load(std::memory_order_acquire) ==
+            SharedMemoryRing::state_closed;
+    }
+
+    bool is_producer_alive()
+    {
+        return ring.is_producer_alive();
+    }
+
+    std::uint64_t get_overrun_record_count()
+    {
+        return ring.get_header().overrun_record_c.load(std::memory_order_relaxed);
+    }
+
+    // Returns the number of bytes, which producers have reserved, but not
+    // committed yet.  (If the producer has exited, those records are lost.)
+    std::uint64_t get_pending_byte_count()
+    {
+        SharedMemoryRing::Header &header = ring.get_header();
+
+        return header.reserve_position.load(std::memory_order_acquire) -
+            header.read_position.load(std::memory_order_relaxed);
+    }
+
+    // Passes the committed records to the target formatter, and returns their
+    // number.  It stops at the first record, which isn't committed yet.
+    std::size_t drain()
+    {
+        SharedMemoryRing::Header &header = ring.get_header();
+        std::uint64_t read_position = header.read_position.load(std::memory_order_relaxed);
+        std::size_t record_c = 0;
+
+        while (true)
+        {
+            char *record = ring.at(read_position);
+            SharedMemoryRing::RecordHeader *record_header =
+                reinterpret_cast<SharedMemoryRing::RecordHeader*>(record);
+            std::uint32_t size = record_header->size.load(std::memory_order_acquire);
+
+            if (size == 0)
+            {
+                break;
+            }
+            if (record_header->type != SharedMemoryRing::record_padding)
+            {
+                write_overruns();
+                replay(record);
+                ++record_c;
+            }
+
+            // Free the space (a record, which is reserved later, is committed
+            // by storing its size over these zeros):
+            std::memset(record, 0, size);
+            read_position += size;
+            header.read_position.store(read_position, std::memory_order_release);
+        }
+        if (is_producer_closed())
+        {
+            write_overruns();
+        }
+
+        return record_c;
+    }
+
+private:
+    // Formats a value from the bytes in a record.
+    class RecordValueFormatter : public ValueFormatterI
+    {
+    public:
+        // `nullptr` for text, which was formatted by the producer:
+        const CapturedValueType *type;
+        const char *bytes;
+        std::size_t size;
+
+        std::string to_text() override
+        {
+            std::stringstream res;
+
+            write_text(res);
+
+            return res.str();
+        }
+
+        std::string to_html() override
+        {
+            std::stringstream res;
+
+            write_html(res);
+
+            return res.str();
+        }
+
+        void write_text(std::ostream &out) override
+        {
+            if (type)
+            {
+                type->write_text(bytes, size, out);
+            }
+            else
+            {
+                out.write(bytes, size);
+            }
+        }
+
+        void write_html(std::ostream &out) override
+        {
+            if (type)
+            {
+                type->write_html(bytes, size, out);
+            }
+            else
+            {
+                HtmlUtils::write_escaped(out, bytes, size);
+            }
+        }
+
+        bool capture(ValueCaptureSinkI &sink) override
+        {
+            if (!type)
+            {
+                return false;
+            }
+            std::memcpy(sink.add_value(*type, size), bytes, size);
+
+            return true;
+        }
+    };
+
+    FormatterBase &target;
+    SharedMemoryRing ring;
+    std::uint64_t reported_overrun_record_c = 0;
+    // The functions, by their serialized parts:
+    std::map<std::string, FunctionInfo> function_infos;
+    // The defined strings, by their ids:
+    std::unordered_map<std::uint32_t, FunctionInfo> defined_functions;
+    std::unordered_map<std::uint32_t, std::vector<std::string>> defined_names;
+    std::unordered_set<BlobId, BlobId::Hash> written_blob_ids;
+    std::vector<std::string> replayed_names;
+    std::vector<RecordValueFormatter> replayed_values;
+    std::vector<ValueFormatterI*> replayed_value_pointers;
+    // The numbers of replayed function entries, and entered functions, which
+    // haven't exited yet:
+    std::size_t open_function_entry_c = 0;
+    std::size_t entered_function_c = 0;
+
+    void write_overruns()
+    {
+        std::uint64_t overrun_record_c = get_overrun_record_count();
+
+        if (overrun_record_c == reported_overrun_record_c)
+        {
+            return;
+        }
+
+        std::stringstream message;
+
+        message << "[operation_log: " << overrun_record_c - reported_overrun_record_c <<
+            " events were dropped, because the shared memory ring was full.]";
+        target.write_message(message.str());
+        reported_overrun_record_c = overrun_record_c;
+    }
+
+    // Passes a record to the target formatter.
+    void replay(const char *record)
+    {
+        const SharedMemoryRing::RecordHeader &header =
+            *reinterpret_cast<const SharedMemoryRing::RecordHeader*>(record);
+        const char *p = record + sizeof(SharedMemoryRing::RecordHeader);
+
+        switch (header.type)
+        {
+            case SharedMemoryRing::record_message:
+                target.write_message(read_string(p));
+                break;
+            case SharedMemoryRing::record_html:
+                target.write_html(read_string(p));
+                break;
+            case SharedMemoryRing::record_dump_values:
+                replayed_names.resize(header.value_count);
+                for (std::string &name : replayed_names)
+                {
+                    StringRef value = read_string(p);
+
+                    name.assign(value.data(), value.size());
+                }
+                read_values(p, header.value_count);
+                target.dump_values(
+                    replayed_names, replayed_value_pointers.data(), header.value_count);
+                break;
+            case SharedMemoryRing::record_function_entry:
+            {
+                const FunctionInfo &function_info = read_function_info(p);
+
+                read_values(p, header.value_count);
+                target.log_function_entry_values(
+                    function_info, replayed_value_pointers.data(), header.value_count);
+                ++open_function_entry_c;
+                break;
+            }
+            case SharedMemoryRing::record_enter_function:
+                target.enter_function();
+                ++entered_function_c;
+                break;
+            case SharedMemoryRing::record_function_exit:
+            {
+                const FunctionInfo &function_info = read_function_info(p);
+
+                if (open_function_entry_c > 0)
+                {
+                    target.log_function_exit(function_info);
+                    --open_function_entry_c;
+                }
+                break;
+            }
+            case SharedMemoryRing::record_exit_function:
+                if (entered_function_c > 0)
+                {
+                    target.exit_function();
+                    --entered_function_c;
+                }
+                break;
+            case SharedMemoryRing::record_blob:
+                replay_blob(p);
+                break;
+            case SharedMemoryRing::record_define_function:
+            {
+                std::uint32_t id = read_id(p);
+
+                defined_functions[id] = read_function_info(p);
+                break;
+            }
+            case SharedMemoryRing::record_define_names:
+            {
+                std::uint32_t id = read_id(p);
+
+                defined_names[id] = read_strings(p);
+                break;
+            }
+            case SharedMemoryRing::record_dump_values_by_id:
+            {
+                const std::vector<std::string> *names = find_defined(defined_names, read_id(p));
+
+                if (names)
+                {
+                    read_values(p, header.value_count);
+                    target.dump_values(
+                        *names, replayed_value_pointers.data(), header.value_count);
+                }
+                break;
+            }
+            case SharedMemoryRing::record_function_entry_by_id:
+            {
+                const FunctionInfo *function_info = find_defined(defined_functions, read_id(p));
+
+                if (function_info)
+                {
+                    read_values(p, header.value_count);
+                    target.log_function_entry_values(
+                        *function_info, replayed_value_pointers.data(), header.value_count);
+                    ++open_function_entry_c;
+                }
+                break;
+            }
+            case SharedMemoryRing::record_function_exit_by_id:
+            {
+                const FunctionInfo *function_info = find_defined(defined_functions, read_id(p));
+
+                if (function_info && open_function_entry_c > 0)
+                {
+                    target.log_function_exit(*function_info);
+                    --open_function_entry_c;
+                }
+                break;
+            }
+        }
+    }
+
+    // Returns the strings with the id, or `nullptr`, if they weren't defined
+    // (the producer only refers to strings, whose definition it has written,
+    // but a collector may have missed it).
+    template<typename T>
+    static const T* find_defined(
+        const std::unordered_map<std::uint32_t, T> &defined, std::uint32_t id)
+    {
+        typename std::unordered_map<std::uint32_t, T>::const_iterator found = defined.find(id);
+
+        return found != defined.end() ? &found->second : nullptr;
+    }
+
+    // A delta is only passed on, if its base was (it may have been dropped).
+    void replay_blob(const char *p)
+    {
+        Blob blob;
+
+        std::memcpy(&blob.id, read_string(p).data(), sizeof(BlobId));
+        std::memcpy(&blob.base_id, read_string(p).data(), sizeof(BlobId));
+        blob.data = read_string(p);
+        blob.delta = read_string(p);
+        if (!blob.base_id.is_null() && written_blob_ids.count(blob.base_id) == 0)
+        {
+            if (blob.data.size() == 0)
+            {
+                return;
+            }
+            blob.base_id = BlobId();
+            blob.delta = StringRef();
+        }
+        written_blob_ids.insert(blob.id);
+        target.write_blob(blob);
+    }
+
+    const FunctionInfo& read_function_info(const char *&p)
+    {
+        const char *begin = p;
+        std::string return_type = read_string(p).str();
+        std::string full_name = read_string(p).str();
+        std::string short_name = read_string(p).str();
+        std::vector<std::string> argument_types = read_strings(p);
+        std::vector<std::string> argument_names = read_strings(p);
+        std::string extra_information = read_string(p).str();
+        std::string key(begin, p - begin);
+        std::map<std::string, FunctionInfo>::iterator found = function_infos.find(key);
+
+        if (found == function_infos.end())
+        {
+            found = function_infos.insert(std::make_pair(
+                key,
+                FunctionInfo::from_parts(
+                    return_type, full_name, short_name, argument_types, argument_names,
+                    extra_information))).first;
+        }
+
+        return found->second;
+    }
+
+    void read_values(const char *&p, std::size_t value_count)
+    {
+        replayed_values.resize(value_count);
+        replayed_value_pointers.resize(value_count);
+        for (std::size_t value_i = 0; value_i < value_count; ++value_i)
+        {
+            SharedMemoryRing::ValueHeader value_header;
+            RecordValueFormatter &value = replayed_values[value_i];
+
+            std::memcpy(&value_header, p, sizeof(value_header));
+            p += SharedMemoryRing::align(sizeof(value_header));
+            value.type = get_captured_type(value_header.tag);
+            value.bytes = p;
+            value.size = value_header.size;
+            p += SharedMemoryRing::align(value_header.size);
+            replayed_value_pointers[value_i] = &value;
+        }
+    }
+
+    static const CapturedValueType* get_captured_type(std::uint32_t tag)
+    {
+        static const CapturedValueType *types[] = {
+            nullptr,
+            &CapturedValueTypeOf<bool>::type,
+            &CapturedValueTypeOf<char>::type,
+            &CapturedValueTypeOf<signed char>::type,
+            &CapturedValueTypeOf<unsigned char>::type,
+            &CapturedValueTypeOf<short>::type,
+            &CapturedValueTypeOf<unsigned short>::type,
+            &CapturedValueTypeOf<int>::type,
+            &CapturedValueTypeOf<unsigned int>::type,
+            &CapturedValueTypeOf<long>::type,
+            &CapturedValueTypeOf<unsigned long>::type,
+            &CapturedValueTypeOf<long long>::type,
+            &CapturedValueTypeOf<unsigned long long>::type,
+            &CapturedValueTypeOf<float>::type,
+            &CapturedValueTypeOf<double>::type,
+            &CapturedValueTypeOf<long double>::type,
+            &CapturedValueTypeOf<std::string>::type,
+            &CapturedValueTypeOf<const char*>::type
+        };
+
+        return tag < sizeof(types) / sizeof(types[0]) ? types[tag] : nullptr;
+    }
+
+    static std::uint32_t read_id(const char *&p)
+    {
+        std::uint64_t id;
+
+        std::memcpy(&id, p, sizeof(id));
+        p += SharedMemoryRing::align(sizeof(id));
+
+        return static_cast<std::uint32_t>(id);
+    }
+
+    static StringRef read_string(const char *&p)
+    {
+        std::uint64_t size;
+
+        std::memcpy(&size, p, sizeof(size));
+
+        const char *data = p + SharedMemoryRing::align(sizeof(size));
+
+        p = data + SharedMemoryRing::align(static_cast<std::size_t>(size));
+
+        return StringRef(data, static_cast<std::size_t>(size));
+    }
+
+    static std::vector<std::string> read_strings(const char *&p)
+    {
+        std::uint64_t count;
+
+        std::memcpy(&count, p, sizeof(count));
+        p += SharedMemoryRing::align(sizeof(count));
+
+        std::vector<std::string> res;
+
+        res.reserve(static_cast<std::size_t>(count));
+        for (std::uint64_t string_i = 0; string_i < count; ++string_i)
+        {
+            res.push_back(read_string(p).str());
+        }
+
+        return res;
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_SHARED_MEMORY_COLLECTOR_H
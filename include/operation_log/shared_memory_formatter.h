@@ -0,0 +1,843 @@
+#ifndef _OPERATION_LOG_SHARED_MEMORY_FORMATTER_H
+#define _OPERATION_LOG_SHARED_MEMORY_FORMATTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "blob.h"
+#include "formatter_base.h"
+#include "function_info.h"
+#include "message_stream_pool.h"
+#include "shared_memory_ring.h"
+#include "string_ref.h"
+#include "value_capture.h"
+#include "value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// A formatter which writes log events as binary records to a shared memory
+// ring (see `SharedMemoryRing`), so another process formats, and writes them
+// (see `tools/operation_log_collector`).
+//
+// Values of arithmetic types, and strings are copied as they are, and
+// formatted by the collector.  Other values are formatted as plain text right
+// away.  (The collector escapes them for HTML formatters.)
+//
+// Events are never waited for: when the collector falls behind, and an event
+// doesn't fit in the ring, it's dropped, and counted (see
+// `get_overrun_record_count()`), and the collector logs how many events were
+// dropped.  A function's exit records are dropped with its entry records,
+// and an exit record, whose entry was sent, is kept, and sent before the
+// thread's next event, when it doesn't fit, so the collected log stays
+// nested.  Destroying the formatter marks the log closed, so the collector
+// exits once it has drained the ring.  (The collector removes the shared
+// memory object.)
+//
+// The strings of a call site (its function's name, and argument names, or
+// the names of dumped variables) are sent once, with an id, and its events
+// only carry the id, and the values (see `set_strings_interned()`).  Use it
+// like:
+//
+//     static operation_log::SharedMemoryFormatter formatter("/my_log");
+//
+//     log.set_formatter(formatter);
+class SharedMemoryFormatter : public FormatterBase
+{
+public:
+    SharedMemoryFormatter(
+        const std::string &name,
+        std::size_t capacity = SharedMemoryRing::default_capacity)
+    : FormatterBase(get_null_stream()),
+    name(name)
+    {
+        std::string error;
+
+        if (!ring.create(name, capacity, error))
+        {
+            std::cerr << "operation_log: " << error << std::endl;
+        }
+    }
+
+    SharedMemoryFormatter(const SharedMemoryFormatter &) = delete;
+    SharedMemoryFormatter& operator=(const SharedMemoryFormatter &) = delete;
+
+    ~SharedMemoryFormatter()
+    {
+        close();
+    }
+
+    // Marks the log closed, so the collector exits, once it has written the
+    // events.  (Events, which are logged later, are dropped.)
+    void close()
+    {
+        if (ring.is_mapped() && !is_inherited)
+        {
+            ring.get_header().state.store(
+                SharedMemoryRing::state_closed, std::memory_order_release);
+        }
+    }
+
+    const std::string& get_name() const
+    {
+        return name;
+    }
+
+    // Returns whether the shared memory ring could be created.
+    bool is_open() const
+    {
+        return ring.is_mapped();
+    }
+
+    // Returns the number of events, which were dropped, because they didn't
+    // fit in the ring.
+    std::uint64_t get_overrun_record_count()
+    {
+        return ring.is_mapped() ?
+            ring.get_header().overrun_record_c.load(std::memory_order_relaxed) : 0;
+    }
+
+    // Sets whether the strings of call sites are sent once (the default), or
+    // with each event.  Messages are always sent with their text.
+    void set_strings_interned(bool are_interned)
+    {
+        are_strings_interned = are_interned;
+    }
+
+    void write_message(StringRef message) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(SharedMemoryRing::record_message, 0);
+        record.add_string(message);
+        publish(record);
+    }
+
+    void write_html(StringRef code) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(SharedMemoryRing::record_html, 0);
+        record.add_string(code);
+        publish(record);
+    }
+
+    void write_blob(const Blob &blob) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(SharedMemoryRing::record_blob, 0);
+        record.add_string(StringRef(reinterpret_cast<const char*>(&blob.id), sizeof(BlobId)));
+        record.add_string(
+            StringRef(reinterpret_cast<const char*>(&blob.base_id), sizeof(BlobId)));
+        record.add_string(blob.data);
+        record.add_string(blob.delta);
+        publish(record);
+    }
+
+    void dump_values(
+        const std::vector<std::string> &names,
+        ValueFormatterI *const *values, std::size_t value_count) override
+    {
+        if (are_strings_interned)
+        {
+            std::uint32_t names_id = get_names_id(names);
+
+            if (names_id == 0)
+            {
+                return;
+            }
+
+            RecordBuilder &record = RecordBuilder::get();
+
+            record.begin(SharedMemoryRing::record_dump_values_by_id, value_count);
+            record.add_id(names_id);
+            add_values(record, values, value_count);
+            publish(record);
+
+            return;
+        }
+
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(SharedMemoryRing::record_dump_values, value_count);
+        for (std::size_t var_i = 0; var_i < value_count; ++var_i)
+        {
+            record.add_string(names[var_i]);
+        }
+        add_values(record, values, value_count);
+        publish(record);
+    }
+
+    void log_function_entry_values(
+        const FunctionInfo &function_info,
+        ValueFormatterI *const *values, std::size_t value_count) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+        ThreadFrames &frames = ThreadFrames::get(number);
+
+        frames.entering_frame = 0;
+        if (are_strings_interned)
+        {
+            std::uint32_t function_id = get_function_id(function_info);
+
+            // (The entry is dropped, when its strings' definition doesn't
+            // fit, and its exit with it.)
+            if (function_id == 0)
+            {
+                return;
+            }
+            record.begin(SharedMemoryRing::record_function_entry_by_id, value_count);
+            record.add_id(function_id);
+        }
+        else
+        {
+            record.begin(SharedMemoryRing::record_function_entry, value_count);
+            record.add_function_info(function_info);
+        }
+        add_values(record, values, value_count);
+        if (publish(record))
+        {
+            frames.entering_frame |= ThreadFrames::function_entry_sent;
+        }
+    }
+
+    void enter_function() override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+        ThreadFrames &frames = ThreadFrames::get(number);
+
+        record.begin(SharedMemoryRing::record_enter_function, 0);
+        if (publish(record))
+        {
+            frames.entering_frame |= ThreadFrames::enter_function_sent;
+        }
+        frames.frames.push_back(frames.entering_frame);
+        frames.entering_frame = 0;
+    }
+
+    void log_function_exit(const FunctionInfo &function_info) override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        if (are_strings_interned)
+        {
+            // The id of a function, whose entry was sent, is known, and the
+            // exit of one, whose entry was dropped, is dropped, too (see
+            // `publish_exit()`), so the exit never defines the strings:
+            std::uint32_t function_id =
+                ThreadFrames::get(number).is_entry_sent(ThreadFrames::function_entry_sent) ?
+                    get_function_id(function_info) : 0;
+
+            record.begin(SharedMemoryRing::record_function_exit_by_id, 0);
+            record.add_id(function_id);
+        }
+        else
+        {
+            record.begin(SharedMemoryRing::record_function_exit, 0);
+            record.add_function_info(function_info);
+        }
+        publish_exit(record, ThreadFrames::function_entry_sent, false);
+    }
+
+    void exit_function() override
+    {
+        RecordBuilder &record = RecordBuilder::get();
+
+        record.begin(SharedMemoryRing::record_exit_function, 0);
+        publish_exit(record, ThreadFrames::enter_function_sent, true);
+    }
+
+    // Keeps another thread from holding the lock of the string ids in the
+    // child process.
+    void prepare_fork() override
+    {
+        string_ids_mutex.lock();
+    }
+
+    void after_fork_in_parent() override
+    {
+        string_ids_mutex.unlock();
+    }
+
+    // The ring stays mapped in a child process, and the events it logs here
+    // go to the parent's collector (with the strings the parent defined),
+    // but only the parent closes the log.
+    void after_fork_in_child() override
+    {
+        string_ids_mutex.unlock();
+        is_inherited = true;
+        // The parent sends its own pending exits, and the child's log starts
+        // at the top level (see `OperationLog::reset_after_fork()`):
+        ThreadFrames::get(number).clear();
+    }
+
+protected:
+    // This formatter passes events on, instead of writing them:
+    void write_message_value(StringRef message) override
+    {}
+
+    void write_dump_var(
+        const std::string &name, ValueFormatterI &value_formatter) override
+    {}
+
+    void write_function_return_type_and_name(
+        const std::string &return_type, const std::string &name) override
+    {}
+
+    void write_function_args_prefix() override
+    {}
+
+    void write_function_args_suffix() override
+    {}
+
+    void write_function_arg(
+        const std::string &type_name, const std::string &parameter_name,
+        ValueFormatterI &value_formatter) override
+    {}
+
+    void write_function_extra_info(const std::string &info) override
+    {}
+
+private:
+    // Builds a record in a per-thread buffer, before it's copied to the ring.
+    class RecordBuilder : public ValueCaptureSinkI
+    {
+    public:
+        std::size_t size = 0;
+
+        static RecordBuilder& get()
+        {
+            static thread_local RecordBuilder instance;
+
+            return instance;
+        }
+
+        const char* data() const
+        {
+            return bytes.data();
+        }
+
+        void begin(SharedMemoryRing::RecordType type, std::size_t value_count)
+        {
+            size = 0;
+
+            SharedMemoryRing::RecordHeader *header =
+                reinterpret_cast<SharedMemoryRing::RecordHeader*>(
+                    add(sizeof(SharedMemoryRing::RecordHeader)));
+
+            header->type = type;
+            header->value_count = static_cast<std::uint16_t>(value_count);
+        }
+
+        void add_string(StringRef value)
+        {
+            std::uint64_t length = value.size();
+
+            std::memcpy(add(sizeof(length)), &length, sizeof(length));
+            std::memcpy(add(value.size()), value.data(), value.size());
+        }
+
+        void add_id(std::uint32_t id)
+        {
+            std::uint64_t value = id;
+
+            std::memcpy(add(sizeof(value)), &value, sizeof(value));
+        }
+
+        void add_strings(const std::vector<std::string> &values)
+        {
+            std::uint64_t count = values.size();
+
+            std::memcpy(add(sizeof(count)), &count, sizeof(count));
+            for (const std::string &value : values)
+            {
+                add_string(value);
+            }
+        }
+
+        void add_function_info(const FunctionInfo &function_info)
+        {
+            add_string(function_info.get_return_type());
+            add_string(function_info.get_full_name());
+            add_string(function_info.get_short_name());
+            add_strings(function_info.get_argument_types());
+            add_strings(function_info.get_argument_names());
+            add_string(function_info.get_extra_information());
+        }
+
+        // Values of types the collector doesn't know are formatted right
+        // away (see `end_value()`).
+        char* add_value(const CapturedValueType &type, std::size_t value_size) override
+        {
+            value_offset = size;
+            captured_type = &type;
+            tag = find_tag(type);
+            add_value_header(tag, value_size);
+
+            return add(value_size);
+        }
+
+        // Adds the text of a value, which couldn't be captured.
+        void add_text_value(StringRef text)
+        {
+            add_value_header(SharedMemoryRing::value_text, text.size());
+            std::memcpy(add(text.size()), text.data(), text.size());
+        }
+
+        // Replaces a captured value of an unknown type with its text.
+        void end_value()
+        {
+            if (tag != SharedMemoryRing::value_text)
+            {
+                return;
+            }
+
+            const SharedMemoryRing::ValueHeader *header =
+                reinterpret_cast<const SharedMemoryRing::ValueHeader*>(
+                    bytes.data() + value_offset);
+            std::string captured(
+                bytes.data() + value_offset + sizeof(SharedMemoryRing::ValueHeader),
+                header->size);
+            MessageStreamPool::Slot &slot = MessageStreamPool::get().acquire();
+
+            captured_type->write_text(captured.data(), captured.size(), slot.stream);
+            size = value_offset;
+            add_text_value(slot.buffer.view());
+            MessageStreamPool::get().release(slot);
+        }
+
+    private:
+        std::vector<char> bytes = std::vector<char>(1024);
+        // The last captured value:
+        std::size_t value_offset = 0;
+        const CapturedValueType *captured_type = nullptr;
+        SharedMemoryRing::ValueTag tag = SharedMemoryRing::value_text;
+
+        // Returns where to write `count` more bytes.
+        char* add(std::size_t count)
+        {
+            std::size_t offset = size;
+
+            size += SharedMemoryRing::align(count);
+            if (size > bytes.size())
+            {
+                bytes.resize(std::max(size, 2 * bytes.size()));
+            }
+
+            return bytes.data() + offset;
+        }
+
+        void add_value_header(SharedMemoryRing::ValueTag value_tag, std::size_t value_size)
+        {
+            SharedMemoryRing::ValueHeader header = {
+                value_tag, static_cast<std::uint32_t>(value_size) };
+
+            std::memcpy(add(sizeof(header)), &header, sizeof(header));
+        }
+
+        static SharedMemoryRing::ValueTag find_tag(const CapturedValueType &type)
+        {
+            struct Entry
+            {
+                const CapturedValueType *type;
+                SharedMemoryRing::ValueTag tag;
+            };
+            static const Entry entries[] = {
+                { &CapturedValueTypeOf<bool>::type, SharedMemoryRing::value_bool },
+                { &CapturedValueTypeOf<char>::type, SharedMemoryRing::value_char },
+                { &CapturedValueTypeOf<signed char>::type, SharedMemoryRing::value_signed_char },
+                { &CapturedValueTypeOf<unsigned char>::type,
+                    SharedMemoryRing::value_unsigned_char },
+                { &CapturedValueTypeOf<short>::type, SharedMemoryRing::value_short },
+                { &CapturedValueTypeOf<unsigned short>::type,
+                    SharedMemoryRing::value_unsigned_short },
+                { &CapturedValueTypeOf<int>::type, SharedMemoryRing::value_int },
+                { &CapturedValueTypeOf<unsigned int>::type, SharedMemoryRing::value_unsigned_int },
+                { &CapturedValueTypeOf<long>::type, SharedMemoryRing::value_long },
+                { &CapturedValueTypeOf<unsigned long>::type,
+                    SharedMemoryRing::value_unsigned_long },
+                { &CapturedValueTypeOf<long long>::type, SharedMemoryRing::value_long_long },
+                { &CapturedValueTypeOf<unsigned long long>::type,
+                    SharedMemoryRing::value_unsigned_long_long },
+                { &CapturedValueTypeOf<float>::type, SharedMemoryRing::value_float },
+                { &CapturedValueTypeOf<double>::type, SharedMemoryRing::value_double },
+                { &CapturedValueTypeOf<long double>::type, SharedMemoryRing::value_long_double },
+                { &CapturedValueTypeOf<std::string>::type, SharedMemoryRing::value_string },
+                { &CapturedValueTypeOf<const char*>::type, SharedMemoryRing::value_c_string },
+                { &CapturedValueTypeOf<char*>::type, SharedMemoryRing::value_c_string }
+            };
+
+            for (const Entry &entry : entries)
+            {
+                if (entry.type == &type)
+                {
+                    return entry.tag;
+                }
+            }
+
+            return SharedMemoryRing::value_text;
+        }
+    };
+
+    // The ids of strings, which this thread has looked up, for the formatter
+    // with the number:
+    struct StringIdCache
+    {
+        struct Names
+        {
+            // (The names are compared, because a vector may be reused for
+            // other names.)
+            std::vector<std::string> names;
+            std::uint32_t id;
+        };
+
+        std::uint64_t formatter_number = 0;
+        std::unordered_map<const void*, std::uint32_t> function_ids;
+        std::unordered_map<const void*, Names> names_ids;
+
+        static StringIdCache& get(std::uint64_t formatter_number)
+        {
+            static thread_local StringIdCache instance;
+
+            if (instance.formatter_number != formatter_number)
+            {
+                instance.formatter_number = formatter_number;
+                instance.function_ids.clear();
+                instance.names_ids.clear();
+            }
+
+            return instance;
+        }
+    };
+
+    // The functions this thread has entered, with which of their entry
+    // records were sent, so only the matching exit records are, and the exit
+    // records, which didn't fit in the ring, for the formatter with the
+    // number:
+    struct ThreadFrames
+    {
+        enum : unsigned char
+        {
+            function_entry_sent = 1,
+            enter_function_sent = 2
+        };
+
+        std::uint64_t formatter_number = 0;
+        std::vector<unsigned char> frames;
+        // The records sent for the function, which is being entered:
+        unsigned char entering_frame = 0;
+        // The exit records, which are sent before the thread's next record:
+        std::vector<std::vector<char>> pending_exits;
+
+        static ThreadFrames& get(std::uint64_t formatter_number)
+        {
+            static thread_local ThreadFrames instance;
+
+            if (instance.formatter_number != formatter_number)
+            {
+                instance.formatter_number = formatter_number;
+                instance.clear();
+            }
+
+            return instance;
+        }
+
+        // Returns whether the innermost function's entry record was sent.
+        // (A function entered before the formatter was set, or before
+        // `fork()`, has no frame.  Its exit is sent as it is.)
+        bool is_entry_sent(unsigned char sent_flag) const
+        {
+            return frames.empty() || (frames.back() & sent_flag);
+        }
+
+        void clear()
+        {
+            frames.clear();
+            entering_frame = 0;
+            pending_exits.clear();
+        }
+    };
+
+    std::string name;
+    SharedMemoryRing ring;
+    bool is_inherited = false;
+    bool are_strings_interned = true;
+    std::uint64_t number = get_next_number();
+    std::mutex string_ids_mutex;
+    // The defined functions (whose copies keep their ids from being reused),
+    // and variable names, with their ids:
+    std::unordered_map<const void*, std::pair<FunctionInfo, std::uint32_t>> function_ids;
+    std::map<std::vector<std::string>, std::uint32_t> names_ids;
+
+    static std::uint64_t get_next_number()
+    {
+        static std::atomic<std::uint64_t> last_number(0);
+
+        return ++last_number;
+    }
+
+    // Returns the id of a function's strings, after defining them, if it's
+    // the first time, or 0, if the definition didn't fit in the ring.  (The
+    // event is dropped then, and the definition is counted as overrun in its
+    // place.)
+    std::uint32_t get_function_id(const FunctionInfo &function_info)
+    {
+        StringIdCache &cache = StringIdCache::get(number);
+        std::unordered_map<const void*, std::uint32_t>::const_iterator cached =
+            cache.function_ids.find(function_info.get_id());
+
+        if (cached != cache.function_ids.end())
+        {
+            return cached->second;
+        }
+
+        std::lock_guard<std::mutex> lock(string_ids_mutex);
+        std::unordered_map<const void*, std::pair<FunctionInfo, std::uint32_t>>::const_iterator
+            found = function_ids.find(function_info.get_id());
+        std::uint32_t id;
+
+        if (found != function_ids.end())
+        {
+            id = found->second.second;
+        }
+        else
+        {
+            id = get_next_string_id();
+            if (id == 0)
+            {
+                return 0;
+            }
+
+            RecordBuilder &record = RecordBuilder::get();
+
+            record.begin(SharedMemoryRing::record_define_function, 0);
+            record.add_id(id);
+            record.add_function_info(function_info);
+            if (!publish(record))
+            {
+                return 0;
+            }
+            function_ids.insert(std::make_pair(
+                function_info.get_id(), std::make_pair(function_info, id)));
+        }
+        cache.function_ids.insert(std::make_pair(function_info.get_id(), id));
+
+        return id;
+    }
+
+    // Returns the id of variable names, like `get_function_id()`.
+    std::uint32_t get_names_id(const std::vector<std::string> &names)
+    {
+        StringIdCache &cache = StringIdCache::get(number);
+        std::unordered_map<const void*, StringIdCache::Names>::const_iterator cached =
+            cache.names_ids.find(&names);
+
+        if (cached != cache.names_ids.end() && cached->second.names == names)
+        {
+            return cached->second.id;
+        }
+
+        std::lock_guard<std::mutex> lock(string_ids_mutex);
+        std::map<std::vector<std::string>, std::uint32_t>::const_iterator found =
+            names_ids.find(names);
+        std::uint32_t id;
+
+        if (found != names_ids.end())
+        {
+            id = found->second;
+        }
+        else
+        {
+            id = get_next_string_id();
+            if (id == 0)
+            {
+                return 0;
+            }
+
+            RecordBuilder &record = RecordBuilder::get();
+
+            record.begin(SharedMemoryRing::record_define_names, 0);
+            record.add_id(id);
+            record.add_strings(names);
+            if (!publish(record))
+            {
+                return 0;
+            }
+            names_ids.insert(std::make_pair(names, id));
+        }
+        cache.names_ids[&names] = StringIdCache::Names { names, id };
+
+        return id;
+    }
+
+    std::uint32_t get_next_string_id()
+    {
+        return ring.is_mapped() ?
+            ring.get_header().last_string_id.fetch_add(1, std::memory_order_relaxed) + 1 : 0;
+    }
+
+    void add_values(
+        RecordBuilder &record, ValueFormatterI *const *values, std::size_t value_count)
+    {
+        for (std::size_t value_i = 0; value_i < value_count; ++value_i)
+        {
+            if (values[value_i]->capture(record))
+            {
+                record.end_value();
+                continue;
+            }
+
+            // Format the value right away:
+            MessageStreamPool::Slot &slot = MessageStreamPool::get().acquire();
+
+            NumberFormat::set(slot.stream, get_number_format());
+            values[value_i]->write_text(slot.stream);
+            record.add_text_value(slot.buffer.view());
+            MessageStreamPool::get().release(slot);
+        }
+    }
+
+    // Copies a record to the ring, after the thread's pending exit records,
+    // or counts it as overrun, if they don't fit.
+    bool publish(RecordBuilder &record)
+    {
+        if (!ring.is_mapped())
+        {
+            return false;
+        }
+        if (!publish_pending_exits(ThreadFrames::get(number)) ||
+            !publish(record.data(), record.size))
+        {
+            count_overrun(record.size);
+
+            return false;
+        }
+
+        return true;
+    }
+
+    // Sends the exit record of the innermost function entered on the thread,
+    // if its entry record (`sent_flag`) was sent, or keeps it pending, if it
+    // doesn't fit.  Otherwise, the exit record is dropped, and counted as
+    // overrun, too.  `is_frame_exited` pops the function.
+    void publish_exit(RecordBuilder &record, unsigned char sent_flag, bool is_frame_exited)
+    {
+        if (!ring.is_mapped())
+        {
+            return;
+        }
+
+        ThreadFrames &frames = ThreadFrames::get(number);
+        bool is_entry_sent = frames.is_entry_sent(sent_flag);
+
+        if (is_frame_exited && !frames.frames.empty())
+        {
+            frames.frames.pop_back();
+        }
+        if (!is_entry_sent)
+        {
+            count_overrun(record.size);
+        }
+        else if (!publish_pending_exits(frames) || !publish(record.data(), record.size))
+        {
+            frames.pending_exits.emplace_back(record.data(), record.data() + record.size);
+        }
+    }
+
+    // Returns whether the thread has no pending exit records left.
+    bool publish_pending_exits(ThreadFrames &frames)
+    {
+        if (frames.pending_exits.empty())
+        {
+            return true;
+        }
+
+        std::size_t sent_c = 0;
+
+        while (sent_c < frames.pending_exits.size() &&
+            publish(frames.pending_exits[sent_c].data(), frames.pending_exits[sent_c].size()))
+        {
+            ++sent_c;
+        }
+        frames.pending_exits.erase(
+            frames.pending_exits.begin(), frames.pending_exits.begin() + sent_c);
+
+        return frames.pending_exits.empty();
+    }
+
+    // Copies a record to the ring, if it fits.
+    bool publish(const char *data, std::size_t size)
+    {
+        SharedMemoryRing::Header &header = ring.get_header();
+        std::uint64_t capacity = ring.get_capacity();
+        std::uint64_t position = header.reserve_position.load(std::memory_order_relaxed);
+        std::uint64_t padding_size;
+
+        do
+        {
+            std::uint64_t space_to_end = capacity - (position & (capacity - 1));
+
+            padding_size = space_to_end < size ? space_to_end : 0;
+            if (size > capacity / 2 ||
+                position + padding_size + size -
+                    header.read_position.load(std::memory_order_acquire) > capacity)
+            {
+                return false;
+            }
+        }
+        while (!header.reserve_position.compare_exchange_weak(
+            position, position + padding_size + size, std::memory_order_relaxed));
+
+        if (padding_size > 0)
+        {
+            commit(position, padding_size, SharedMemoryRing::record_padding);
+            position += padding_size;
+        }
+
+        char *dest = ring.at(position);
+
+        // Copy everything but the size, which commits the record:
+        std::memcpy(
+            dest + sizeof(std::uint32_t), data + sizeof(std::uint32_t),
+            size - sizeof(std::uint32_t));
+        reinterpret_cast<SharedMemoryRing::RecordHeader*>(dest)->size.store(
+            static_cast<std::uint32_t>(size), std::memory_order_release);
+
+        return true;
+    }
+
+    void count_overrun(std::uint64_t size)
+    {
+        SharedMemoryRing::Header &header = ring.get_header();
+
+        header.overrun_record_c.fetch_add(1, std::memory_order_relaxed);
+        header.overrun_byte_c.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    void commit(std::uint64_t position, std::uint64_t size, SharedMemoryRing::RecordType type)
+    {
+        SharedMemoryRing::RecordHeader *header =
+            reinterpret_cast<SharedMemoryRing::RecordHeader*>(ring.at(position));
+
+        header->type = type;
+        header->value_count = 0;
+        header->size.store(static_cast<std::uint32_t>(size), std::memory_order_release);
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_SHARED_MEMORY_FORMATTER_H
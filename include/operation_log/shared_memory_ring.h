@@ -0,0 +1,330 @@
+#ifndef _OPERATION_LOG_SHARED_MEMORY_RING_H
+#define _OPERATION_LOG_SHARED_MEMORY_RING_H
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+
+namespace operation_log
+{
+
+// A ring buffer of log records in POSIX shared memory (`shm_open()`), which a
+// process logs to (see `SharedMemoryFormatter`), and a collector process
+// drains (see `SharedMemoryCollector`, and `tools/operation_log_collector`).
+//
+// The shared memory object starts with a page with the `Header`, which is
+// followed by `capacity` bytes of records.  Producer threads reserve space
+// for a record by advancing the reserve position with a compare-and-swap,
+// copy the record, and commit it by storing its size last.  A record, which
+// doesn't fit in the space the collector has freed, is dropped, and counted
+// as overrun, so producers never wait for the collector.
+//
+// The collector reads the committed records in order, zeroes them, and
+// advances the read position.  Records are aligned to 8 bytes, and don't
+// wrap around the end of the buffer (a padding record fills the rest of the
+// buffer instead).  The layout only uses fixed-size types, and lock-free
+// atomics, which work across processes.
+//
+// The strings of a call site (its function's name, and argument names, or
+// the names of dumped variables) are sent once, in a definition record,
+// which gives them an id, and the events of the call site only carry the id
+// (see `SharedMemoryFormatter::set_strings_interned()`).
+class SharedMemoryRing
+{
+public:
+    static const std::uint64_t magic = 0x474f4c2d50524f4fULL;
+    static const std::uint32_t version = 2;
+    // Records, and their parts are aligned to this many bytes:
+    static const std::size_t alignment = 8;
+    static const std::size_t default_capacity = 1 << 24;
+
+    enum State : std::uint32_t
+    {
+        state_initializing,
+        state_open,
+        // The producer closed the log (and won't write to it any more):
+        state_closed
+    };
+
+    enum RecordType : std::uint16_t
+    {
+        record_padding = 1,
+        record_message,
+        record_html,
+        record_dump_values,
+        record_function_entry,
+        record_enter_function,
+        record_function_exit,
+        record_exit_function,
+        record_blob,
+        // The strings of a function, or of dumped variables, and their id:
+        record_define_function,
+        record_define_names,
+        // Events, which refer to defined strings by their id:
+        record_dump_values_by_id,
+        record_function_entry_by_id,
+        record_function_exit_by_id
+    };
+
+    // The types of values, which the collector formats with their
+    // `ValueFormatter`.  Values of other types are formatted as text by the
+    // producer (`value_text`).
+    enum ValueTag : std::uint32_t
+    {
+        value_text,
+        value_bool,
+        value_char,
+        value_signed_char,
+        value_unsigned_char,
+        value_short,
+        value_unsigned_short,
+        value_int,
+        value_unsigned_int,
+        value_long,
+        value_unsigned_long,
+        value_long_long,
+        value_unsigned_long_long,
+        value_float,
+        value_double,
+        value_long_double,
+        value_string,
+        value_c_string
+    };
+
+    struct Header
+    {
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::atomic<std::uint32_t> state;
+        std::uint64_t capacity;
+        std::atomic<std::int64_t> producer_pid;
+        // The records, and bytes, which were dropped, because they didn't
+        // fit:
+        std::atomic<std::uint64_t> overrun_record_c;
+        std::atomic<std::uint64_t> overrun_byte_c;
+        // The last id of defined strings (the processes, which share the
+        // ring, after `fork()`, share the ids):
+        std::atomic<std::uint32_t> last_string_id;
+        // The producers, and the collector write their positions on separate
+        // cache lines.  Positions grow without wrapping around:
+        alignas(64) std::atomic<std::uint64_t> reserve_position;
+        alignas(64) std::atomic<std::uint64_t> read_position;
+    };
+
+    struct RecordHeader
+    {
+        // 0 until the record is committed:
+        std::atomic<std::uint32_t> size;
+        std::uint16_t type;
+        std::uint16_t value_count;
+    };
+
+    struct ValueHeader
+    {
+        std::uint32_t tag;
+        std::uint32_t size;
+    };
+
+    static_assert(
+        ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+        "The shared memory ring needs lock-free atomics.");
+
+    SharedMemoryRing()
+    {}
+
+    SharedMemoryRing(const SharedMemoryRing &) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing &) = delete;
+
+    ~SharedMemoryRing()
+    {
+        unmap();
+    }
+
+    bool is_mapped() const
+    {
+        return header != nullptr;
+    }
+
+    Header& get_header()
+    {
+        return *header;
+    }
+
+    std::uint64_t get_capacity() const
+    {
+        return capacity;
+    }
+
+    char* at(std::uint64_t position)
+    {
+        return data + (position & (capacity - 1));
+    }
+
+    // Replaces the shared memory object with the name (e.g., `/my_log`) with
+    // a new ring of at least `capacity` bytes (rounded up to a power of 2).
+    bool create(const std::string &name, std::size_t min_capacity, std::string &error)
+    {
+        unmap();
+        shm_unlink(name.c_str());
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+        if (fd < 0)
+        {
+            error = "Can't create " + name + ": " + std::strerror(errno);
+
+            return false;
+        }
+
+        std::uint64_t new_capacity = 4096;
+
+        while (new_capacity < min_capacity)
+        {
+            new_capacity *= 2;
+        }
+        if (ftruncate(fd, static_cast<off_t>(get_data_offset() + new_capacity)) != 0 ||
+            !map(fd, get_data_offset() + new_capacity, error))
+        {
+            if (error.empty())
+            {
+                error = "Can't size " + name + ": " + std::strerror(errno);
+            }
+            close(fd);
+            shm_unlink(name.c_str());
+
+            return false;
+        }
+        close(fd);
+
+        // (The new object is zero filled.)
+        new (header) Header();
+        header->magic = magic;
+        header->version = version;
+        header->capacity = new_capacity;
+        header->producer_pid.store(getpid(), std::memory_order_relaxed);
+        capacity = new_capacity;
+        header->state.store(state_open, std::memory_order_release);
+
+        return true;
+    }
+
+    // Maps an existing ring.  Returns `false`, if it doesn't exist, or
+    // hasn't been initialized yet.
+    bool attach(const std::string &name, std::string &error)
+    {
+        unmap();
+
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+
+        if (fd < 0)
+        {
+            error = "Can't open " + name + ": " + std::strerror(errno);
+
+            return false;
+        }
+
+        struct stat status;
+
+        if (fstat(fd, &status) != 0 ||
+            static_cast<std::size_t>(status.st_size) <= get_data_offset() ||
+            !map(fd, static_cast<std::size_t>(status.st_size), error))
+        {
+            if (error.empty())
+            {
+                error = name + " isn't initialized yet.";
+            }
+            close(fd);
+
+            return false;
+        }
+        close(fd);
+        if (header->magic != magic || header->version != version ||
+            header->state.load(std::memory_order_acquire) == state_initializing ||
+            get_data_offset() + header->capacity != mapped_size)
+        {
+            error = name + " isn't an operation log ring (of this version).";
+            unmap();
+
+            return false;
+        }
+        capacity = header->capacity;
+
+        return true;
+    }
+
+    // Returns whether the producer process still exists.
+    bool is_producer_alive()
+    {
+        pid_t pid = static_cast<pid_t>(header->producer_pid.load(std::memory_order_relaxed));
+
+        return kill(pid, 0) == 0 || errno != ESRCH;
+    }
+
+    static bool unlink(const std::string &name)
+    {
+        return shm_unlink(name.c_str()) == 0;
+    }
+
+    static std::size_t align(std::size_t size)
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+private:
+    Header *header = nullptr;
+    char *data = nullptr;
+    std::size_t mapped_size = 0;
+    std::uint64_t capacity = 0;
+
+    static std::size_t get_data_offset()
+    {
+        long page_size = sysconf(_SC_PAGESIZE);
+
+        return static_cast<std::size_t>(page_size) > sizeof(Header) ?
+            static_cast<std::size_t>(page_size) : align(sizeof(Header));
+    }
+
+    bool map(int fd, std::size_t size, std::string &error)
+    {
+        void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (address == MAP_FAILED)
+        {
+            error = std::string("Can't map the ring: ") + std::strerror(errno);
+
+            return false;
+        }
+        header = static_cast<Header*>(address);
+        data = static_cast<char*>(address) + get_data_offset();
+        mapped_size = size;
+
+        return true;
+    }
+
+    void unmap()
+    {
+        if (header)
+        {
+            munmap(header, mapped_size);
+            header = nullptr;
+            data = nullptr;
+            mapped_size = 0;
+            capacity = 0;
+        }
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_SHARED_MEMORY_RING_H
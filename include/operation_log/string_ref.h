@@ -0,0 +1,81 @@
+#ifndef _OPERATION_LOG_STRING_REF_H
+#define _OPERATION_LOG_STRING_REF_H
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+
+namespace operation_log
+{
+
+// A non-owning reference to a string of characters.
+//
+// It's used for passing message text to formatters without copying it into
+// an `std::string`.  (`std::string_view` isn't available in C++11.)
+class StringRef
+{
+public:
+    inline StringRef()
+    : chars(""),
+    length(0)
+    {}
+
+    inline StringRef(const char *value)
+    : chars(value),
+    length(std::strlen(value))
+    {}
+
+    inline StringRef(const char *data, std::size_t size)
+    : chars(data),
+    length(size)
+    {}
+
+    inline StringRef(const std::string &value)
+    : chars(value.data()),
+    length(value.length())
+    {}
+
+    inline const char* data() const
+    {
+        return chars;
+    }
+
+    inline std::size_t size() const
+    {
+        return length;
+    }
+
+    inline bool empty() const
+    {
+        return length == 0;
+    }
+
+    inline const char* begin() const
+    {
+        return chars;
+    }
+
+    inline const char* end() const
+    {
+        return chars + length;
+    }
+
+    inline std::string str() const
+    {
+        return std::string(chars, length);
+    }
+
+private:
+    const char *chars;
+    std::size_t length;
+};
+
+inline std::ostream& operator<<(std::ostream &out, const StringRef &value)
+{
+    return out.write(value.data(), value.size());
+}
+
+}
+
+#endif // _OPERATION_LOG_STRING_REF_H
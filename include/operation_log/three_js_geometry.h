@@ -0,0 +1,190 @@
+#ifndef _OPERATION_LOG_THREE_JS_GEOMETRY_H
+#define _OPERATION_LOG_THREE_JS_GEOMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include "base64.h"
+#include "blob.h"
+
+
+namespace operation_log
+{
+
+// Writes JavaScript code which creates three.js geometry from arrays of
+// vertices, indices, and colors.  The arrays are embedded as base64 packed
+// typed arrays, rather than as JavaScript source, so large meshes are quick
+// to write, and for the browser to load.
+//
+// The code uses the helpers in `HtmlFormatter::three_js_header_code`.  E.g.:
+//
+//     code << "var geometry = ";
+//     ThreeJsGeometry::write_buffer_geometry(code, positions, indices);
+//     code << ";" << std::endl <<
+//         "var mesh = new THREE.Mesh(geometry, material);";
+//
+// When the same, or nearly the same geometry is drawn again and again (e.g.,
+// in each iteration of an algorithm), `write_shared_buffer_geometry()` writes
+// the arrays to the log as blobs (see `Blob`), so only distinct arrays take
+// up space in it.
+class ThreeJsGeometry
+{
+    public:
+
+    // Writes an expression which evaluates to a `THREE.BufferGeometry` with:
+    //
+    // * `positions`: the x, y, and z coordinates of each vertex,
+    // * `indices`: the vertex indices of the faces (three per triangle), or
+    //   null, for a point cloud, or a non-indexed mesh,
+    // * `colors`: the red, green, and blue components (from 0 to 1) of each
+    //   vertex, or null.
+    static void write_buffer_geometry(
+        std::ostream &out, const float *positions, std::size_t vertex_count,
+        const std::uint32_t *indices = nullptr, std::size_t index_count = 0,
+        const float *colors = nullptr)
+    {
+        out << "operation_log_3js.createBufferGeometry(";
+        write_typed_array_data(out, positions, 3 * vertex_count);
+        out << ", ";
+        if (indices != nullptr)
+        {
+            write_typed_array_data(out, indices, index_count);
+        }
+        else
+        {
+            out << "null";
+        }
+        out << ", ";
+        if (colors != nullptr)
+        {
+            write_typed_array_data(out, colors, 3 * vertex_count);
+        }
+        else
+        {
+            out << "null";
+        }
+        out << ")";
+    }
+
+    // (Colors are only written, if there are as many as positions.)
+    static void write_buffer_geometry(
+        std::ostream &out, const std::vector<float> &positions,
+        const std::vector<std::uint32_t> &indices = std::vector<std::uint32_t>(),
+        const std::vector<float> &colors = std::vector<float>())
+    {
+        write_buffer_geometry(
+            out, positions.data(), positions.size() / 3,
+            indices.empty() ? nullptr : indices.data(), indices.size(),
+            colors.size() == positions.size() && !colors.empty() ?
+                colors.data() : nullptr);
+    }
+
+    // Like `write_buffer_geometry()`, but the arrays are written to `log` as
+    // blobs, which the expression loads.  The code must be written to the
+    // same log afterwards.
+    //
+    // If `position_series` is given, the positions are added to it, so they
+    // can be written as a delta of the previous positions in the series.
+    template <typename LogT>
+    static void write_shared_buffer_geometry(
+        std::ostream &out, LogT &log, const std::vector<float> &positions,
+        const std::vector<std::uint32_t> &indices = std::vector<std::uint32_t>(),
+        const std::vector<float> &colors = std::vector<float>(),
+        BlobSeries *position_series = nullptr)
+    {
+        out << "operation_log_3js.createBufferGeometry(";
+        write_typed_array_blob(out, log, positions.data(), positions.size(), position_series);
+        out << ", ";
+        if (!indices.empty())
+        {
+            write_typed_array_blob(out, log, indices.data(), indices.size());
+        }
+        else
+        {
+            out << "null";
+        }
+        out << ", ";
+        if (colors.size() == positions.size() && !colors.empty())
+        {
+            write_typed_array_blob(out, log, colors.data(), colors.size());
+        }
+        else
+        {
+            out << "null";
+        }
+        out << ")";
+    }
+
+    // Writes the values to `log` as a blob of their bytes in little endian
+    // order, and an expression which loads it (as a `Uint8Array`).
+    template <typename LogT, typename T>
+    static void write_typed_array_blob(
+        std::ostream &out, LogT &log, const T *values, std::size_t count,
+        BlobSeries *series = nullptr)
+    {
+        static_assert(sizeof(T) == 4, "Typed array elements must be 4 bytes.");
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        std::vector<std::uint32_t> swapped(count);
+
+        std::memcpy(swapped.data(), values, 4 * count);
+        for (std::uint32_t &value : swapped)
+        {
+            value = __builtin_bswap32(value);
+        }
+
+        const void *bytes = swapped.data();
+#else
+        const void *bytes = values;
+#endif
+        Blob blob = series ? series->add(bytes, 4 * count) : Blob(bytes, 4 * count);
+
+        log.write_blob(blob);
+        out << "operation_log_3js.getBlob(\"" << blob.id << "\")";
+    }
+
+    // Writes a quoted base64 string of the values' bytes, in little endian
+    // order, which `Float32Array`, and `Uint32Array` read on the platforms
+    // browsers run on.
+    template <typename T>
+    static void write_typed_array_data(std::ostream &out, const T *values, std::size_t count)
+    {
+        static_assert(sizeof(T) == 4, "Typed array elements must be 4 bytes.");
+
+        out << '"';
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        // Swap the bytes in blocks, which are a multiple of 3 bytes long, so
+        // there's no padding between them:
+        const std::size_t block_value_c = 3 * 256;
+        unsigned char block[4 * block_value_c];
+
+        for (std::size_t value_i = 0; value_i < count; value_i += block_value_c)
+        {
+            std::size_t value_c =
+                count - value_i < block_value_c ? count - value_i : block_value_c;
+
+            for (std::size_t block_value_i = 0; block_value_i < value_c; ++block_value_i)
+            {
+                unsigned char bytes[4];
+
+                std::memcpy(bytes, &values[value_i + block_value_i], 4);
+                for (int byte_i = 0; byte_i < 4; ++byte_i)
+                {
+                    block[4 * block_value_i + byte_i] = bytes[3 - byte_i];
+                }
+            }
+            Base64::write(out, block, 4 * value_c);
+        }
+#else
+        Base64::write(out, values, count * sizeof(T));
+#endif
+        out << '"';
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_THREE_JS_GEOMETRY_H
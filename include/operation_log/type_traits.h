@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 
@@ -49,6 +50,21 @@ class HasOstreamRShift
     static constexpr bool value = has_trait_type::value;
 };
 
+// A predicate class to tell whether values of the given type `T` can be
+// captured by copying their bytes, and formatted later (see
+// `DeferredFormatter`).
+//
+// It's true for arithmetic, and enumeration types.  You can specialize it for
+// your own trivially copyable types, if they don't refer to other objects:
+//
+//     template <>
+//     struct IsTriviallyCapturable<Point_3> : public std::true_type {};
+template <typename T>
+struct IsTriviallyCapturable
+: public std::integral_constant<
+    bool, std::is_arithmetic<T>::value || std::is_enum<T>::value>
+{};
+
 }
 
 #endif // _OPERATION_LOG_TYPE_TRAITS_H
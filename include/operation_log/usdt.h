@@ -0,0 +1,224 @@
+#ifndef _OPERATION_LOG_USDT_H
+#define _OPERATION_LOG_USDT_H
+
+// User-space statically defined tracing (USDT) probes at the call sites of
+// the operation log macros, which system tracers (`bpftrace`, `perf`,
+// SystemTap, BCC) can attach to without restarting the program, whether the
+// call sites log, or not.
+//
+// They're compiled in, when `OPERATION_LOG_USDT` is defined globally (e.g.,
+// with the `operationlog_usdt` CMake target).  Like `<sys/sdt.h>`, each probe
+// is a `nop` instruction, which is described by a note in the
+// `.note.stapsdt` section of the binary, so there's no run-time library.
+// Each probe has a semaphore, which tracers increment while they're
+// attached, and the probe's arguments (and the logged values) are only
+// evaluated then, so an unattached probe costs a load, and a branch.
+//
+// The probes of the `operation_log` provider are:
+//
+// * `function_entry`: `OPERATION_LOG_ENTER_FUNCTION()`, and
+//   `OPERATION_LOG_ENTER_NO_ARG_FUNCTION()`,
+// * `function_exit`: the exit from a function entered by them,
+// * `message`: `OPERATION_LOG_MESSAGE()`, `OPERATION_LOG_MESSAGE_STREAM()`,
+//   and the streams of `OPERATION_LOG_MESSAGE_STREAM_OPEN()` (when they're
+//   closed),
+// * `dump_vars`: `OPERATION_LOG_DUMP_VARS()`, and
+//   `OPERATION_LOG_ACCUMULATE_VARS()` (each time it's reached, with the
+//   variables' values, rather than their statistics).
+//
+// (The leveled variants of the macros have the same probes.)  All of them
+// have the same arguments:
+//
+// * `arg0`: the `operation_log::CallSite`,
+// * `arg1`: the source file name,
+// * `arg2`: the source line,
+// * `arg3`: the function's `__PRETTY_FUNCTION__`,
+// * `arg4`: the stringified logged argument, or variable names (e.g.,
+//   `"a, b"`),
+// * `arg5`: the number of values (the message's size for `message`),
+// * `arg6`: an array of pointers to the values (the message's characters for
+//   `message`), e.g., an `int` argument's pointer points to the `int`, and a
+//   `std::string` argument's pointer to the `std::string`.
+//
+// For example:
+//
+//     bpftrace -e 'usdt:./server:operation_log:message { printf("%s\n", str(arg6, arg5)); }'
+//
+// The probes are only defined for ELF binaries on x86-64, x86, and AArch64.
+// Elsewhere, they're compiled out.
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "call_site.h"
+
+
+#if defined(OPERATION_LOG_USDT) && defined(__ELF__) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+#    define OPERATION_LOG_USDT_PROBES 1
+#else
+#    define OPERATION_LOG_USDT_PROBES 0
+#endif
+
+
+#if OPERATION_LOG_USDT_PROBES
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#    define OPERATION_LOG_USDT_ASM_ADDRESS ".8byte"
+#else
+#    define OPERATION_LOG_USDT_ASM_ADDRESS ".4byte"
+#endif
+
+// The semaphores of the probes, which tracers find through the probes' notes.
+// (They're weak, so each binary has one of each, and hidden, so each shared
+// library has its own.)
+#define OPERATION_LOG_USDT_SEMAPHORE(probe) operation_log_usdt_##probe##_semaphore
+
+#define OPERATION_LOG_USDT_DEFINE_SEMAPHORE(probe) \
+        __attribute__((weak, used, visibility("hidden"), section(".probes"))) \
+        volatile unsigned short OPERATION_LOG_USDT_SEMAPHORE(probe) = 0;
+
+extern "C"
+{
+OPERATION_LOG_USDT_DEFINE_SEMAPHORE(function_entry)
+OPERATION_LOG_USDT_DEFINE_SEMAPHORE(function_exit)
+OPERATION_LOG_USDT_DEFINE_SEMAPHORE(message)
+OPERATION_LOG_USDT_DEFINE_SEMAPHORE(dump_vars)
+}
+
+// Returns whether a tracer is attached to the probe.
+#define OPERATION_LOG_USDT_IS_ATTACHED(probe) \
+        __builtin_expect(OPERATION_LOG_USDT_SEMAPHORE(probe) != 0, 0)
+
+// An argument's description is its size, negative for signed types, and its
+// location (e.g., `8@%rdi`, or `-4@$12`).  (The `n` operand modifier writes
+// the size constant negated, without a `$` prefix.)
+#define OPERATION_LOG_USDT_ARG(i) "%n[size" #i "]@%[arg" #i "]"
+
+#define OPERATION_LOG_USDT_ARG_OPERAND(i, expression) \
+        [size##i] "n" ( \
+            (std::is_signed<typename std::decay<decltype(expression)>::type>::value ? 1 : -1) * \
+            static_cast<int>(sizeof(expression))), \
+        [arg##i] "nor" (expression)
+
+// Defines a probe with 7 arguments at this point of the code (the layout of
+// the note is the one of `<sys/sdt.h>`, version 3).  The memory clobber keeps
+// the values, which the arguments point to, in memory, when the probe fires.
+#define OPERATION_LOG_USDT_PROBE(probe, a0, a1, a2, a3, a4, a5, a6) \
+        __asm__ __volatile__ ( \
+            "990: nop\n" \
+            ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+            ".balign 4\n" \
+            ".4byte 992f-991f, 994f-993f, 3\n" \
+            "991: .asciz \"stapsdt\"\n" \
+            "992: .balign 4\n" \
+            "993: " OPERATION_LOG_USDT_ASM_ADDRESS " 990b\n" \
+            OPERATION_LOG_USDT_ASM_ADDRESS " _.stapsdt.base\n" \
+            OPERATION_LOG_USDT_ASM_ADDRESS " operation_log_usdt_" #probe "_semaphore\n" \
+            ".asciz \"operation_log\"\n" \
+            ".asciz \"" #probe "\"\n" \
+            ".asciz \"" \
+                OPERATION_LOG_USDT_ARG(0) " " OPERATION_LOG_USDT_ARG(1) " " \
+                OPERATION_LOG_USDT_ARG(2) " " OPERATION_LOG_USDT_ARG(3) " " \
+                OPERATION_LOG_USDT_ARG(4) " " OPERATION_LOG_USDT_ARG(5) " " \
+                OPERATION_LOG_USDT_ARG(6) "\"\n" \
+            "994: .balign 4\n" \
+            ".popsection\n" \
+            ".ifndef _.stapsdt.base\n" \
+            ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+            ".weak _.stapsdt.base\n" \
+            ".hidden _.stapsdt.base\n" \
+            "_.stapsdt.base: .space 1\n" \
+            ".size _.stapsdt.base, 1\n" \
+            ".popsection\n" \
+            ".endif\n" \
+            : \
+            : OPERATION_LOG_USDT_ARG_OPERAND(0, a0), OPERATION_LOG_USDT_ARG_OPERAND(1, a1), \
+            OPERATION_LOG_USDT_ARG_OPERAND(2, a2), OPERATION_LOG_USDT_ARG_OPERAND(3, a3), \
+            OPERATION_LOG_USDT_ARG_OPERAND(4, a4), OPERATION_LOG_USDT_ARG_OPERAND(5, a5), \
+            OPERATION_LOG_USDT_ARG_OPERAND(6, a6) \
+            : "memory")
+
+#else // OPERATION_LOG_USDT_PROBES
+
+#define OPERATION_LOG_USDT_IS_ATTACHED(probe) false
+
+#endif // OPERATION_LOG_USDT_PROBES
+
+
+namespace operation_log
+{
+
+// Fires the probes (see above).  Each function checks the probe's semaphore
+// itself, so the macros only check it to avoid evaluating the logged values.
+class Usdt
+{
+public:
+    template <typename... ValueTs>
+    static void function_entry(CallSite &call_site, const ValueTs&... values)
+    {
+#if OPERATION_LOG_USDT_PROBES
+        if (OPERATION_LOG_USDT_IS_ATTACHED(function_entry))
+        {
+            const void *pointers[] = {
+                static_cast<const void*>(std::addressof(values))..., nullptr };
+
+            OPERATION_LOG_USDT_PROBE(
+                function_entry, &call_site, call_site.get_file(),
+                static_cast<long>(call_site.get_line()), call_site.get_pretty_function(),
+                call_site.get_stringified_args(), sizeof...(values),
+                static_cast<const void *const *>(pointers));
+        }
+#endif // OPERATION_LOG_USDT_PROBES
+    }
+
+    static void function_exit(CallSite &call_site)
+    {
+#if OPERATION_LOG_USDT_PROBES
+        if (OPERATION_LOG_USDT_IS_ATTACHED(function_exit))
+        {
+            OPERATION_LOG_USDT_PROBE(
+                function_exit, &call_site, call_site.get_file(),
+                static_cast<long>(call_site.get_line()), call_site.get_pretty_function(),
+                call_site.get_stringified_args(), static_cast<std::size_t>(0),
+                static_cast<const void *const *>(nullptr));
+        }
+#endif // OPERATION_LOG_USDT_PROBES
+    }
+
+    static void message(CallSite &call_site, const char *text, std::size_t size)
+    {
+#if OPERATION_LOG_USDT_PROBES
+        if (OPERATION_LOG_USDT_IS_ATTACHED(message))
+        {
+            OPERATION_LOG_USDT_PROBE(
+                message, &call_site, call_site.get_file(),
+                static_cast<long>(call_site.get_line()), call_site.get_pretty_function(),
+                call_site.get_stringified_args(), size, text);
+        }
+#endif // OPERATION_LOG_USDT_PROBES
+    }
+
+    template <typename... ValueTs>
+    static void dump_vars(CallSite &call_site, const ValueTs&... values)
+    {
+#if OPERATION_LOG_USDT_PROBES
+        if (OPERATION_LOG_USDT_IS_ATTACHED(dump_vars))
+        {
+            const void *pointers[] = {
+                static_cast<const void*>(std::addressof(values))..., nullptr };
+
+            OPERATION_LOG_USDT_PROBE(
+                dump_vars, &call_site, call_site.get_file(),
+                static_cast<long>(call_site.get_line()), call_site.get_pretty_function(),
+                call_site.get_stringified_args(), sizeof...(values),
+                static_cast<const void *const *>(pointers));
+        }
+#endif // OPERATION_LOG_USDT_PROBES
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_USDT_H
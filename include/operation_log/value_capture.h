@@ -0,0 +1,206 @@
+#ifndef _OPERATION_LOG_VALUE_CAPTURE_H
+#define _OPERATION_LOG_VALUE_CAPTURE_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "type_traits.h"
+#include "value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+template <typename T>
+class ValueFormatter;
+
+// Copies values of type `T` to bytes, and passes them back to a visitor from
+// those bytes.
+//
+// The default is for types that can't be captured.  Values of those types
+// are formatted right away.
+template <typename T, typename Enable = void>
+struct ValueCapture
+{
+    static constexpr bool is_supported = false;
+};
+
+// Types whose bytes are the whole value (see `IsTriviallyCapturable`):
+template <typename T>
+struct ValueCapture<T, typename std::enable_if<IsTriviallyCapturable<T>::value>::type>
+{
+    static constexpr bool is_supported = true;
+
+    static std::size_t get_size(const T &value)
+    {
+        return sizeof(T);
+    }
+
+    static void write(char *dest, const T &value)
+    {
+        std::memcpy(dest, &value, sizeof(T));
+    }
+
+    template <class Visitor>
+    static void visit(const char *bytes, std::size_t size, Visitor &visitor)
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        std::memcpy(&storage, bytes, sizeof(T));
+        visitor(*reinterpret_cast<const T*>(&storage));
+    }
+};
+
+template <>
+struct ValueCapture<std::string>
+{
+    static constexpr bool is_supported = true;
+
+    static std::size_t get_size(const std::string &value)
+    {
+        return value.length();
+    }
+
+    static void write(char *dest, const std::string &value)
+    {
+        std::memcpy(dest, value.data(), value.length());
+    }
+
+    template <class Visitor>
+    static void visit(const char *bytes, std::size_t size, Visitor &visitor)
+    {
+        visitor(std::string(bytes, size));
+    }
+};
+
+// C strings are captured by their characters, and formatted as
+// `const char*`s.  (A null pointer is captured as an empty string.)
+template <typename T>
+struct ValueCapture<
+    T,
+    typename std::enable_if<
+        std::is_same<typename std::decay<T>::type, char*>::value ||
+        std::is_same<typename std::decay<T>::type, const char*>::value>::type>
+{
+    static constexpr bool is_supported = true;
+
+    static std::size_t get_size(const T &value)
+    {
+        return get_pointer(value) ? std::strlen(get_pointer(value)) : 0;
+    }
+
+    static void write(char *dest, const T &value)
+    {
+        if (get_pointer(value))
+        {
+            std::memcpy(dest, get_pointer(value), std::strlen(get_pointer(value)));
+        }
+    }
+
+    template <class Visitor>
+    static void visit(const char *bytes, std::size_t size, Visitor &visitor)
+    {
+        std::string value(bytes, size);
+
+        visitor(value.c_str());
+    }
+
+    private:
+
+    static const char* get_pointer(const T &value)
+    {
+        return value;
+    }
+};
+
+// Formats captured values of type `T` with their `ValueFormatter`.
+template <typename T>
+class CapturedValueTypeOf
+{
+    public:
+
+    static const CapturedValueType type;
+
+    private:
+
+    struct TextWriter
+    {
+        std::ostream &out;
+
+        template <typename U>
+        void operator()(const U &value)
+        {
+            ValueFormatter<U> value_formatter(value);
+
+            value_formatter.write_text(out);
+        }
+    };
+
+    struct HtmlWriter
+    {
+        std::ostream &out;
+
+        template <typename U>
+        void operator()(const U &value)
+        {
+            ValueFormatter<U> value_formatter(value);
+
+            value_formatter.write_html(out);
+        }
+    };
+
+    static void write_text(const char *bytes, std::size_t size, std::ostream &out)
+    {
+        TextWriter writer { out };
+
+        ValueCapture<T>::visit(bytes, size, writer);
+    }
+
+    static void write_html(const char *bytes, std::size_t size, std::ostream &out)
+    {
+        HtmlWriter writer { out };
+
+        ValueCapture<T>::visit(bytes, size, writer);
+    }
+};
+
+template <typename T>
+const CapturedValueType CapturedValueTypeOf<T>::type = {
+    &CapturedValueTypeOf<T>::write_text,
+    &CapturedValueTypeOf<T>::write_html
+};
+
+// Captures a value with `ValueCapture<T>`, if it's supported.
+template <typename T>
+inline bool capture_value(
+    ValueCaptureSinkI &sink, const T &value, std::true_type is_supported)
+{
+    std::size_t size = ValueCapture<T>::get_size(value);
+
+    ValueCapture<T>::write(
+        sink.add_value(CapturedValueTypeOf<T>::type, size), value);
+
+    return true;
+}
+
+template <typename T>
+inline bool capture_value(
+    ValueCaptureSinkI &sink, const T &value, std::false_type is_supported)
+{
+    return false;
+}
+
+template <typename T>
+inline bool capture_value(ValueCaptureSinkI &sink, const T &value)
+{
+    return capture_value(
+        sink, value,
+        std::integral_constant<bool, ValueCapture<T>::is_supported>());
+}
+
+}
+
+#endif // _OPERATION_LOG_VALUE_CAPTURE_H
@@ -1,10 +1,15 @@
 #ifndef _OPERATION_LOG_VALUE_FORMATTER_BASE_H
 #define _OPERATION_LOG_VALUE_FORMATTER_BASE_H
 
+#include <ostream>
+#include <sstream>
 #include <string>
 
 #include "html_utils.h"
+#include "message_stream_pool.h"
+#include "number_formatter.h"
 #include "type_traits.h"
+#include "value_capture.h"
 
 #include "value_formatter_i.h"
 
@@ -13,18 +18,20 @@ namespace operation_log
 {
 
 // A base type for formatting variable values.
+//
+// The formatter keeps a reference to the value, so it must not outlive it.
 template <typename T>
 class ValueFormatterBase : public ValueFormatterI
 {
     protected:
 
-	const T value;
+	const T &value;
 	typedef typename HasToString<T>::has_trait_type ValueHasToString;
 	typedef typename HasOstreamRShift<T>::has_trait_type ValueHasOstreamRShift;
 
 	public:
 
-	ValueFormatterBase(const T value)
+	ValueFormatterBase(const T &value)
 	: value(value)
 	{}
 
@@ -40,12 +47,27 @@ class ValueFormatterBase : public ValueFormatterI
 			value, ValueHasToString(), ValueHasOstreamRShift() ));
 	}
 
+	void write_text(std::ostream &out) override
+	{
+		write(out, value, ValueHasToString(), ValueHasOstreamRShift());
+	}
+
+	void write_html(std::ostream &out) override
+	{
+		write_html(out, value, ValueHasToString(), ValueHasOstreamRShift());
+	}
+
+	bool capture(ValueCaptureSinkI &sink) override
+	{
+		return capture_value(sink, value);
+	}
+
     protected:
 
 	template <typename HasOstreamRShift>
 	std::string to_string(const T &value, std::true_type has_to_string, HasOstreamRShift)
 	{
-		return std::to_string(value);
+		return NumberFormatter::to_string(value);
 	}
 
 	std::string to_string(
@@ -59,6 +81,66 @@ class ValueFormatterBase : public ValueFormatterI
 		return res.str();
 	}
 
+	template <typename HasOstreamRShift>
+	void write(
+		std::ostream &out, const T &value, std::true_type has_to_string,
+		HasOstreamRShift)
+	{
+		NumberFormatter::write(out, value);
+	}
+
+	void write(
+		std::ostream &out, const T &value, std::false_type has_to_string,
+		std::true_type has_ostream_rshift)
+	{
+		MessageStreamPool::Slot &slot = format_in_pool(value);
+		StringRef text = slot.buffer.view();
+
+		out.write(text.data(), static_cast<std::streamsize>(text.size()));
+		MessageStreamPool::get().release(slot);
+	}
+
+	// (Numbers have no characters to escape.)
+	template <typename HasOstreamRShift>
+	void write_html(
+		std::ostream &out, const T &value, std::true_type has_to_string,
+		HasOstreamRShift)
+	{
+		NumberFormatter::write(out, value);
+	}
+
+	void write_html(
+		std::ostream &out, const T &value, std::false_type has_to_string,
+		std::true_type has_ostream_rshift)
+	{
+		MessageStreamPool::Slot &slot = format_in_pool(value);
+		StringRef text = slot.buffer.view();
+
+		HtmlUtils::write_escaped(out, text.data(), text.size());
+		MessageStreamPool::get().release(slot);
+	}
+
+	// Runs the value's `operator<<` on a pooled stream with the default
+	// formatting state, rather than on the log's stream, so the manipulators
+	// it uses don't leak into the following lines, and its text doesn't
+	// depend on what was written before.  (The caller releases the slot.)
+	static MessageStreamPool::Slot& format_in_pool(const T &value)
+	{
+		MessageStreamPool::Slot &slot = MessageStreamPool::get().acquire();
+
+		try
+		{
+			slot.stream << value;
+		}
+		catch (...)
+		{
+			MessageStreamPool::get().release(slot);
+			throw;
+		}
+
+		return slot;
+	}
+
 	// std::string to_string(
 	// 	const T &value, std::false_type has_to_string,
 	// 	std::false_type has_ostream_rshift)
@@ -66,11 +148,14 @@ class ValueFormatterBase : public ValueFormatterI
 	// 	std::cout << "No conversion to string." << std::endl;
 	// }
 };
-
 }
 
 
+#include "value_formatters/heap_scope_totals.h"
+#include "value_formatters/lock_contention_event.h"
+#include "value_formatters/perf_counter_values.h"
 #include "value_formatters/string.h"
 #include "value_formatters/tuple.h"
+#include "value_formatters/var_statistics.h"
 
 #endif // _OPERATION_LOG_VALUE_FORMATTER_BASE_H
@@ -1,18 +1,58 @@
 #ifndef _OPERATION_LOG_VALUE_FORMATTER_I_H
 #define _OPERATION_LOG_VALUE_FORMATTER_I_H
 
+#include <cstddef>
+#include <ostream>
 #include <string>
 
 
 namespace operation_log
 {
 
+// Functions that format a value from its captured bytes (see
+// `ValueFormatterI::capture()`).
+struct CapturedValueType
+{
+    void (*write_text)(const char *bytes, std::size_t size, std::ostream &out);
+    void (*write_html)(const char *bytes, std::size_t size, std::ostream &out);
+};
+
+// Receives captured values.
+class ValueCaptureSinkI
+{
+    public:
+
+    // Returns where to copy the `size` bytes of a value of the given type.
+    virtual char* add_value(const CapturedValueType &type, std::size_t size) = 0;
+};
+
 class ValueFormatterI
 {
     public:
 
     virtual std::string to_text() = 0;
     virtual std::string to_html() = 0;
+
+    // Write the formatted value directly to a stream.  Formatters can
+    // override these to avoid building a temporary `std::string`.
+    virtual void write_text(std::ostream &out)
+    {
+        out << to_text();
+    }
+
+    virtual void write_html(std::ostream &out)
+    {
+        out << to_html();
+    }
+
+    // Copies the value to the given sink, so it can be formatted later, and
+    // returns `true`, or returns `false`, if the value can't be captured
+    // safely (e.g., it refers to other objects), and should be formatted
+    // right away.
+    virtual bool capture(ValueCaptureSinkI &sink)
+    {
+        return false;
+    }
 };
 
 }
@@ -0,0 +1,80 @@
+#ifndef _OPERATION_LOG_VALUE_FORMATTERS_HEAP_SCOPE_TOTALS_H
+#define _OPERATION_LOG_VALUE_FORMATTERS_HEAP_SCOPE_TOTALS_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "../heap_accounting.h"
+#include "../number_formatter.h"
+#include "../value_capture.h"
+#include "../value_formatter_base.h"
+#include "../value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// Formats the heap allocations of a logged function call (see
+// `HeapAccounting`).
+template <>
+class ValueFormatterBase<HeapScopeTotals> : public ValueFormatterI
+{
+    public:
+
+    const HeapScopeTotals &value;
+
+    ValueFormatterBase(const HeapScopeTotals &value)
+    : value(value)
+    {}
+
+    std::string to_text() override
+    {
+        std::stringstream res;
+
+        write_text(res);
+
+        return res.str();
+    }
+
+    std::string to_html() override
+    {
+        std::stringstream res;
+
+        write_html(res);
+
+        return res.str();
+    }
+
+    void write_text(std::ostream &out) override
+    {
+        out << "inclusive: ";
+        write_totals(out, value.inclusive);
+        out << ", exclusive: ";
+        write_totals(out, value.exclusive);
+    }
+
+    void write_html(std::ostream &out) override
+    {
+        write_text(out);
+    }
+
+    bool capture(ValueCaptureSinkI &sink) override
+    {
+        return capture_value(sink, value);
+    }
+
+    private:
+
+    static void write_totals(std::ostream &out, const HeapTotals &totals)
+    {
+        NumberFormatter::write(out, totals.allocation_c);
+        out << " allocations, ";
+        NumberFormatter::write(out, totals.byte_c);
+        out << " bytes";
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_VALUE_FORMATTERS_HEAP_SCOPE_TOTALS_H
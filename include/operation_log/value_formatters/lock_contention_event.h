@@ -0,0 +1,79 @@
+#ifndef _OPERATION_LOG_VALUE_FORMATTERS_LOCK_CONTENTION_EVENT_H
+#define _OPERATION_LOG_VALUE_FORMATTERS_LOCK_CONTENTION_EVENT_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "../html_utils.h"
+#include "../lock_contention.h"
+#include "../number_formatter.h"
+#include "../value_capture.h"
+#include "../value_formatter_base.h"
+#include "../value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// Formats a wait for, or a hold of an instrumented lock (see
+// `LockContention`), e.g., `queue_mutex: lock wait 1250000 ns`.
+template <>
+class ValueFormatterBase<LockContentionEvent> : public ValueFormatterI
+{
+    public:
+
+    const LockContentionEvent &value;
+
+    ValueFormatterBase(const LockContentionEvent &value)
+    : value(value)
+    {}
+
+    std::string to_text() override
+    {
+        std::stringstream res;
+
+        write_text(res);
+
+        return res.str();
+    }
+
+    std::string to_html() override
+    {
+        std::stringstream res;
+
+        write_html(res);
+
+        return res.str();
+    }
+
+    void write_text(std::ostream &out) override
+    {
+        out << value.lock_name;
+        write_duration(out);
+    }
+
+    void write_html(std::ostream &out) override
+    {
+        HtmlUtils::write_escaped(out, value.lock_name);
+        write_duration(out);
+    }
+
+    bool capture(ValueCaptureSinkI &sink) override
+    {
+        return capture_value(sink, value);
+    }
+
+    private:
+
+    void write_duration(std::ostream &out)
+    {
+        out << ": " << LockContention::get_kind_name(value.kind) << " ";
+        NumberFormatter::write(out, value.duration_ns);
+        out << " ns";
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_VALUE_FORMATTERS_LOCK_CONTENTION_EVENT_H
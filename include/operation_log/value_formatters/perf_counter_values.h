@@ -0,0 +1,77 @@
+#ifndef _OPERATION_LOG_VALUE_FORMATTERS_PERF_COUNTER_VALUES_H
+#define _OPERATION_LOG_VALUE_FORMATTERS_PERF_COUNTER_VALUES_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "../number_formatter.h"
+#include "../perf_counters.h"
+#include "../value_capture.h"
+#include "../value_formatter_base.h"
+#include "../value_formatter_i.h"
+
+
+namespace operation_log
+{
+
+// Formats the CPU time, and hardware counters of a logged function call (see
+// `PerfCounters`).  Counters, which aren't available, are left out.
+template <>
+class ValueFormatterBase<PerfCounterValues> : public ValueFormatterI
+{
+    public:
+
+    const PerfCounterValues &value;
+
+    ValueFormatterBase(const PerfCounterValues &value)
+    : value(value)
+    {}
+
+    std::string to_text() override
+    {
+        std::stringstream res;
+
+        write_text(res);
+
+        return res.str();
+    }
+
+    std::string to_html() override
+    {
+        std::stringstream res;
+
+        write_html(res);
+
+        return res.str();
+    }
+
+    void write_text(std::ostream &out) override
+    {
+        out << "cpu time: ";
+        NumberFormatter::write(out, value.cpu_time_ns);
+        out << " ns";
+        for (int counter_i = 0; counter_i < PerfCounterValues::counter_c; ++counter_i)
+        {
+            if (value.counters[counter_i] >= 0)
+            {
+                out << ", " << PerfCounters::get_counter_name(counter_i) << ": ";
+                NumberFormatter::write(out, value.counters[counter_i]);
+            }
+        }
+    }
+
+    void write_html(std::ostream &out) override
+    {
+        write_text(out);
+    }
+
+    bool capture(ValueCaptureSinkI &sink) override
+    {
+        return capture_value(sink, value);
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_VALUE_FORMATTERS_PERF_COUNTER_VALUES_H
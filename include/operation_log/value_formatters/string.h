@@ -1,6 +1,8 @@
 #ifndef _OPERATION_LOG_VALUE_FORMATTERS_STRING_H
 #define _OPERATION_LOG_VALUE_FORMATTERS_STRING_H
 
+#include "../char_search.h"
+#include "../html_utils.h"
 #include "../value_formatter_base.h"
 #include "../value_formatter_i.h"
 
@@ -15,42 +17,102 @@ class ValueFormatterBase<std::string> : public ValueFormatterI
 {
 	public:
 
-	const std::string value;
+	const std::string &value;
 
-	ValueFormatterBase(std::string value)
+	ValueFormatterBase(const std::string &value)
 	: value(value)
 	{}
 
 	std::string to_text() override
 	{
-		std::stringstream res;
+		std::string res;
 
-		res << '"';
-		for (const auto &ch : value)
+		res.reserve(value.length() + 2);
+		write_quoted(res);
+
+		return res;
+	}
+
+	std::string to_html() override
+	{
+		std::string res;
+
+		res.reserve(value.length() + 12);
+		write_quoted_html(res);
+
+		return res;
+	}
+
+	void write_text(std::ostream &out) override
+	{
+		write_quoted(out);
+	}
+
+	void write_html(std::ostream &out) override
+	{
+		write_quoted_html(out);
+	}
+
+	bool capture(ValueCaptureSinkI &sink) override
+	{
+		return capture_value(sink, value);
+	}
+
+	private:
+
+	// Writes the value in double quotes, with `"`, and line breaks escaped
+	// by a backslash.  (The characters are written unformatted, so the
+	// stream's formatting state, e.g., its width, doesn't apply.)
+	template <typename OutT>
+	void write_quoted(OutT &out)
+	{
+		const char *run_begin = value.data();
+		const char *end = run_begin + value.length();
+
+		helpers::append(out, "\"", 1);
+		for (;;)
 		{
-			switch (ch)
+			const char *p = CharSearch::find_first_of<'"', '\r', '\n'>(run_begin, end);
+
+			helpers::append(out, run_begin, p - run_begin);
+			if (p == end)
 			{
-				case '"':
-					res << "\\\"";
-					break;
-				case '\r':
-					res << "\\\r";
-					break;
-				case '\n':
-					res << "\\\n";
-					break;
-				default:
-					res << ch;
+				break;
 			}
+			helpers::append(out, "\\", 1);
+			helpers::append(out, p, 1);
+			run_begin = p + 1;
 		}
-		res << '"';
-
-		return res.str();
+		helpers::append(out, "\"", 1);
 	}
 
-	std::string to_html() override
+	// Writes the same text as `write_quoted()`, escaped for HTML in the same
+	// pass.
+	template <typename OutT>
+	void write_quoted_html(OutT &out)
 	{
-		return HtmlUtils::escape(to_text());
+		const char *run_begin = value.data();
+		const char *end = run_begin + value.length();
+
+		helpers::append(out, "&quot;", 6);
+		for (;;)
+		{
+			const char *p = CharSearch::find_first_of<
+				'&', '"', '\'', '<', '>', '\r', '\n'>(run_begin, end);
+
+			helpers::append(out, run_begin, p - run_begin);
+			if (p == end)
+			{
+				break;
+			}
+			if (*p == '"' || *p == '\r' || *p == '\n')
+			{
+				helpers::append(out, "\\", 1);
+			}
+			HtmlUtils::write_entity(out, *p);
+			run_begin = p + 1;
+		}
+		helpers::append(out, "&quot;", 6);
 	}
 };
 
@@ -25,6 +25,16 @@ std::string format_to_html(ValueFormatterI &formatter)
     return formatter.to_html();
 }
 
+inline void write_text(ValueFormatterI &formatter, std::ostream &out)
+{
+    formatter.write_text(out);
+}
+
+inline void write_html(ValueFormatterI &formatter, std::ostream &out)
+{
+    formatter.write_html(out);
+}
+
 }
 
 // A default value formatter for the `std::tuple` data type.
@@ -33,12 +43,12 @@ class ValueFormatterBase<std::tuple<Ts...>> : public ValueFormatterI
 {
     private:
 
-    const std::tuple<Ts...> value;
+    const std::tuple<Ts...> &value;
 
     public:
 
     // Receives the value to format.
-    ValueFormatterBase(const std::tuple<Ts...> value)
+    ValueFormatterBase(const std::tuple<Ts...> &value)
     : value(value)
     {}
 
@@ -47,9 +57,7 @@ class ValueFormatterBase<std::tuple<Ts...>> : public ValueFormatterI
     {
         std::stringstream res;
 
-        res << "std::tuple( ";
-        write_elements<0, helpers::format_to_text>(res);
-        res << " )";
+        write_text(res);
 
         return res.str();
     }
@@ -59,35 +67,47 @@ class ValueFormatterBase<std::tuple<Ts...>> : public ValueFormatterI
     {
         std::stringstream res;
 
-        res << "std::tuple( ";
-        write_elements<0, helpers::format_to_html>(res);
-        res << " )";
+        write_html(res);
 
         return res.str();
     }
 
+    void write_text(std::ostream &out) override
+    {
+        out << "std::tuple( ";
+        write_elements<0, helpers::write_text>(out);
+        out << " )";
+    }
+
+    void write_html(std::ostream &out) override
+    {
+        out << "std::tuple( ";
+        write_elements<0, helpers::write_html>(out);
+        out << " )";
+    }
+
     private:
 
-    template <std::size_t VarI, std::string FormatFunctor(ValueFormatterI&)>
+    template <std::size_t VarI, void WriteFunctor(ValueFormatterI&, std::ostream&)>
     inline typename std::enable_if<VarI == sizeof...(Ts), void>::type
-    write_elements(std::stringstream &res)
+    write_elements(std::ostream &out)
     {}
 
-    template <std::size_t VarI, std::string FormatFunctor(ValueFormatterI&)>
+    template <std::size_t VarI, void WriteFunctor(ValueFormatterI&, std::ostream&)>
     inline typename std::enable_if<VarI < sizeof...(Ts), void>::type
-    write_elements(std::stringstream &res)
+    write_elements(std::ostream &out)
     {
         if (VarI > 0)
         {
-            res << ", ";
+            out << ", ";
         }
 
         ValueFormatter<typename std::tuple_element<VarI, std::tuple<Ts...>>::type>
             value_formatter(std::get<VarI>(value));
 
-        res << FormatFunctor(value_formatter);
+        WriteFunctor(value_formatter, out);
 
-        write_elements<VarI + 1, FormatFunctor>(res);
+        write_elements<VarI + 1, WriteFunctor>(out);
     }
 };
 
@@ -0,0 +1,127 @@
+#ifndef _OPERATION_LOG_VALUE_FORMATTERS_VAR_STATISTICS_H
+#define _OPERATION_LOG_VALUE_FORMATTERS_VAR_STATISTICS_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "../number_formatter.h"
+#include "../value_capture.h"
+#include "../value_formatter_base.h"
+#include "../value_formatter_i.h"
+#include "../var_statistics.h"
+
+
+namespace operation_log
+{
+
+// Formats the summary of an accumulated variable (see
+// `OPERATION_LOG_ACCUMULATE_VARS()`).  HTML logs show its series as an
+// inline SVG sparkline after the numbers.
+template <>
+class ValueFormatterBase<VarStatistics> : public ValueFormatterI
+{
+    public:
+
+    static const int sparkline_width = 120;
+    static const int sparkline_height = 20;
+
+    const VarStatistics &value;
+
+    ValueFormatterBase(const VarStatistics &value)
+    : value(value)
+    {}
+
+    std::string to_text() override
+    {
+        std::stringstream res;
+
+        write_text(res);
+
+        return res.str();
+    }
+
+    std::string to_html() override
+    {
+        std::stringstream res;
+
+        write_html(res);
+
+        return res.str();
+    }
+
+    void write_text(std::ostream &out) override
+    {
+        out << "n: ";
+        NumberFormatter::write(out, value.get_count());
+        if (value.get_count() == 0)
+        {
+            return;
+        }
+        out << ", min: ";
+        NumberFormatter::write(out, value.get_min());
+        out << ", max: ";
+        NumberFormatter::write(out, value.get_max());
+        out << ", mean: ";
+        NumberFormatter::write(out, value.get_mean());
+        out << ", variance: ";
+        NumberFormatter::write(out, value.get_variance());
+    }
+
+    void write_html(std::ostream &out) override
+    {
+        write_text(out);
+        if (value.get_point_count() > 1)
+        {
+            out << ' ';
+            write_sparkline(out);
+        }
+    }
+
+    bool capture(ValueCaptureSinkI &sink) override
+    {
+        return capture_value(sink, value);
+    }
+
+    private:
+
+    // Writes the series as a line, scaled to the minimum, and maximum.
+    void write_sparkline(std::ostream &out)
+    {
+        const int point_c = value.get_point_count();
+        const double range = value.get_max() - value.get_min();
+
+        out << "<svg class=\"operation-log-sparkline\" width=\"" << sparkline_width <<
+            "\" height=\"" << sparkline_height <<
+            "\" style=\"vertical-align: middle\"><polyline fill=\"none\" "
+            "stroke=\"currentColor\" points=\"";
+        for (int point_i = 0; point_i < point_c; ++point_i)
+        {
+            double y = range > 0 ?
+                (value.get_max() - value.get_point(point_i)) / range : 0.5;
+
+            if (point_i > 0)
+            {
+                out << ' ';
+            }
+            write_coordinate(out, static_cast<double>(sparkline_width) * point_i / (point_c - 1));
+            out << ',';
+            write_coordinate(out, 1 + (sparkline_height - 2) * y);
+        }
+        out << "\"/></svg>";
+    }
+
+    static void write_coordinate(std::ostream &out, double coordinate)
+    {
+        char buffer[NumberFormatter::get_buffer_size<double>()];
+
+        out.write(
+            buffer,
+            static_cast<std::streamsize>(NumberFormatter::format(
+                buffer, coordinate, NumberFormat(NumberFormat::fixed, 1))));
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_VALUE_FORMATTERS_VAR_STATISTICS_H
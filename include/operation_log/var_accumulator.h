@@ -0,0 +1,133 @@
+#ifndef _OPERATION_LOG_VAR_ACCUMULATOR_H
+#define _OPERATION_LOG_VAR_ACCUMULATOR_H
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "call_site.h"
+#include "value_formatter.h"
+#include "value_formatter_i.h"
+#include "var_statistics.h"
+
+
+namespace operation_log
+{
+
+namespace helpers
+{
+
+template <typename... Ts>
+struct AreArithmetic : public std::true_type {};
+
+template <typename T, typename... Ts>
+struct AreArithmetic<T, Ts...>
+: public std::integral_constant<
+    bool, std::is_arithmetic<T>::value && AreArithmetic<Ts...>::value>
+{};
+
+}
+
+// The statistics of the variables an `OPERATION_LOG_ACCUMULATE_VARS()` call
+// site accumulates, until the log writes them (see
+// `OperationLog::accumulate_vars()`).
+//
+// Each call site has a static accumulator, which only allocates memory the
+// first time it's reached.
+class VarAccumulator
+{
+public:
+    explicit VarAccumulator(CallSite &call_site)
+    : call_site(call_site)
+    {}
+
+    VarAccumulator(const VarAccumulator &) = delete;
+    VarAccumulator& operator=(const VarAccumulator &) = delete;
+
+    template <typename... VarTs>
+    void add(const VarTs&... vars)
+    {
+        static_assert(
+            helpers::AreArithmetic<VarTs...>::value,
+            "Only numeric variables can be accumulated.");
+
+        if (statistics.empty())
+        {
+            statistics.resize(sizeof...(VarTs));
+            for (const VarStatistics &var_statistics : statistics)
+            {
+                value_formatters.emplace_back(var_statistics);
+            }
+            for (ValueFormatter<VarStatistics> &value_formatter : value_formatters)
+            {
+                values.push_back(&value_formatter);
+            }
+        }
+        add_values(0, vars...);
+    }
+
+    // Returns the depth of the call stack the statistics are accumulated at,
+    // or -1, if there are none.
+    int get_depth() const
+    {
+        return depth;
+    }
+
+    void set_depth(int value)
+    {
+        depth = value;
+    }
+
+    CallSite& get_call_site()
+    {
+        return call_site;
+    }
+
+    const std::vector<std::string>& get_names()
+    {
+        return call_site.get_function_info().get_argument_names();
+    }
+
+    // Returns formatters of the variables' statistics for
+    // `FormatterBase::dump_values()`.
+    ValueFormatterI *const * get_values() const
+    {
+        return values.data();
+    }
+
+    std::size_t get_value_count() const
+    {
+        return values.size();
+    }
+
+    void reset()
+    {
+        for (VarStatistics &var_statistics : statistics)
+        {
+            var_statistics.reset();
+        }
+        depth = -1;
+    }
+
+private:
+    CallSite &call_site;
+    int depth = -1;
+    std::vector<VarStatistics> statistics;
+    std::vector<ValueFormatter<VarStatistics>> value_formatters;
+    std::vector<ValueFormatterI*> values;
+
+    void add_values(std::size_t var_i)
+    {}
+
+    template <typename VarT, typename... VarTs>
+    void add_values(std::size_t var_i, const VarT &var, const VarTs&... vars)
+    {
+        statistics[var_i].add(static_cast<double>(var));
+        add_values(var_i + 1, vars...);
+    }
+};
+
+}
+
+#endif // _OPERATION_LOG_VAR_ACCUMULATOR_H
@@ -0,0 +1,124 @@
+#ifndef _OPERATION_LOG_VAR_STATISTICS_H
+#define _OPERATION_LOG_VAR_STATISTICS_H
+
+#include <type_traits>
+
+#include "type_traits.h"
+
+
+namespace operation_log
+{
+
+// A summary of the values a numeric variable took (see
+// `OPERATION_LOG_ACCUMULATE_VARS()`): their count, minimum, maximum, mean,
+// and variance, and a series of up to `max_point_c` points for drawing them.
+//
+// It takes the same space, however many values are added.  The mean, and
+// variance are updated with Welford's method.  When the series is full,
+// adjacent points are merged, so each point is the mean of twice as many
+// values as before.
+class VarStatistics
+{
+public:
+    static const int max_point_c = 64;
+
+    void add(double value)
+    {
+        ++count;
+        if (count == 1 || value < min)
+        {
+            min = value;
+        }
+        if (count == 1 || value > max)
+        {
+            max = value;
+        }
+
+        double delta = value - mean;
+
+        mean += delta / count;
+        squared_deviation_sum += delta * (value - mean);
+
+        bucket_sum += value;
+        if (++bucket_value_c == values_per_point)
+        {
+            points[point_c++] = bucket_sum / values_per_point;
+            bucket_sum = 0;
+            bucket_value_c = 0;
+            if (point_c == max_point_c)
+            {
+                for (int point_i = 0; point_i < max_point_c / 2; ++point_i)
+                {
+                    points[point_i] = (points[2 * point_i] + points[2 * point_i + 1]) / 2;
+                }
+                point_c = max_point_c / 2;
+                values_per_point *= 2;
+            }
+        }
+    }
+
+    void reset()
+    {
+        *this = VarStatistics();
+    }
+
+    long long get_count() const
+    {
+        return count;
+    }
+
+    double get_min() const
+    {
+        return min;
+    }
+
+    double get_max() const
+    {
+        return max;
+    }
+
+    double get_mean() const
+    {
+        return mean;
+    }
+
+    // Returns the sample variance (or 0 for fewer than 2 values).
+    double get_variance() const
+    {
+        return count > 1 ? squared_deviation_sum / (count - 1) : 0;
+    }
+
+    // Returns the number of points in the series, including the mean of the
+    // values which don't fill a whole point yet.
+    int get_point_count() const
+    {
+        return point_c + (bucket_value_c > 0 ? 1 : 0);
+    }
+
+    double get_point(int point_i) const
+    {
+        return point_i < point_c ? points[point_i] : bucket_sum / bucket_value_c;
+    }
+
+private:
+    long long count = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double squared_deviation_sum = 0;
+    double points[max_point_c] = {};
+    int point_c = 0;
+    // The values in each point, and in the point being filled:
+    long long values_per_point = 1;
+    long long bucket_value_c = 0;
+    double bucket_sum = 0;
+};
+
+// The statistics are plain numbers, so they're formatted on the background
+// thread by `DeferredFormatter`.
+template <>
+struct IsTriviallyCapturable<VarStatistics> : public std::true_type {};
+
+}
+
+#endif // _OPERATION_LOG_VAR_STATISTICS_H
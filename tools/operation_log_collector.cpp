@@ -0,0 +1,190 @@
+// Collects the log of another process, which logs to a shared memory ring
+// with `operation_log::SharedMemoryFormatter`, and formats it.
+//
+// Usage:
+//
+//     operation_log_collector NAME [--format=text|html|html-viewer]
+//         [--output=PATH] [--keep]
+//
+// It waits for the ring called NAME (e.g., `/my_log`) to be created, and
+// writes its events to the output (by default, the standard output) until
+// the producer closes the log, or exits.  (If the producer crashes, the
+// events it logged before are still written.)  Then, it removes the ring,
+// unless `--keep` is given.  SIGINT, and SIGTERM make it write the events,
+// which are in the ring, and exit.
+//
+// It exits with 1, if it can't attach to the ring, and with 2, if events
+// were lost.
+
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <operation_log.h>
+
+
+namespace
+{
+
+std::atomic<bool> is_interrupted { false };
+
+void handle_interrupt(int signal_number)
+{
+    is_interrupted = true;
+}
+
+int usage()
+{
+    std::cerr << "Usage: operation_log_collector NAME [--format=text|html|html-viewer] "
+        "[--output=PATH] [--keep]" << std::endl;
+
+    return 1;
+}
+
+bool starts_with(const std::string &s, const std::string &prefix)
+{
+    return s.compare(0, prefix.length(), prefix) == 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string name;
+    std::string format = "text";
+    std::string output_path;
+    bool is_kept = false;
+
+    for (int arg_i = 1; arg_i < argc; ++arg_i)
+    {
+        std::string arg = argv[arg_i];
+
+        if (starts_with(arg, "--format="))
+        {
+            format = arg.substr(std::string("--format=").length());
+        }
+        else if (starts_with(arg, "--output="))
+        {
+            output_path = arg.substr(std::string("--output=").length());
+        }
+        else if (arg == "--keep")
+        {
+            is_kept = true;
+        }
+        else if (name.empty() && !starts_with(arg, "--"))
+        {
+            name = arg;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if (name.empty())
+    {
+        return usage();
+    }
+
+    std::ofstream output_file;
+
+    if (!output_path.empty())
+    {
+        output_file.open(output_path);
+        if (!output_file)
+        {
+            std::cerr << "Can't write " << output_path << std::endl;
+
+            return 1;
+        }
+    }
+
+    std::ostream &output = output_path.empty() ? std::cout : output_file;
+    std::unique_ptr<operation_log::FormatterBase> formatter;
+
+    if (format == "text")
+    {
+        formatter.reset(new operation_log::PlainTextFormatter(output));
+    }
+    else if (format == "html")
+    {
+        formatter.reset(new operation_log::HtmlFormatter(output, name));
+    }
+    else if (format == "html-viewer")
+    {
+        formatter.reset(new operation_log::HtmlViewerFormatter(output, name));
+    }
+    else
+    {
+        return usage();
+    }
+
+    signal(SIGINT, handle_interrupt);
+    signal(SIGTERM, handle_interrupt);
+
+    operation_log::SharedMemoryCollector collector(*formatter);
+    std::string error;
+
+    // Wait for the producer to create the ring:
+    while (!collector.attach(name, error))
+    {
+        if (is_interrupted)
+        {
+            std::cerr << error << std::endl;
+
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    bool is_producer_dead = false;
+
+    while (!is_interrupted && !collector.is_producer_closed())
+    {
+        if (collector.drain() > 0)
+        {
+            continue;
+        }
+        if (!collector.is_producer_alive())
+        {
+            is_producer_dead = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    collector.drain();
+
+    int exit_code = 0;
+    std::uint64_t overrun_record_c = collector.get_overrun_record_count();
+    std::uint64_t pending_byte_c = collector.get_pending_byte_count();
+
+    if (overrun_record_c > 0)
+    {
+        std::cerr << name << ": " << overrun_record_c <<
+            " events were dropped, because the ring was full." << std::endl;
+        exit_code = 2;
+    }
+    if (is_producer_dead)
+    {
+        std::cerr << name << ": the producer exited without closing the log";
+        if (pending_byte_c > 0)
+        {
+            std::cerr << ", and " << pending_byte_c << " bytes of events weren't committed";
+            exit_code = 2;
+        }
+        std::cerr << "." << std::endl;
+    }
+    // Write the formatter's footer:
+    formatter.reset();
+    if (!is_kept)
+    {
+        operation_log::SharedMemoryRing::unlink(name);
+    }
+
+    return exit_code;
+}
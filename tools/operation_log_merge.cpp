@@ -0,0 +1,161 @@
+// Merges the logs of several processes (see `operation_log::ProcessLogFile`,
+// and `operation_log::ForkHandling::enable_process_files()`) in time order.
+//
+// Usage:
+//
+//     operation_log_merge FILE... [--output=PATH] [--timestamps]
+//
+// Each line is written with its process id (`[4711] ...`), and, with
+// `--timestamps`, its time in nanoseconds.  Lines, which were written at the
+// same time, keep the order of the files.  It exits with 1, if a file can't
+// be read.
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+
+// The next line of a process's log.
+struct LogReader
+{
+    std::unique_ptr<std::ifstream> input;
+    long long time_ns = 0;
+    std::string pid;
+    std::string text;
+
+    // Reads the next line.  A line without a time gets the time of the
+    // previous one.
+    bool read()
+    {
+        std::string line;
+
+        if (!std::getline(*input, line))
+        {
+            return false;
+        }
+
+        std::size_t time_end = line.find(' ');
+        std::size_t pid_end =
+            time_end == std::string::npos ? std::string::npos : line.find(' ', time_end + 1);
+        char *parse_end = nullptr;
+        long long line_time_ns = std::strtoll(line.c_str(), &parse_end, 10);
+
+        if (pid_end == std::string::npos || parse_end != line.c_str() + time_end)
+        {
+            text = line;
+
+            return true;
+        }
+        time_ns = line_time_ns;
+        pid = line.substr(time_end + 1, pid_end - time_end - 1);
+        text = line.substr(pid_end + 1);
+
+        return true;
+    }
+};
+
+int usage()
+{
+    std::cerr << "Usage: operation_log_merge FILE... [--output=PATH] [--timestamps]" <<
+        std::endl;
+
+    return 1;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> paths;
+    std::string output_path;
+    bool are_timestamps_written = false;
+
+    for (int arg_i = 1; arg_i < argc; ++arg_i)
+    {
+        std::string arg = argv[arg_i];
+
+        if (arg.compare(0, 9, "--output=") == 0)
+        {
+            output_path = arg.substr(9);
+        }
+        else if (arg == "--timestamps")
+        {
+            are_timestamps_written = true;
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            return usage();
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty())
+    {
+        return usage();
+    }
+
+    std::vector<LogReader> readers(paths.size());
+    // The readers with a line, by its time, and the reader's index:
+    typedef std::pair<long long, std::size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    for (std::size_t path_i = 0; path_i < paths.size(); ++path_i)
+    {
+        readers[path_i].input.reset(new std::ifstream(paths[path_i]));
+        if (!*readers[path_i].input)
+        {
+            std::cerr << "Can't read " << paths[path_i] << std::endl;
+
+            return 1;
+        }
+        if (readers[path_i].read())
+        {
+            queue.push(QueueEntry(readers[path_i].time_ns, path_i));
+        }
+    }
+
+    std::ofstream output_file;
+
+    if (!output_path.empty())
+    {
+        output_file.open(output_path);
+        if (!output_file)
+        {
+            std::cerr << "Can't write " << output_path << std::endl;
+
+            return 1;
+        }
+    }
+
+    std::ostream &output = output_path.empty() ? std::cout : output_file;
+
+    while (!queue.empty())
+    {
+        LogReader &reader = readers[queue.top().second];
+        std::size_t reader_i = queue.top().second;
+
+        queue.pop();
+        if (are_timestamps_written)
+        {
+            output << reader.time_ns << " ";
+        }
+        output << "[" << reader.pid << "] " << reader.text << '\n';
+        if (reader.read())
+        {
+            queue.push(QueueEntry(reader.time_ns, reader_i));
+        }
+    }
+
+    return 0;
+}